@@ -27,10 +27,9 @@
 
 #include "booleanplaylist.h"
 #include "myutility.h"
-#include "highresolutiontime.h"
-#include "fdtimer.h"
-#include "rt.h"
+#include "scheduler.h"
 #include <sstream>
+#include <algorithm>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -45,101 +44,343 @@ using namespace portplayer;
 // ======================================================================
 // PRIVATE METHODS
 
-void* BooleanPlaylist::processThread(void* obj) {
+void BooleanPlaylist::compile() throw(MyException*) {
+
+    const unsigned int numStates = getNumStates();
+    if (numStates == 0)
+        throw new MyException("The playlist is empty.");
+    if (stateDurations_.size() != numStates)
+        throw new MyException("Number of duration fields is not equal to the number of states in the playlist.");
+    if (numItems_ > PLAYLIST_MAX_PACKED_ITEMS)
+        LOG(WARNING) << "Only the first " << PLAYLIST_MAX_PACKED_ITEMS << " items of the playlist are packed into the state words.";
+
+    const unsigned int numPacked = std::min(numItems_, (unsigned int)PLAYLIST_MAX_PACKED_ITEMS);
+    // durations are in frames or in ms
+    const uint64_t unit = frameLocked_ ? 1 : 1000000;
+    words_.assign(numStates, 0);
+    offsets_.assign(numStates, 0);
+
+    uint64_t offset = 0;
+    for (unsigned int i = 0; i < numStates; i++) {
+        const std::vector<bool>& state = playlist_.at(i);
+        for (unsigned int j = 0; j < numPacked && j < state.size(); j++) {
+            if (state.at(j))
+                words_.at(i) |= ((uint64_t)1 << j);
+        }
+        offsets_.at(i) = offset;
+        offset += (uint64_t)stateDurations_.at(i) * unit;
+    }
+    cycle_ = offset;
+
+    if (cycle_ == 0)
+        throw new MyException("The total duration of the playlist must be positive.");
+}
+
+// ----------------------------------------------------------------------
+
+bool BooleanPlaylist::process(void* obj) {
 
     BooleanPlaylist* playlist = reinterpret_cast<BooleanPlaylist*>(obj);
 
-    LOG(INFO) << "Promoting playlist to RT priority.";
-    promoteRT();
+    if (playlist->pause_ && !playlist->abort_) {
+        // parked until pause(false) wakes it up
+        Scheduler::getInstance()->setTaskDeadline(playlist->taskId_, SharedClock::getMonotonicTimeInNs() + 1000000000);
+        return true;
+    }
 
-    double playListBaseInMs = 0.;
-    double stateBaseInMs = 0.;
-    double pauseOffsetInMs = 0.;
+    // apply all the states whose start has passed (the next state starts
+    // when the current one should have ended so that delays don't accumulate)
+    const uint64_t tInNs = playlist->clock_->getElapsedTimeInNs();
+    const unsigned int numStates = playlist->words_.size();
+    playlist->beginProgress();
+    while (!playlist->abort_ && tInNs >= playlist->nextDeadlineInNs_) {
+        const uint64_t deadlineInNs = playlist->nextDeadlineInNs_;
+        if (playlist->currentState_ < numStates - 1)
+            playlist->next(playlist->currentState_ + 1, deadlineInNs, 0);
+        // end of the playlist ? go to state 0 or stop
+        else if (playlist->repeatPlaylist_) {
+            playlist->playlistBaseInNs_ = deadlineInNs;
+            playlist->next(0, deadlineInNs, 0);
+            playlist->notifyCycle(deadlineInNs);
+        }
+        else
+            playlist->abort_ = true;
+    }
+    playlist->endProgress();
 
-    HighResolutionTime time;
-    FdTimer timer;
-    timer.initialize(0, playlist->getUpdateIntervalInUs() * 1000);
+    if (playlist->abort_) {
+        // the interface task terminates the player
+        playlist->finish();
+        return false;
+    }
 
-    time.start();   // time is used to get the elapsed time since starting the player
-    timer.start();  // generates the timeouts to refresh the interface
-    int fd = timer.getTimer();
+    try {
+        playlist->schedule();
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to schedule the next state of the playlist: " << e->getMessage();
+        playlist->abort_ = true;
+        playlist->finish();
+        return false;
+    }
 
-    double tInMs = 0.;
-    while (!playlist->isAbort()) {
-        pthread_mutex_lock(&playlist->mutex_);
-        if (!playlist->pause_) {
-            pthread_mutex_unlock(&playlist->mutex_);
-
-            uint64_t numTimeout;
-            read(fd, &numTimeout, sizeof(numTimeout));
-//            if (numTimeout > 1)
-//                LOG(WARNING) << "Playlist timer missed " << (numTimeout - 1) << " events.";
-
-            tInMs = time.getElapsedTimeInMs() - pauseOffsetInMs;
-
-            // refresh the interface
-            emit playlist->updatePlaylistTimeInMs(tInMs - playListBaseInMs);
-            emit playlist->updateStateTimeInMs(tInMs - stateBaseInMs);
-
-            pthread_mutex_lock(&playlist->mutex_);
-            if (tInMs - stateBaseInMs > playlist->stateDurations_.at(playlist->currentState_)) {
-                // move and apply next state
-                if (playlist->currentState_ < playlist->getNumStates() - 1) {
-                    stateBaseInMs = tInMs;
-                    playlist->next(playlist->currentState_ + 1);
-//                    playlist->currentState_++;
-//                    emit playlist->stateChanged(playlist->currentState_);
-                }
-                // end of the playlist ? go to state 0 or stop
-                else if (playlist->repeatPlaylist_) {
-                    playListBaseInMs = tInMs;
-                    stateBaseInMs = tInMs;
-                    playlist->next(0);
-//                    playlist->currentState_ = 0;
-//                    emit playlist->stateChanged(playlist->currentState_);
-                }
-                else
-                    playlist->abort_ = true;
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+void BooleanPlaylist::lockToTrigger(void* obj, unsigned int triggerId, uint64_t triggerInNs, uint64_t leadInNs) {
+
+    BooleanPlaylist* playlist = reinterpret_cast<BooleanPlaylist*>(obj);
+
+    if (!playlist->running_ || !playlist->frameLocked_)
+        return;
+
+    // the trigger thread never waits for the player
+    PlaylistTrigger trigger;
+    trigger.triggerId_ = triggerId;
+    trigger.triggerInNs_ = triggerInNs;
+    trigger.leadInNs_ = leadInNs;
+    if (!playlist->triggers_.push(trigger))
+        playlist->numDroppedTriggers_++;
+    Scheduler::getInstance()->wakeTask(playlist->taskId_);
+}
+
+// ----------------------------------------------------------------------
+
+bool BooleanPlaylist::processFrames(void* obj) {
+
+    BooleanPlaylist* playlist = reinterpret_cast<BooleanPlaylist*>(obj);
+
+    PlaylistTrigger trigger;
+    playlist->beginProgress();
+    while (!playlist->abort_ && playlist->triggers_.pop(trigger))
+        playlist->moveToTrigger(trigger);
+    playlist->endProgress();
+
+    if (playlist->abort_) {
+        // the interface task terminates the player
+        playlist->finish();
+        return false;
+    }
+
+    try {
+        // parked until the next trigger wakes it up
+        Scheduler::getInstance()->setTaskDeadline(playlist->taskId_, SharedClock::getMonotonicTimeInNs() + 1000000000);
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to park the frame-locked playlist: " << e->getMessage();
+        playlist->abort_ = true;
+        playlist->finish();
+        return false;
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+void BooleanPlaylist::moveToTrigger(const PlaylistTrigger& trigger) {
+
+    // the state is due when the lead time before the trigger starts
+    const uint64_t deadlineInNs = clock_->toElapsedTimeInNs(trigger.triggerInNs_ - std::min(trigger.leadInNs_, trigger.triggerInNs_));
+    const unsigned int triggerId = trigger.triggerId_;
+    lastFrame_ = triggerId;
+
+    if (!frameStarted_) {
+        // the playlist starts at the first trigger
+        frameStarted_ = true;
+        playlistBaseFrame_ = triggerId;
+        playlistBaseInNs_ = deadlineInNs;
+        next(0, deadlineInNs, triggerId);
+        notifyCycle(deadlineInNs);
+    } else if (pause_) {
+        // the frames received during the pause don't count
+        playlistBaseFrame_++;
+        stateBaseFrame_++;
+        nextFrame_++;
+    } else {
+        const unsigned int numStates = words_.size();
+        while (!abort_ && triggerId >= nextFrame_) {
+            if (currentState_ < numStates - 1)
+                next(currentState_ + 1, deadlineInNs, triggerId);
+            // end of the playlist ? go to state 0 or stop
+            else if (repeatPlaylist_) {
+                playlistBaseFrame_ = nextFrame_;
+                playlistBaseInNs_ = deadlineInNs;
+                next(0, deadlineInNs, triggerId);
+                notifyCycle(deadlineInNs);
             }
+            else
+                abort_ = true;
         }
+    }
+}
 
-        // pause the player ?
-        while (playlist->pause_) {
-            double tInMsBkp = time.getElapsedTimeInMs();
-            if (pthread_cond_wait(&playlist->cond_, &playlist->mutex_)) // wait for resume signal
-                throw new MyException("Unable to suspend playlist: pthread_cond_wait() failed.");
-            pauseOffsetInMs += time.getElapsedTimeInMs() - tInMsBkp;
-            LOG(INFO) << "Resuming playlist after a break of " << pauseOffsetInMs/1000. << " seconds.";
-        }
+// ----------------------------------------------------------------------
+
+bool BooleanPlaylist::update(void* obj) {
+
+    BooleanPlaylist* playlist = reinterpret_cast<BooleanPlaylist*>(obj);
+
+    // read finished_ before draining the queue so that no transition is left behind
+    const bool finished = playlist->finished_;
+    __sync_synchronize();
+
+    PlaylistTransition transition;
+    while (playlist->queue_.pop(transition)) {
+        pthread_mutex_lock(&playlist->mutex_);
+        playlist->record(transition);
         pthread_mutex_unlock(&playlist->mutex_);
+        emit playlist->stateChanged(transition.stateIndex_);
     }
 
+    // the RT lane is never waited for, the progress is read again if it has moved meanwhile
+    uint64_t playlistBaseInNs = 0;
+    uint64_t stateBaseInNs = 0;
+    unsigned int playlistFrames = 0;
+    unsigned int stateFrames = 0;
+    bool frameStarted = false;
+    unsigned int sequence;
+    do {
+        sequence = playlist->progressSequence_;
+        __sync_synchronize(); // the progress must be read after the sequence
+        playlistBaseInNs = playlist->playlistBaseInNs_;
+        stateBaseInNs = playlist->stateBaseInNs_;
+        playlistFrames = playlist->lastFrame_ - playlist->playlistBaseFrame_;
+        stateFrames = playlist->lastFrame_ - playlist->stateBaseFrame_;
+        frameStarted = playlist->frameStarted_;
+        __sync_synchronize(); // the progress must be read before checking the sequence again
+    } while ((sequence & 1) || sequence != playlist->progressSequence_);
+    const bool pause = playlist->pause_;
+    const bool frames = playlist->frameLocked_;
+
+    // publish the elapsed times polled by the interface (in frames if frame-locked)
+    PlayerSnapshot* snapshot = playlist->snapshot_;
+    if (snapshot != NULL && frames) {
+        snapshot->publishTimes(frameStarted ? playlistFrames : 0, frameStarted ? stateFrames : 0);
+    } else if (snapshot != NULL && (!pause || finished)) {
+        const uint64_t tInNs = playlist->clock_->getElapsedTimeInNs();
+        snapshot->publishTimes(tInNs > playlistBaseInNs ? (tInNs - playlistBaseInNs) / 1000000 : 0,
+                               tInNs > stateBaseInNs ? (tInNs - stateBaseInNs) / 1000000 : 0);
+    }
+
+    if (!finished)
+        return true;
+
     // abortion
-    emit playlist->updatePlaylistTimeInMs(tInMs - playListBaseInMs);
-    emit playlist->updateStateTimeInMs(tInMs - stateBaseInMs);
+    if (playlist->numDroppedTriggers_ > 0)
+        LOG(WARNING) << playlist->numDroppedTriggers_ << " triggers have been lost by the frame-locked playlist.";
     emit playlist->done();
 
-    time.stop();
-    timer.stop();
+    if (playlist->clock_ == &playlist->ownClock_)
+        playlist->ownClock_.stop();
 
     pthread_mutex_lock(&playlist->mutex_);
+    playlist->taskId_ = -1;
+    playlist->updateTaskId_ = -1;
     playlist->running_ = false;
+    if (pthread_cond_broadcast(&playlist->cond_))
+        LOG(WARNING) << "Unable to signal the end of the playlist: pthread_cond_broadcast() failed.";
     pthread_mutex_unlock(&playlist->mutex_);
 
-    return NULL;
+    return false;
 }
 
 // ----------------------------------------------------------------------
 
-void BooleanPlaylist::next(const unsigned int stateIndex) {
+void BooleanPlaylist::schedule() throw(MyException*) {
+
+    // converts the deadline on the clock (which may be paused) to CLOCK_MONOTONIC
+    const uint64_t tInNs = clock_->getElapsedTimeInNs();
+    const uint64_t delayInNs = (nextDeadlineInNs_ > tInNs) ? nextDeadlineInNs_ - tInNs : 0;
+    Scheduler::getInstance()->setTaskDeadline(taskId_, SharedClock::getMonotonicTimeInNs() + delayInNs);
+}
+
+// ----------------------------------------------------------------------
+
+void BooleanPlaylist::beginProgress() {
+
+    progressSequence_++;
+    __sync_synchronize(); // the sequence must be odd before the progress is modified
+}
+
+// ----------------------------------------------------------------------
+
+void BooleanPlaylist::endProgress() {
+
+    __sync_synchronize(); // the progress must be modified before the sequence is even again
+    progressSequence_++;
+}
+
+// ----------------------------------------------------------------------
+
+void BooleanPlaylist::finish() {
+
+    __sync_synchronize(); // the transitions must be queued before the interface task sees the end
+    finished_ = true;
+}
+
+// ----------------------------------------------------------------------
+
+PlaylistTransition BooleanPlaylist::apply(const unsigned int stateIndex, const uint64_t deadlineInNs, const unsigned int frame) {
 
     currentState_ = stateIndex;
+    stateBaseInNs_ = deadlineInNs;
+    const uint64_t nextOffset = (stateIndex + 1 < words_.size()) ? offsets_.at(stateIndex + 1) : cycle_;
+    if (frameLocked_) {
+        stateBaseFrame_ = frame;
+        nextFrame_ = playlistBaseFrame_ + nextOffset;
+    } else
+        nextDeadlineInNs_ = playlistBaseInNs_ + nextOffset;
+
+    if (stateCallback_ != NULL)
+        stateCallback_(stateCallbackData_, stateIndex, words_.at(stateIndex));
+
+    PlaylistTransition transition;
+    transition.stateIndex_ = stateIndex;
+    transition.word_ = words_.at(stateIndex);
+    transition.deadlineInNs_ = deadlineInNs;
+    transition.switchedInNs_ = clock_->getElapsedTimeInNs();
+    transition.switchedMonotonicInNs_ = SharedClock::getMonotonicTimeInNs();
+    transition.frame_ = frame;
+
+    return transition;
+}
 
-//    (this->*preNextStateAction_)(stateIndex);
-    // there is no warranty that the slot(s) responding to this signal
-    // will be executed before the post action.
-    emit stateChanged(stateIndex);
-//    (this->*postNextStateAction_)(stateIndex);
+// ----------------------------------------------------------------------
+
+void BooleanPlaylist::next(const unsigned int stateIndex, const uint64_t deadlineInNs, const unsigned int frame) {
+
+    // the interface is notified by the non-RT lane
+    const PlaylistTransition transition = apply(stateIndex, deadlineInNs, frame);
+    if (!queue_.push(transition))
+        numDroppedTransitions_++;
+
+    // the state of the frames is looked up without waiting for the interface
+    if (frameLocked_)
+        frameHistory_[numFrameTransitions_++ % PLAYLIST_FRAME_HISTORY_SIZE] = transition;
+}
+
+// ----------------------------------------------------------------------
+
+void BooleanPlaylist::record(const PlaylistTransition& transition) {
+
+    const uint64_t latenessInNs = (transition.switchedInNs_ > transition.deadlineInNs_) ? transition.switchedInNs_ - transition.deadlineInNs_ : 0;
+    maxLatenessInNs_ = std::max(maxLatenessInNs_, latenessInNs);
+    totalLatenessInNs_ += latenessInNs;
+    transitions_[numTransitions_++ % PLAYLIST_TRANSITION_HISTORY_SIZE] = transition;
+}
+
+// ----------------------------------------------------------------------
+
+void BooleanPlaylist::notifyCycle(const uint64_t cycleStartInNs) {
+
+    if (cycleCallback_ == NULL)
+        return;
+
+    // converts the time of the clock to CLOCK_MONOTONIC
+    const uint64_t now = SharedClock::getMonotonicTimeInNs();
+    const uint64_t tInNs = clock_->getElapsedTimeInNs();
+    cycleCallback_(cycleCallbackData_, now - ((tInNs > cycleStartInNs) ? tInNs - cycleStartInNs : 0));
 }
 
 // ======================================================================
@@ -180,8 +421,32 @@ void BooleanPlaylist::initialize() {
     stateDurations_.push_back(1);
 
     currentState_ = 0;
-    updateIntervalInUs_ = 10000;
+    updateIntervalInUs_ = 40000;
     repeatPlaylist_ = false;
+    cycleCallback_ = NULL;
+    cycleCallbackData_ = NULL;
+    stateCallback_ = NULL;
+    stateCallbackData_ = NULL;
+    snapshot_ = NULL;
+    frameLocked_ = false;
+    frameStarted_ = false;
+    playlistBaseFrame_ = 0;
+    stateBaseFrame_ = 0;
+    nextFrame_ = 0;
+    lastFrame_ = 0;
+    numDroppedTriggers_ = 0;
+    numFrameTransitions_ = 0;
+    clock_ = &ownClock_;
+    taskId_ = -1;
+    updateTaskId_ = -1;
+    finished_ = false;
+    progressSequence_ = 0;
+    playlistBaseInNs_ = 0;
+    stateBaseInNs_ = 0;
+    numTransitions_ = 0;
+    numDroppedTransitions_ = 0;
+    maxLatenessInNs_ = 0;
+    totalLatenessInNs_ = 0;
     running_ = false;
     pause_ = false;
     abort_ = false;
@@ -298,14 +563,57 @@ void BooleanPlaylist::start() throw(MyException*) {
     if (running_)
         throw new MyException("Playlist is already running.");
 
+    compile();
+
     pthread_mutex_lock(&mutex_);
     abort_ = false;
     pause_ = false;
-
-    if (pthread_create(&thread_, 0, BooleanPlaylist::processThread, this))
-        throw new MyException("Unable to start playlist thread: pthread_create() failed.");
+    finished_ = false;
+    queue_.clear();
+    numTransitions_ = 0;
+    numDroppedTransitions_ = 0;
+    maxLatenessInNs_ = 0;
+    totalLatenessInNs_ = 0;
+
+    // the clock is used to get the elapsed time since starting the player
+    if (clock_ == &ownClock_)
+        ownClock_.start();
+    playlistBaseInNs_ = clock_->getElapsedTimeInNs();
+    stateBaseInNs_ = playlistBaseInNs_;
+    frameStarted_ = false;
+    numDroppedTriggers_ = 0;
+    numFrameTransitions_ = 0;
+    // the RT task is not registered yet, the queue has no consumer
+    PlaylistTrigger trigger;
+    while (triggers_.pop(trigger)) {}
+    if (snapshot_ != NULL)
+        snapshot_->publishTimes(0, 0);
+
+    try {
+        if (frameLocked_) {
+            // parked until the first trigger wakes it up (lockToTrigger())
+            taskId_ = Scheduler::getInstance()->addDeadlineTask(Scheduler::RT_LANE, &BooleanPlaylist::processFrames, this, SharedClock::getMonotonicTimeInNs() + 1000000000);
+        } else {
+            // the first state is applied now, the interface has already selected it
+            record(apply(0, playlistBaseInNs_, 0));
+            const uint64_t tInNs = clock_->getElapsedTimeInNs();
+            const uint64_t delayInNs = (nextDeadlineInNs_ > tInNs) ? nextDeadlineInNs_ - tInNs : 0;
+            taskId_ = Scheduler::getInstance()->addDeadlineTask(Scheduler::RT_LANE, &BooleanPlaylist::process, this, SharedClock::getMonotonicTimeInNs() + delayInNs);
+        }
+        updateTaskId_ = Scheduler::getInstance()->addTask(Scheduler::NON_RT_LANE, &BooleanPlaylist::update, this, updateIntervalInUs_);
+    } catch (MyException* e) {
+        const int taskId = taskId_;
+        taskId_ = -1;
+        pthread_mutex_unlock(&mutex_);
+        Scheduler::getInstance()->removeTask(taskId);
+        if (clock_ == &ownClock_)
+            ownClock_.stop();
+        throw e;
+    }
 
     running_ = true;
+    if (!frameLocked_)
+        notifyCycle(playlistBaseInNs_);
     pthread_mutex_unlock(&mutex_);
 }
 
@@ -318,10 +626,20 @@ void BooleanPlaylist::stop() throw(MyException*) {
 
     if (pause_)
         pause(false);
-    pause_ = false;
+
     abort_ = true;
-    pthread_join(thread_, NULL);
-    running_ = false;
+    // wake up the RT task now rather than at the start of the next state
+    Scheduler::getInstance()->wakeTask(taskId_);
+
+    // wait until the player is stopped
+    pthread_mutex_lock(&mutex_);
+    while (running_) {
+        if (pthread_cond_wait(&cond_, &mutex_)) {
+            pthread_mutex_unlock(&mutex_);
+            throw new MyException("Unable to stop playlist: pthread_cond_wait() failed.");
+        }
+    }
+    pthread_mutex_unlock(&mutex_);
 }
 
 // ----------------------------------------------------------------------
@@ -336,15 +654,125 @@ void BooleanPlaylist::pause(bool pause) throw(MyException*) {
 
     pthread_mutex_lock(&mutex_);
     pause_ = pause;
-    if (!pause) {
-        if (pthread_cond_signal(&cond_))
-            throw new MyException("Unable to resume playlist thread: pthread_cond_signal() failed.");
+    // the pause offset is kept by the clock, which may be shared with the experiment
+    clock_->pause(pause);
+    // a frame-locked playlist is moved by the triggers
+    if (!pause && !frameLocked_) {
+        LOG(INFO) << "Resuming playlist after a break of " << clock_->getPauseOffsetInNs()/1000000000. << " seconds.";
+        // the start of the next state has moved on CLOCK_MONOTONIC, the RT task reschedules itself
+        Scheduler::getInstance()->wakeTask(taskId_);
     }
     pthread_mutex_unlock(&mutex_);
 }
 
 // ----------------------------------------------------------------------
 
+void BooleanPlaylist::setClock(SharedClock* clock) throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Unable to set the clock of the playlist while it is running.");
+
+    clock_ = (clock != NULL) ? clock : &ownClock_;
+}
+
+// ----------------------------------------------------------------------
+
+void BooleanPlaylist::setCycleCallback(PlaylistCycleCallback callback, void* data) throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Unable to set the cycle callback of the playlist while it is running.");
+
+    cycleCallback_ = callback;
+    cycleCallbackData_ = data;
+}
+
+// ----------------------------------------------------------------------
+
+void BooleanPlaylist::setStateCallback(PlaylistStateCallback callback, void* data) throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Unable to set the state callback of the playlist while it is running.");
+
+    stateCallback_ = callback;
+    stateCallbackData_ = data;
+}
+
+// ----------------------------------------------------------------------
+
+void BooleanPlaylist::setFrameLocked(bool frameLocked) throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Unable to lock the playlist to the frames while it is running.");
+
+    frameLocked_ = frameLocked;
+}
+
+// ----------------------------------------------------------------------
+
+bool BooleanPlaylist::getStateAtFrame(const unsigned int frame, unsigned int& stateIndex) {
+
+    if (!frameLocked_)
+        return false;
+
+    // the history is written by the RT lane, which is never waited for: the
+    // lookup is done again if a transition has been applied meanwhile
+    bool found = false;
+    unsigned int state = 0;
+    unsigned int sequence;
+    do {
+        sequence = progressSequence_;
+        __sync_synchronize(); // the history must be read after the sequence
+        found = false;
+        // the trigger has not been received yet
+        if (frameStarted_ && frame <= lastFrame_) {
+            // walks back from the last transition applied
+            const unsigned int n = numFrameTransitions_;
+            for (unsigned int k = 0; k < n && k < PLAYLIST_FRAME_HISTORY_SIZE && !found; k++) {
+                const PlaylistTransition& transition = frameHistory_[(n - 1 - k) % PLAYLIST_FRAME_HISTORY_SIZE];
+                if (transition.frame_ <= frame) {
+                    state = transition.stateIndex_;
+                    found = true;
+                }
+            }
+        }
+        __sync_synchronize(); // the history must be read before checking the sequence again
+    } while ((sequence & 1) || sequence != progressSequence_);
+
+    if (found)
+        stateIndex = state;
+
+    return found;
+}
+
+// ----------------------------------------------------------------------
+
+std::vector<PlaylistTransition> BooleanPlaylist::getTransitions() {
+
+    pthread_mutex_lock(&mutex_);
+    // the oldest transitions have been overwritten by the ring
+    const unsigned int n = std::min(numTransitions_, (unsigned int)PLAYLIST_TRANSITION_HISTORY_SIZE);
+    std::vector<PlaylistTransition> transitions;
+    transitions.reserve(n);
+    for (unsigned int k = numTransitions_ - n; k < numTransitions_; k++)
+        transitions.push_back(transitions_[k % PLAYLIST_TRANSITION_HISTORY_SIZE]);
+    pthread_mutex_unlock(&mutex_);
+
+    return transitions;
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t BooleanPlaylist::getMeanLatenessInNs() {
+
+    pthread_mutex_lock(&mutex_);
+    const uint64_t mean = (numTransitions_ == 0) ? 0 : totalLatenessInNs_ / numTransitions_;
+    pthread_mutex_unlock(&mutex_);
+
+    return mean;
+}
+
+// ----------------------------------------------------------------------
+
 unsigned int BooleanPlaylist::getPlaylistTotalTime() {
 
     unsigned int total = 0;
@@ -375,3 +803,11 @@ bool BooleanPlaylist::isRunning() { return running_; }
 
 void BooleanPlaylist::setUpdateIntervalInUs(long updateIntervalInUs) { updateIntervalInUs_ = updateIntervalInUs; }
 long BooleanPlaylist::getUpdateIntervalInUs() { return updateIntervalInUs_; }
+
+SharedClock* BooleanPlaylist::getClock() { return clock_; }
+
+bool BooleanPlaylist::hasStateCallback() { return stateCallback_ != NULL; }
+void BooleanPlaylist::setSnapshot(PlayerSnapshot* snapshot) { snapshot_ = snapshot; }
+bool BooleanPlaylist::isFrameLocked() { return frameLocked_; }
+unsigned int BooleanPlaylist::getNumDroppedTransitions() { return numDroppedTransitions_; }
+uint64_t BooleanPlaylist::getMaxLatenessInNs() { return maxLatenessInNs_; }
@@ -29,25 +29,92 @@
 #define BOOLEANPLAYLIST_H
 
 #include "myexception.h"
+#include "sharedclock.h"
+#include "lockfreequeue.h"
+#include "playersnapshot.h"
 #include <pthread.h>
+#include <stdint.h>
 #include <vector>
 #include <QObject>
 
 //! Library to interact with the environment (valves, LEDs, robots, etc.).
 namespace portplayer {
 
+/** Size of the queue passing the transitions from the RT lane to the interface (power of two). */
+#define PLAYLIST_TRANSITION_QUEUE_SIZE 1024
+/** Number of transitions recorded by the interface task and returned by getTransitions(). */
+#define PLAYLIST_TRANSITION_HISTORY_SIZE 1024
+/** Size of the queue passing the triggers from the trigger thread to the RT lane (power of two). */
+#define PLAYLIST_TRIGGER_QUEUE_SIZE 64
+/** Number of transitions of a frame-locked playlist kept to find the state of a trigger id. */
+#define PLAYLIST_FRAME_HISTORY_SIZE 256
+/** Maximum number of items packed in the word of a state. */
+#define PLAYLIST_MAX_PACKED_ITEMS 64
+
+/** Callback executed by the player when the playlist (re)starts, with the start time in ns on CLOCK_MONOTONIC (must not block). */
+typedef void (*PlaylistCycleCallback)(void* data, uint64_t cycleStartInNs);
+/** Callback executed by the RT lane to apply a state, with its items packed in a word (bit i = item i, must not block). */
+typedef void (*PlaylistStateCallback)(void* data, unsigned int stateIndex, uint64_t word);
+
+/**
+ * \brief Describes a transition of the playlist.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct PlaylistTransition {
+    /** Index of the state applied. */
+    unsigned int stateIndex_;
+    /** Items of the state (bit i = item i). */
+    uint64_t word_;
+    /** Time in ns on the clock of the player at which the state should have started. */
+    uint64_t deadlineInNs_;
+    /** Time in ns on the clock of the player at which the state has been applied. */
+    uint64_t switchedInNs_;
+    /** Time in ns on CLOCK_MONOTONIC at which the state has been applied. */
+    uint64_t switchedMonotonicInNs_;
+    /** Trigger id at which the state starts (frame-locked playlists only, 0 otherwise). */
+    unsigned int frame_;
+};
+
+/**
+ * \brief Describes a trigger announced to a frame-locked playlist.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct PlaylistTrigger {
+    /** Id of the trigger. */
+    unsigned int triggerId_;
+    /** Time in ns on CLOCK_MONOTONIC at which the trigger is sent. */
+    uint64_t triggerInNs_;
+    /** Lead time in ns before the trigger at which the state is due. */
+    uint64_t leadInNs_;
+};
+
 /**
  * \brief Represents a playlist of different states composed of boolean items, e.g. the parallel port pins.
  *
  * A duration in minutes, seconds or milliseconds can be associated to each state/line
- * in the player list. When starting the player, a timer is executed in a dedicated pthread. If
- * rtkit is correctly setup, the thread is set with a real-time priority. At each timeout
- * of the timer, the player moves and applied the next state. It it possible to configure
- * the player to repeat again and again the playlist without interruption. A SIGNAL
- * is sent at each timeout of the timer to indicate that the effective state in the player
- * has changed.
+ * in the player list. When starting the player, the playlist is compiled into packed
+ * words and into the start time of each state, and a deadline task is registered on the
+ * RT lane of the Scheduler. If rtkit is correctly setup, this lane runs with a real-time
+ * priority. The task sleeps until the exact start of the next state, applies it through
+ * the state callback and records the time of the switch. It it possible to configure
+ * the player to repeat again and again the playlist without interruption.
+ *
+ * A periodic task of the non-RT lane publishes the elapsed times in the PlayerSnapshot
+ * polled by the interface, and sends a SIGNAL for each transition passed by the RT lane.
+ * The RT lane never takes a lock: it reads the pause and stop requests from flags, is
+ * woken up by them, and publishes its progress to the non-RT lane through a seqlock.
  *
- * @version February 26, 2012
+ * A frame-locked playlist expresses the state durations in camera frames. The trigger
+ * thread calls lockToTrigger() a lead time before each trigger, which only queues the
+ * trigger and wakes up the task of the RT lane. The task then applies the states at
+ * exact trigger ids, so that every repetition has the same alignment between the
+ * frames and the stimuli.
+ *
+ * @version March 18, 2012
  * @author Thomas Schaffter (thomas.schaff...@gmail.com)
  */
 class BooleanPlaylist : public QObject {
@@ -56,23 +123,81 @@ class BooleanPlaylist : public QObject {
 
 private:
 
-    /** Mutex for the thread. */
+    /** Mutex serializing the interface and the non-RT lane (never taken by the RT lane). */
     pthread_mutex_t mutex_;
-    /** Condition variable to pause the thread. */
+    /** Signaled when the player is stopped. */
     pthread_cond_t cond_;
-    /** Id returned by pthread_create(). */
-    pthread_t thread_;
+    /** Id of the deadline task applying the states on the RT lane. */
+    int taskId_;
+    /** Id of the periodic task refreshing the interface on the non-RT lane. */
+    int updateTaskId_;
+    /** Is true once the RT task has returned for good. */
+    volatile bool finished_;
 
     /** Is true if the player is running. */
     bool running_;
-    /** Sets to true to abort. */
-    bool abort_;
-    /** Sets to true to pause the player. */
-    bool pause_;
+    /** Sets to true to abort (read by the RT lane without lock). */
+    volatile bool abort_;
+    /** Sets to true to pause the player (read by the RT lane without lock). */
+    volatile bool pause_;
 
-    /** Interval in us between two timeouts to refresh the interface (default: 10ms). */
+    /** Interval in us between two refreshments of the interface (default: 40ms). */
     long updateIntervalInUs_;
 
+    /** Clock of the player, started with the player. */
+    SharedClock ownClock_;
+    /** Clock read by the player (ownClock_ or a clock shared with the experiment). */
+    SharedClock* clock_;
+    /** Sequence number of the progress below, odd while the RT lane moves the player. */
+    volatile unsigned int progressSequence_;
+    /** Time in ns on the clock when the playlist (re)started. */
+    volatile uint64_t playlistBaseInNs_;
+    /** Time in ns on the clock when the current state started. */
+    volatile uint64_t stateBaseInNs_;
+    /** Time in ns on the clock at which the next state starts. */
+    uint64_t nextDeadlineInNs_;
+
+    /** If true, the state durations are in frames and the states are applied by lockToTrigger(). */
+    bool frameLocked_;
+    /** Is true once the first trigger has been received by a frame-locked playlist. */
+    volatile bool frameStarted_;
+    /** Trigger id at which the playlist (re)started. */
+    volatile unsigned int playlistBaseFrame_;
+    /** Trigger id at which the current state started. */
+    volatile unsigned int stateBaseFrame_;
+    /** Trigger id at which the next state starts. */
+    unsigned int nextFrame_;
+    /** Last trigger id received. */
+    volatile unsigned int lastFrame_;
+    /** Triggers passed from the trigger thread to the RT lane. */
+    LockFreeQueue<PlaylistTrigger, PLAYLIST_TRIGGER_QUEUE_SIZE> triggers_;
+    /** Number of triggers lost because the RT lane didn't keep up (modified by the trigger thread only). */
+    volatile unsigned int numDroppedTriggers_;
+    /** Last transitions applied by a frame-locked playlist (ring buffer). */
+    PlaylistTransition frameHistory_[PLAYLIST_FRAME_HISTORY_SIZE];
+    /** Number of transitions applied by a frame-locked playlist since its start. */
+    volatile unsigned int numFrameTransitions_;
+
+    /** Items of each state packed in a word (compiled at start). */
+    std::vector<uint64_t> words_;
+    /** Start of each state relative to the start of the playlist in ns, or in frames if frame-locked (compiled at start). */
+    std::vector<uint64_t> offsets_;
+    /** Total duration of the playlist in ns, or in frames if frame-locked (compiled at start). */
+    uint64_t cycle_;
+
+    /** Transitions passed from the RT lane to the interface. */
+    LockFreeQueue<PlaylistTransition, PLAYLIST_TRANSITION_QUEUE_SIZE> queue_;
+    /** Last transitions recorded by the interface task (ring buffer). */
+    PlaylistTransition transitions_[PLAYLIST_TRANSITION_HISTORY_SIZE];
+    /** Number of transitions recorded since the start of the player. */
+    unsigned int numTransitions_;
+    /** Number of transitions lost because the queue was full. */
+    unsigned int numDroppedTransitions_;
+    /** Maximum delay in ns between the start of a state and its application. */
+    uint64_t maxLatenessInNs_;
+    /** Sum of the delays in ns between the start of the states and their application. */
+    uint64_t totalLatenessInNs_;
+
     /** The number of boolean items composing one state. */
     unsigned int numItems_;
     /** The index of the current and effective state in the playlist. */
@@ -84,6 +209,17 @@ private:
     /** If true, the playlist is played again and again. */
     bool repeatPlaylist_;
 
+    /** Callback executed when the playlist (re)starts. */
+    PlaylistCycleCallback cycleCallback_;
+    /** Data passed to the cycle callback. */
+    void* cycleCallbackData_;
+    /** Callback executed to apply a state. */
+    PlaylistStateCallback stateCallback_;
+    /** Data passed to the state callback. */
+    void* stateCallbackData_;
+    /** Status in which the elapsed times are published (NULL = not published). */
+    PlayerSnapshot* snapshot_;
+
 public:
 
     /** Constructor initialized with a given number of state/line. */
@@ -110,6 +246,42 @@ public:
     /** Returns true if the player is configured to play the playlist again and again. */
     bool repeatPlaylist();
 
+    /**
+     * Sets the clock read by the player, e.g. the experiment clock so that both
+     * share the same time and pauses. NULL to use the clock of the player.
+     * The clock must be running when the player starts.
+     */
+    void setClock(SharedClock* clock) throw(MyException*);
+    /** Returns the clock read by the player. */
+    SharedClock* getClock();
+
+    /** Sets the callback executed when the playlist (re)starts, e.g. to loop a trigger sequence in sync (NULL = none). */
+    void setCycleCallback(PlaylistCycleCallback callback, void* data) throw(MyException*);
+    /** Sets the callback applying the states from the RT lane, e.g. to the port (NULL = states are only signaled). */
+    void setStateCallback(PlaylistStateCallback callback, void* data) throw(MyException*);
+    /** Returns true if the states are applied by the state callback. */
+    bool hasStateCallback();
+    /** Sets the status in which the elapsed times are published (NULL = none). */
+    void setSnapshot(PlayerSnapshot* snapshot);
+
+    /** Sets to true to express the state durations in frames and apply the states at trigger ids. */
+    void setFrameLocked(bool frameLocked) throw(MyException*);
+    /** Returns true if the state durations are in frames. */
+    bool isFrameLocked();
+    /** Announces a trigger to a frame-locked playlist, executed by the trigger thread leadInNs before triggerInNs (doesn't block). */
+    static void lockToTrigger(void* obj, unsigned int triggerId, uint64_t triggerInNs, uint64_t leadInNs);
+    /** Gets the state of a frame-locked playlist at a trigger id without lock (returns false if unknown or no longer available). */
+    bool getStateAtFrame(const unsigned int frame, unsigned int& stateIndex);
+
+    /** Returns the last transitions recorded since the start of the player (at most PLAYLIST_TRANSITION_HISTORY_SIZE). */
+    std::vector<PlaylistTransition> getTransitions();
+    /** Returns the number of transitions lost because the interface didn't keep up. */
+    unsigned int getNumDroppedTransitions();
+    /** Returns the maximum delay in ns between the start of a state and its application. */
+    uint64_t getMaxLatenessInNs();
+    /** Returns the mean delay in ns between the start of a state and its application. */
+    uint64_t getMeanLatenessInNs();
+
 public slots:
 
     /** Loads a playlist from a single string. */
@@ -142,10 +314,6 @@ public slots:
 
 signals:
 
-    /** Sends the time in ms elapsed (or remaining) in the playlist. */
-    void updatePlaylistTimeInMs(const unsigned int tInMs);
-    /** Sends the time in ms elapsed (or remaining) in the current state. */
-    void updateStateTimeInMs(const unsigned int tInMs);
     /** Sent when the current state has changed. */
     void stateChanged(const unsigned int currentState);
     /** Sent when the playlist is done, i.e. the player is stopped. */
@@ -155,15 +323,34 @@ private:
 
     /** Initializes the playlist. */
     void initialize();
+    /** Compiles the states into packed words and start times. */
+    void compile() throw(MyException*);
 
-    /**
-     * This is the static class function that serves as a C style function pointer
-     * for the pthread_create call.
-     */
-    static void* processThread(void* obj);
+    /** Function run by the scheduler at the start of each state to move through the playlist. */
+    static bool process(void* obj);
+    /** Function run by the scheduler when woken up by lockToTrigger() to move a frame-locked playlist. */
+    static bool processFrames(void* obj);
+    /** Moves a frame-locked playlist to the given trigger (RT lane only). */
+    void moveToTrigger(const PlaylistTrigger& trigger);
+    /** Function run periodically by the scheduler to refresh the interface. */
+    static bool update(void* obj);
+    /** Moves the deadline task to the start of the next state (RT lane only). */
+    void schedule() throw(MyException*);
+    /** Begins a move of the player published to the non-RT lane (RT lane only). */
+    void beginProgress();
+    /** Ends a move of the player published to the non-RT lane (RT lane only). */
+    void endProgress();
+    /** Tells the interface task that the RT task has returned for good (RT lane only). */
+    void finish();
 
-    /** Function executed each time the playlist moves to the next state. */
-    void next(const unsigned int nextStateIndex);
+    /** Applies a state through the state callback and returns the transition (RT lane only). */
+    PlaylistTransition apply(const unsigned int stateIndex, const uint64_t deadlineInNs, const unsigned int frame);
+    /** Applies the next state and passes the transition to the interface (RT lane only). */
+    void next(const unsigned int nextStateIndex, const uint64_t deadlineInNs, const unsigned int frame);
+    /** Records a transition applied (mutex must be held). */
+    void record(const PlaylistTransition& transition);
+    /** Executes the cycle callback with the time of the clock at which the playlist (re)started. */
+    void notifyCycle(const uint64_t cycleStartInNs);
 };
 
 }
@@ -0,0 +1,307 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "gpiomanager.h"
+#include "myutility.h"
+#include <sstream>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include <glog/logging.h>
+
+using namespace portplayer;
+
+// ======================================================================
+// PRIVATE METHODS
+
+void GpioManager::requestLines() throw(MyException*) {
+
+    const unsigned int numPins = getNumPins();
+    lineMask_ = (numPins == 64) ? ~(uint64_t)0 : (((uint64_t)1 << numPins) - 1);
+    values_ = 0;
+
+    if (mock_ || numPins == 0)
+        return;
+
+    chipFd_ = open(portDevice_.c_str(), O_RDWR | O_CLOEXEC);
+    if (chipFd_ == -1)
+        throw new MyException("Could not open GPIO chip " + portDevice_ + ": " + strerror(errno) + ".");
+
+    struct gpio_v2_line_request request;
+    memset(&request, 0, sizeof(request));
+    for (unsigned int i = 0; i < numPins; i++)
+        request.offsets[i] = pins_.at(i)->getPin();
+    strncpy(request.consumer, GPIO_CONSUMER, GPIO_MAX_NAME_SIZE - 1);
+    request.num_lines = numPins;
+    request.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    // all lines start low
+    request.config.num_attrs = 1;
+    request.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+    request.config.attrs[0].attr.values = 0;
+    request.config.attrs[0].mask = lineMask_;
+
+    if (ioctl(chipFd_, GPIO_V2_GET_LINE_IOCTL, &request) == -1 || request.fd <= 0) {
+        std::string msg = "Could not request the lines of GPIO chip " + portDevice_ + ": " + strerror(errno) + ".";
+        close(chipFd_);
+        chipFd_ = -1;
+        throw new MyException(msg);
+    }
+    lineFd_ = request.fd;
+}
+
+// ----------------------------------------------------------------------
+
+void GpioManager::releaseLines() {
+
+    if (lineFd_ != -1) {
+        close(lineFd_); // the kernel keeps the last values of the lines
+        lineFd_ = -1;
+    }
+    if (chipFd_ != -1) {
+        close(chipFd_);
+        chipFd_ = -1;
+    }
+    values_ = 0;
+    lineMask_ = 0;
+}
+
+// ----------------------------------------------------------------------
+
+void GpioManager::deletePins() {
+
+    stopRemoteTask();
+    pwm_.stop();
+    if (lineFd_ != -1 || mock_)
+        setAllPinsLow();
+    releaseLines();
+    IOPinManager::deletePins();
+    stateLines_.clear();
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+GpioManager::GpioManager(QObject *parent) :
+    IOPinManager(parent),
+    chipFd_(-1),
+    lineFd_(-1),
+    mock_(false),
+    values_(0),
+    lineMask_(0),
+    eventLog_(NULL) {
+
+    pinPlaylist_ = NULL;
+}
+
+// ----------------------------------------------------------------------
+
+GpioManager::~GpioManager() {
+
+    deletePins();
+}
+
+// ----------------------------------------------------------------------
+
+void GpioManager::load(const std::string chip, const std::string pinList) throw(MyException*) {
+
+    deletePins();
+    portDevice_ = chip;
+    mock_ = (chip == GPIO_MOCK_DEVICE);
+
+    std::string buffer;
+    std::stringstream ss(pinList);
+    std::vector<std::string> tokens;
+
+    while (ss >> buffer)
+        tokens.push_back(buffer);
+
+    int n = tokens.size();
+
+    if (n%3 != 0)
+        throw new MyException("Invalid LED list format.");
+
+    n /= 3;
+
+    if (n > GPIO_V2_LINES_MAX)
+        throw new MyException("A GPIO line request is limited to " + intToIntString(GPIO_V2_LINES_MAX) + " lines.");
+
+    for (int i = 0; i < n; i++) {
+        try {
+            std::string id = tokens.at(3 * i);
+            int port = hexStringToInt(tokens.at((3 * i) + 1));
+            unsigned int line = intStringToInt(tokens.at((3 * i) + 2));
+            pins_.push_back(new GpioPin(this, id, port, line, pins_.size()));
+        } catch (MyException* e) {
+            LOG(WARNING) << "GpioManager::load(): " << e->getMessage();
+        }
+    }
+
+    try {
+        requestLines();
+    } catch (MyException* e) {
+        LOG(WARNING) << "GpioManager::load(): " << e->getMessage();
+    }
+
+    for (unsigned int i = 0; i < pins_.size(); i++)
+        pins_.at(i)->print();
+
+    delete pinPlaylist_;
+    pinPlaylist_ = new BooleanPlaylist(n);
+    // the states are written to the lines by the RT lane of the playlist
+    pinPlaylist_->setStateCallback(&IOPinManager::applyStateCallback, this);
+    pinPlaylist_->setSnapshot(&snapshot_);
+    compileStates();
+}
+
+// ----------------------------------------------------------------------
+
+std::string GpioManager::save() {
+
+    if (getNumPins() == 0)
+        return "";
+
+    std::ostringstream output;
+    IOPin* p = NULL;
+    const unsigned int numPins = getNumPins();
+
+    for (unsigned int i = 0; i < numPins; i++) {
+        p = pins_.at(i);
+        output << p->getName() << " ";
+        output << intToHexString(p->getPort()) << " ";
+        output << intToIntString(p->getPin()) << " ";
+    }
+
+    return output.str();
+}
+
+// ----------------------------------------------------------------------
+
+void GpioManager::compileStates() {
+
+    if (pinPlaylist_ == NULL)
+        return;
+
+    const unsigned int numPins = getNumPins();
+    const unsigned int numStates = pinPlaylist_->getNumStates();
+
+    stateLines_.assign(numStates, 0);
+    for (unsigned int i = 0; i < numStates; i++) {
+        const std::vector<bool>& state = pinPlaylist_->getPlaylist()->at(i);
+        for (unsigned int j = 0; j < numPins && j < state.size(); j++) {
+            if (state.at(j))
+                stateLines_.at(i) |= ((uint64_t)1 << j);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void GpioManager::writeLines(const uint64_t values, const uint64_t mask, const unsigned int stateIndex) throw(MyException*) {
+
+    const uint64_t lines = (values_ & ~mask) | (values & mask & lineMask_);
+    if (lines == values_)
+        return;
+
+    if (!mock_) {
+        if (lineFd_ == -1)
+            throw new MyException("The lines of GPIO chip " + portDevice_ + " are not requested.");
+
+        struct gpio_v2_line_values lv;
+        lv.bits = lines;
+        lv.mask = lineMask_;
+        if (ioctl(lineFd_, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv) == -1)
+            throw new MyException("Could not write GPIO lines.");
+    }
+
+    values_ = lines;
+    if (eventLog_ != NULL)
+        eventLog_->push(PortEventLog::WRITE, stateIndex, lines);
+}
+
+// ----------------------------------------------------------------------
+
+void GpioManager::setAllPinsLow() {
+
+    if (getNumPins() == 0)
+        return;
+
+    try {
+        // turns off the PWM channels so that they do not toggle the lines again
+        if (pwm_.isRunning())
+            pwm_.apply(PORT_EVENT_NO_STATE, 0);
+        writeLines(0, lineMask_);
+    } catch (MyException* e) {
+        LOG(WARNING) << "GpioManager::setAllPinsLow(): " << e->getMessage();
+    }
+
+    snapshot_.publishPins(0);
+}
+
+// ----------------------------------------------------------------------
+
+void GpioManager::applyState(const unsigned int state) throw(MyException*) {
+
+    // the states are compiled by the interface after each edit of the playlist
+    if (stateLines_.size() != pinPlaylist_->getNumStates())
+        throw new MyException("The playlist has been modified since its states were compiled.");
+
+    if (state >= stateLines_.size())
+        throw new MyException("Invalid state index " + intToIntString(state) + ".");
+
+    // the PWM generator merges the state with the levels of its lines
+    if (pwm_.isRunning()) {
+        snapshot_.publishState(state, stateLines_.at(state));
+        pwm_.apply(state, stateLines_.at(state));
+    } else {
+        writeLines(stateLines_.at(state), lineMask_, state);
+        snapshot_.publishState(state, stateLines_.at(state));
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void GpioManager::writePins(const uint64_t values, const uint64_t mask, const unsigned int stateIndex) throw(MyException*) {
+
+    writeLines(values, mask, stateIndex);
+}
+
+// ----------------------------------------------------------------------
+
+bool GpioManager::isGpioDevice(const std::string device) {
+
+    return (device == GPIO_MOCK_DEVICE || device.find("/dev/gpiochip") == 0);
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+uint64_t GpioManager::getLines() { return values_; }
+bool GpioManager::isMock() { return mock_; }
+void GpioManager::setEventLog(PortEventLog* log) { eventLog_ = log; }
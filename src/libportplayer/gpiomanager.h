@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef GPIOMANAGER_H
+#define GPIOMANAGER_H
+
+#include "iopinmanager.h"
+#include "gpiopin.h"
+#include "porteventlog.h"
+#include "myexception.h"
+#include <stdint.h>
+#include <vector>
+
+/** Device name selecting the mock GPIO chip (no hardware, writes are only cached and logged). */
+#define GPIO_MOCK_DEVICE "mock"
+/** Consumer label of the requested lines (see gpioinfo). */
+#define GPIO_CONSUMER "squid"
+
+//! Library to interact with the environment (valves, LEDs, robots, etc.).
+namespace portplayer {
+
+/**
+ * \brief Manages pins on a Linux GPIO chip through the GPIO v2 character device API.
+ *
+ * All the lines are requested as a single line set so that each state of the
+ * playlist is applied atomically with a single GPIO_V2_LINE_SET_VALUES_IOCTL.
+ * The pins are loaded from the same list as ParallelPortManager::load()
+ * ("name port line" for each pin, the port being only kept for the format).
+ *
+ * With the device GPIO_MOCK_DEVICE, no chip is opened: the writes are only
+ * cached and sent to the event log, which allows to benchmark the timing of
+ * the playlist without hardware. A gpio-sim chip can be used as a real
+ * device for the same purpose.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class GpioManager : public IOPinManager {
+
+    Q_OBJECT
+
+protected:
+
+    /** File descriptor of the GPIO chip (-1 if closed or mock). */
+    int chipFd_;
+    /** File descriptor of the request of the lines (-1 if closed or mock). */
+    int lineFd_;
+    /** Is true if no chip is opened. */
+    bool mock_;
+    /** Cached values of the lines (bit i is the i-th line of the request). */
+    volatile uint64_t values_;
+    /** Bits of the lines of the request. */
+    uint64_t lineMask_;
+
+    /** Values of the lines for each state of the playlist (bit i is the state of the i-th pin). */
+    std::vector<uint64_t> stateLines_;
+
+    /** Log of the accesses to the lines (NULL = disabled). */
+    PortEventLog* eventLog_;
+
+    /** Opens the chip and requests the lines of the pins as outputs set low. */
+    void requestLines() throw(MyException*);
+    /** Releases the lines and closes the chip. */
+    void releaseLines();
+    /** Releases the lines and deletes the pins. */
+    virtual void deletePins();
+
+public:
+
+    /** Constructor. */
+    GpioManager(QObject *parent = 0);
+    /** Destructor. */
+    ~GpioManager();
+
+    /** Loads the pins from the given list and requests their lines on the chip. */
+    virtual void load(const std::string chip, const std::string pins) throw(MyException*);
+
+    /** Precomputes the values of the lines for each state of the playlist (GUI thread only). */
+    virtual void compileStates();
+
+    /** Writes the bits of values selected by mask to the lines using a single ioctl. */
+    void writeLines(const uint64_t values, const uint64_t mask, const unsigned int stateIndex = PORT_EVENT_NO_STATE) throw(MyException*);
+    /** Returns the cached values of the lines. */
+    uint64_t getLines();
+    /** Returns true if no chip is opened. */
+    bool isMock();
+
+    /** Sets the log of the accesses to the lines (NULL to disable). */
+    virtual void setEventLog(PortEventLog* log);
+    /** Writes the pins selected by mask with a single write to the lines. */
+    virtual void writePins(const uint64_t values, const uint64_t mask, const unsigned int stateIndex) throw(MyException*);
+
+    /** Returns true if the device is a GPIO chip (/dev/gpiochipN) or the mock chip. */
+    static bool isGpioDevice(const std::string device);
+
+public slots:
+
+    /** Returns a string describing the settings of the pins. */
+    virtual std::string save();
+    /** Turns off all pins with a single write to the lines. */
+    virtual void setAllPinsLow();
+    /** Applies the specified state with a single write to the lines. */
+    virtual void applyState(const unsigned int state) throw(MyException*);
+};
+
+}
+
+#endif // GPIOMANAGER_H
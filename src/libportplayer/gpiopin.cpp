@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "gpiopin.h"
+#include "gpiomanager.h"
+#include <glog/logging.h>
+
+using namespace portplayer;
+
+// ======================================================================
+// PUBLIC METHODS
+
+GpioPin::GpioPin(GpioManager* manager, const std::string name, const int port, const unsigned int pin, const unsigned int lineIndex, QObject *parent) :
+    IOPin(name, port, pin, parent),
+    manager_(manager),
+    lineIndex_(lineIndex)
+{}
+
+// ----------------------------------------------------------------------
+
+void GpioPin::setLow() {
+
+    try {
+        manager_->writeLines(0, (uint64_t)1 << lineIndex_);
+        emit stateChanged(false);
+
+    } catch (MyException* e) {
+        LOG(WARNING) << e->getMessage();
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void GpioPin::setHigh() {
+
+    try {
+        manager_->writeLines(~(uint64_t)0, (uint64_t)1 << lineIndex_);
+        emit stateChanged(true);
+
+    } catch (MyException* e) {
+        LOG(WARNING) << e->getMessage();
+    }
+}
+
+// ----------------------------------------------------------------------
+
+bool GpioPin::isLow() throw(MyException*) {
+
+    return (!((manager_->getLines() >> lineIndex_) & 1));
+}
+
+// ----------------------------------------------------------------------
+
+bool GpioPin::isHigh() throw(MyException*) {
+
+    return ((manager_->getLines() >> lineIndex_) & 1);
+}
+
+// ----------------------------------------------------------------------
+
+void GpioPin::print() {
+
+    LOG(INFO) << "GPIO pin: name = " << name_ << ", device = " << manager_->getPortDevice() << ", line = " << pin_ << ", state = " << getState();
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+unsigned int GpioPin::getLineIndex() { return lineIndex_; }
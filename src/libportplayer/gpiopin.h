@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef GPIOPIN_H
+#define GPIOPIN_H
+
+#include "iopin.h"
+
+//! Library to interact with the environment (valves, LEDs, robots, etc.).
+namespace portplayer {
+
+class GpioManager;
+
+/**
+ * \brief Represents a line of a GPIO chip (/dev/gpiochipN).
+ *
+ * The index of the pin is the offset of the line on the chip. The lines are
+ * requested all together by the GpioManager which writes them.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class GpioPin : public IOPin {
+
+    Q_OBJECT
+
+protected:
+
+    /** Manager owning the request of the lines. */
+    GpioManager* manager_;
+    /** Index of the line in the request of the manager. */
+    unsigned int lineIndex_;
+
+public:
+
+    /** Constructor takes the manager, the name of the pin, the address of the port, the line offset and its index in the request. */
+    GpioPin(GpioManager* manager, const std::string name, const int port, const unsigned int pin, const unsigned int lineIndex, QObject *parent = 0);
+    /** Destructor. */
+    virtual ~GpioPin() {}
+
+    /** Returns true if the state of the pin is low. */
+    virtual bool isLow() throw(MyException*);
+    /** Returns true if the state of the pin is high. */
+    virtual bool isHigh() throw(MyException*);
+
+    /** Returns the index of the line in the request of the manager. */
+    unsigned int getLineIndex();
+
+public slots:
+
+    /** Sets pin to low state. */
+    virtual void setLow();
+    /** Sets pin to high state. */
+    virtual void setHigh();
+    /** Prints the description of the pin (name, port, index and state). */
+    virtual void print();
+};
+
+}
+
+#endif // GPIOPIN_H
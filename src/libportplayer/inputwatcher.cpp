@@ -0,0 +1,337 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "inputwatcher.h"
+#include "parallelportdevice.h"
+#include "myutility.h"
+#include "rt.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <linux/ppdev.h>
+#include <linux/parport.h>
+#include <linux/gpio.h>
+#include <glog/logging.h>
+
+using namespace portplayer;
+
+// ======================================================================
+// PRIVATE METHODS
+
+void InputWatcher::openParallelPort() throw(MyException*) {
+
+    // the port can only be claimed once, the pins and the watcher share it: the
+    // watcher holds a reference so that the port stays open until closeSource()
+    port_ = ParallelPortDevice::acquire(device_);
+    fd_ = port_->getFd();
+
+    if (ioctl(fd_, PPRCONTROL, &control_))
+        throw new MyException("Could not read the control register of the parallel port.");
+
+    // the interrupt stays enabled after each IRQ
+    unsigned char control = control_ | INPUT_PARPORT_IRQ_ENABLE;
+    int numIrqs = 0;
+    if (ioctl(fd_, PPWCONTROL, &control) || ioctl(fd_, PPWCTLONIRQ, &control) || ioctl(fd_, PPCLRIRQ, &numIrqs))
+        throw new MyException("Could not enable the interrupt of the parallel port.");
+}
+
+// ----------------------------------------------------------------------
+
+void InputWatcher::openGpioLine() throw(MyException*) {
+
+    deviceFd_ = open(device_.c_str(), O_RDWR | O_CLOEXEC);
+    if (deviceFd_ == -1)
+        throw new MyException("Could not open GPIO chip " + device_ + ": " + strerror(errno) + ".");
+
+    struct gpio_v2_line_request request;
+    memset(&request, 0, sizeof(request));
+    request.offsets[0] = line_;
+    strncpy(request.consumer, "squid-input", GPIO_MAX_NAME_SIZE - 1);
+    request.num_lines = 1;
+    // the kernel timestamps the edges with CLOCK_MONOTONIC
+    request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING;
+
+    if (ioctl(deviceFd_, GPIO_V2_GET_LINE_IOCTL, &request) == -1 || request.fd <= 0) {
+        std::string msg = "Could not request the input line of GPIO chip " + device_ + ": " + strerror(errno) + ".";
+        close(deviceFd_);
+        deviceFd_ = -1;
+        throw new MyException(msg);
+    }
+    fd_ = request.fd;
+}
+
+// ----------------------------------------------------------------------
+
+void InputWatcher::closeSource() {
+
+    if (source_ == PARALLEL_PORT) {
+        if (fd_ != -1) {
+            ioctl(fd_, PPWCTLONIRQ, &control_);
+            ioctl(fd_, PPWCONTROL, &control_);
+        }
+        // closed if no pin uses it
+        ParallelPortDevice::release(port_);
+        port_ = NULL;
+    } else {
+        if (fd_ != -1)
+            close(fd_);
+        if (deviceFd_ != -1)
+            close(deviceFd_);
+    }
+    fd_ = -1;
+    deviceFd_ = -1;
+}
+
+// ----------------------------------------------------------------------
+
+bool InputWatcher::readEdges(const uint64_t wakeupInNs, InputEvent& event) {
+
+    event.numEdges_ = 0;
+    event.edgeInNs_ = wakeupInNs;
+
+    if (source_ == PARALLEL_PORT) {
+        int numIrqs = 0;
+        if (ioctl(fd_, PPCLRIRQ, &numIrqs) || numIrqs <= 0)
+            return false;
+        event.numEdges_ = numIrqs;
+        return true;
+    }
+
+    // several edges may be pending, the first one gives the time of the event
+    struct gpio_v2_line_event edges[16];
+    ssize_t n = read(fd_, edges, sizeof(edges));
+    if (n < (ssize_t)sizeof(struct gpio_v2_line_event))
+        return false;
+    event.numEdges_ = n / sizeof(struct gpio_v2_line_event);
+    event.edgeInNs_ = edges[0].timestamp_ns;
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+void InputWatcher::dispatch(InputEvent& event) {
+
+    event.index_ = numEvents_;
+    event.timeInNs_ = (clock_ != NULL) ? clock_->toElapsedTimeInNs(event.edgeInNs_) : event.edgeInNs_;
+
+    for (unsigned int i = 0; i < numCallbacks_; i++)
+        callbacks_[i](callbackData_[i], event);
+
+    const uint64_t now = SharedClock::getMonotonicTimeInNs();
+    const uint64_t latency = (now > event.edgeInNs_) ? now - event.edgeInNs_ : 0;
+    lastLatencyInNs_ = latency;
+    if (latency > maxLatencyInNs_)
+        maxLatencyInNs_ = latency;
+    totalLatencyInNs_ += latency;
+    numMergedEdges_ += event.numEdges_ - 1;
+    numEvents_++;
+
+    if (eventLog_ != NULL)
+        eventLog_->push(PortEventLog::INPUT, PORT_EVENT_NO_STATE, event.numEdges_);
+}
+
+// ----------------------------------------------------------------------
+
+void* InputWatcher::processThread(void* obj) {
+
+    InputWatcher* watcher = reinterpret_cast<InputWatcher*>(obj);
+
+    LOG(INFO) << "Promoting input watcher to RT priority.";
+    promoteRT();
+
+    struct pollfd fds[2];
+    fds[0].fd = watcher->fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = watcher->stopFd_;
+    fds[1].events = POLLIN;
+
+    InputEvent event;
+    while (!watcher->abort_) {
+        if (poll(fds, 2, -1) < 0)
+            continue; // interrupted
+        const uint64_t wakeup = SharedClock::getMonotonicTimeInNs();
+        if (fds[1].revents & POLLIN)
+            break;
+        if ((fds[0].revents & POLLIN) && watcher->readEdges(wakeup, event)) {
+            event.wakeupInNs_ = wakeup;
+            watcher->dispatch(event);
+        }
+    }
+
+    return NULL;
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+InputWatcher::InputWatcher(QObject* parent) :
+    QObject(parent),
+    line_(0),
+    source_(PARALLEL_PORT),
+    fd_(-1),
+    deviceFd_(-1),
+    port_(NULL),
+    control_(0),
+    stopFd_(-1),
+    running_(false),
+    abort_(false),
+    clock_(NULL),
+    numCallbacks_(0),
+    eventLog_(NULL),
+    numEvents_(0),
+    numMergedEdges_(0),
+    lastLatencyInNs_(0),
+    maxLatencyInNs_(0),
+    totalLatencyInNs_(0)
+{}
+
+// ----------------------------------------------------------------------
+
+InputWatcher::~InputWatcher() {
+
+    try {
+        stop();
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to stop input watcher: " << e->getMessage();
+        delete e;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void InputWatcher::start(const std::string device, const unsigned int line) throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Input watcher is already running.");
+
+    device_ = device;
+    line_ = line;
+    source_ = (device.find("/dev/gpiochip") == 0) ? GPIO_LINE : PARALLEL_PORT;
+
+    numEvents_ = 0;
+    numMergedEdges_ = 0;
+    lastLatencyInNs_ = 0;
+    maxLatencyInNs_ = 0;
+    totalLatencyInNs_ = 0;
+
+    try {
+        if (source_ == GPIO_LINE)
+            openGpioLine();
+        else
+            openParallelPort();
+    } catch (MyException* e) {
+        closeSource();
+        throw e;
+    }
+
+    if ((stopFd_ = eventfd(0, 0)) < 0) {
+        closeSource();
+        throw new MyException("Unable to start input watcher: eventfd() failed.");
+    }
+
+    abort_ = false;
+    if (pthread_create(&thread_, 0, InputWatcher::processThread, this)) {
+        close(stopFd_);
+        stopFd_ = -1;
+        closeSource();
+        throw new MyException("Unable to start input watcher thread: pthread_create() failed.");
+    }
+    running_ = true;
+
+    LOG(INFO) << "Watching external input on " << device_ << (source_ == GPIO_LINE ? " line " + intToIntString(line_) : " (ACK)") << ".";
+}
+
+// ----------------------------------------------------------------------
+
+void InputWatcher::stop() throw(MyException*) {
+
+    if (!running_)
+        return;
+
+    abort_ = true;
+    uint64_t one = 1;
+    write(stopFd_, &one, sizeof(one));
+    pthread_join(thread_, NULL);
+    close(stopFd_);
+    stopFd_ = -1;
+    closeSource();
+    running_ = false;
+
+    if (numEvents_ > 0)
+        LOG(INFO) << "Input watcher: " << numEvents_ << " events (" << numMergedEdges_ << " merged edges), latency mean " << getMeanLatencyInNs() / 1000 << " us, max " << maxLatencyInNs_ / 1000 << " us.";
+}
+
+// ----------------------------------------------------------------------
+
+void InputWatcher::addCallback(InputEventCallback callback, void* data) throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Unable to add input callback: Input watcher is running.");
+    if (numCallbacks_ >= INPUT_MAX_CALLBACKS)
+        throw new MyException("Unable to add input callback: Too many callbacks.");
+
+    callbacks_[numCallbacks_] = callback;
+    callbackData_[numCallbacks_] = data;
+    numCallbacks_++;
+}
+
+// ----------------------------------------------------------------------
+
+void InputWatcher::clearCallbacks() throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Unable to remove input callbacks: Input watcher is running.");
+
+    numCallbacks_ = 0;
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t InputWatcher::getMeanLatencyInNs() {
+
+    if (numEvents_ == 0)
+        return 0;
+
+    return totalLatencyInNs_ / numEvents_;
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+void InputWatcher::setClock(SharedClock* clock) { clock_ = clock; }
+void InputWatcher::setEventLog(PortEventLog* log) { eventLog_ = log; }
+
+bool InputWatcher::isRunning() { return running_; }
+InputWatcher::source InputWatcher::getSource() { return source_; }
+unsigned int InputWatcher::getNumEvents() { return numEvents_; }
+unsigned int InputWatcher::getNumMergedEdges() { return numMergedEdges_; }
+uint64_t InputWatcher::getLastLatencyInNs() { return lastLatencyInNs_; }
+uint64_t InputWatcher::getMaxLatencyInNs() { return maxLatencyInNs_; }
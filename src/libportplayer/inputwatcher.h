@@ -0,0 +1,206 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef INPUTWATCHER_H
+#define INPUTWATCHER_H
+
+#include "myexception.h"
+#include "sharedclock.h"
+#include "porteventlog.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <QObject>
+
+/** Maximum number of callbacks executed for each input event. */
+#define INPUT_MAX_CALLBACKS 4
+/** IRQ enable bit of the control register of the parallel port (interrupt on ACK, pin 10). */
+#define INPUT_PARPORT_IRQ_ENABLE 0x10
+
+//! Library to interact with the environment (valves, LEDs, robots, etc.).
+namespace portplayer {
+
+class ParallelPortDevice;
+
+/**
+ * \brief Edge received on an input line.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct InputEvent {
+    /** Index of the event since the watcher started (0 for the first). */
+    unsigned int index_;
+    /** Number of edges merged in this event (more than 1 if edges came faster than they were handled). */
+    unsigned int numEdges_;
+    /** Time of the edge in ns on CLOCK_MONOTONIC (kernel timestamp for GPIO, wakeup time for the parallel port). */
+    uint64_t edgeInNs_;
+    /** Time of the edge in ns on the clock of the watcher (e.g. experiment time of the frames). */
+    uint64_t timeInNs_;
+    /** Time in ns on CLOCK_MONOTONIC when the watcher thread woke up. */
+    uint64_t wakeupInNs_;
+};
+
+/** Callback executed by the watcher thread for each input event (must be RT-safe). */
+typedef void (*InputEventCallback)(void* data, const InputEvent& event);
+
+/**
+ * \brief Waits for edges on an external input and dispatches them.
+ *
+ * A RT thread blocks in poll() on the interrupt of the parallel port (ACK
+ * pin, enabled with the control register and kept enabled with PPWCTLONIRQ,
+ * acknowledged with PPCLRIRQ) or on the edge events of a GPIO line requested
+ * through the GPIO v2 API. Each edge is timestamped with CLOCK_MONOTONIC and
+ * with the clock of the watcher, then passed to the registered callbacks
+ * from the watcher thread itself: stepping the player, requesting a burst
+ * of triggers or starting to save frames never waits for the interface.
+ *
+ * The latency from the edge to the end of the callbacks is measured for
+ * each event. The interface is not notified: the states applied by the
+ * callbacks are published by the manager in its PlayerSnapshot.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class InputWatcher : public QObject {
+
+    Q_OBJECT
+
+public:
+
+    /** Sources of edges. */
+    enum source {
+        PARALLEL_PORT = 0,  // interrupt of the ACK pin (/dev/parportN)
+        GPIO_LINE           // rising edges of a GPIO line (/dev/gpiochipN)
+    };
+
+private:
+
+    /** Device watched. */
+    std::string device_;
+    /** Offset of the GPIO line watched. */
+    unsigned int line_;
+    /** Source of the edges. */
+    source source_;
+    /** File descriptor polled for the edges. */
+    int fd_;
+    /** File descriptor of the GPIO chip opened by the watcher (-1 if none). */
+    int deviceFd_;
+    /** Parallel port acquired by the watcher (shared with the pins, NULL if none). */
+    ParallelPortDevice* port_;
+    /** Control register of the parallel port before enabling the interrupt. */
+    unsigned char control_;
+    /** Wakes up the thread to stop it. */
+    int stopFd_;
+
+    /** Thread waiting for the edges. */
+    pthread_t thread_;
+    /** Is true while the thread runs. */
+    volatile bool running_;
+    /** Set to true to stop the thread. */
+    volatile bool abort_;
+
+    /** Clock giving the time of the events (NULL = CLOCK_MONOTONIC). */
+    SharedClock* clock_;
+    /** Callbacks executed for each event. */
+    InputEventCallback callbacks_[INPUT_MAX_CALLBACKS];
+    /** Data passed to the callbacks. */
+    void* callbackData_[INPUT_MAX_CALLBACKS];
+    /** Number of callbacks. */
+    unsigned int numCallbacks_;
+    /** Log of the accesses to the port (NULL = disabled). */
+    PortEventLog* eventLog_;
+
+    /** Number of events dispatched. */
+    volatile unsigned int numEvents_;
+    /** Number of edges merged with another one. */
+    volatile unsigned int numMergedEdges_;
+    /** Latency in ns from the edge to the end of the callbacks of the last event. */
+    volatile uint64_t lastLatencyInNs_;
+    /** Maximum latency in ns from the edge to the end of the callbacks. */
+    volatile uint64_t maxLatencyInNs_;
+    /** Sum of the latencies in ns (for the mean). */
+    volatile uint64_t totalLatencyInNs_;
+
+    /** Acquires the parallel port (shared with the pins) and enables its interrupt. */
+    void openParallelPort() throw(MyException*);
+    /** Requests the GPIO line as an input with rising edge detection. */
+    void openGpioLine() throw(MyException*);
+    /** Disables the interrupt and releases the parallel port, or releases the line. */
+    void closeSource();
+
+    /** Reads the pending edges, returns false if there is none. */
+    bool readEdges(const uint64_t wakeupInNs, InputEvent& event);
+    /** Executes the callbacks and measures the latency. */
+    void dispatch(InputEvent& event);
+
+    /**
+     * This is the static class function that serves as a C style function pointer
+     * for the pthread_create call.
+     */
+    static void* processThread(void* obj);
+
+public:
+
+    /** Constructor. */
+    InputWatcher(QObject* parent = 0);
+    /** Destructor. */
+    ~InputWatcher();
+
+    /** Starts watching the device (the line is only used for GPIO chips). */
+    void start(const std::string device, const unsigned int line) throw(MyException*);
+    /** Stops watching. */
+    void stop() throw(MyException*);
+
+    /** Adds a callback executed for each event (the watcher must be stopped). */
+    void addCallback(InputEventCallback callback, void* data) throw(MyException*);
+    /** Removes all the callbacks (the watcher must be stopped). */
+    void clearCallbacks() throw(MyException*);
+
+    /** Sets the clock giving the time of the events (NULL = CLOCK_MONOTONIC). */
+    void setClock(SharedClock* clock);
+    /** Sets the log of the accesses to the port (NULL to disable). */
+    void setEventLog(PortEventLog* log);
+
+    /** Returns true while the watcher runs. */
+    bool isRunning();
+    /** Returns the source of the edges. */
+    source getSource();
+    /** Returns the number of events dispatched. */
+    unsigned int getNumEvents();
+    /** Returns the number of edges merged with another one. */
+    unsigned int getNumMergedEdges();
+    /** Returns the latency in ns from the edge to the end of the callbacks of the last event. */
+    uint64_t getLastLatencyInNs();
+    /** Returns the maximum latency in ns from the edge to the end of the callbacks. */
+    uint64_t getMaxLatencyInNs();
+    /** Returns the mean latency in ns from the edge to the end of the callbacks. */
+    uint64_t getMeanLatencyInNs();
+};
+
+}
+
+#endif // INPUTWATCHER_H
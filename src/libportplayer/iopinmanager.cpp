@@ -26,12 +26,79 @@
  */
 
 #include "iopinmanager.h"
+#include "parallelportmanager.h"
+#include "gpiomanager.h"
 #include "myutility.h"
+#include "scheduler.h"
+#include "sharedclock.h"
 #include <sstream>
+#include <algorithm>
 #include <glog/logging.h>
 
 using namespace portplayer;
 
+// ======================================================================
+// PRIVATE METHODS
+
+void IOPinManager::startPwm() {
+
+    if (pwm_.getNumChannels() == 0)
+        return;
+
+    try {
+        pwm_.start();
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to start PWM generator: " << e->getMessage();
+        delete e;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void IOPinManager::stopRemoteTask() {
+
+    if (remoteTaskId_ == -1)
+        return;
+
+    const int taskId = remoteTaskId_;
+    remoteTaskId_ = -1;
+    try {
+        Scheduler::getInstance()->removeTask(taskId);
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to remove the remote task: " << e->getMessage();
+        delete e;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+bool IOPinManager::processRemote(void* obj) {
+
+    IOPinManager* manager = reinterpret_cast<IOPinManager*>(obj);
+
+    // the edges received meanwhile are merged, the last one gives the state
+    const unsigned int numEdges = manager->remoteStep_;
+    if (numEdges != manager->remoteApplied_) {
+        manager->remoteApplied_ = numEdges;
+        try {
+            manager->applyState((numEdges - 1) % manager->remoteNumStates_);
+        } catch (MyException* e) {
+            LOG(WARNING) << "Unable to apply remote state: " << e->getMessage();
+        }
+    }
+
+    // parked until the next edge wakes it up
+    try {
+        Scheduler::getInstance()->setTaskDeadline(manager->remoteTaskId_, SharedClock::getMonotonicTimeInNs() + 1000000000);
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to park the remote task: " << e->getMessage();
+        delete e;
+        return false;
+    }
+
+    return true;
+}
+
 // ======================================================================
 // PUBLIC METHODS
 
@@ -39,6 +106,11 @@ IOPinManager::IOPinManager(QObject *parent) : QObject(parent) {
 
     portDevice_ = "/dev/parport0";
     mode_ = EDITION;
+    remoteStep_ = 0;
+    remoteApplied_ = 0;
+    remoteNumStates_ = 0;
+    remoteTaskId_ = -1;
+    pwm_.setWriteCallback(&IOPinManager::pwmWriteCallback, this);
 }
 
 // ----------------------------------------------------------------------
@@ -54,6 +126,10 @@ IOPinManager::~IOPinManager() {
 
 void IOPinManager::deletePins() {
 
+    stopRemoteTask();
+    pwm_.stop();
+    pwm_.clearChannels();
+
     const unsigned int numPins = pins_.size();
     IOPin* pin = NULL;
     for (unsigned int i = 0; i < numPins; i++) {
@@ -66,6 +142,142 @@ void IOPinManager::deletePins() {
 
 // ----------------------------------------------------------------------
 
+void IOPinManager::applyStateCallback(void* data, unsigned int stateIndex, uint64_t /*word*/) {
+
+    IOPinManager* manager = reinterpret_cast<IOPinManager*>(data);
+    try {
+        manager->applyState(stateIndex);
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to apply state " << stateIndex << ": " << e->getMessage();
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void IOPinManager::pwmWriteCallback(void* data, uint64_t values, uint64_t mask, unsigned int stateIndex) {
+
+    IOPinManager* manager = reinterpret_cast<IOPinManager*>(data);
+    try {
+        manager->writePins(values, mask, stateIndex);
+        manager->snapshot_.publishPins(values); // the generator writes all the pins
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to write PWM pins: " << e->getMessage();
+        delete e;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void IOPinManager::remoteStateCallback(void* data, const InputEvent& /*event*/) {
+
+    IOPinManager* manager = reinterpret_cast<IOPinManager*>(data);
+    if (manager->mode_ != REMOTE || manager->remoteTaskId_ == -1)
+        return;
+
+    // the n-th edge since entering REMOTE mode applies the n-th state of the
+    // playlist, written by the RT lane like the states of the playlist
+    __sync_fetch_and_add(&manager->remoteStep_, 1);
+    Scheduler::getInstance()->wakeTask(manager->remoteTaskId_);
+}
+
+// ----------------------------------------------------------------------
+
+IOPinManager* IOPinManager::create(const std::string portDevice) {
+
+    if (GpioManager::isGpioDevice(portDevice))
+        return new GpioManager();
+
+    return new ParallelPortManager();
+}
+
+// ----------------------------------------------------------------------
+
+bool IOPinManager::matchesDevice(const std::string portDevice) {
+
+    return GpioManager::isGpioDevice(portDevice) == (dynamic_cast<GpioManager*>(this) != NULL);
+}
+
+// ----------------------------------------------------------------------
+
+void IOPinManager::writePins(const uint64_t values, const uint64_t mask, const unsigned int /*stateIndex*/) throw(MyException*) {
+
+    for (unsigned int i = 0; i < getNumPins() && i < 64; i++) {
+        if (mask & (1ULL << i))
+            pins_.at(i)->setState((values & (1ULL << i)) != 0);
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void IOPinManager::loadPwm(const std::string channels, const std::string duties) throw(MyException*) {
+
+    pwm_.stop();
+    pwm_.clearChannels();
+
+    std::vector<std::string> tokens = getTokensSeparatedBySpace(channels);
+    if (tokens.size() % 2 != 0)
+        throw new MyException("Invalid PWM channel list format.");
+
+    const std::vector<std::string> names = getPinNames();
+    for (unsigned int i = 0; i < tokens.size(); i += 2) {
+        const unsigned int pin = std::find(names.begin(), names.end(), tokens.at(i)) - names.begin();
+        if (pin == names.size())
+            throw new MyException("Unknown PWM pin " + tokens.at(i) + ".");
+        const int period = intStringToInt(tokens.at(i + 1));
+        if (period <= 0)
+            throw new MyException("Invalid PWM period for pin " + tokens.at(i) + ".");
+        pwm_.addChannel(pin, tokens.at(i), period);
+    }
+
+    // one group of duty cycles per state, in the order of the channels
+    std::stringstream ss(duties);
+    std::string group;
+    for (unsigned int state = 0; std::getline(ss, group, ';'); state++) {
+        std::stringstream gs(group);
+        double duty = 0;
+        for (unsigned int c = 0; c < pwm_.getNumChannels() && gs >> duty; c++)
+            pwm_.setDuty(c, state, duty);
+    }
+
+    // the channels are loaded outside EDITION mode when importing settings
+    if (mode_ != EDITION)
+        startPwm();
+}
+
+// ----------------------------------------------------------------------
+
+std::string IOPinManager::savePwmChannels() {
+
+    std::ostringstream output;
+    const std::vector<PwmChannel>& channels = pwm_.getChannels();
+    for (unsigned int c = 0; c < channels.size(); c++)
+        output << channels.at(c).name_ << " " << channels.at(c).periodInNs_ / 1000 << " ";
+
+    return output.str();
+}
+
+// ----------------------------------------------------------------------
+
+std::string IOPinManager::savePwmDuties() {
+
+    const std::vector<PwmChannel>& channels = pwm_.getChannels();
+    unsigned int numStates = 0;
+    for (unsigned int c = 0; c < channels.size(); c++)
+        numStates = std::max(numStates, (unsigned int)channels.at(c).duties_.size());
+
+    std::ostringstream output;
+    for (unsigned int s = 0; s < numStates; s++) {
+        if (s > 0)
+            output << ";";
+        for (unsigned int c = 0; c < channels.size(); c++)
+            output << (c > 0 ? " " : "") << (s < channels.at(c).duties_.size() ? channels.at(c).duties_.at(s) : 100.);
+    }
+
+    return output.str();
+}
+
+// ----------------------------------------------------------------------
+
 std::vector<std::string> IOPinManager::getPinNames() {
 
     const unsigned int numPins = getNumPins();
@@ -98,17 +310,59 @@ void IOPinManager::setAllPinsLow() {
         pin = getPins().at(i);
         pin->setLow();
     }
+
+    snapshot_.publishPins(0);
 }
 
 // ----------------------------------------------------------------------
 
 void IOPinManager::applyState(const unsigned int state) throw(MyException*) {
 
-    std::vector<bool> b = pinPlaylist_->getPlaylist()->at(state);
+    const std::vector<bool>& b = pinPlaylist_->getPlaylist()->at(state);
     IOPin* pin = NULL;
+    uint64_t states = 0;
     for (unsigned int i = 0; i < getNumPins(); i++) {
         pin = dynamic_cast<IOPin*>(pins_.at(i));
         pin->setState(b.at(i));
+        if (b.at(i) && i < 64)
+            states |= ((uint64_t)1 << i);
+    }
+
+    snapshot_.publishState(state, states);
+}
+
+// ----------------------------------------------------------------------
+
+void IOPinManager::setMode(const Mode mode) {
+
+    // the remote states are no longer applied while the states are compiled
+    stopRemoteTask();
+
+    // the states are compiled and the generator started before the new mode can apply them
+    if (mode != EDITION) {
+        compileStates();
+        startPwm();
+    }
+    // the first edge received in REMOTE mode applies the first state
+    if (mode == REMOTE && pinPlaylist_ != NULL && pinPlaylist_->getNumStates() > 0) {
+        __sync_lock_test_and_set(&remoteStep_, 0);
+        remoteApplied_ = 0;
+        remoteNumStates_ = pinPlaylist_->getNumStates();
+        try {
+            remoteTaskId_ = Scheduler::getInstance()->addDeadlineTask(Scheduler::RT_LANE, &IOPinManager::processRemote, this, SharedClock::getMonotonicTimeInNs() + 1000000000);
+        } catch (MyException* e) {
+            LOG(WARNING) << "Unable to register the remote task: " << e->getMessage();
+            delete e;
+        }
+    }
+    mode_ = mode;
+    if (mode_ == EDITION) {
+        try {
+            pwm_.stop();
+        } catch (MyException* e) {
+            LOG(WARNING) << "Unable to stop PWM generator: " << e->getMessage();
+            delete e;
+        }
     }
 }
 
@@ -119,5 +373,7 @@ unsigned int IOPinManager::getNumPins() { return pins_.size(); }
 std::vector<IOPin*>& IOPinManager::getPins() { return pins_; }
 BooleanPlaylist* IOPinManager::getPinPlaylist() { return pinPlaylist_; }
 
-void IOPinManager::setMode(const Mode mode) { mode_ = mode; }
 IOPinManager::Mode IOPinManager::getMode() { return mode_; }
+std::string IOPinManager::getPortDevice() { return portDevice_; }
+PwmGenerator* IOPinManager::getPwm() { return &pwm_; }
+PlayerSnapshot* IOPinManager::getSnapshot() { return &snapshot_; }
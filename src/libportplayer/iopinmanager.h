@@ -30,6 +30,9 @@
 
 #include "iopin.h"
 #include "booleanplaylist.h"
+#include "inputwatcher.h"
+#include "pwmgenerator.h"
+#include "playersnapshot.h"
 #include "myexception.h"
 #include <vector>
 #include <QObject>
@@ -37,10 +40,12 @@
 //! Library to interact with the environment (valves, LEDs, robots, etc.).
 namespace portplayer {
 
+class PortEventLog;
+
 /**
  * \brief Abstract manager of a set of pins.
  *
- * @version February 26, 2012
+ * @version March 18, 2012
  * @author Thomas Schaffter (thomas.schaff...@gmail.com)
  */
 class IOPinManager : public QObject {
@@ -67,9 +72,32 @@ protected:
     BooleanPlaylist* pinPlaylist_;
     /** Current mode of the manager. */
     Mode mode_;
+    /** Number of edges received since entering REMOTE mode (the n-th edge applies the n-th state). */
+    volatile unsigned int remoteStep_;
+    /** Number of edges whose state has been applied by the remote task (RT lane only). */
+    unsigned int remoteApplied_;
+    /** Number of states of the playlist when entering REMOTE mode. */
+    unsigned int remoteNumStates_;
+    /** Id of the task applying the remote states on the RT lane (-1 if not in REMOTE mode). */
+    int remoteTaskId_;
+    /** Software PWM on the pins (no channel by default). */
+    PwmGenerator pwm_;
+    /** Status of the player polled by the interface. */
+    PlayerSnapshot snapshot_;
 
     /** Delete the pins. */
     virtual void deletePins();
+    /** Removes the task applying the remote states (GUI thread only). */
+    void stopRemoteTask();
+
+    /** Callback executed by the RT lane of the playlist to apply a state. */
+    static void applyStateCallback(void* data, unsigned int stateIndex, uint64_t word);
+    /** Callback executed by the PWM generator to write the pins. */
+    static void pwmWriteCallback(void* data, uint64_t values, uint64_t mask, unsigned int stateIndex);
+    /** Starts the PWM generator if it has channels (GUI thread only). */
+    void startPwm();
+    /** Function run by the scheduler on the RT lane when woken up by remoteStateCallback(). */
+    static bool processRemote(void* obj);
 
 public:
 
@@ -91,6 +119,33 @@ public:
     BooleanPlaylist* getPinPlaylist();
     /** Returns the current mode of the manager. */
     Mode getMode();
+    /** Returns the absolute path to the port device. */
+    std::string getPortDevice();
+
+    /** Precomputes the states of the playlist for fast application, to call after each edit of the playlist (GUI thread only, does nothing by default). */
+    virtual void compileStates() {}
+    /** Sets the log of the accesses to the port (NULL to disable, does nothing by default). */
+    virtual void setEventLog(PortEventLog* /*log*/) {}
+    /** Writes the pins selected by mask (bit i is the i-th pin), pin by pin by default. */
+    virtual void writePins(const uint64_t values, const uint64_t mask, const unsigned int stateIndex) throw(MyException*);
+
+    /** Configures the PWM channels ("name period_us ...") and their duty cycles in percent ("d d;d d;..." one group per state). */
+    void loadPwm(const std::string channels, const std::string duties) throw(MyException*);
+    /** Returns a string describing the PWM channels. */
+    std::string savePwmChannels();
+    /** Returns a string describing the duty cycles of the PWM channels. */
+    std::string savePwmDuties();
+    /** Returns the PWM generator. */
+    PwmGenerator* getPwm();
+    /** Returns the status of the player published for the interface (states applied, pins and times). */
+    PlayerSnapshot* getSnapshot();
+
+    /** Creates the manager matching the port device (GPIO chip or parallel port). */
+    static IOPinManager* create(const std::string portDevice);
+    /** Returns true if the manager is of the type created by create() for the port device. */
+    bool matchesDevice(const std::string portDevice);
+    /** Callback executed by an InputWatcher to apply the n-th state in REMOTE mode for the n-th edge (only wakes up the RT lane). */
+    static void remoteStateCallback(void* data, const InputEvent& event);
 
  public slots:
 
@@ -100,9 +155,9 @@ public:
     virtual void setAllPinsLow();
 
     /** Applies the specified state in the sequence. */
-    void applyState(const unsigned int state) throw(MyException*);
+    virtual void applyState(const unsigned int state) throw(MyException*);
 
-    /** Sets the mode of the manager. */
+    /** Sets the mode of the manager (compiles the states and starts the PWM generator when leaving EDITION mode). */
     void setMode(const Mode mode);
     /** Prints a description of the sequence. */
     void printPlaylist();
@@ -1,10 +1,24 @@
 SOURCES += iopin.cpp \
     parallelportpin.cpp \
+    parallelportdevice.cpp \
     iopinmanager.cpp \
     parallelportmanager.cpp \
-    booleanplaylist.cpp
+    booleanplaylist.cpp \
+    porteventlog.cpp \
+    gpiopin.cpp \
+    gpiomanager.cpp \
+    inputwatcher.cpp \
+    pwmgenerator.cpp \
+    playersnapshot.cpp
 HEADERS += iopin.h \
     parallelportpin.h \
+    parallelportdevice.h \
     iopinmanager.h \
     parallelportmanager.h \
-    booleanplaylist.h
+    booleanplaylist.h \
+    porteventlog.h \
+    gpiopin.h \
+    gpiomanager.h \
+    inputwatcher.h \
+    pwmgenerator.h \
+    playersnapshot.h
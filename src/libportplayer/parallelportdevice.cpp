@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "parallelportdevice.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/parport.h>
+#include <linux/ppdev.h>
+#include <glog/logging.h>
+
+using namespace portplayer;
+
+std::vector<ParallelPortDevice*> ParallelPortDevice::devices_;
+PortEventLog* ParallelPortDevice::eventLog_ = NULL;
+
+// ======================================================================
+// PRIVATE METHODS
+
+ParallelPortDevice::ParallelPortDevice(const std::string path, const unsigned int index) throw(MyException*) :
+    path_(path),
+    index_(index),
+    fd_(-1),
+    data_(0),
+    numPins_(0) {
+
+    // open the parallel port for reading and writing
+    fd_ = open(path_.c_str(), O_RDWR);
+    if (fd_ == -1)
+        throw new MyException("Could not open parallel port " + path_ + ".");
+
+    // try to claim port (see http://www.linuxfocus.org/common/src/article205/ppdev.html)
+    if (ioctl(fd_, PPCLAIM, NULL)) {
+        close(fd_);
+        throw new MyException("Could not claim parallel port " + path_ + ".");
+    }
+
+    // and set the mode (SPP bi-directional, sometimes calls PS/2)
+    int mode = IEEE1284_MODE_BYTE;
+    if (ioctl(fd_, PPSETMODE, &mode)) {
+        ioctl(fd_, PPRELEASE);
+        close(fd_);
+        throw new MyException("Unable to set paralllel port " + path_ + " in SSP bi-directional mode.");
+    }
+
+    // the data register is only written by us from now on
+    unsigned char data = 0;
+    if (ioctl(fd_, PPRDATA, &data)) {
+        ioctl(fd_, PPRELEASE);
+        close(fd_);
+        throw new MyException("Could not read parallel port " + path_ + ".");
+    }
+    data_ = data;
+}
+
+// ----------------------------------------------------------------------
+
+ParallelPortDevice::~ParallelPortDevice() {
+
+    // release and close the parallel port
+    ioctl(fd_, PPRELEASE);
+    close(fd_);
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+ParallelPortDevice* ParallelPortDevice::acquire(const std::string path) throw(MyException*) {
+
+    ParallelPortDevice* device = find(path);
+    if (device == NULL) {
+        // reuse the slot of a device closed before
+        unsigned int index = 0;
+        while (index < devices_.size() && devices_.at(index) != NULL)
+            index++;
+        device = new ParallelPortDevice(path, index);
+        if (index == devices_.size())
+            devices_.push_back(device);
+        else
+            devices_.at(index) = device;
+    }
+    device->numPins_++;
+
+    return device;
+}
+
+// ----------------------------------------------------------------------
+
+void ParallelPortDevice::release(ParallelPortDevice* device) {
+
+    if (device == NULL || --device->numPins_ > 0)
+        return;
+
+    devices_.at(device->index_) = NULL;
+    delete device;
+}
+
+// ----------------------------------------------------------------------
+
+ParallelPortDevice* ParallelPortDevice::find(const std::string path) {
+
+    for (unsigned int i = 0; i < devices_.size(); i++) {
+        if (devices_.at(i) != NULL && devices_.at(i)->path_ == path)
+            return devices_.at(i);
+    }
+    return NULL;
+}
+
+// ----------------------------------------------------------------------
+
+void ParallelPortDevice::writeData(const unsigned char value, const unsigned char mask, const unsigned int stateIndex) throw(MyException*) {
+
+    // the RT lane, the input watcher and the interface write the port: the
+    // bits of the other writers are kept by updating the cache atomically
+    unsigned char current;
+    unsigned char data;
+    do {
+        current = data_;
+        data = (current & ~mask) | (value & mask);
+        if (data == current)
+            return;
+    } while (!__sync_bool_compare_and_swap(&data_, current, data));
+
+    // a concurrent writer may have written its older content after ours,
+    // the last writer writes again until the port holds the cache
+    do {
+        if (ioctl(fd_, PPWDATA, &data))
+            throw new MyException("Could not write parallle port " + path_ + ".");
+        if (eventLog_ != NULL)
+            eventLog_->push(PortEventLog::WRITE, stateIndex, data, index_);
+        current = data;
+        __sync_synchronize(); // the cache must be read again after the ioctl
+        data = data_;
+    } while (data != current);
+}
+
+// ----------------------------------------------------------------------
+
+void ParallelPortDevice::write(const unsigned char value) throw(MyException*) {
+
+    writeData(value, 0xFF);
+}
+
+// ----------------------------------------------------------------------
+
+void ParallelPortDevice::read(unsigned char& value) throw(MyException*) {
+
+    if (ioctl(fd_, PPRDATA, &value))
+        throw new MyException("Could not read parallel port " + path_ + ".");
+
+    if (eventLog_ != NULL)
+        eventLog_->push(PortEventLog::READ, PORT_EVENT_NO_STATE, value, index_);
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+std::string ParallelPortDevice::getPath() { return path_; }
+unsigned int ParallelPortDevice::getIndex() { return index_; }
+int ParallelPortDevice::getFd() { return fd_; }
+unsigned char ParallelPortDevice::getData() { return data_; }
+
+void ParallelPortDevice::setEventLog(PortEventLog* log) { eventLog_ = log; }
+PortEventLog* ParallelPortDevice::getEventLog() { return eventLog_; }
@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PARALLELPORTDEVICE_H
+#define PARALLELPORTDEVICE_H
+
+#include "porteventlog.h"
+#include "myexception.h"
+#include <string>
+#include <vector>
+
+/** Number of data pins of a parallel port (D0..D7). */
+#define PARALLEL_PORT_NUM_DATA_PINS 8
+
+//! Library to interact with the environment (valves, LEDs, robots, etc.).
+namespace portplayer {
+
+/**
+ * \brief Parallel port device (/dev/parportN) shared by the pins wired to it.
+ *
+ * A device is opened and claimed when the first pin (or input watcher)
+ * acquires it and released with the last one. Its data register is cached so that writing a subset of
+ * the pins never requires reading the port: each write is a single ioctl.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class ParallelPortDevice {
+
+private:
+
+    /** Devices currently open (NULL for a free slot, the slot gives the index of the device). */
+    static std::vector<ParallelPortDevice*> devices_;
+    /** Log of the accesses to the ports (NULL = disabled). */
+    static PortEventLog* eventLog_;
+
+    /** Absolute path to the device (e.g. "/dev/parport0"). */
+    std::string path_;
+    /** Index of the device (slot in devices_). */
+    unsigned int index_;
+    /** File descriptor of the device. */
+    int fd_;
+    /** Cached content of the data register (read once when opening the port, updated with a CAS). */
+    volatile unsigned char data_;
+    /** Number of pins using the device. */
+    unsigned int numPins_;
+
+    /** Constructor opens and claims the port. */
+    ParallelPortDevice(const std::string path, const unsigned int index) throw(MyException*);
+    /** Destructor releases and closes the port. */
+    ~ParallelPortDevice();
+
+public:
+
+    /** Returns the device with the given path, opened if no pin uses it yet. */
+    static ParallelPortDevice* acquire(const std::string path) throw(MyException*);
+    /** Releases the device, closed when no pin uses it anymore. */
+    static void release(ParallelPortDevice* device);
+    /** Returns the open device with the given path (NULL if not open). */
+    static ParallelPortDevice* find(const std::string path);
+
+    /** Writes the bits of value selected by mask to the data register using a single ioctl (thread-safe). */
+    void writeData(const unsigned char value, const unsigned char mask, const unsigned int stateIndex = PORT_EVENT_NO_STATE) throw(MyException*);
+    /** Writes the data register. */
+    void write(const unsigned char value) throw(MyException*);
+    /** Reads the data register. */
+    void read(unsigned char& value) throw(MyException*);
+
+    /** Returns the absolute path to the device. */
+    std::string getPath();
+    /** Returns the index of the device. */
+    unsigned int getIndex();
+    /** Returns the file descriptor of the device. */
+    int getFd();
+    /** Returns the cached content of the data register. */
+    unsigned char getData();
+
+    /** Sets the log of the accesses to the ports (NULL to disable). */
+    static void setEventLog(PortEventLog* log);
+    /** Returns the log of the accesses to the ports. */
+    static PortEventLog* getEventLog();
+};
+
+}
+
+#endif // PARALLELPORTDEVICE_H
@@ -28,10 +28,39 @@
 #include "parallelportmanager.h"
 #include "myutility.h"
 #include <sstream>
+#include <algorithm>
 #include <glog/logging.h>
 
 using namespace portplayer;
 
+// ======================================================================
+// PRIVATE METHODS
+
+void ParallelPortManager::compileDevices() {
+
+    const unsigned int numPins = getNumPins();
+
+    // devices in the order of the pins, pins whose port could not be opened are ignored
+    devices_.clear();
+    deviceMasks_.clear();
+    pinDevices_.assign(numPins, -1);
+    for (unsigned int i = 0; i < numPins; i++) {
+        ParallelPortDevice* device = dynamic_cast<ParallelPortPin*>(pins_.at(i))->getDevice();
+        if (device == NULL)
+            continue;
+        unsigned int d = std::find(devices_.begin(), devices_.end(), device) - devices_.begin();
+        if (d == devices_.size()) {
+            devices_.push_back(device);
+            deviceMasks_.push_back(0);
+        }
+        deviceMasks_.at(d) |= (1 << pins_.at(i)->getPin());
+        pinDevices_.at(i) = d;
+    }
+
+    writeBytes_.assign(devices_.size(), 0);
+    writeMasks_.assign(devices_.size(), 0);
+}
+
 // ======================================================================
 // PUBLIC METHODS
 
@@ -51,6 +80,10 @@ ParallelPortManager::~ParallelPortManager() {
 
 void ParallelPortManager::deletePins() {
 
+    stopRemoteTask();
+    pwm_.stop();
+    pwm_.clearChannels();
+
     const unsigned int numPins = pins_.size();
     IOPin* pin = NULL;
     for (unsigned int i = 0; i < numPins; i++) {
@@ -59,6 +92,11 @@ void ParallelPortManager::deletePins() {
         pin = NULL;
     }
     pins_.clear();
+    devices_.clear();
+    deviceMasks_.clear();
+    pinDevices_.clear();
+    stateBytes_.clear();
+    statePins_.clear();
 }
 
 // ----------------------------------------------------------------------
@@ -82,6 +120,7 @@ void ParallelPortManager::load(const std::string parport, const std::string pinL
     n /= 3;
 
     std::string id = "";
+    std::string device = "";
     int port = 0;
     unsigned char pin = 0;
     ParallelPortPin* p = NULL;
@@ -90,18 +129,29 @@ void ParallelPortManager::load(const std::string parport, const std::string pinL
     for (int i = 0; i < n; i++) {
         try {
             id = tokens.at(3 * i);
-            port = hexStringToInt(tokens.at((3 * i) + 1));
+            // the port column is either the device of the pin or the address of the default port
+            device = portDevice_;
+            port = 0;
+            if (tokens.at((3 * i) + 1).find("/dev/") == 0)
+                device = tokens.at((3 * i) + 1);
+            else
+                port = hexStringToInt(tokens.at((3 * i) + 1));
             pin = intStringToInt(tokens.at((3 * i) + 2));
 
-            p = new ParallelPortPin(portDevice_, id, port, pin);
+            p = new ParallelPortPin(device, id, port, pin);
             pins_.push_back(p);
         } catch (MyException* e) {
             LOG(WARNING) << "ParallelPortPinManager::load(): " << e->getMessage();
         }
     }
+    compileDevices();
     
     delete pinPlaylist_;
     pinPlaylist_ = new BooleanPlaylist(n);
+    // the states are written to the port by the RT lane of the playlist
+    pinPlaylist_->setStateCallback(&IOPinManager::applyStateCallback, this);
+    pinPlaylist_->setSnapshot(&snapshot_);
+    compileStates();
 }
 
 // ----------------------------------------------------------------------
@@ -118,7 +168,10 @@ std::string ParallelPortManager::save() {
     for (unsigned int i = 0; i < numPins; i++) {
         p = dynamic_cast<ParallelPortPin*>(pins_.at(i));
         output << p->getName() << " ";
-        output << intToHexString(p->getPort()) << " ";
+        if (p->getParport() != portDevice_)
+            output << p->getParport() << " ";
+        else
+            output << intToHexString(p->getPort()) << " ";
         output << intToIntString(p->getPin()) << " ";
     }
 
@@ -134,6 +187,7 @@ ParallelPortManager* ParallelPortManager::generateParallelPortExample() {
     ppManager->load("/dev/parport0", "pin0 0x327 0 pin1 0x327 1 pin2 0x327 2 pin3 0x327 3 pin4 0x327 4 pin5 0x327 5 pin6 0x327 6 pin7 0x327 7");
     ppManager->getPinPlaylist()->loadPlaylist("10000000 01000000");
     ppManager->getPinPlaylist()->loadStateDurations("5 5");
+    ppManager->compileStates();
 
     return ppManager;
 }
@@ -142,18 +196,122 @@ ParallelPortManager* ParallelPortManager::generateParallelPortExample() {
 
 std::string ParallelPortManager::getParallelPortState() {
 
-    std::ostringstream buffer;
-    ParallelPortPin* p = dynamic_cast<ParallelPortPin*>(pins_.at(0)); // use the first pin as reference
+    // the data registers are cached, no need to read the ports
+    std::string state = "";
+    for (unsigned int d = 0; d < devices_.size(); d++)
+        state += (d > 0 ? " " : "") + unsignedCharToString(devices_.at(d)->getData());
+
+    return state;
+}
+
+// ----------------------------------------------------------------------
+
+void ParallelPortManager::compileStates() {
+
+    if (pinPlaylist_ == NULL)
+        return;
+
+    const unsigned int numPins = getNumPins();
+    const unsigned int numStates = pinPlaylist_->getNumStates();
+    const unsigned int numDevices = devices_.size();
+
+    // the devices are compiled by load(), the PWM generator may be writing them
+    stateBytes_.assign(numStates * numDevices, 0);
+    statePins_.assign(numStates, 0);
+    for (unsigned int i = 0; i < numStates; i++) {
+        const std::vector<bool>& state = pinPlaylist_->getPlaylist()->at(i);
+        for (unsigned int j = 0; j < numPins && j < state.size(); j++) {
+            if (!state.at(j))
+                continue;
+            if (pinDevices_.at(j) != -1)
+                stateBytes_.at(i * numDevices + pinDevices_.at(j)) |= (1 << pins_.at(j)->getPin());
+            if (j < 64)
+                statePins_.at(i) |= ((uint64_t)1 << j);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void ParallelPortManager::setEventLog(PortEventLog* log) {
+
+    ParallelPortDevice::setEventLog(log);
+}
+
+// ----------------------------------------------------------------------
 
-    unsigned char value;
-    p->readParallelPort(value);
+void ParallelPortManager::writePins(const uint64_t values, const uint64_t mask, const unsigned int stateIndex) throw(MyException*) {
 
-    return unsignedCharToString(value);
+    const unsigned int numDevices = devices_.size();
+    for (unsigned int d = 0; d < numDevices; d++) {
+        writeBytes_[d] = 0;
+        writeMasks_[d] = 0;
+    }
+    for (unsigned int i = 0; i < pinDevices_.size() && i < 64; i++) {
+        const int d = pinDevices_[i];
+        if (d == -1 || !(mask & (1ULL << i)))
+            continue;
+        const unsigned char bit = 1 << pins_[i]->getPin();
+        writeMasks_[d] |= bit;
+        if (values & (1ULL << i))
+            writeBytes_[d] |= bit;
+    }
+    for (unsigned int d = 0; d < numDevices; d++) {
+        if (writeMasks_[d] != 0)
+            devices_[d]->writeData(writeBytes_[d], writeMasks_[d], stateIndex);
+    }
 }
 
 // ----------------------------------------------------------------------
 
-void ParallelPortManager::saveParallelPortState(std::ofstream* os, std::string prefix) {
+void ParallelPortManager::setAllPinsLow() {
+
+    if (getNumPins() == 0)
+        return;
+
+    // turns off the PWM channels so that they do not toggle the pins again
+    if (pwm_.isRunning()) {
+        try {
+            pwm_.apply(PORT_EVENT_NO_STATE, 0);
+        } catch (MyException* e) {
+            LOG(WARNING) << "ParallelPortManager::setAllPinsLow(): " << e->getMessage();
+            delete e;
+        }
+    }
+
+    for (unsigned int d = 0; d < devices_.size(); d++) {
+        try {
+            devices_.at(d)->writeData(0x00, deviceMasks_.at(d));
+        } catch (MyException* e) {
+            LOG(WARNING) << "ParallelPortManager::setAllPinsLow(): " << e->getMessage();
+        }
+    }
+
+    snapshot_.publishPins(0);
+}
+
+// ----------------------------------------------------------------------
+
+void ParallelPortManager::applyState(const unsigned int state) throw(MyException*) {
+
+    // the states are compiled by the interface after each edit of the playlist
+    if (statePins_.size() != pinPlaylist_->getNumStates())
+        throw new MyException("The playlist has been modified since its states were compiled.");
+
+    if (state >= statePins_.size())
+        throw new MyException("Invalid state index " + intToIntString(state) + ".");
+
+    // the PWM generator merges the state with the levels of its pins
+    if (pwm_.isRunning()) {
+        snapshot_.publishState(state, statePins_.at(state));
+        pwm_.apply(state, statePins_.at(state));
+        return;
+    }
 
-    *os << prefix << getParallelPortState() << "\n";
+    // one write per device, back to back
+    const unsigned int numDevices = devices_.size();
+    const unsigned char* bytes = &stateBytes_[state * numDevices];
+    for (unsigned int d = 0; d < numDevices; d++)
+        devices_[d]->writeData(bytes[d], deviceMasks_[d], state);
+    snapshot_.publishState(state, statePins_.at(state));
 }
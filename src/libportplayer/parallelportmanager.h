@@ -33,7 +33,6 @@
 #include "myexception.h"
 #include <vector>
 #include <iostream>
-#include <fstream>
 
 //! Library to interact with the environment (valves, LEDs, robots, etc.).
 namespace portplayer {
@@ -41,7 +40,12 @@ namespace portplayer {
 /**
  * \brief Parallel port (IEEE1284) manager.
  *
- * @version February 26, 2012
+ * The pins may be wired to several parallel ports: the port column of the
+ * pin list gives the device of the pin (e.g. "/dev/parport1") instead of the
+ * address of the port, the default device being the one given to load().
+ * A state is applied with one write per device, issued back to back.
+ *
+ * @version March 18, 2012
  * @author Thomas Schaffter (thomas.schaff...@gmail.com)
  */
 class ParallelPortManager : public IOPinManager {
@@ -50,8 +54,25 @@ class ParallelPortManager : public IOPinManager {
 
 protected:
 
+    /** Parallel ports the pins are wired to (in the order of the pins). */
+    std::vector<ParallelPortDevice*> devices_;
+    /** Bits of the data register of each device driven by the pins. */
+    std::vector<unsigned char> deviceMasks_;
+    /** Index of the device of each pin (-1 if its port could not be opened). */
+    std::vector<int> pinDevices_;
+    /** Data registers being composed by writePins() (one byte per device). */
+    std::vector<unsigned char> writeBytes_;
+    /** Bits being written by writePins() (one byte per device). */
+    std::vector<unsigned char> writeMasks_;
+    /** Content of the data registers for each state of the playlist (one byte per device). */
+    std::vector<unsigned char> stateBytes_;
+    /** Pin states of each state of the playlist (bit i is the state of the i-th pin). */
+    std::vector<uint64_t> statePins_;
+
     /** Closes and deletes the pins. */
     virtual void deletePins();
+    /** Groups the pins by device and precomputes the bits of each data register. */
+    void compileDevices();
 
 public:
 
@@ -66,15 +87,24 @@ public:
     /** Generates an example using all the pins of a standard parallel port (IEEE1284).*/
     static ParallelPortManager* generateParallelPortExample();
 
-    /** Returns a string descrbing the current state of the parallel port. */
+    /** Returns a string descrbing the current state of the parallel ports (one byte per device). */
     std::string getParallelPortState();
 
+    /** Precomputes the content of the data registers for each state of the playlist (GUI thread only). */
+    virtual void compileStates();
+    /** Sets the log of the accesses to the parallel port (NULL to disable). */
+    virtual void setEventLog(PortEventLog* log);
+    /** Writes the pins selected by mask with a single write per data register. */
+    virtual void writePins(const uint64_t values, const uint64_t mask, const unsigned int stateIndex) throw(MyException*);
+
 public slots:
 
     /** Returns a string describing the settings of the pins. */
     virtual std::string save();
-    /** Saves the current states of the parallel port to file. */
-    void saveParallelPortState(std::ofstream* os, std::string prefix);
+    /** Turns off all pins with a single write per data register. */
+    virtual void setAllPinsLow();
+    /** Applies the specified state with a single write per data register. */
+    virtual void applyState(const unsigned int state) throw(MyException*);
 };
 
 }
@@ -28,32 +28,28 @@
 #include "parallelportpin.h"
 #include "myutility.h"
 #include <exception>
-#include <sys/io.h>
 #include <glog/logging.h>
 #include <sys/ioctl.h>
 #include <linux/parport.h>
 #include <linux/ppdev.h>
-#include <fcntl.h>
 
 using namespace portplayer;
 
-int ParallelPortPin::fd_ = 0;
-unsigned int ParallelPortPin::ppPinCount_ = 0;
-
 // ======================================================================
 // PUBLIC METHODS
 
 ParallelPortPin::ParallelPortPin(const std::string parport, const std::string name, const int port, const unsigned int pin, QObject *parent) : IOPin(name, port, pin, parent) {
 
+    parport_ = parport;
+    device_ = NULL;
     try {
-        if (ppPinCount_ == 0)
-            initializeParallelPort(parport);
+        if (pin_ >= PARALLEL_PORT_NUM_DATA_PINS)
+            throw new MyException("Invalid data pin index " + intToIntString(pin_) + ".");
 
+        device_ = ParallelPortDevice::acquire(parport);
         setLow();
         print();
 
-        ppPinCount_++;
-
     } catch (MyException* e) {
         LOG(WARNING) << "Unable to initialize parallel port pin \"" << name_ << "\": " << e->getMessage();
     }
@@ -63,52 +59,12 @@ ParallelPortPin::ParallelPortPin(const std::string parport, const std::string na
 
 ParallelPortPin::~ParallelPortPin() {
 
-    try {
-        setLow();
-
-        if (ppPinCount_ == 1)
-            finilizeParallelPort();
-
-        ppPinCount_--;
-
-    } catch (MyException* e) {
-        LOG(WARNING) << "Unable to close parallel port pin \"" << name_ << "\": " << e->getMessage();
-    }
-}
-
-// ----------------------------------------------------------------------
+    if (device_ == NULL)
+        return;
 
-void ParallelPortPin::initializeParallelPort(const std::string parport) throw(MyException*) {
-
-    // open the parallel port for reading and writing
-    fd_ = open(parport.c_str(), O_RDWR);
-    if (fd_ == -1) {
-        std::string str = "Could not open parallel port " + parport + ".";
-        throw new MyException(str);
-    }
-
-    // try to claim port (see http://www.linuxfocus.org/common/src/article205/ppdev.html)
-    if (ioctl(fd_, PPCLAIM, NULL)) {
-        close(fd_);
-        throw new MyException("Could not claim parallel port.");
-    }
-
-    // and set the mode (SPP bi-directional, sometimes calls PS/2)
-    int mode = IEEE1284_MODE_BYTE;
-    if (ioctl(fd_, PPSETMODE, &mode)) {
-        ioctl(fd_, PPRELEASE);
-        close(fd_);
-        throw new MyException("Unable to set paralllel port in SSP bi-directional mode.");
-    }
-}
-
-// ----------------------------------------------------------------------
-
-void ParallelPortPin::finilizeParallelPort() throw(MyException*) {
-
-    // release and close the parallel port
-    ioctl(fd_, PPRELEASE);
-    close(fd_);
+    setLow();
+    ParallelPortDevice::release(device_);
+    device_ = NULL;
 }
 
 // ----------------------------------------------------------------------
@@ -116,11 +72,9 @@ void ParallelPortPin::finilizeParallelPort() throw(MyException*) {
 void ParallelPortPin::setLow() {
 
     try {
-        unsigned char value;
-        readParallelPort(value);
-        value &= ~(1 << pin_);
-        writeParallelPort(value);
-		
+        if (device_ == NULL)
+            throw new MyException("Parallel port of pin \"" + name_ + "\" is not open.");
+        device_->writeData(0x00, 1 << pin_);
         emit stateChanged(false);
 
     } catch (MyException* e) {
@@ -133,11 +87,9 @@ void ParallelPortPin::setLow() {
 void ParallelPortPin::setHigh() {
 
     try {
-        unsigned char value;
-        readParallelPort(value);
-        value |= (1 << pin_);
-        writeParallelPort(value);
-
+        if (device_ == NULL)
+            throw new MyException("Parallel port of pin \"" + name_ + "\" is not open.");
+        device_->writeData(0xFF, 1 << pin_);
         emit stateChanged(true);
 
     } catch (MyException* e) {
@@ -149,49 +101,41 @@ void ParallelPortPin::setHigh() {
 
 bool ParallelPortPin::isLow() throw(MyException*) {
 
-    unsigned char value;
-    readParallelPort(value);
-    value >>= pin_;
-
-    return (!(value & 1));
+    return (device_ == NULL || !((device_->getData() >> pin_) & 1));
 }
 
 // ----------------------------------------------------------------------
 
 bool ParallelPortPin::isHigh() throw(MyException*) {
 
-    unsigned char value;
-    readParallelPort(value);
-    value >>= pin_;
-
-    return (value & 1);
+    return (device_ != NULL && ((device_->getData() >> pin_) & 1));
 }
 
 // ----------------------------------------------------------------------
 
 void ParallelPortPin::print() {
 
-    LOG(INFO) << "Parallel port pin: name = " << name_ << ", port = " << intToHexString(port_) << ", pin index = " << pin_ << ", state = " << getState();
+    LOG(INFO) << "Parallel port pin: name = " << name_ << ", device = " << (device_ != NULL ? device_->getPath() : "none") << ", port = " << intToHexString(port_) << ", pin index = " << pin_ << ", state = " << getState();
 }
 
 // ---------------------------------------------------------------------- //
 
 void ParallelPortPin::readParallelPort(unsigned char& value) throw(MyException*) {
 
-//    setParallelPortDirectionToInput();
-
-    if (ioctl(fd_, PPRDATA, &value) == 1)
+    if (device_ == NULL)
         throw new MyException("Could not read parallel port.");
+
+    device_->read(value);
 }
 
 // ---------------------------------------------------------------------- //
 
 void ParallelPortPin::writeParallelPort(unsigned char& value) throw(MyException*) {
 
-//    setParallelPortDirectionToOutput();
-
-    if (ioctl(fd_, PPWDATA, &value))
+    if (device_ == NULL)
         throw new MyException("Could not write parallle port.");
+
+    device_->write(value);
 }
 
 // ---------------------------------------------------------------------- //
@@ -201,11 +145,8 @@ void ParallelPortPin::setParallelPortDirectionToOutput() throw(MyException*) {
 
     // and direction (0=out) (1=in)
     int dir = 0x00;
-    if (ioctl(fd_, PPDATADIR, &dir)) {
-        ioctl(fd_, PPRELEASE);
-        close(fd_);
+    if (device_ == NULL || ioctl(device_->getFd(), PPDATADIR, &dir))
         throw new MyException("Could not set parallel port direction to output.");
-    }
 }
 
 // ---------------------------------------------------------------------- //
@@ -215,9 +156,12 @@ void ParallelPortPin::setParallelPortDirectionToInput() throw(MyException*) {
 
     // and direction (0=out) (1=in)
     int dir = 0x01; // data_reverse
-    if (ioctl(fd_, PPDATADIR, &dir)) {
-        ioctl(fd_, PPRELEASE);
-        close(fd_);
+    if (device_ == NULL || ioctl(device_->getFd(), PPDATADIR, &dir))
         throw new MyException("Could not set parallel port direction to intput.");
-    }
 }
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+std::string ParallelPortPin::getParport() { return parport_; }
+ParallelPortDevice* ParallelPortPin::getDevice() { return device_; }
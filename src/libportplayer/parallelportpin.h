@@ -29,6 +29,7 @@
 #define PARALLELPORTPIN_H
 
 #include "iopin.h"
+#include "parallelportdevice.h"
 
 //! Library to interact with the environment (valves, LEDs, robots, etc.).
 namespace portplayer {
@@ -36,7 +37,7 @@ namespace portplayer {
 /**
  * \brief Represents the pin of a parallel port (IEEE1284).
  *
- * @version February 26, 2012
+ * @version March 18, 2012
  * @author Thomas Schaffter (thomas.schaff...@gmail.com)
  */
 class ParallelPortPin : public IOPin {
@@ -45,14 +46,14 @@ class ParallelPortPin : public IOPin {
 
 protected:
 
-    /** Reference to parport{fd_} */
-    static int fd_;
-    /** Number of pins accessible through the parallel port. */
-    static unsigned int ppPinCount_;
+    /** Absolute path to the parallel port the pin is wired to. */
+    std::string parport_;
+    /** Parallel port the pin is wired to (NULL if the port could not be opened). */
+    ParallelPortDevice* device_;
 
 public:
 
-    /** Constructor takes the name of the pin, the address of the port and the index of the pin. */
+    /** Constructor takes the device, the name of the pin, the address of the port and the index of the pin. */
     ParallelPortPin(const std::string parport, const std::string name, const int port, const unsigned int pin, QObject *parent = 0);
     /** Destructor. */
     virtual ~ParallelPortPin();
@@ -62,6 +63,11 @@ public:
     /** Returns true if the state of the pin is high. */
     virtual bool isHigh() throw(MyException*);
 
+    /** Returns the absolute path to the parallel port the pin is wired to. */
+    std::string getParport();
+    /** Returns the parallel port the pin is wired to (NULL if the port could not be opened). */
+    ParallelPortDevice* getDevice();
+
 public slots:
 
     /** Sets pin to low state. */
@@ -71,10 +77,6 @@ public slots:
     /** Prints the description of the pin (name, port, index and state). */
     virtual void print();
 
-    /** Initializes the parallel port. */
-    void initializeParallelPort(const std::string parport) throw(MyException*);
-    /** Close the parallel port. */
-    void finilizeParallelPort() throw(MyException*);
     /** Read the parallel port. */
     void readParallelPort(unsigned char& value) throw(MyException*);
     /** Write to the parallel port. */
@@ -0,0 +1,222 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "playersnapshot.h"
+#include "porteventlog.h"
+#include "scheduler.h"
+#include "sharedclock.h"
+#include <glog/logging.h>
+
+using namespace portplayer;
+
+// ======================================================================
+// PRIVATE METHODS
+
+void PlayerSnapshot::beginWrite() {
+
+    sequence_++;
+    __sync_synchronize(); // the sequence must be odd before the status is modified
+}
+
+// ----------------------------------------------------------------------
+
+void PlayerSnapshot::endWrite() {
+
+    __sync_synchronize(); // the status must be modified before the sequence is even again
+    sequence_++;
+}
+
+// ----------------------------------------------------------------------
+
+void PlayerSnapshot::apply(const Update& update) {
+
+    switch (update.part_) {
+    case STATE_PART:
+        status_.stateIndex_ = update.stateIndex_;
+        status_.numStates_++;
+        status_.pins_ = update.pins_;
+        break;
+    case PINS_PART:
+        status_.pins_ = update.pins_;
+        break;
+    case TIMES_PART:
+        status_.playlistTimeInMs_ = update.playlistTimeInMs_;
+        status_.stateTimeInMs_ = update.stateTimeInMs_;
+        break;
+    case RESET_PART:
+        // the number of states keeps increasing so that the next state is detected
+        status_.stateIndex_ = PORT_EVENT_NO_STATE;
+        status_.pins_ = 0;
+        status_.playlistTimeInMs_ = 0;
+        status_.stateTimeInMs_ = 0;
+        break;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void PlayerSnapshot::publish(const Update& update) {
+
+    if (Scheduler::getInstance()->isLaneThread(Scheduler::RT_LANE)) {
+        beginWrite();
+        apply(update);
+        endWrite();
+        return;
+    }
+
+    // the RT lane applies the update as soon as possible
+    pthread_mutex_lock(&mutex_);
+    if (!updates_.push(update))
+        LOG(WARNING) << "The status of the player is not refreshed: the RT lane didn't keep up.";
+    if (taskId_ == -1) {
+        try {
+            taskId_ = Scheduler::getInstance()->addDeadlineTask(Scheduler::RT_LANE, &PlayerSnapshot::process, this, SharedClock::getMonotonicTimeInNs());
+        } catch (MyException* e) {
+            LOG(WARNING) << "Unable to register the task of the player status: " << e->getMessage();
+            delete e;
+        }
+    }
+    const int taskId = taskId_;
+    pthread_mutex_unlock(&mutex_);
+
+    Scheduler::getInstance()->wakeTask(taskId);
+}
+
+// ----------------------------------------------------------------------
+
+bool PlayerSnapshot::process(void* obj) {
+
+    PlayerSnapshot* snapshot = reinterpret_cast<PlayerSnapshot*>(obj);
+
+    // the updates queued meanwhile are seen together by the readers
+    Update update;
+    snapshot->beginWrite();
+    while (snapshot->updates_.pop(update))
+        snapshot->apply(update);
+    snapshot->endWrite();
+
+    // parked until the next update wakes it up
+    try {
+        Scheduler::getInstance()->setTaskDeadline(snapshot->taskId_, SharedClock::getMonotonicTimeInNs() + 1000000000);
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to park the task of the player status: " << e->getMessage();
+        delete e;
+        return false;
+    }
+
+    return true;
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+PlayerSnapshot::PlayerSnapshot() :
+    sequence_(0),
+    taskId_(-1) {
+
+    if (pthread_mutex_init(&mutex_, NULL) == -1)
+        throw new MyException("Unable to pthread_mutex_init().");
+
+    // no thread reads the status yet
+    status_.stateIndex_ = PORT_EVENT_NO_STATE;
+    status_.numStates_ = 0;
+    status_.pins_ = 0;
+    status_.playlistTimeInMs_ = 0;
+    status_.stateTimeInMs_ = 0;
+}
+
+// ----------------------------------------------------------------------
+
+PlayerSnapshot::~PlayerSnapshot() {
+
+    if (taskId_ != -1) {
+        try {
+            Scheduler::getInstance()->removeTask(taskId_);
+        } catch (MyException* e) {
+            LOG(WARNING) << "Unable to remove the task of the player status: " << e->getMessage();
+            delete e;
+        }
+    }
+    pthread_mutex_destroy(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
+void PlayerSnapshot::reset() {
+
+    Update update;
+    update.part_ = RESET_PART;
+    publish(update);
+}
+
+// ----------------------------------------------------------------------
+
+void PlayerSnapshot::publishState(const unsigned int stateIndex, const uint64_t pins) {
+
+    Update update;
+    update.part_ = STATE_PART;
+    update.stateIndex_ = stateIndex;
+    update.pins_ = pins;
+    publish(update);
+}
+
+// ----------------------------------------------------------------------
+
+void PlayerSnapshot::publishPins(const uint64_t pins) {
+
+    Update update;
+    update.part_ = PINS_PART;
+    update.pins_ = pins;
+    publish(update);
+}
+
+// ----------------------------------------------------------------------
+
+void PlayerSnapshot::publishTimes(const unsigned int playlistTimeInMs, const unsigned int stateTimeInMs) {
+
+    Update update;
+    update.part_ = TIMES_PART;
+    update.playlistTimeInMs_ = playlistTimeInMs;
+    update.stateTimeInMs_ = stateTimeInMs;
+    publish(update);
+}
+
+// ----------------------------------------------------------------------
+
+PlayerStatus PlayerSnapshot::read() const {
+
+    PlayerStatus status;
+    unsigned int sequence;
+    do {
+        sequence = sequence_;
+        __sync_synchronize(); // the status must be read after the sequence
+        status = status_;
+        __sync_synchronize(); // the status must be read before checking the sequence again
+    } while ((sequence & 1) || sequence != sequence_);
+
+    return status;
+}
@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PLAYERSNAPSHOT_H
+#define PLAYERSNAPSHOT_H
+
+#include "lockfreequeue.h"
+#include <pthread.h>
+#include <stdint.h>
+
+/** Size of the queue passing the updates of the status from the other threads to the RT lane (power of two). */
+#define PLAYER_SNAPSHOT_QUEUE_SIZE 64
+
+//! Library to interact with the environment (valves, LEDs, robots, etc.).
+namespace portplayer {
+
+/**
+ * \brief Status of the player displayed by the interface.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct PlayerStatus {
+    /** Index of the last state applied (PORT_EVENT_NO_STATE if none). */
+    unsigned int stateIndex_;
+    /** Number of states applied, to detect a state applied again. */
+    unsigned long numStates_;
+    /** Levels written to the pins (bit i is the state of the i-th pin). */
+    uint64_t pins_;
+    /** Time in ms (frames if frame-locked) elapsed in the playlist. */
+    unsigned int playlistTimeInMs_;
+    /** Time in ms (frames if frame-locked) elapsed in the current state. */
+    unsigned int stateTimeInMs_;
+};
+
+/**
+ * \brief Status of the player published by the RT threads and polled by the interface.
+ *
+ * The threads applying the states never send Qt signals to the interface:
+ * they publish the status in the snapshot, and the interface reads a
+ * consistent copy at its own refresh rate. The status is protected by a
+ * seqlock as in SharedClock: the sequence number is odd while the status is
+ * being updated, and a reader retries if it was odd or has changed while
+ * reading.
+ *
+ * The status is only written by the RT lane of the Scheduler, whose tasks
+ * (playlist, remote states, PWM) run one after the other, so that writers
+ * never wait for each other. The updates published by the other threads
+ * (interface, non-RT lane) are queued and applied by a task of the RT lane,
+ * woken up without lock. Only these non-RT threads wait for each other to
+ * queue their updates.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class PlayerSnapshot {
+
+private:
+
+    /** Parts of the status written by an update. */
+    enum part {
+        STATE_PART = 0,
+        PINS_PART,
+        TIMES_PART,
+        RESET_PART
+    };
+
+    /** Update of the status queued for the RT lane. */
+    struct Update {
+        /** Part of the status updated. */
+        part part_;
+        /** Index of the state applied (STATE_PART). */
+        unsigned int stateIndex_;
+        /** Levels written to the pins (STATE_PART and PINS_PART). */
+        uint64_t pins_;
+        /** Time elapsed in the playlist (TIMES_PART). */
+        unsigned int playlistTimeInMs_;
+        /** Time elapsed in the current state (TIMES_PART). */
+        unsigned int stateTimeInMs_;
+    };
+
+    /** Sequence number, odd while the status is being updated. */
+    volatile unsigned int sequence_;
+    /** Status (written by the RT lane only). */
+    PlayerStatus status_;
+
+    /** Updates queued by the other threads for the RT lane. */
+    LockFreeQueue<Update, PLAYER_SNAPSHOT_QUEUE_SIZE> updates_;
+    /** Mutex serializing the threads queuing updates (never taken by the RT lane). */
+    pthread_mutex_t mutex_;
+    /** Id of the task applying the queued updates on the RT lane (-1 until the first update queued). */
+    int taskId_;
+
+    /** Begins an update of the status (RT lane only). */
+    void beginWrite();
+    /** Ends an update of the status (RT lane only). */
+    void endWrite();
+    /** Applies an update to the status (RT lane only, between beginWrite() and endWrite()). */
+    void apply(const Update& update);
+    /** Writes the update if called from the RT lane, queues it for the RT lane otherwise. */
+    void publish(const Update& update);
+    /** Function run by the scheduler on the RT lane to apply the queued updates. */
+    static bool process(void* obj);
+
+public:
+
+    /** Constructor. */
+    PlayerSnapshot();
+    /** Destructor. */
+    ~PlayerSnapshot();
+
+    /** Resets the status (no state, pins low, times zero). */
+    void reset();
+    /** Publishes a state applied and the levels written to the pins. */
+    void publishState(const unsigned int stateIndex, const uint64_t pins);
+    /** Publishes the levels written to the pins (the state is unchanged). */
+    void publishPins(const uint64_t pins);
+    /** Publishes the times elapsed in the playlist and in the current state. */
+    void publishTimes(const unsigned int playlistTimeInMs, const unsigned int stateTimeInMs);
+
+    /** Returns a consistent copy of the status. */
+    PlayerStatus read() const;
+};
+
+}
+
+#endif // PLAYERSNAPSHOT_H
@@ -0,0 +1,235 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "porteventlog.h"
+#include "scheduler.h"
+#include <string.h>
+#include <sched.h>
+#include <glog/logging.h>
+
+using namespace portplayer;
+
+// ======================================================================
+// PRIVATE METHODS
+
+void PortEventLog::writeEvents() {
+
+    while (true) {
+        // the oldest event at the head of the queues is written first
+        int next = -1;
+        for (unsigned int i = 0; i < PORT_EVENT_LOG_NUM_QUEUES; i++) {
+            if (!hasHead_[i])
+                hasHead_[i] = queues_[i].pop(heads_[i]);
+            if (hasHead_[i] && (next < 0 || heads_[i].monotonicInNs_ < heads_[next].monotonicInNs_))
+                next = i;
+        }
+        if (next < 0)
+            break;
+        file_.write(reinterpret_cast<const char*>(&heads_[next]), sizeof(PortEvent));
+        hasHead_[next] = false;
+        numEvents_++;
+    }
+    file_.flush();
+}
+
+// ----------------------------------------------------------------------
+
+bool PortEventLog::flush(void* obj) {
+
+    PortEventLog* log = reinterpret_cast<PortEventLog*>(obj);
+    log->writeEvents();
+    return true;
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+PortEventLog::PortEventLog() :
+    clock_(NULL),
+    taskId_(-1),
+    open_(false),
+    numEvents_(0),
+    numDroppedEvents_(0) {
+
+    nextQueue_ = 0;
+    for (unsigned int i = 0; i < PORT_EVENT_LOG_NUM_QUEUES; i++) {
+        pushLocks_[i] = 0;
+        hasHead_[i] = false;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+PortEventLog::~PortEventLog() {
+
+    try {
+        close();
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to close port event log: " << e->getMessage();
+        delete e;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void PortEventLog::open(const std::string filename, SharedClock* clock) throw(MyException*) {
+
+    if (open_)
+        close();
+
+    file_.open(filename.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!file_.is_open())
+        throw new MyException("Unable to open port event log " + filename + ".");
+
+    const uint32_t version = PORT_EVENT_LOG_VERSION;
+    const uint32_t recordSize = sizeof(PortEvent);
+    file_.write(PORT_EVENT_LOG_MAGIC, 8);
+    file_.write(reinterpret_cast<const char*>(&version), sizeof(uint32_t));
+    file_.write(reinterpret_cast<const char*>(&recordSize), sizeof(uint32_t));
+
+    for (unsigned int i = 0; i < PORT_EVENT_LOG_NUM_QUEUES; i++) {
+        queues_[i].clear();
+        hasHead_[i] = false;
+    }
+    clock_ = clock;
+    numEvents_ = 0;
+    numDroppedEvents_ = 0;
+
+    try {
+        taskId_ = Scheduler::getInstance()->addTask(Scheduler::NON_RT_LANE, &PortEventLog::flush, this, PORT_EVENT_LOG_FLUSH_INTERVAL);
+    } catch (MyException* e) {
+        file_.close();
+        throw e;
+    }
+    __sync_synchronize();
+    open_ = true;
+}
+
+// ----------------------------------------------------------------------
+
+void PortEventLog::close() throw(MyException*) {
+
+    if (!open_)
+        return;
+
+    open_ = false;
+    // wait for the producers which would be pushing, the late ones find the queues busy
+    for (unsigned int i = 0; i < PORT_EVENT_LOG_NUM_QUEUES; i++) {
+        while (__sync_lock_test_and_set(&pushLocks_[i], 1))
+            sched_yield();
+    }
+
+    if (taskId_ != -1) {
+        int taskId = taskId_;
+        taskId_ = -1;
+        Scheduler::getInstance()->removeTask(taskId);
+    }
+    writeEvents();
+    file_.close();
+
+    for (unsigned int i = 0; i < PORT_EVENT_LOG_NUM_QUEUES; i++)
+        __sync_lock_release(&pushLocks_[i]);
+
+    if (numDroppedEvents_ > 0)
+        LOG(WARNING) << "Port event log: " << numDroppedEvents_ << " events dropped (queues full or busy).";
+}
+
+// ----------------------------------------------------------------------
+
+void PortEventLog::push(const eventType type, const unsigned int stateIndex, const uint64_t value, const unsigned int device) {
+
+    if (!open_)
+        return;
+
+    PortEvent event;
+    event.monotonicInNs_ = SharedClock::getMonotonicTimeInNs();
+    event.timeInNs_ = (clock_ != NULL) ? clock_->toElapsedTimeInNs(event.monotonicInNs_) : event.monotonicInNs_;
+    event.stateIndex_ = stateIndex;
+    event.type_ = type;
+    event.value_ = value;
+    event.device_ = device;
+    event.reserved_[0] = event.reserved_[1] = 0;
+
+    // never waits for another producer: takes the next queue free
+    const unsigned int first = __sync_fetch_and_add(&nextQueue_, 1);
+    for (unsigned int k = 0; k < PORT_EVENT_LOG_NUM_QUEUES; k++) {
+        const unsigned int i = (first + k) % PORT_EVENT_LOG_NUM_QUEUES;
+        if (__sync_lock_test_and_set(&pushLocks_[i], 1))
+            continue;
+        if (!queues_[i].push(event))
+            __sync_fetch_and_add(&numDroppedEvents_, 1);
+        __sync_lock_release(&pushLocks_[i]);
+        return;
+    }
+    __sync_fetch_and_add(&numDroppedEvents_, 1);
+}
+
+// ----------------------------------------------------------------------
+
+void PortEventLog::convertToCsv(const std::string binFilename, const std::string csvFilename) throw(MyException*) {
+
+    std::ifstream in(binFilename.c_str(), std::ios::in | std::ios::binary);
+    if (!in.is_open())
+        throw new MyException("Unable to open port event log " + binFilename + ".");
+
+    char magic[8];
+    uint32_t version = 0;
+    uint32_t recordSize = 0;
+    in.read(magic, 8);
+    in.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
+    in.read(reinterpret_cast<char*>(&recordSize), sizeof(uint32_t));
+    if (!in.good() || memcmp(magic, PORT_EVENT_LOG_MAGIC, 8) != 0)
+        throw new MyException(binFilename + " is not a port event log.");
+    if (version != PORT_EVENT_LOG_VERSION || recordSize != sizeof(PortEvent))
+        throw new MyException("Unsupported version of port event log " + binFilename + ".");
+
+    std::ofstream out(csvFilename.c_str(), std::ios::out | std::ios::trunc);
+    if (!out.is_open())
+        throw new MyException("Unable to create " + csvFilename + ".");
+
+    out << "# monotonic_ns\ttime_ns\ttype\tdevice\tstate (-1 = none)\tvalue (hex, bit i = line i)" << std::endl;
+    PortEvent event;
+    while (in.read(reinterpret_cast<char*>(&event), sizeof(PortEvent))) {
+        out << event.monotonicInNs_ << "\t" << event.timeInNs_ << "\t";
+        out << (event.type_ == WRITE ? "W" : (event.type_ == READ ? "R" : "I")) << "\t";
+        out << (unsigned int)event.device_ << "\t";
+        if (event.stateIndex_ == PORT_EVENT_NO_STATE)
+            out << "-1";
+        else
+            out << event.stateIndex_;
+        out << "\t0x" << std::hex << event.value_ << std::dec << std::endl;
+    }
+    out.close();
+    in.close();
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+bool PortEventLog::isOpen() { return open_; }
+unsigned long PortEventLog::getNumEvents() { return numEvents_; }
+unsigned long PortEventLog::getNumDroppedEvents() { return numDroppedEvents_; }
@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PORTEVENTLOG_H
+#define PORTEVENTLOG_H
+
+#include "myexception.h"
+#include "sharedclock.h"
+#include "lockfreequeue.h"
+#include <stdint.h>
+#include <fstream>
+
+/** Capacity of each queue of events waiting to be written to file (power of two). */
+#define PORT_EVENT_LOG_QUEUE_SIZE 4096
+/** Number of queues shared by the producers. */
+#define PORT_EVENT_LOG_NUM_QUEUES 4
+/** Interval in us between two flushes of the queue to file. */
+#define PORT_EVENT_LOG_FLUSH_INTERVAL 100000
+/** State index of the events which don't come from a state of the playlist. */
+#define PORT_EVENT_NO_STATE 0xFFFFFFFF
+/** Identifies the binary files written by PortEventLog. */
+#define PORT_EVENT_LOG_MAGIC "SQPORTEV"
+/** Version of the format of the binary files. */
+#define PORT_EVENT_LOG_VERSION 3
+
+//! Library to interact with the environment (valves, LEDs, robots, etc.).
+namespace portplayer {
+
+/**
+ * \brief Write or read access to the port.
+ *
+ * Written as is to the binary file (32 bytes, little-endian on x86).
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct PortEvent {
+    /** Time of the access in ns on CLOCK_MONOTONIC. */
+    uint64_t monotonicInNs_;
+    /** Time of the access in ns on the clock of the log (e.g. experiment time of the frames). */
+    uint64_t timeInNs_;
+    /** Output lines after the write or read (bit i is the i-th data line or GPIO line). */
+    uint64_t value_;
+    /** Index of the state of the playlist (PORT_EVENT_NO_STATE if none). */
+    uint32_t stateIndex_;
+    /** Type of access (PortEventLog::eventType). */
+    uint8_t type_;
+    /** Index of the port device accessed. */
+    uint8_t device_;
+    /** Unused, keeps the size of the record a multiple of 8 bytes. */
+    uint8_t reserved_[2];
+};
+
+/**
+ * \brief Binary log of the accesses to the port.
+ *
+ * Events are timestamped with CLOCK_MONOTONIC and with the clock given to
+ * open(), typically the experiment clock used to stamp the frames so that
+ * both can be correlated. Producers (RT lane of the playlist, trigger thread,
+ * interface) never block on I/O nor allocate: events are pushed to one of a few
+ * lock-free queues, each producer taking the next queue which no other
+ * producer is pushing to. A producer never waits for another one: if all the
+ * queues are busy, the event is dropped and counted. A periodic task of the
+ * non-RT lane of the Scheduler merges the queues in the order of the events
+ * and writes them to a compact binary file, which convertToCsv() turns into a
+ * text table.
+ *
+ * The file starts with PORT_EVENT_LOG_MAGIC (8 bytes), the version and the
+ * size of a record (uint32_t each), followed by the PortEvent records.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class PortEventLog {
+
+public:
+
+    /** Types of access. */
+    enum eventType {
+        WRITE = 0,
+        READ = 1,
+        INPUT = 2       // edge received on an input line (value = number of edges)
+    };
+
+private:
+
+    /** Events waiting to be written to file. */
+    LockFreeQueue<PortEvent, PORT_EVENT_LOG_QUEUE_SIZE> queues_[PORT_EVENT_LOG_NUM_QUEUES];
+    /** Is 1 while a producer pushes to the queue (taken with a try-lock only). */
+    volatile int pushLocks_[PORT_EVENT_LOG_NUM_QUEUES];
+    /** Queue tried first by the next producer (the queues are used in turn). */
+    volatile unsigned int nextQueue_;
+    /** Event popped from each queue and not written yet. */
+    PortEvent heads_[PORT_EVENT_LOG_NUM_QUEUES];
+    /** Is true if heads_ holds an event. */
+    bool hasHead_[PORT_EVENT_LOG_NUM_QUEUES];
+    /** Binary file. */
+    std::ofstream file_;
+    /** Clock giving the second timestamp of the events. */
+    SharedClock* clock_;
+    /** Id of the flush task registered on the non-RT lane. */
+    int taskId_;
+    /** Is true while the log is open. */
+    volatile bool open_;
+
+    /** Number of events written to file. */
+    unsigned long numEvents_;
+    /** Number of events lost because the queues were full or busy. */
+    volatile unsigned long numDroppedEvents_;
+
+    /** Writes the events of the queues to file in the order of the events. */
+    void writeEvents();
+    /** Function run periodically by the scheduler to flush the queue. */
+    static bool flush(void* obj);
+
+public:
+
+    /** Constructor. */
+    PortEventLog();
+    /** Destructor (closes the log). */
+    ~PortEventLog();
+
+    /** Opens the binary file and starts flushing the events (clock NULL = CLOCK_MONOTONIC only). */
+    void open(const std::string filename, SharedClock* clock) throw(MyException*);
+    /** Writes the last events and closes the file. */
+    void close() throw(MyException*);
+
+    /** Logs an access to the port (RT-safe, does nothing if the log is closed). */
+    void push(const eventType type, const unsigned int stateIndex, const uint64_t value, const unsigned int device = 0);
+
+    /** Converts a binary log to a tab-separated text file. */
+    static void convertToCsv(const std::string binFilename, const std::string csvFilename) throw(MyException*);
+
+    /** Returns true while the log is open. */
+    bool isOpen();
+    /** Returns the number of events written to file. */
+    unsigned long getNumEvents();
+    /** Returns the number of events lost because the queues were full or busy. */
+    unsigned long getNumDroppedEvents();
+};
+
+}
+
+#endif // PORTEVENTLOG_H
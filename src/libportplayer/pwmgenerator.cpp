@@ -0,0 +1,397 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "pwmgenerator.h"
+#include "scheduler.h"
+#include "sharedclock.h"
+#include <sstream>
+#include <glog/logging.h>
+
+using namespace portplayer;
+
+// ======================================================================
+// PRIVATE METHODS
+
+uint64_t PwmGenerator::getLevels(const uint64_t tInNs) {
+
+    uint64_t levels = 0;
+    for (unsigned int i = 0; i < channels_.size(); i++) {
+        const PwmChannel& c = channels_[i];
+        if (c.onInNs_ == 0)
+            continue;
+        if (c.onInNs_ >= c.periodInNs_ || (tInNs - originInNs_) % c.periodInNs_ < c.onInNs_)
+            levels |= (1ULL << c.pin_);
+    }
+    return levels;
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t PwmGenerator::getNextEdge(const uint64_t tInNs) {
+
+    uint64_t next = tInNs + PWM_PARK_INTERVAL;
+    for (unsigned int i = 0; i < channels_.size(); i++) {
+        const PwmChannel& c = channels_[i];
+        if (c.onInNs_ == 0 || c.onInNs_ >= c.periodInNs_)
+            continue; // constant level
+        const uint64_t phase = (tInNs - originInNs_) % c.periodInNs_;
+        const uint64_t edge = (phase < c.onInNs_) ? tInNs + c.onInNs_ - phase : tInNs + c.periodInNs_ - phase;
+        if (edge < next)
+            next = edge;
+    }
+    return next;
+}
+
+// ----------------------------------------------------------------------
+
+void PwmGenerator::write(const uint64_t levels) {
+
+    levels_ = levels;
+    if (writeCallback_ != NULL)
+        writeCallback_(writeCallbackData_, (stateBits_ & ~pwmMask_) | (levels & pwmMask_), ~0ULL, stateIndex_);
+}
+
+// ----------------------------------------------------------------------
+
+void PwmGenerator::measure(const uint64_t levels, const uint64_t nowInNs) {
+
+    for (unsigned int i = 0; i < channels_.size(); i++) {
+        PwmChannel& c = channels_[i];
+        const uint64_t bit = 1ULL << c.pin_;
+        if ((levels & bit) == (levels_ & bit))
+            continue;
+
+        if (levels & bit) { // rising edge
+            if (c.lastRiseInNs_ != 0) {
+                const uint64_t period = nowInNs - c.lastRiseInNs_;
+                const uint64_t error = (period > c.periodInNs_) ? period - c.periodInNs_ : c.periodInNs_ - period;
+                c.numPeriods_++;
+                c.totalPeriodInNs_ += period;
+                if (error > c.maxPeriodErrorInNs_)
+                    c.maxPeriodErrorInNs_ = error;
+            }
+            c.lastRiseInNs_ = nowInNs;
+        } else if (c.lastRiseInNs_ != 0) { // falling edge
+            const uint64_t on = nowInNs - c.lastRiseInNs_;
+            const uint64_t error = (on > c.onInNs_) ? on - c.onInNs_ : c.onInNs_ - on;
+            c.numOnTimes_++;
+            c.totalOnErrorInNs_ += error;
+            if (error > c.maxOnErrorInNs_)
+                c.maxOnErrorInNs_ = error;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------
+
+bool PwmGenerator::receive(PwmState& state) {
+
+    unsigned int n = lastPosted_;
+    if (n == lastApplied_)
+        return false;
+
+    // the slot is read again if a later apply() has reused it meanwhile
+    do {
+        n = lastPosted_;
+        __sync_synchronize();
+        state = mailbox_[n % PWM_MAILBOX_SIZE];
+        __sync_synchronize();
+    } while (numPosted_ - n >= PWM_MAILBOX_SIZE);
+
+    lastApplied_ = n;
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+void PwmGenerator::setState(const PwmState& state) {
+
+    stateBits_ = state.stateBits_;
+    stateIndex_ = state.stateIndex_;
+    for (unsigned int i = 0; i < channels_.size(); i++) {
+        PwmChannel& c = channels_[i];
+        double duty = 0.;
+        if (stateBits_ & (1ULL << c.pin_))
+            duty = (stateIndex_ < c.duties_.size()) ? c.duties_[stateIndex_] : 100.;
+        c.onInNs_ = static_cast<uint64_t>(duty / 100. * c.periodInNs_ + 0.5);
+        // the edges caused by the state change are not PWM edges
+        c.lastRiseInNs_ = 0;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+bool PwmGenerator::process(void* obj) {
+
+    PwmGenerator* pwm = reinterpret_cast<PwmGenerator*>(obj);
+
+    const uint64_t now = SharedClock::getMonotonicTimeInNs();
+
+    // a state posted by apply() is written right away
+    PwmState state;
+    if (pwm->receive(state)) {
+        pwm->setState(state);
+        pwm->write(pwm->getLevels(now));
+        pwm->deadlineInNs_ = pwm->getNextEdge(now);
+        Scheduler::getInstance()->setTaskDeadline(pwm->taskId_, pwm->deadlineInNs_);
+        return true;
+    }
+
+    // woken up before the next edge (the deadline is kept)
+    if (now < pwm->deadlineInNs_)
+        return true;
+
+    uint64_t t = pwm->deadlineInNs_;
+    const uint64_t lateness = (now > t) ? now - t : 0;
+
+    // late by more than the shortest high or low time: resume from now
+    for (unsigned int i = 0; i < pwm->channels_.size(); i++) {
+        const PwmChannel& c = pwm->channels_[i];
+        if (c.onInNs_ > 0 && c.onInNs_ < c.periodInNs_ && (lateness >= c.onInNs_ || lateness >= c.periodInNs_ - c.onInNs_)) {
+            t = now;
+            pwm->numSkips_++;
+            break;
+        }
+    }
+
+    const uint64_t levels = pwm->getLevels(t);
+    if (levels != pwm->levels_) {
+        const uint64_t written = SharedClock::getMonotonicTimeInNs();
+        pwm->measure(levels, written);
+        pwm->write(levels);
+        pwm->numEdges_++;
+        pwm->totalLatenessInNs_ += lateness;
+        if (lateness > pwm->maxLatenessInNs_)
+            pwm->maxLatenessInNs_ = lateness;
+    }
+
+    pwm->deadlineInNs_ = pwm->getNextEdge(t);
+    Scheduler::getInstance()->setTaskDeadline(pwm->taskId_, pwm->deadlineInNs_);
+
+    return true;
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+PwmGenerator::PwmGenerator() :
+    pwmMask_(0),
+    writeCallback_(NULL),
+    writeCallbackData_(NULL),
+    numPosted_(0),
+    lastPosted_(0),
+    lastApplied_(0),
+    taskId_(-1),
+    originInNs_(0),
+    deadlineInNs_(0),
+    stateBits_(0),
+    stateIndex_(PORT_EVENT_NO_STATE),
+    levels_(0),
+    numEdges_(0),
+    numSkips_(0),
+    maxLatenessInNs_(0),
+    totalLatenessInNs_(0)
+{}
+
+// ----------------------------------------------------------------------
+
+PwmGenerator::~PwmGenerator() {
+
+    try {
+        stop();
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to stop PWM generator: " << e->getMessage();
+        delete e;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void PwmGenerator::setWriteCallback(PwmWriteCallback callback, void* data) {
+
+    writeCallback_ = callback;
+    writeCallbackData_ = data;
+}
+
+// ----------------------------------------------------------------------
+
+void PwmGenerator::addChannel(const unsigned int pin, const std::string name, const unsigned int periodInUs) throw(MyException*) {
+
+    if (isRunning())
+        throw new MyException("Unable to add PWM channel: the generator is running.");
+    if (channels_.size() >= PWM_MAX_CHANNELS)
+        throw new MyException("Unable to add PWM channel: too many channels.");
+    if (pin >= 64)
+        throw new MyException("Unable to add PWM channel: pin index must be lower than 64.");
+    if (pwmMask_ & (1ULL << pin))
+        throw new MyException("Unable to add PWM channel: pin " + name + " already has a channel.");
+    if (periodInUs == 0)
+        throw new MyException("Unable to add PWM channel: period must be positive.");
+
+    PwmChannel c;
+    c.pin_ = pin;
+    c.name_ = name;
+    c.periodInNs_ = 1000ULL * periodInUs;
+    c.onInNs_ = 0;
+    c.lastRiseInNs_ = 0;
+    c.numPeriods_ = 0;
+    c.totalPeriodInNs_ = 0;
+    c.maxPeriodErrorInNs_ = 0;
+    c.numOnTimes_ = 0;
+    c.totalOnErrorInNs_ = 0;
+    c.maxOnErrorInNs_ = 0;
+    channels_.push_back(c);
+    pwmMask_ |= (1ULL << pin);
+}
+
+// ----------------------------------------------------------------------
+
+void PwmGenerator::clearChannels() throw(MyException*) {
+
+    if (isRunning())
+        throw new MyException("Unable to clear PWM channels: the generator is running.");
+
+    channels_.clear();
+    pwmMask_ = 0;
+}
+
+// ----------------------------------------------------------------------
+
+void PwmGenerator::setDuty(const unsigned int channel, const unsigned int state, const double duty) throw(MyException*) {
+
+    if (isRunning())
+        throw new MyException("Unable to set PWM duty cycle: the generator is running.");
+    if (channel >= channels_.size())
+        throw new MyException("Unable to set PWM duty cycle: channel index is out of range.");
+    if (duty < 0 || duty > 100)
+        throw new MyException("Unable to set PWM duty cycle: duty cycle must be between 0 and 100%.");
+
+    std::vector<double>& duties = channels_[channel].duties_;
+    if (state >= duties.size())
+        duties.resize(state + 1, 100.);
+    duties[state] = duty;
+}
+
+// ----------------------------------------------------------------------
+
+void PwmGenerator::start() throw(MyException*) {
+
+    if (isRunning())
+        return;
+
+    for (unsigned int i = 0; i < channels_.size(); i++) {
+        PwmChannel& c = channels_[i];
+        c.onInNs_ = 0;
+        c.lastRiseInNs_ = 0;
+        c.numPeriods_ = 0;
+        c.totalPeriodInNs_ = 0;
+        c.maxPeriodErrorInNs_ = 0;
+        c.numOnTimes_ = 0;
+        c.totalOnErrorInNs_ = 0;
+        c.maxOnErrorInNs_ = 0;
+    }
+    numEdges_ = 0;
+    numSkips_ = 0;
+    maxLatenessInNs_ = 0;
+    totalLatenessInNs_ = 0;
+    stateBits_ = 0;
+    stateIndex_ = PORT_EVENT_NO_STATE;
+    levels_ = 0;
+    numPosted_ = 0;
+    lastPosted_ = 0;
+    lastApplied_ = 0;
+
+    originInNs_ = SharedClock::getMonotonicTimeInNs();
+    deadlineInNs_ = originInNs_ + PWM_PARK_INTERVAL;
+    taskId_ = Scheduler::getInstance()->addDeadlineTask(Scheduler::RT_LANE, &PwmGenerator::process, this, deadlineInNs_);
+}
+
+// ----------------------------------------------------------------------
+
+void PwmGenerator::stop() throw(MyException*) {
+
+    if (!isRunning())
+        return;
+
+    int taskId = taskId_;
+    taskId_ = -1;
+    Scheduler::getInstance()->removeTask(taskId);
+
+    LOG(INFO) << getReport();
+}
+
+// ----------------------------------------------------------------------
+
+void PwmGenerator::apply(const unsigned int stateIndex, const uint64_t stateBits) throw(MyException*) {
+
+    PwmState state;
+    state.stateIndex_ = stateIndex;
+    state.stateBits_ = stateBits;
+
+    // each caller writes its own slot, then publishes it unless a later state has been published
+    const unsigned int n = __sync_add_and_fetch(&numPosted_, 1);
+    mailbox_[n % PWM_MAILBOX_SIZE] = state;
+    __sync_synchronize();
+    unsigned int last = lastPosted_;
+    while ((int)(n - last) > 0 && !__sync_bool_compare_and_swap(&lastPosted_, last, n))
+        last = lastPosted_;
+
+    // the task writes the state as soon as possible
+    Scheduler::getInstance()->wakeTask(taskId_);
+}
+
+// ----------------------------------------------------------------------
+
+std::string PwmGenerator::getReport() {
+
+    std::stringstream ss;
+    ss << "PWM: " << numEdges_ << " edges, lateness mean " << getMeanLatenessInNs() / 1000. << " us, max "
+       << maxLatenessInNs_ / 1000. << " us, " << numSkips_ << " skips.";
+
+    for (unsigned int i = 0; i < channels_.size(); i++) {
+        const PwmChannel& c = channels_[i];
+        ss << std::endl << "PWM " << c.name_ << ": period " << c.periodInNs_ / 1000. << " us";
+        if (c.numPeriods_ > 0)
+            ss << ", measured frequency " << c.numPeriods_ * 1e9 / c.totalPeriodInNs_ << " Hz"
+               << ", max period error " << c.maxPeriodErrorInNs_ / 1000. << " us";
+        if (c.numOnTimes_ > 0)
+            ss << ", high time error mean " << c.totalOnErrorInNs_ / c.numOnTimes_ / 1000. << " us"
+               << ", max " << c.maxOnErrorInNs_ / 1000. << " us";
+        ss << ".";
+    }
+    return ss.str();
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+bool PwmGenerator::isRunning() { return taskId_ != -1; }
+unsigned int PwmGenerator::getNumChannels() { return channels_.size(); }
+const std::vector<PwmChannel>& PwmGenerator::getChannels() { return channels_; }
+uint64_t PwmGenerator::getMask() { return pwmMask_; }
+uint64_t PwmGenerator::getMaxLatenessInNs() { return maxLatenessInNs_; }
+uint64_t PwmGenerator::getMeanLatenessInNs() { return (numEdges_ > 0) ? totalLatenessInNs_ / numEdges_ : 0; }
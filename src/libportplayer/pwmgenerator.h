@@ -0,0 +1,223 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PWMGENERATOR_H
+#define PWMGENERATOR_H
+
+#include "myexception.h"
+#include "porteventlog.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Maximum number of PWM channels. */
+#define PWM_MAX_CHANNELS 16
+/** Time in ns after which the task is woken up again when no channel toggles. */
+#define PWM_PARK_INTERVAL 1000000000ULL
+/** Number of slots of the mailbox passing the states to the task. */
+#define PWM_MAILBOX_SIZE 8
+
+//! Library to interact with the environment (valves, LEDs, robots, etc.).
+namespace portplayer {
+
+/** Writes the pins selected by mask (bit i is the i-th pin of the manager). */
+typedef void (*PwmWriteCallback)(void* data, uint64_t values, uint64_t mask, unsigned int stateIndex);
+
+/**
+ * \brief Software PWM channel on a pin.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct PwmChannel {
+    /** Index of the pin in the manager. */
+    unsigned int pin_;
+    /** Name of the pin. */
+    std::string name_;
+    /** Period in ns. */
+    uint64_t periodInNs_;
+    /** Duty cycle in percent for each state of the playlist (100 for the states not given). */
+    std::vector<double> duties_;
+    /** Time in ns during which the pin is high in each period for the current state. */
+    uint64_t onInNs_;
+
+    /** Time in ns on CLOCK_MONOTONIC of the last rising edge written (0 if none since the last state change). */
+    uint64_t lastRiseInNs_;
+    /** Number of periods measured between two rising edges. */
+    unsigned long numPeriods_;
+    /** Sum of the periods measured in ns. */
+    uint64_t totalPeriodInNs_;
+    /** Maximum error in ns between a measured period and the period. */
+    uint64_t maxPeriodErrorInNs_;
+    /** Number of high times measured. */
+    unsigned long numOnTimes_;
+    /** Sum of the errors in ns between the measured high times and the high time. */
+    uint64_t totalOnErrorInNs_;
+    /** Maximum error in ns between a measured high time and the high time. */
+    uint64_t maxOnErrorInNs_;
+};
+
+/**
+ * \brief State posted to the PWM generator.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct PwmState {
+    /** Index of the state (PORT_EVENT_NO_STATE if none). */
+    unsigned int stateIndex_;
+    /** Pins of the state (bit i is the i-th pin). */
+    uint64_t stateBits_;
+};
+
+/**
+ * \brief Generates software PWM on selected pins.
+ *
+ * The generator runs as a deadline task of the RT lane of the Scheduler,
+ * woken up on the absolute time of the next edge of all channels (the edges
+ * of each channel are aligned on the start of the generator so that they
+ * never drift). The states of the playlist are applied through apply(), which
+ * posts the state to a mailbox and wakes up the task without lock, so that
+ * the callers (RT lane, input watcher, interface) never wait for each other
+ * nor for the task. The task applies the last state posted: the state of the
+ * pins without PWM and the current level of the PWM pins are merged in a
+ * single write of the port, and each PWM toggle rewrites the
+ * same merged output, so that the playlist and the generator never write
+ * the port separately. A PWM pin is driven only when it is on in the state,
+ * at the duty cycle given for the state.
+ *
+ * The lateness of the edges, the achieved period and the error on the high
+ * time are measured and reported when the generator stops.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class PwmGenerator {
+
+private:
+
+    /** PWM channels. */
+    std::vector<PwmChannel> channels_;
+    /** Pins driven by the channels. */
+    uint64_t pwmMask_;
+
+    /** Function writing the pins. */
+    PwmWriteCallback writeCallback_;
+    /** Data passed to the write function. */
+    void* writeCallbackData_;
+
+    /** States posted by apply(), the task only applies the last one. */
+    PwmState mailbox_[PWM_MAILBOX_SIZE];
+    /** Number of states posted (the n-th state is written to slot n % PWM_MAILBOX_SIZE). */
+    volatile unsigned int numPosted_;
+    /** Number of the last state completely written to the mailbox. */
+    volatile unsigned int lastPosted_;
+    /** Number of the last state applied by the task. */
+    unsigned int lastApplied_;
+    /** Id of the task registered on the RT lane (-1 if stopped). */
+    int taskId_;
+    /** Time in ns on CLOCK_MONOTONIC on which the periods are aligned. */
+    uint64_t originInNs_;
+    /** Time in ns on CLOCK_MONOTONIC of the next edge. */
+    uint64_t deadlineInNs_;
+    /** Pins of the current state. */
+    uint64_t stateBits_;
+    /** Index of the current state. */
+    unsigned int stateIndex_;
+    /** Levels of the PWM pins last written. */
+    uint64_t levels_;
+
+    /** Number of edges written by the task. */
+    unsigned long numEdges_;
+    /** Number of times the task was late by more than a period and skipped edges. */
+    unsigned long numSkips_;
+    /** Maximum lateness in ns of the edges. */
+    uint64_t maxLatenessInNs_;
+    /** Sum of the lateness in ns of the edges. */
+    uint64_t totalLatenessInNs_;
+
+    /** Returns the levels of the PWM pins at the given time. */
+    uint64_t getLevels(const uint64_t tInNs);
+    /** Returns the time of the first edge after the given time. */
+    uint64_t getNextEdge(const uint64_t tInNs);
+    /** Writes the state merged with the levels of the PWM pins. */
+    void write(const uint64_t levels);
+    /** Measures the periods and high times from the edges written by the task. */
+    void measure(const uint64_t levels, const uint64_t nowInNs);
+    /** Gets the last state posted to the mailbox, returns false if it has already been applied. */
+    bool receive(PwmState& state);
+    /** Sets the duty cycles of the channels for a state (task only). */
+    void setState(const PwmState& state);
+
+    /** Function run by the scheduler at each edge. */
+    static bool process(void* obj);
+
+public:
+
+    /** Constructor. */
+    PwmGenerator();
+    /** Destructor. */
+    ~PwmGenerator();
+
+    /** Sets the function writing the pins. */
+    void setWriteCallback(PwmWriteCallback callback, void* data);
+
+    /** Adds a channel on the given pin (the generator must be stopped). */
+    void addChannel(const unsigned int pin, const std::string name, const unsigned int periodInUs) throw(MyException*);
+    /** Removes all the channels (the generator must be stopped). */
+    void clearChannels() throw(MyException*);
+    /** Sets the duty cycle in percent of a channel for a state of the playlist. */
+    void setDuty(const unsigned int channel, const unsigned int state, const double duty) throw(MyException*);
+
+    /** Starts the generator (all PWM pins off), before any state is applied. */
+    void start() throw(MyException*);
+    /** Stops the generator and reports the timing measured. */
+    void stop() throw(MyException*);
+
+    /** Posts a state (bit i is the i-th pin) with the duty cycles of the state to the running generator (doesn't wait for the task). */
+    void apply(const unsigned int stateIndex, const uint64_t stateBits) throw(MyException*);
+
+    /** Returns a description of the timing measured for each channel. */
+    std::string getReport();
+
+    /** Returns true while the generator runs. */
+    bool isRunning();
+    /** Returns the number of channels. */
+    unsigned int getNumChannels();
+    /** Returns the channels. */
+    const std::vector<PwmChannel>& getChannels();
+    /** Returns the pins driven by the channels. */
+    uint64_t getMask();
+    /** Returns the maximum lateness in ns of the edges. */
+    uint64_t getMaxLatenessInNs();
+    /** Returns the mean lateness in ns of the edges. */
+    uint64_t getMeanLatenessInNs();
+};
+
+}
+
+#endif // PWMGENERATOR_H
@@ -27,10 +27,19 @@
 
 #include "cameramanager.h"
 #include "experimenttime.h"
+#include "scheduler.h"
 #include <glog/logging.h>
 #include <sys/select.h>
+#include <poll.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sstream>
+#include <algorithm>
 
 #define NUM_BUFFERS 1
+/** Timeout in ms of the poll of the capture fds, bounds the time to notice abort_. */
+#define CAPTURE_POLL_TIMEOUT 100
 
 using namespace squid;
 
@@ -94,6 +103,17 @@ void CameraManager::initialize(std::string dc1394) throw(MyException*) {
     abort_ = false;
     mode_ = FREERUN;
     saveFrame_ = false;
+    numDmaBuffers_ = NUM_BUFFERS;
+    triggerGating_ = false;
+    resetTriggerGating();
+    cycleTimerCorrelation_ = true;
+    correlationTaskId_ = -1;
+    for (unsigned int i = 0; i < MAX_CAMERAS; i++) {
+        for (unsigned int j = 0; j < MAX_DMA_BUFFERS; j++) {
+            frameMetadata_[i][j].captureErrorInNs_ = -1;
+            frameMetadata_[i][j].triggerId_ = -1;
+        }
+    }
 
     LOG(INFO) << "Detecting dc1394 cameras.";
     detectCameras();
@@ -162,7 +182,6 @@ void CameraManager::reset() {
     for (unsigned int i = 0; i < numActiveCameras; i++) {
         fps = activeCameras_[i]->getFpsEvaluator();
         fps->initialize();
-        fps->setRestart(true);
     }
 
     if (mode_ == CameraManager::SOFTWARE_TRIGGERS) {
@@ -192,7 +211,7 @@ void CameraManager::run() {
         for (unsigned int i = 0; i < numRunningCameras; i++) {
             if((err_ = dc1394_video_set_transmission(activeCameras_[i]->getCamera(), DC1394_ON)) != DC1394_SUCCESS)
                 dc1394_log_error("Could not start camera iso transmission.");
-            if ((err_ = dc1394_capture_setup(activeCameras_[i]->getCamera(), NUM_BUFFERS, DC1394_CAPTURE_FLAGS_DEFAULT)) != DC1394_SUCCESS)
+            if ((err_ = dc1394_capture_setup(activeCameras_[i]->getCamera(), numDmaBuffers_, DC1394_CAPTURE_FLAGS_DEFAULT)) != DC1394_SUCCESS)
                 dc1394_log_error("Could not setup camera make sure that the video mode and framerate are supported by your camera.");
         }
 
@@ -200,20 +219,49 @@ void CameraManager::run() {
         const bool triggerMode = (mode_ == CameraManager::SOFTWARE_TRIGGERS);
         if (triggerMode) {
             LOG(INFO) << "Setting trigger manager with period " << tmanager_->getIntervalInUs() << " us.";
-            tmanager_->setPostTriggerAction((pfv) &CameraManager::triggerFunction);
+            for (unsigned int i = 0; i < tmanager_->getNumChannels() && i < numRunningCameras; i++)
+                LOG(INFO) << "Trigger schedule of " << activeCameras_[i]->getCameraNameAndGuid() << ": period " << tmanager_->getSchedule(i).periodInUs_ << " us, phase " << tmanager_->getSchedule(i).phaseInUs_ << " us.";
+            if (triggerGating_)
+                LOG(INFO) << "Triggers are gated by WaitingForTrigger.";
+            resetTriggerGating();
+            tmanager_->clearTriggerCallbacks();
+            tmanager_->addTriggerCallback(&CameraManager::triggerCameras, this);
             LOG(INFO) << "Starting camera software trigger." << std::endl;
             tmanager_->start();
         }
 
+        // correlates the bus time of the cameras with the host clock
+        for (unsigned int i = 0; i < MAX_CAMERAS; i++) {
+            correlators_[i].initialize();
+            for (unsigned int j = 0; j < MAX_DMA_BUFFERS; j++) {
+                frameMetadata_[i][j].captureErrorInNs_ = -1;
+                frameMetadata_[i][j].triggerId_ = -1;
+            }
+        }
+        if (cycleTimerCorrelation_) {
+            LOG(INFO) << "Starting cycle timer correlation.";
+            try {
+                correlationTaskId_ = Scheduler::getInstance()->addTask(Scheduler::NON_RT_LANE, &CameraManager::sampleCycleTimers, this, CYCLE_TIMER_SAMPLING_INTERVAL);
+            } catch (MyException* e) {
+                LOG(WARNING) << "Unable to start cycle timer correlation, frames are stamped when dequeued: " << e->getMessage();
+            }
+        }
+
         for (unsigned int i = 0; i < numRunningCameras; i++) {
             LOG (INFO) << "Starting FPS evaluator for camera " << activeCameras_[i]->getCameraNameAndGuid() << ".";
-            activeCameras_[i]->getFpsEvaluator()->start(QThread::LowestPriority);
+            activeCameras_[i]->getFpsEvaluator()->start();
         }
 
 
         // do not save the frame by default when starting the camera
         saveFrame_ = false;
 
+        // a frame is ready on a camera when its capture fd is readable
+        std::vector<struct pollfd> captureFds(numRunningCameras);
+        for (unsigned int i = 0; i < numRunningCameras; i++) {
+            captureFds[i].fd = dc1394_capture_get_fileno(activeCameras_[i]->getCamera());
+            captureFds[i].events = POLLIN;
+        }
 
         forever {
             if (abort_) {
@@ -221,9 +269,13 @@ void CameraManager::run() {
                 if (triggerMode) {
                     LOG (INFO) << "Stopping camera software trigger.";
                     tmanager_->stop();
-                    tmanager_->setPostTriggerAction((pfv) &FdTriggerManager::defaultPostTriggerAction);
+                    tmanager_->clearTriggerCallbacks();
                 }
 
+                // stop cycle timer correlation
+                Scheduler::getInstance()->removeTask(correlationTaskId_);
+                correlationTaskId_ = -1;
+
                 // stop FPS evaluators
                 for (unsigned int i = 0; i < numRunningCameras; i++) {
                     LOG (INFO) << "Stopping FPS evaluator of camera " << activeCameras_[i]->getCameraNameAndGuid() << ".";
@@ -245,27 +297,34 @@ void CameraManager::run() {
                 return;
             }
 
-            // when capturing a frame you can choose to either wait for the frame indefinitely (WAIT)
-            // or return immediately if no frame arrived yet (POLL).
+            // waits for the first camera having a frame ready rather than dequeuing the
+            // cameras in turn with WAIT, which throttles each camera to the slowest one
+            // and overflows the DMA ring of the cameras triggered at a higher rate
+            for (unsigned int i = 0; i < numRunningCameras; i++)
+                captureFds[i].revents = 0;
+            if (poll(&captureFds[0], numRunningCameras, CAPTURE_POLL_TIMEOUT) < 0 && errno != EINTR)
+                dc1394_log_error("Failed to poll the cameras.");
+
             for (unsigned int i = 0; i < numRunningCameras; i++) {
+                if (!(captureFds[i].revents & POLLIN))
+                    continue;
                 Dc1394Camera* camera = activeCameras_[i];
-                dc1394video_frame_t* frame = camera->frame_.frame_;
+                dc1394video_frame_t* frame = NULL;
 
-                // dequeue to get the image :)
-                if (dc1394_capture_dequeue(activeCameras_[i]->getCamera(), DC1394_CAPTURE_POLICY_WAIT, &frame) != DC1394_SUCCESS)
-                    dc1394_log_error("Failed to capture frame.");
+                // dequeue all the frames ready on this camera (POLL returns NULL when none is left)
+                while (dc1394_capture_dequeue(camera->getCamera(), DC1394_CAPTURE_POLICY_POLL, &frame) == DC1394_SUCCESS && frame != NULL) {
 
-                // SIGNAL SENT WHEN A FRAME IS GRABBED
-                unsigned int us = 0;
-                if (grabReferenceTimer_ != NULL)
-                    us = grabReferenceTimer_->getElapsedTimeInUs();
-                emit frameCaptured(frame, i, us, saveFrame_);
+                    // SIGNAL SENT WHEN A FRAME IS GRABBED
+                    emit frameCaptured(frame, i, getFrameTimeInUs(i, frame), saveFrame_);
 
-                camera->getFpsEvaluator()->incrementNumFrames();
+                    camera->getFpsEvaluator()->incrementNumFrames();
+                    measureBusyTime(i);
 
-                // otherwise the buffer will saturate
-                if ((err_ = dc1394_capture_enqueue(activeCameras_[i]->getCamera(), frame)) != DC1394_SUCCESS)
-                    dc1394_log_error("Could not enqueue frame.");
+                    // otherwise the buffer will saturate
+                    if ((err_ = dc1394_capture_enqueue(camera->getCamera(), frame)) != DC1394_SUCCESS)
+                        dc1394_log_error("Could not enqueue frame.");
+                    frame = NULL;
+                }
             }
 
             mutex_.lock();
@@ -353,14 +412,173 @@ bool CameraManager::setCameraPassive(std::string guid) throw(MyException*) {
 // ----------------------------------------------------------------------
 
 /** Only use the CameraManager pointer got from getInstance(). */
-void CameraManager::triggerFunction(int /*triggerId*/) {
+void CameraManager::triggerCameras(void* obj, const TriggerEvent& event) {
 
-    CameraManager* cmanager = CameraManager::getInstance(); // access could be improved
-    const unsigned int n = cmanager->getNumActiveCameras();
+    CameraManager* cmanager = reinterpret_cast<CameraManager*>(obj);
+    const unsigned int n = std::min(cmanager->getNumActiveCameras(), (unsigned int)MAX_CAMERAS);
+    // cameras whose schedule is due (all of them without per-camera schedules)
     for (unsigned int i = 0; i < n; i++) {
-        if ((cmanager->err_ = dc1394_software_trigger_set_power(cmanager->getActiveCamera(i)->getCamera(), DC1394_ON)) != DC1394_SUCCESS)
-            LOG(WARNING) << "Could not send software trigger.";
+        if (!(event.mask_ & (1 << i)))
+            continue;
+        Dc1394Camera* camera = cmanager->getActiveCamera(i);
+
+        // a trigger sent while the camera is still exposing or reading out is silently lost:
+        // it is refused without waiting so that the other cameras are triggered on time,
+        // the next trigger of the schedule retries
+        if (cmanager->triggerGating_ && !camera->isWaitingForTrigger()) {
+            cmanager->numRefusedTriggers_[i]++;
+            continue;
+        }
+
+        if ((cmanager->err_ = dc1394_software_trigger_set_power(camera->getCamera(), DC1394_ON)) != DC1394_SUCCESS)
+            LOG_FIRST_N(WARNING, 10) << "Could not send software trigger.";
+        const uint64_t sent = SharedClock::getMonotonicTimeInNs();
+        __sync_lock_test_and_set(&cmanager->pendingTriggerInNs_[i], sent);
+
+        // the entry is invalidated while it is written
+        const unsigned int numSent = cmanager->numSentTriggers_[i];
+        TriggerTime& entry = cmanager->sentTriggers_[i][numSent % CAMERA_TRIGGER_HISTORY_SIZE];
+        entry.triggerId_ = -1;
+        __sync_synchronize();
+        entry.scheduledInNs_ = event.scheduledInNs_;
+        entry.sentInNs_ = sent;
+        __sync_synchronize();
+        entry.triggerId_ = event.triggerId_;
+        cmanager->numSentTriggers_[i] = numSent + 1;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void CameraManager::measureBusyTime(const unsigned int index) {
+
+    if (index >= MAX_CAMERAS)
+        return;
+
+    // the frame of the last trigger is out, the camera is ready again: the time
+    // since the trigger is an upper bound of the time it has been busy
+    const uint64_t triggerInNs = __sync_fetch_and_and(&pendingTriggerInNs_[index], 0);
+    const uint64_t now = SharedClock::getMonotonicTimeInNs();
+    if (triggerInNs > 0 && now > triggerInNs)
+        maxBusyInNs_[index] = std::max(maxBusyInNs_[index], now - triggerInNs);
+}
+
+// ----------------------------------------------------------------------
+
+void CameraManager::resetTriggerGating() {
+
+    for (unsigned int i = 0; i < MAX_CAMERAS; i++) {
+        numRefusedTriggers_[i] = 0;
+        pendingTriggerInNs_[i] = 0;
+        maxBusyInNs_[i] = 0;
+        numSentTriggers_[i] = 0;
+        for (unsigned int j = 0; j < CAMERA_TRIGGER_HISTORY_SIZE; j++)
+            sentTriggers_[i][j].triggerId_ = -1;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+bool CameraManager::sampleCycleTimers(void* obj) {
+
+    CameraManager* cmanager = reinterpret_cast<CameraManager*>(obj);
+
+    const unsigned int n = std::min(cmanager->getNumActiveCameras(), (unsigned int)MAX_CAMERAS);
+    for (unsigned int i = 0; i < n; i++)
+        cmanager->correlators_[i].sample(cmanager->activeCameras_[i]->getCamera());
+
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+unsigned int CameraManager::getFrameTimeInUs(const unsigned int index, dc1394video_frame_t* frame) {
+
+    if (grabReferenceTimer_ == NULL)
+        return 0;
+
+    // the metadata are stored with the buffer of the frame, not read again when it is saved
+    FrameMetadata* metadata = (index < MAX_CAMERAS) ? &frameMetadata_[index][frame->id % MAX_DMA_BUFFERS] : NULL;
+
+    // capture time derived from the bus time, otherwise time of dequeuing
+    uint64_t monotonicInNs, errorInNs;
+    if (cycleTimerCorrelation_ && metadata != NULL && correlators_[index].convertHostTimestamp(frame->timestamp, monotonicInNs, errorInNs)) {
+        metadata->captureErrorInNs_ = errorInNs;
+        metadata->triggerId_ = (mode_ == SOFTWARE_TRIGGERS) ? findTrigger(index, monotonicInNs) : -1;
+        return grabReferenceTimer_->toElapsedTimeInNs(monotonicInNs) / 1000;
+    }
+
+    if (metadata != NULL) {
+        metadata->captureErrorInNs_ = -1;
+        // the host timestamp of the frame (wall clock) is still more accurate than the dequeuing
+        // to find its trigger, as a new trigger may have been sent since the end of the readout
+        uint64_t captureInNs = SharedClock::getMonotonicTimeInNs();
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        const uint64_t nowInUs = (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+        if (frame->timestamp <= nowInUs && (nowInUs - frame->timestamp) * 1000 < captureInNs)
+            captureInNs -= (nowInUs - frame->timestamp) * 1000;
+        metadata->triggerId_ = (mode_ == SOFTWARE_TRIGGERS) ? findTrigger(index, captureInNs) : -1;
+    }
+    return grabReferenceTimer_->getElapsedTimeInUs();
+}
+
+// ----------------------------------------------------------------------
+
+int CameraManager::findTrigger(const unsigned int index, const uint64_t captureInNs) {
+
+    // walks back from the last trigger sent to the camera
+    const unsigned int n = numSentTriggers_[index];
+    for (unsigned int k = 0; k < n && k < CAMERA_TRIGGER_HISTORY_SIZE; k++) {
+        const TriggerTime& entry = sentTriggers_[index][(n - 1 - k) % CAMERA_TRIGGER_HISTORY_SIZE];
+        const int triggerId = entry.triggerId_;
+        if (triggerId < 0)
+            continue;
+        __sync_synchronize();
+        const uint64_t sentInNs = entry.sentInNs_;
+        __sync_synchronize();
+        // the entry may have been overwritten in the meantime
+        if (entry.triggerId_ != triggerId)
+            continue;
+        if (sentInNs <= captureInNs)
+            return triggerId;
+    }
+
+    return -1;
+}
+
+// ----------------------------------------------------------------------
+
+std::string CameraManager::getCycleTimerReport() {
+
+    std::stringstream ss;
+    if (!cycleTimerCorrelation_) {
+        ss << "Cycle timer correlation: disabled" << std::endl;
+        return ss.str();
+    }
+    ss << "Cycle timer correlation:" << std::endl;
+    for (unsigned int i = 0; i < getNumActiveCameras() && i < MAX_CAMERAS; i++)
+        ss << "Camera " << i << ": " << correlators_[i].getSummary() << std::endl;
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------
+
+std::string CameraManager::getTriggerGatingReport() {
+
+    std::stringstream ss;
+    if (!triggerGating_) {
+        ss << "Trigger gating: disabled" << std::endl;
+        return ss.str();
+    }
+    ss << "Trigger gating: enabled" << std::endl;
+    for (unsigned int i = 0; i < getNumActiveCameras() && i < MAX_CAMERAS; i++) {
+        ss << "Camera " << i << ": " << numRefusedTriggers_[i] << " refused";
+        if (maxBusyInNs_[i] > 0)
+            ss << ", minimum safe period " << getMinSafeTriggerPeriodInUs(i) << " us";
+        ss << std::endl;
     }
+    return ss.str();
 }
 
 // ----------------------------------------------------------------------
@@ -427,8 +645,23 @@ Dc1394Camera* CameraManager::getActiveCamera(const unsigned int index) { return
 
 void CameraManager::setSaveFrame(bool saveFrame) {
 
-    mutex_.lock();
+    // the flag is read by the capture thread with each frame
     saveFrame_ = saveFrame;
-    mutex_.unlock();
+    __sync_synchronize();
 }
 bool CameraManager::getSaveFrame() { return saveFrame_; }
+
+void CameraManager::setTriggerGating(bool b) { triggerGating_ = b; }
+bool CameraManager::getTriggerGating() { return triggerGating_; }
+
+
+unsigned long CameraManager::getNumRefusedTriggers(const unsigned int index) { return numRefusedTriggers_[index % MAX_CAMERAS]; }
+unsigned int CameraManager::getMinSafeTriggerPeriodInUs(const unsigned int index) { return maxBusyInNs_[index % MAX_CAMERAS] / 1000; }
+
+void CameraManager::setCycleTimerCorrelation(bool b) { cycleTimerCorrelation_ = b; }
+bool CameraManager::getCycleTimerCorrelation() { return cycleTimerCorrelation_; }
+
+void CameraManager::setNumDmaBuffers(unsigned int numBuffers) { numDmaBuffers_ = std::min(std::max(numBuffers, 1u), (unsigned int)MAX_DMA_BUFFERS); }
+unsigned int CameraManager::getNumDmaBuffers() { return numDmaBuffers_; }
+CycleTimeCorrelator* CameraManager::getCycleTimeCorrelator(const unsigned int index) { return &correlators_[index % MAX_CAMERAS]; }
+FrameMetadata CameraManager::getFrameMetadata(const unsigned int index, dc1394video_frame_t* frame) { return frameMetadata_[index % MAX_CAMERAS][frame->id % MAX_DMA_BUFFERS]; }
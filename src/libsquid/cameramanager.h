@@ -31,7 +31,8 @@
 #include "dc1394camera.h"
 #include "fdtriggermanager.h"
 #include "fpsevaluator.h"
-#include "highresolutiontime.h"
+#include "cycletimecorrelator.h"
+#include "sharedclock.h"
 #include <vector>
 #include <QThread>
 #include <QMutex>
@@ -41,10 +42,30 @@
 #define MAX_CAMERAS 16
 /** Max number of 1s-separated tries to get one camera ready. */
 #define MAX_CAMERA_DETECTION_TRIES 20
+/** Max number of DMA buffers allocated to each camera to absorb a burst. */
+#define MAX_DMA_BUFFERS 64
+/** Number of triggers sent to each camera kept to find the trigger of a frame. */
+#define CAMERA_TRIGGER_HISTORY_SIZE 64
 
 //! Library to control multiple cameras and manage the experiments.
 namespace squid {
 
+/**
+ * \brief Metadata of a frame recorded when it is dequeued.
+ *
+ * The metadata are stored with the DMA buffer of the frame so that the slots
+ * receiving the frame later read the values that applied at its capture.
+ *
+ * @version March 16, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct FrameMetadata {
+    /** Estimated error in ns of the capture time of the frame (-1 = time of dequeuing). */
+    int64_t captureErrorInNs_;
+    /** Id of the trigger which exposed the frame (-1 = unknown or FREERUN). */
+    int triggerId_;
+};
+
 /**
  * \brief Manage the dc1394 cameras (Singleton pattern).
  *
@@ -65,8 +86,8 @@ public:
         SOFTWARE_TRIGGERS = 1
     };
 
-    /** Reference to a time to get timestamp for grabbed image. Declared as public for prototyping. */
-    HighResolutionTime* grabReferenceTimer_;
+    /** Reference to a clock to get timestamp for grabbed image. Declared as public for prototyping. */
+    SharedClock* grabReferenceTimer_;
 
 private:
 
@@ -85,11 +106,35 @@ private:
     /** Camera mode (0 = FREERUN, 1 = SOFTWARE_TRIGGERS). */
     cameraMode mode_;
     /** Tag the frame sent to know if it must be saved or not. */
-    bool saveFrame_;
+    volatile bool saveFrame_;
+    /** Number of DMA buffers allocated to each camera (frames which can wait to be dequeued). */
+    unsigned int numDmaBuffers_;
 
     /** Used to send the triggers to the camera. */
     FdTriggerManager* tmanager_;
 
+    /** If true, a trigger is only sent to a camera which signals WaitingForTrigger on GPOut2. */
+    bool triggerGating_;
+    /** Number of triggers not sent because the camera was still busy. */
+    unsigned long numRefusedTriggers_[MAX_CAMERAS];
+    /** Time in ns at which the last trigger whose frame has not been dequeued yet has been sent (0 = none). */
+    uint64_t pendingTriggerInNs_[MAX_CAMERAS];
+    /** Longest time in ns between a trigger and the dequeue of its frame (0 = never measured). */
+    uint64_t maxBusyInNs_[MAX_CAMERAS];
+    /** Last triggers actually sent to each camera (ring buffer written by the trigger thread). */
+    TriggerTime sentTriggers_[MAX_CAMERAS][CAMERA_TRIGGER_HISTORY_SIZE];
+    /** Number of triggers sent to each camera. */
+    volatile unsigned int numSentTriggers_[MAX_CAMERAS];
+
+    /** If true, frames are stamped with their capture time derived from the bus time. */
+    bool cycleTimerCorrelation_;
+    /** Correlation between the bus time and the host clock of each active camera. */
+    CycleTimeCorrelator correlators_[MAX_CAMERAS];
+    /** Metadata of the frame held by each DMA buffer of each active camera. */
+    FrameMetadata frameMetadata_[MAX_CAMERAS][MAX_DMA_BUFFERS];
+    /** Id of the sampling task registered on the scheduler. */
+    int correlationTaskId_;
+
     /** Mutex. */
     QMutex mutex_;
     /** Condition for waiting. */
@@ -163,11 +208,38 @@ public:
     /** Returns dc1394 mode. */
     std::string getDc1394() const;
 
-    /** Indiquates that the frames emitted should be saved. */
+    /** Indiquates that the frames emitted should be saved (doesn't block, e.g. from an input callback). */
     void setSaveFrame(bool saveFrame);
     /** Returns true if frames are currently being saved. */
     bool getSaveFrame();
 
+    /** Enables the gating of the triggers by the WaitingForTrigger signal of the cameras (GPOut2). */
+    void setTriggerGating(bool b);
+    /** Returns true if the triggers are gated by the readiness of the cameras. */
+    bool getTriggerGating();
+    /** Returns the number of triggers refused by an active camera (still busy). */
+    unsigned long getNumRefusedTriggers(const unsigned int index);
+    /** Returns the minimum safe trigger period in us measured for an active camera (0 = not measured). */
+    unsigned int getMinSafeTriggerPeriodInUs(const unsigned int index);
+    /** Returns a report of the gating (refused triggers, minimum safe period). */
+    std::string getTriggerGatingReport();
+
+    /** Enables stamping the frames with their capture time derived from the FireWire cycle timer. */
+    void setCycleTimerCorrelation(bool b);
+    /** Returns true if the frames are stamped with their capture time derived from the cycle timer. */
+    bool getCycleTimerCorrelation();
+    /** Returns the correlation between the bus time and the host clock of an active camera. */
+    CycleTimeCorrelator* getCycleTimeCorrelator(const unsigned int index);
+    /** Returns the metadata recorded when a frame of an active camera has been dequeued. */
+    FrameMetadata getFrameMetadata(const unsigned int index, dc1394video_frame_t* frame);
+    /** Returns a report of the correlation of each active camera. */
+    std::string getCycleTimerReport();
+
+    /** Sets the number of DMA buffers of each camera (applied when the cameras are started). */
+    void setNumDmaBuffers(unsigned int numBuffers);
+    /** Returns the number of DMA buffers of each camera. */
+    unsigned int getNumDmaBuffers();
+
 public slots:
 
     /** Start thread. */
@@ -201,8 +273,19 @@ private:
     /** Make connections. */
     void makeConnections();
 
-    /** Function called each time a trigger is generated. */
-    void triggerFunction(int triggerId);
+    /** Callback executed by the RT thread of the trigger manager at every trigger. */
+    static void triggerCameras(void* obj, const TriggerEvent& event);
+    /** Measures the time the camera has been busy since its last trigger, called when one of its frames is dequeued. */
+    void measureBusyTime(const unsigned int index);
+    /** Resets the counters of the trigger gating. */
+    void resetTriggerGating();
+
+    /** Function run periodically by the scheduler to sample the cycle timers of the active cameras. */
+    static bool sampleCycleTimers(void* obj);
+    /** Returns the time in us of a frame on the experiment clock and records its metadata. */
+    unsigned int getFrameTimeInUs(const unsigned int index, dc1394video_frame_t* frame);
+    /** Returns the id of the last trigger sent to a camera before captureInNs (CLOCK_MONOTONIC), -1 if unknown. */
+    int findTrigger(const unsigned int index, const uint64_t captureInNs);
 };
 
 } // end namespace squid
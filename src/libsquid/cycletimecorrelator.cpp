@@ -0,0 +1,261 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "cycletimecorrelator.h"
+#include "sharedclock.h"
+#include <cmath>
+#include <sstream>
+#include <glog/logging.h>
+
+using namespace squid;
+
+// ======================================================================
+// TIME MAPPING
+
+uint64_t TimeMapping::map(uint64_t x) const {
+
+    const double dx = (double)(int64_t)(x - xRef_);
+    return yRef_ + (int64_t)llround(slope_ * dx);
+}
+
+// ======================================================================
+// PRIVATE METHODS
+
+double CycleTimeCorrelator::fit(uint64_t Sample::*x, uint64_t Sample::*y, TimeMapping& mapping) {
+
+    const unsigned int n = (numSamples_ < CYCLE_TIMER_NUM_SAMPLES) ? numSamples_ : CYCLE_TIMER_NUM_SAMPLES;
+    const Sample& last = samples_[(numSamples_ - 1) % CYCLE_TIMER_NUM_SAMPLES];
+
+    // values relative to the last sample to keep the precision of doubles
+    double meanX = 0., meanY = 0.;
+    for (unsigned int i = 0; i < n; i++) {
+        meanX += (double)(int64_t)(samples_[i].*x - last.*x);
+        meanY += (double)(int64_t)(samples_[i].*y - last.*y);
+    }
+    meanX /= n;
+    meanY /= n;
+
+    double sxx = 0., sxy = 0.;
+    for (unsigned int i = 0; i < n; i++) {
+        const double dx = (double)(int64_t)(samples_[i].*x - last.*x) - meanX;
+        const double dy = (double)(int64_t)(samples_[i].*y - last.*y) - meanY;
+        sxx += dx * dx;
+        sxy += dx * dy;
+    }
+
+    // the mapping is expressed at the last sample
+    mapping.slope_ = (sxx > 0.) ? sxy / sxx : 1.;
+    mapping.xRef_ = last.*x;
+    mapping.yRef_ = last.*y + (int64_t)llround(meanY - mapping.slope_ * meanX);
+
+    double sse = 0.;
+    for (unsigned int i = 0; i < n; i++) {
+        const double residual = (double)(int64_t)(samples_[i].*y - mapping.map(samples_[i].*x));
+        sse += residual * residual;
+    }
+
+    return sqrt(sse / n);
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+CycleTimeCorrelator::CycleTimeCorrelator() {
+
+    sequence_ = 0;
+    initialize();
+}
+
+// ----------------------------------------------------------------------
+
+void CycleTimeCorrelator::initialize() {
+
+    sequence_++;
+    __sync_synchronize();
+    valid_ = false;
+    errorInNs_ = 0;
+    __sync_synchronize();
+    sequence_++;
+
+    numSamples_ = 0;
+    numRejectedSamples_ = 0;
+    lastBusInNs_ = 0;
+    busWrapInNs_ = 0;
+}
+
+// ----------------------------------------------------------------------
+
+bool CycleTimeCorrelator::sample(dc1394camera_t* camera) {
+
+    uint32_t cycleTimer;
+    uint64_t hostInUs;
+
+    const uint64_t before = SharedClock::getMonotonicTimeInNs();
+    if (dc1394_read_cycle_timer(camera, &cycleTimer, &hostInUs) != DC1394_SUCCESS) {
+        numRejectedSamples_++;
+        return false;
+    }
+    const uint64_t after = SharedClock::getMonotonicTimeInNs();
+
+    // unwrap the bus time (the seconds field wraps every 128 s)
+    const uint64_t busInNs = cycleTimerToNs(cycleTimer);
+    if (numSamples_ + numRejectedSamples_ > 0 && busInNs < lastBusInNs_)
+        busWrapInNs_ += CYCLE_TIMER_WRAP_IN_NS;
+    lastBusInNs_ = busInNs;
+
+    // the thread has been preempted while reading
+    if (after - before > CYCLE_TIMER_MAX_READ_SPAN * 1000ULL) {
+        numRejectedSamples_++;
+        return false;
+    }
+
+    Sample& sample = samples_[numSamples_ % CYCLE_TIMER_NUM_SAMPLES];
+    sample.busInNs_ = busWrapInNs_ + busInNs;
+    sample.hostInNs_ = hostInUs * 1000;
+    sample.halfSpanInNs_ = (after - before) / 2;
+    sample.monotonicInNs_ = before + sample.halfSpanInNs_;
+    numSamples_++;
+
+    if (numSamples_ < CYCLE_TIMER_MIN_SAMPLES)
+        return true;
+
+    TimeMapping hostToBus, busToMonotonic;
+    fit(&Sample::hostInNs_, &Sample::busInNs_, hostToBus);
+    const double rms = fit(&Sample::busInNs_, &Sample::monotonicInNs_, busToMonotonic);
+
+    const unsigned int n = (numSamples_ < CYCLE_TIMER_NUM_SAMPLES) ? numSamples_ : CYCLE_TIMER_NUM_SAMPLES;
+    uint64_t halfSpan = 0;
+    for (unsigned int i = 0; i < n; i++)
+        halfSpan += samples_[i].halfSpanInNs_;
+
+    // publish the new mappings
+    sequence_++;
+    __sync_synchronize();
+    hostToBus_ = hostToBus;
+    busToMonotonic_ = busToMonotonic;
+    errorInNs_ = (uint64_t)llround(rms) + halfSpan / n;
+    valid_ = true;
+    __sync_synchronize();
+    sequence_++;
+
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+bool CycleTimeCorrelator::convertHostTimestamp(uint64_t timestampInUs, uint64_t& monotonicInNs, uint64_t& errorInNs) {
+
+    unsigned int sequence;
+    TimeMapping hostToBus, busToMonotonic;
+    bool valid;
+    do {
+        sequence = sequence_;
+        __sync_synchronize();
+        hostToBus = hostToBus_;
+        busToMonotonic = busToMonotonic_;
+        errorInNs = errorInNs_;
+        valid = valid_;
+        __sync_synchronize();
+    } while ((sequence & 1) || sequence != sequence_);
+
+    if (!valid)
+        return false;
+
+    monotonicInNs = busToMonotonic.map(hostToBus.map(timestampInUs * 1000));
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+bool CycleTimeCorrelator::convertBusTime(uint64_t busInNs, uint64_t& monotonicInNs) {
+
+    unsigned int sequence;
+    TimeMapping busToMonotonic;
+    bool valid;
+    do {
+        sequence = sequence_;
+        __sync_synchronize();
+        busToMonotonic = busToMonotonic_;
+        valid = valid_;
+        __sync_synchronize();
+    } while ((sequence & 1) || sequence != sequence_);
+
+    if (!valid)
+        return false;
+
+    monotonicInNs = busToMonotonic.map(busInNs);
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+double CycleTimeCorrelator::getDriftInPpm() {
+
+    unsigned int sequence;
+    double slope;
+    do {
+        sequence = sequence_;
+        __sync_synchronize();
+        slope = busToMonotonic_.slope_;
+        __sync_synchronize();
+    } while ((sequence & 1) || sequence != sequence_);
+
+    return (1. / slope - 1.) * 1000000.;
+}
+
+// ----------------------------------------------------------------------
+
+std::string CycleTimeCorrelator::getSummary() {
+
+    std::stringstream ss;
+    if (!isValid())
+        ss << "not established (" << numSamples_ << " samples, " << numRejectedSamples_ << " rejected)";
+    else
+        ss << "error " << getErrorInNs() / 1000. << " us, drift " << getDriftInPpm() << " ppm (" << numSamples_ << " samples, " << numRejectedSamples_ << " rejected)";
+
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t CycleTimeCorrelator::cycleTimerToNs(uint32_t cycleTimer) {
+
+    // 7 bits of seconds, 13 bits of cycles (8000 per second) and 12 bits of
+    // offset (3072 ticks of the 24.576 MHz clock per cycle)
+    const uint64_t seconds = (cycleTimer >> 25) & 0x7f;
+    const uint64_t cycles = (cycleTimer >> 12) & 0x1fff;
+    const uint64_t offset = cycleTimer & 0xfff;
+
+    return seconds * 1000000000ULL + cycles * 125000ULL + (offset * 125000ULL) / 3072;
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+bool CycleTimeCorrelator::isValid() { return valid_; }
+unsigned long CycleTimeCorrelator::getNumSamples() { return numSamples_; }
+unsigned long CycleTimeCorrelator::getNumRejectedSamples() { return numRejectedSamples_; }
+uint64_t CycleTimeCorrelator::getErrorInNs() { return errorInNs_; }
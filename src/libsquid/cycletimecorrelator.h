@@ -0,0 +1,169 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CYCLETIMECORRELATOR_H
+#define CYCLETIMECORRELATOR_H
+
+#include "dc1394/dc1394.h"
+#include <stdint.h>
+#include <string>
+
+//! Library to control multiple cameras and manage the experiments.
+namespace squid {
+
+/** Interval in us between two samples of the cycle timer. */
+#define CYCLE_TIMER_SAMPLING_INTERVAL 100000
+/** Number of samples used to fit the mapping (sliding window). */
+#define CYCLE_TIMER_NUM_SAMPLES 32
+/** Minimum number of samples before the mapping is used. */
+#define CYCLE_TIMER_MIN_SAMPLES 4
+/** Samples for which reading the cycle timer took longer than this (in us) are rejected. */
+#define CYCLE_TIMER_MAX_READ_SPAN 200
+/** Period of the cycle timer in ns (the seconds field wraps at 128 s). */
+#define CYCLE_TIMER_WRAP_IN_NS 128000000000ULL
+
+/**
+ * \brief Linear mapping y = yRef + slope * (x - xRef) between two time bases in ns.
+ *
+ * @version March 16, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct TimeMapping {
+    /** Reference point on the source time base. */
+    uint64_t xRef_;
+    /** Reference point on the destination time base. */
+    uint64_t yRef_;
+    /** Rate of the destination time base relative to the source. */
+    double slope_;
+
+    /** Maps a time from the source to the destination time base. */
+    uint64_t map(uint64_t x) const;
+};
+
+/**
+ * \brief Correlates the FireWire bus time of a camera with the host clock.
+ *
+ * sample() reads the cycle timer of the bus together with the host time at
+ * which the kernel read it (dc1394_read_cycle_timer()) and the monotonic time
+ * before and after the call. Over a sliding window of samples, two linear
+ * mappings are fitted by least squares: host timestamps (the domain of the
+ * timestamps of the dc1394 frames) to bus time, and bus time to monotonic time.
+ * The slope of the latter corrects the drift between the bus and the host
+ * clocks; the residuals and the time spent reading give the estimated error.
+ *
+ * The timestamp of a dc1394 frame is taken by the driver when the frame has
+ * been received. Mapping it through the bus time gives a capture time free of
+ * the scheduling noise of the thread dequeuing the frames.
+ *
+ * sample() is called by one thread only. The mapping is published through a
+ * seqlock so that the capture thread converts timestamps without lock.
+ *
+ * @version March 16, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class CycleTimeCorrelator {
+
+private:
+
+    /** Sample of the cycle timer. */
+    struct Sample {
+        /** Bus time in ns (unwrapped). */
+        uint64_t busInNs_;
+        /** Host time in ns at which the kernel read the cycle timer. */
+        uint64_t hostInNs_;
+        /** Monotonic time in ns in the middle of the read. */
+        uint64_t monotonicInNs_;
+        /** Half of the time spent reading in ns. */
+        uint64_t halfSpanInNs_;
+    };
+
+    /** Sliding window of samples. */
+    Sample samples_[CYCLE_TIMER_NUM_SAMPLES];
+    /** Total number of samples accepted. */
+    unsigned long numSamples_;
+    /** Number of samples rejected (read failed or too slow). */
+    unsigned long numRejectedSamples_;
+    /** Last bus time read in ns (wrapped). */
+    uint64_t lastBusInNs_;
+    /** Time in ns to add to the bus time to unwrap it. */
+    uint64_t busWrapInNs_;
+
+    /** Sequence number of the seqlock, odd while the mappings are updated. */
+    volatile unsigned int sequence_;
+    /** Mapping from host timestamps to bus time. */
+    TimeMapping hostToBus_;
+    /** Mapping from bus time to monotonic time. */
+    TimeMapping busToMonotonic_;
+    /** Estimated error in ns of the conversions. */
+    uint64_t errorInNs_;
+    /** Is true once enough samples have been fitted. */
+    bool valid_;
+
+    /** Fits a mapping on the window of samples, returns the RMS of the residuals in ns. */
+    double fit(uint64_t Sample::*x, uint64_t Sample::*y, TimeMapping& mapping);
+
+public:
+
+    /** Constructor. */
+    CycleTimeCorrelator();
+    /** Destructor. */
+    ~CycleTimeCorrelator() {}
+
+    /** Clears the samples and the mappings. */
+    void initialize();
+
+    /** Samples the cycle timer of the bus of the camera, returns false if the sample is rejected. */
+    bool sample(dc1394camera_t* camera);
+
+    /**
+     * Converts a host timestamp in us (e.g. the timestamp of a dc1394 frame)
+     * to a monotonic time in ns. Returns false if the correlation is not
+     * established yet.
+     */
+    bool convertHostTimestamp(uint64_t timestampInUs, uint64_t& monotonicInNs, uint64_t& errorInNs);
+    /** Converts a bus time in ns to a monotonic time in ns. Returns false if the correlation is not established yet. */
+    bool convertBusTime(uint64_t busInNs, uint64_t& monotonicInNs);
+
+    /** Returns true if the correlation is established. */
+    bool isValid();
+    /** Returns the number of samples accepted. */
+    unsigned long getNumSamples();
+    /** Returns the number of samples rejected. */
+    unsigned long getNumRejectedSamples();
+    /** Returns the estimated error in ns of the conversions. */
+    uint64_t getErrorInNs();
+    /** Returns the drift of the bus clock relative to the host clock in ppm (> 0 if the bus clock is faster). */
+    double getDriftInPpm();
+    /** Returns a one-line summary of the correlation. */
+    std::string getSummary();
+
+    /** Converts a cycle timer register value (seconds, cycles and offset) to ns. */
+    static uint64_t cycleTimerToNs(uint32_t cycleTimer);
+};
+
+} // end namespace squid
+
+#endif // CYCLETIMECORRELATOR_H
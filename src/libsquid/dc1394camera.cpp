@@ -28,6 +28,7 @@
 #include "dc1394camera.h"
 #include "dc1394utility.h"
 #include "cameramanager.h"
+#include <dc1394/vendor/avt.h>
 #include <sstream>
 #include <glog/logging.h>
 
@@ -99,7 +100,20 @@ void Dc1394Camera::initialize() throw(MyException*) {
 
     LOG(INFO) << "Initializing camera " << getCameraName() << " (" + getCameraGuid() << ")" << ".";
     supportedResolutions_ = getSupportedResolutions(camera_);
-    resolution_ = getHighestSupportedResolution(camera_, &supportedResolutions_, DC1394_COLOR_CODING_MONO8); // XXX: squid only handle MONO8 images (for display and saving)
+    // MONO8 is preferred because it is the only coding that can also be saved,
+    // other codings supported by the display are used as fallback
+    const dc1394color_coding_t codings[] = {DC1394_COLOR_CODING_MONO8, DC1394_COLOR_CODING_MONO16, DC1394_COLOR_CODING_YUV422, DC1394_COLOR_CODING_RGB8};
+    const unsigned int numCodings = sizeof(codings) / sizeof(codings[0]);
+    for (unsigned int i = 0; i < numCodings; i++) {
+        try {
+            resolution_ = getHighestSupportedResolution(camera_, &supportedResolutions_, codings[i]);
+            break;
+        } catch (MyException* e) {
+            if (i == numCodings - 1)
+                throw e;
+            LOG(INFO) << e->getMessage();
+        }
+    }
     supportedFps_ = getSupportedFps(camera_, resolution_); // get the supported FPS from the current video mode
     fps_ = getHighestSupportedFps(&supportedFps_);
     // Object to compute the FPS
@@ -158,6 +172,36 @@ void Dc1394Camera::setSoftwareTrigger() {
 
 // ----------------------------------------------------------------------
 
+bool Dc1394Camera::isWaitingForTrigger() {
+
+    dc1394bool_t polarity;
+    uint32_t mode;
+    dc1394bool_t pinstate;
+
+    // called from the RT trigger thread: don't throw, a camera which can't be read is considered ready
+    if (dc1394_avt_get_io(camera_, 0x324, &polarity, &mode, &pinstate) != DC1394_SUCCESS) {
+        LOG_FIRST_N(WARNING, 1) << "Could not read GPOut2 of camera " << getCameraGuid() << ".";
+        return true;
+    }
+    return pinstate == DC1394_TRUE;
+}
+
+// ----------------------------------------------------------------------
+
+bool Dc1394Camera::canSaveFrames() {
+
+    // the AOI is always set in MONO8
+    if (useAoi_)
+        return true;
+
+    dc1394color_coding_t coding;
+    if (dc1394_get_color_coding_from_video_mode(camera_, resolution_, &coding) != DC1394_SUCCESS)
+        return false;
+    return (coding == DC1394_COLOR_CODING_MONO8 || coding == DC1394_COLOR_CODING_RAW8);
+}
+
+// ----------------------------------------------------------------------
+
 void Dc1394Camera::cleanup(bool verbose) {
 
     if (verbose)
@@ -135,6 +135,10 @@ public slots:
 
     /** Set the camera to use the software trigger. */
     void setSoftwareTrigger();
+    /** Returns true if GPOut2 signals WaitingForTrigger (also true if the register can't be read). */
+    bool isWaitingForTrigger();
+    /** Returns true if the frames of the current video mode can be saved (8-bit codings only). */
+    bool canSaveFrames();
     /** Reset camera bus. */
     void resetBus();
     /** Free camera. */
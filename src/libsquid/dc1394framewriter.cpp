@@ -27,7 +27,7 @@
 
 #include "dc1394framewriter.h"
 #include "dc1394utility.h"
-#include "fdtimer.h"
+#include "scheduler.h"
 #include <cstdlib>
 #include <glog/logging.h>
 
@@ -36,62 +36,39 @@ using namespace squid;
 // ======================================================================
 // PRIVATE METHODS
 
-void* Dc1394FrameWriter::processThread(void* obj) {
+void Dc1394FrameWriter::flush() throw(MyException*) {
 
-    Dc1394FrameWriter* fwriter = reinterpret_cast<Dc1394FrameWriter*>(obj);
-
-    FdTimer timer;
-    timer.initialize(0, 50000 * 1000); // 50 ms
-
-    timer.start();  // generates the timeouts
-    int fd = timer.getTimer();
-
-    while (!(fwriter->isAbort() && fwriter->frames_.size() == 0)) {
-        pthread_mutex_lock(&fwriter->mutex_);
-        if (!fwriter->pause_) {
-            pthread_mutex_unlock(&fwriter->mutex_);
-
-            uint64_t numTimeout;
-            read(fd, &numTimeout, sizeof(numTimeout));
-//            if (numTimeout > 1)
-//                LOG(WARNING) << "Playlist timer missed " << (numTimeout - 1) << " events.";
-
-            dc1394video_frame_t* frame = NULL;
-            std::string filename;
-            unsigned int format;
-            pthread_mutex_lock(&fwriter->mutex_);
-            while (fwriter->frames_.size() > 0) {
-                // get the reference to the variables
-                frame = fwriter->frames_.front();
-                filename = fwriter->filenames_.front();
-                format = fwriter->formats_.front();
-                // release the lock while writing the frame to file
-                pthread_mutex_unlock(&fwriter->mutex_);
-                fwriter->write(frame, filename, format);
-                // lock again before deleting the data
-                pthread_mutex_lock(&fwriter->mutex_);
-                fwriter->frames_.erase(fwriter->frames_.begin());
-                fwriter->filenames_.erase(fwriter->filenames_.begin());
-                fwriter->formats_.erase(fwriter->formats_.begin());
-            }
-        }
-
-        // pause the frame writer ?
-        while (fwriter->pause_) {
-            if (pthread_cond_wait(&fwriter->cond_, &fwriter->mutex_)) // wait for resume signal
-                throw new MyException("Unable to suspend frame writer: pthread_cond_wait() failed.");
-            LOG(INFO) << "Resuming frame writer.";
-        }
-        pthread_mutex_unlock(&fwriter->mutex_);
+    dc1394video_frame_t* frame = NULL;
+    std::string filename;
+    unsigned int format;
+    pthread_mutex_lock(&mutex_);
+    while (frames_.size() > 0) {
+        // get the reference to the variables
+        frame = frames_.front();
+        filename = filenames_.front();
+        format = formats_.front();
+        // release the lock while writing the frame to file
+        pthread_mutex_unlock(&mutex_);
+        write(frame, filename, format);
+        // lock again before deleting the data
+        pthread_mutex_lock(&mutex_);
+        frames_.erase(frames_.begin());
+        filenames_.erase(filenames_.begin());
+        formats_.erase(formats_.begin());
     }
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
+bool Dc1394FrameWriter::writeFrames(void* obj) {
 
-    timer.stop();
+    Dc1394FrameWriter* fwriter = reinterpret_cast<Dc1394FrameWriter*>(obj);
 
-    pthread_mutex_lock(&fwriter->mutex_);
-    fwriter->running_ = false;
-    pthread_mutex_unlock(&fwriter->mutex_);
+    if (!fwriter->pause_)
+        fwriter->flush();
 
-    return NULL;
+    return true;
 }
 
 // ----------------------------------------------------------------------
@@ -119,8 +96,6 @@ Dc1394FrameWriter::Dc1394FrameWriter() {
 
     if (pthread_mutex_init(&mutex_, NULL) == -1)
         throw new MyException("Unable to pthread_mutex_init().");
-    if (pthread_cond_init(&cond_, NULL) == -1)
-        throw new MyException("Unable to pthread_cond_init().");
 
     initialize();
 }
@@ -129,8 +104,6 @@ Dc1394FrameWriter::Dc1394FrameWriter() {
 
 Dc1394FrameWriter::~Dc1394FrameWriter() {
 
-    if (pthread_cond_destroy(&cond_) == -1)
-        throw new MyException("Unable to pthread_cond_destroy().");
     if (pthread_mutex_destroy(&mutex_) == -1)
         throw new MyException("Unable to pthread_mutex_destroy().");
 }
@@ -142,6 +115,7 @@ void Dc1394FrameWriter::initialize() {
     running_ = false;
     pause_ = false;
     abort_ = false;
+    taskId_ = -1;
 }
 
 // ----------------------------------------------------------------------
@@ -157,20 +131,27 @@ void Dc1394FrameWriter::push(dc1394video_frame_t* frame, std::string filename, u
 
 // ----------------------------------------------------------------------
 
+void Dc1394FrameWriter::reserve(unsigned int numFrames) {
+
+    pthread_mutex_lock(&mutex_);
+    const unsigned int n = frames_.size() + numFrames;
+    frames_.reserve(n);
+    filenames_.reserve(n);
+    formats_.reserve(n);
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
 void Dc1394FrameWriter::start() throw(MyException*) {
 
     if (running_)
         throw new MyException("Frame writer is already running.");
 
-    pthread_mutex_lock(&mutex_);
     abort_ = false;
     pause_ = false;
-
-    if (pthread_create(&thread_, 0, Dc1394FrameWriter::processThread, this))
-        throw new MyException("Unable to start frame writer thread: pthread_create() failed.");
-
+    taskId_ = Scheduler::getInstance()->addTask(Scheduler::NON_RT_LANE, &Dc1394FrameWriter::writeFrames, this, FRAME_WRITER_INTERVAL);
     running_ = true;
-    pthread_mutex_unlock(&mutex_);
 }
 
 // ----------------------------------------------------------------------
@@ -180,11 +161,13 @@ void Dc1394FrameWriter::stop() throw(MyException*) {
     if (!running_)
         return;
 
-    if (pause_)
-        pause(false);
     pause_ = false;
     abort_ = true;
-    pthread_join(thread_, NULL);
+    // waits until the frames being written are saved
+    Scheduler::getInstance()->removeTask(taskId_);
+    taskId_ = -1;
+    // saves the frames still present in the stack
+    flush();
     running_ = false;
 }
 
@@ -198,13 +181,7 @@ void Dc1394FrameWriter::pause(bool pause) throw(MyException*) {
     if (pause) LOG(INFO) << "Suspending frame writer.";
     else LOG(INFO) << "Resuming frame writer.";
 
-    pthread_mutex_lock(&mutex_);
     pause_ = pause;
-    if (!pause) {
-        if (pthread_cond_signal(&cond_))
-            throw new MyException("Unable to resume frame writer thread: pthread_cond_signal() failed.");
-    }
-    pthread_mutex_unlock(&mutex_);
 }
 
 // ======================================================================
@@ -30,6 +30,7 @@
 
 #include "dc1394/dc1394.h"
 #include "myexception.h"
+#include <pthread.h>
 #include <vector>
 #include <QObject>
 
@@ -39,6 +40,9 @@ namespace squid {
 #define IMAGE_PGM_EXTENSION ".pgm"
 #define IMAGE_TIFF_EXTENSION ".tif"
 
+/** Interval in us between two checks of the stack of frames. */
+#define FRAME_WRITER_INTERVAL 50000
+
 /**
  * \brief Saves frames to image files (e.g. with low priority).
  *
@@ -46,11 +50,12 @@ namespace squid {
  * been taken right after finishing grabbing the image. Thus when the image are
  * saved is not critical. The desired behavior is that if there are images in the
  * stack to be saved, the writer runs until no image are left in the stack. If
- * there are no images in the stack, the writer wait SLEEPTIMEINMS before checking
- * again if the stack is empty. When the writer is stopped, it ensure that all
+ * there are no images in the stack, the writer waits FRAME_WRITER_INTERVAL before
+ * checking again if the stack is empty. The writer is a periodic task of the
+ * non-RT lane of the Scheduler. When the writer is stopped, it ensure that all
  * images still present in the stack are saved.
  *
- * @version February 21, 2012
+ * @version March 14, 2012
  * @author Thomas Schaffter (thomas.schaff...@gmail.com)
  */
 class Dc1394FrameWriter : public QObject {
@@ -59,12 +64,10 @@ class Dc1394FrameWriter : public QObject {
 
 private:
 
-    /** Mutex for the thread. */
+    /** Mutex protecting the frames left to be saved. */
     pthread_mutex_t mutex_;
-    /** Condition variable to pause the thread. */
-    pthread_cond_t cond_;
-    /** Id returned by pthread_create(). */
-    pthread_t thread_;
+    /** Id of the task registered on the scheduler. */
+    int taskId_;
 
     /** Is true if the frame writer is running. */
     bool running_;
@@ -95,6 +98,8 @@ public:
 
     /** Add the following frame to the list of frames still to be written. */
     void push(dc1394video_frame_t* frame, std::string filename, unsigned int format = Dc1394FrameWriter::IMAGE_TIFF);
+    /** Pre-allocates room for numFrames more frames so that a burst doesn't reallocate the stack. */
+    void reserve(unsigned int numFrames);
 
 public slots:
 
@@ -119,11 +124,11 @@ private:
     /** Write the image to file. */
     void write(dc1394video_frame_t* frame, std::string filename, unsigned int format) throw(MyException*);
 
-    /**
-     * This is the static class function that serves as a C style function pointer
-     * for the pthread_create call.
-     */
-    static void* processThread(void* obj);
+    /** Writes all the frames left in the stack. */
+    void flush() throw(MyException*);
+
+    /** Function run periodically by the scheduler. */
+    static bool writeFrames(void* obj);
 };
 
 } // end namespace squid
@@ -27,7 +27,11 @@
 
 #include "dc1394utility.h"
 #include <tiffio.h>
+#include <cstring>
 #include <glog/logging.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace squid;
 
@@ -382,3 +386,211 @@ void squid::grayscale8bitsToTiff(const char* filename, unsigned char* image, con
     }
     TIFFClose(out);
 }
+
+// ======================================================================
+// DISPLAY CONVERSION UTILITY METHODS
+
+/**
+ * BT.601 YUV to RGB coefficients in fixed point (6 fractional bits). The
+ * scale is chosen so that all the intermediate values fit in 16-bit signed
+ * integers, which allows the SSE2 path to process eight pixels at once and
+ * to produce exactly the same output as the scalar path.
+ */
+#define YUV_SHIFT 6
+#define YUV_RV 90  // 1.402 * 64
+#define YUV_GU 22  // 0.344 * 64
+#define YUV_GV 46  // 0.714 * 64
+#define YUV_BU 113 // 1.772 * 64
+
+static inline unsigned char clampToUchar(const int value) {
+
+    return (unsigned char) (value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// ----------------------------------------------------------------------
+
+static inline unsigned int yuvToRgb32(const int y, const int u, const int v) {
+
+    const int y64 = y << YUV_SHIFT;
+    const unsigned int r = clampToUchar((y64 + YUV_RV * v) >> YUV_SHIFT);
+    const unsigned int g = clampToUchar((y64 - YUV_GU * u - YUV_GV * v) >> YUV_SHIFT);
+    const unsigned int b = clampToUchar((y64 + YUV_BU * u) >> YUV_SHIFT);
+
+    return 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+// ----------------------------------------------------------------------
+
+void squid::computeWindowLevelLut(unsigned char* lut, const unsigned int low, const unsigned int high) {
+
+    const unsigned int h = (high > low) ? high : low + 1;
+    const unsigned int range = h - low;
+
+    for (unsigned int i = 0; i < 65536; i++) {
+        if (i <= low)
+            lut[i] = 0;
+        else if (i >= h)
+            lut[i] = 255;
+        else
+            lut[i] = (unsigned char) (((i - low) * 255 + range / 2) / range);
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void squid::getMono16Range(const unsigned char* image, const unsigned int numPixels, const bool littleEndian, const unsigned int step, unsigned int& min, unsigned int& max) {
+
+    const unsigned int s = (step == 0) ? 1 : step;
+    const unsigned int lsb = littleEndian ? 0 : 1;
+    const unsigned int msb = 1 - lsb;
+    unsigned int value;
+
+    min = 65535;
+    max = 0;
+    for (unsigned int i = 0; i < numPixels; i += s) {
+        value = (image[2*i + msb] << 8) | image[2*i + lsb];
+        if (value < min)
+            min = value;
+        if (value > max)
+            max = value;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void squid::mono16ToMono8(const unsigned char* image, unsigned char* output, const unsigned int numPixels, const bool littleEndian, const unsigned char* lut) {
+
+    const unsigned int lsb = littleEndian ? 0 : 1;
+    const unsigned int msb = 1 - lsb;
+
+    for (unsigned int i = 0; i < numPixels; i++)
+        output[i] = lut[(image[2*i + msb] << 8) | image[2*i + lsb]];
+}
+
+// ----------------------------------------------------------------------
+
+/**
+ * Each 2x2 cell of the Bayer pattern contains one red, two green and one
+ * blue samples. The four pixels of the cell are set to the same color. This
+ * halves the effective resolution but costs only a few operations per pixel,
+ * which is what we want for a live preview.
+ */
+void squid::raw8ToRgb32(const unsigned char* image, unsigned int* output, const unsigned int width, const unsigned int height, const dc1394color_filter_t filter) {
+
+    // position of the red and blue samples in the cell (0: top-left, 1: top-right, 2: bottom-left, 3: bottom-right)
+    unsigned int rIndex, bIndex;
+    switch (filter) {
+    case DC1394_COLOR_FILTER_RGGB: rIndex = 0; bIndex = 3; break;
+    case DC1394_COLOR_FILTER_GBRG: rIndex = 2; bIndex = 1; break;
+    case DC1394_COLOR_FILTER_GRBG: rIndex = 1; bIndex = 2; break;
+    case DC1394_COLOR_FILTER_BGGR: rIndex = 3; bIndex = 0; break;
+    default: rIndex = 0; bIndex = 3; break;
+    }
+    const unsigned int g1Index = (rIndex == 0 || bIndex == 0) ? 1 : 0;
+    const unsigned int g2Index = 3 - g1Index;
+
+    const unsigned int w = width & ~1u;
+    const unsigned int h = height & ~1u;
+    unsigned char cell[4];
+    unsigned int pixel;
+
+    for (unsigned int y = 0; y < h; y += 2) {
+        const unsigned char* row0 = image + y * width;
+        const unsigned char* row1 = row0 + width;
+        unsigned int* out0 = output + y * width;
+        unsigned int* out1 = out0 + width;
+        for (unsigned int x = 0; x < w; x += 2) {
+            cell[0] = row0[x];
+            cell[1] = row0[x+1];
+            cell[2] = row1[x];
+            cell[3] = row1[x+1];
+            pixel = 0xff000000 | (cell[rIndex] << 16) | (((cell[g1Index] + cell[g2Index]) >> 1) << 8) | cell[bIndex];
+            out0[x] = pixel;
+            out0[x+1] = pixel;
+            out1[x] = pixel;
+            out1[x+1] = pixel;
+        }
+        if (w < width) {
+            out0[w] = out0[w-1];
+            out1[w] = out1[w-1];
+        }
+    }
+    if (h < height && h > 0)
+        memcpy(output + h * width, output + (h - 1) * width, width * sizeof(unsigned int));
+}
+
+// ----------------------------------------------------------------------
+
+void squid::yuv422ToRgb32(const unsigned char* image, unsigned int* output, const unsigned int numPixels, const dc1394byte_order_t order) {
+
+    // offsets of Y0, U, Y1 and V in a 4-byte macropixel
+    const bool uyvy = (order != DC1394_BYTE_ORDER_YUYV);
+    const unsigned int y0 = uyvy ? 1 : 0;
+    const unsigned int u = uyvy ? 0 : 1;
+    const unsigned int y1 = uyvy ? 3 : 2;
+    const unsigned int v = uyvy ? 2 : 3;
+    unsigned int i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowMask = _mm_set1_epi32(0x0000ffff);
+    const __m128i offset = _mm_set1_epi16(128);
+    const __m128i alpha = _mm_set1_epi8((char)0xff);
+    const __m128i rv = _mm_set1_epi16(YUV_RV);
+    const __m128i gu = _mm_set1_epi16(YUV_GU);
+    const __m128i gv = _mm_set1_epi16(YUV_GV);
+    const __m128i bu = _mm_set1_epi16(YUV_BU);
+
+    // eight pixels (16 bytes) per iteration
+    for (; i + 8 <= numPixels; i += 8) {
+        const __m128i in = _mm_loadu_si128((const __m128i*)(image + 2*i));
+        const __m128i lo = _mm_unpacklo_epi8(in, zero);
+        const __m128i hi = _mm_unpackhi_epi8(in, zero);
+
+        // split luma and chroma 16-bit words
+        __m128i y, uv;
+        if (uyvy) {
+            y = _mm_packs_epi32(_mm_srli_epi32(lo, 16), _mm_srli_epi32(hi, 16));
+            uv = _mm_packs_epi32(_mm_and_si128(lo, lowMask), _mm_and_si128(hi, lowMask));
+        } else {
+            y = _mm_packs_epi32(_mm_and_si128(lo, lowMask), _mm_and_si128(hi, lowMask));
+            uv = _mm_packs_epi32(_mm_srli_epi32(lo, 16), _mm_srli_epi32(hi, 16));
+        }
+        // duplicate each chroma sample for the two pixels sharing it
+        __m128i cu = _mm_and_si128(uv, lowMask);
+        __m128i cv = _mm_srli_epi32(uv, 16);
+        cu = _mm_sub_epi16(_mm_or_si128(cu, _mm_slli_epi32(cu, 16)), offset);
+        cv = _mm_sub_epi16(_mm_or_si128(cv, _mm_slli_epi32(cv, 16)), offset);
+
+        const __m128i y64 = _mm_slli_epi16(y, YUV_SHIFT);
+        __m128i r = _mm_srai_epi16(_mm_add_epi16(y64, _mm_mullo_epi16(rv, cv)), YUV_SHIFT);
+        __m128i g = _mm_srai_epi16(_mm_sub_epi16(_mm_sub_epi16(y64, _mm_mullo_epi16(gu, cu)), _mm_mullo_epi16(gv, cv)), YUV_SHIFT);
+        __m128i b = _mm_srai_epi16(_mm_add_epi16(y64, _mm_mullo_epi16(bu, cu)), YUV_SHIFT);
+        r = _mm_packus_epi16(r, zero);
+        g = _mm_packus_epi16(g, zero);
+        b = _mm_packus_epi16(b, zero);
+
+        // interleave to B G R A bytes (0xAARRGGBB on little-endian)
+        const __m128i bg = _mm_unpacklo_epi8(b, g);
+        const __m128i ra = _mm_unpacklo_epi8(r, alpha);
+        _mm_storeu_si128((__m128i*)(output + i), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i*)(output + i + 4), _mm_unpackhi_epi16(bg, ra));
+    }
+#endif
+
+    const unsigned char* p = NULL;
+    for (; i + 2 <= numPixels; i += 2) {
+        p = image + 2*i;
+        output[i] = yuvToRgb32(p[y0], p[u] - 128, p[v] - 128);
+        output[i+1] = yuvToRgb32(p[y1], p[u] - 128, p[v] - 128);
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void squid::rgb8ToRgb32(const unsigned char* image, unsigned int* output, const unsigned int numPixels) {
+
+    const unsigned char* p = image;
+    for (unsigned int i = 0; i < numPixels; i++, p += 3)
+        output[i] = 0xff000000 | (p[0] << 16) | (p[1] << 8) | p[2];
+}
@@ -100,6 +100,22 @@ void grayscale8bitsToPgm(const char* filename, unsigned char* image, const unsig
 /** Converts a 8-bit grayscale image to TIFF format. */
 void grayscale8bitsToTiff(const char * filename, unsigned char* image, const unsigned int width, const unsigned int height) throw(MyException*);
 
+// ======================================================================
+// DISPLAY CONVERSION UTILITY METHODS
+
+/** Fills a 65536 entries LUT mapping 16-bit values in [low, high] to [0, 255] (window/level). */
+void computeWindowLevelLut(unsigned char* lut, const unsigned int low, const unsigned int high);
+/** Finds the min and max values of a MONO16 image by sampling one pixel out of step. */
+void getMono16Range(const unsigned char* image, const unsigned int numPixels, const bool littleEndian, const unsigned int step, unsigned int& min, unsigned int& max);
+/** Converts a MONO16 image to 8-bit grayscale using a window/level LUT. */
+void mono16ToMono8(const unsigned char* image, unsigned char* output, const unsigned int numPixels, const bool littleEndian, const unsigned char* lut);
+/** Converts a RAW8 Bayer image to RGB32 (0xffRRGGBB) by 2x2 super-pixel demosaicing. */
+void raw8ToRgb32(const unsigned char* image, unsigned int* output, const unsigned int width, const unsigned int height, const dc1394color_filter_t filter);
+/** Converts a YUV422 image (UYVY or YUYV) to RGB32 (0xffRRGGBB), using SSE2 when available. */
+void yuv422ToRgb32(const unsigned char* image, unsigned int* output, const unsigned int numPixels, const dc1394byte_order_t order);
+/** Converts a RGB8 image to RGB32 (0xffRRGGBB). */
+void rgb8ToRgb32(const unsigned char* image, unsigned int* output, const unsigned int numPixels);
+
 } // end namespace squid
 
 #endif // DC1394UTILITY_H
@@ -29,8 +29,7 @@
 #include "experimenttime.h"
 #include "myutility.h"
 #include "cameramanager.h"
-#include "fdtimer.h"
-#include "rt.h"
+#include "scheduler.h"
 #include <fstream>
 #include <glog/logging.h>
 
@@ -39,85 +38,65 @@ using namespace squid;
 // ======================================================================
 // PRIVATE METHODS
 
-void* Experiment::processThread(void* obj) {
+bool Experiment::update(void* obj) {
 
     Experiment* experiment = reinterpret_cast<Experiment*>(obj);
+    SharedClock* clock = ExperimentTime::getInstance()->getClock();
 
-    LOG(INFO) << "Promoting experiment to RT priority.";
-    promoteRT();
-
-    double pauseOffsetInMs = 0.;
-    bool prematureAbortion = true;
-
-    // experiment time
-    ExperimentTime* time = ExperimentTime::getInstance();
-    time->initialize();
-    CameraManager::getInstance()->grabReferenceTimer_ = time->getTimeReference();
-
-    // timer for update interface
-    FdTimer timer;
-    timer.initialize(0, 10000 * 1000); // 10 ms
-
-    time->getTimeReference()->start();
-    timer.start();  // generates the timeouts to refresh the interface
-    int fd = timer.getTimer();
-
-    // takes care of writing frames to files
-    experiment->frameWriter_->start();
-
-    // start saving the frames if required
-    CameraManager::getInstance()->setSaveFrame(experiment->saveFirstFrames_);
-
-    double tInMs = 0.;
-    while (!experiment->isAbort()) {
-        pthread_mutex_lock(&experiment->mutex_);
-        if (!experiment->pause_) {
-            pthread_mutex_unlock(&experiment->mutex_);
-
-            uint64_t numTimeout;
-            read(fd, &numTimeout, sizeof(numTimeout));
-//            if (numTimeout > 1)
-//                LOG(WARNING) << "Playlist timer missed " << (numTimeout - 1) << " events.";
-
-            tInMs = time->getTimeReference()->getElapsedTimeInMs() - pauseOffsetInMs;
-            emit experiment->timeElapsedInUs(tInMs * 1000);
-
-            // timeout
-            if (experiment->durationMode_ == FIXED || experiment->durationMode_ == PLAYER) {
-                if ((tInMs * 1000) > experiment->durationInUs_) {
-                    experiment->abort_ = true;
-                    prematureAbortion = false;
-                }
+    pthread_mutex_lock(&experiment->mutex_);
+    if (!experiment->pause_ && !experiment->abort_) {
+        double tInMs = clock->getElapsedTimeInMs();
+        emit experiment->timeElapsedInUs(tInMs * 1000);
+
+        // timeout
+        if (experiment->durationMode_ == FIXED || experiment->durationMode_ == PLAYER) {
+            if ((tInMs * 1000) > experiment->durationInUs_) {
+                experiment->abort_ = true;
+                experiment->prematureAbortion_ = false;
             }
         }
+    }
 
-        // pause the experiment ?
-        while (experiment->pause_) {
-            double tInMsBkp = time->getTimeReference()->getElapsedTimeInMs();
-            if (pthread_cond_wait(&experiment->cond_, &experiment->mutex_)) // wait for resume signal
-                throw new MyException("Unable to suspend playlist: pthread_cond_wait() failed.");
-            pauseOffsetInMs += time->getTimeReference()->getElapsedTimeInMs() - tInMsBkp;
-            LOG(INFO) << "Resuming experiment after a break of " << pauseOffsetInMs/1000. << " seconds.";
+    // writing the last frames may take time, hence it's done by another task
+    if (experiment->abort_) {
+        try {
+            Scheduler::getInstance()->addOneShotTask(Scheduler::NON_RT_LANE, &Experiment::finish, experiment, 0);
+        } catch (MyException* e) {
+            LOG(WARNING) << "Unable to finish experiment: " << e->getMessage();
         }
+        experiment->taskId_ = -1;
         pthread_mutex_unlock(&experiment->mutex_);
+        return false;
     }
+    pthread_mutex_unlock(&experiment->mutex_);
+
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+bool Experiment::finish(void* obj) {
 
-    time->getTimeReference()->stop();
-    timer.stop();
+    Experiment* experiment = reinterpret_cast<Experiment*>(obj);
+
+    ExperimentTime::getInstance()->getClock()->stop();
 
     pthread_mutex_lock(&experiment->mutex_);
-    experiment->running_ = false;
     CameraManager::getInstance()->setSaveFrame(false);
     CameraManager::getInstance()->grabReferenceTimer_ = NULL;
     experiment->frameWriter_->stop();
+    experiment->closeMetadataFiles();
     experiment->end_ = getCurrentLocalYyyyMmDd("-") + " " + getCurrentLocalHhMmSs("-"); // absolute end time
+    experiment->running_ = false;
 
-    if (!prematureAbortion)
+    if (!experiment->prematureAbortion_)
         emit experiment->timeElapsedInUs(experiment->durationInUs_);
     emit experiment->finished();
+    if (pthread_cond_broadcast(&experiment->cond_))
+        LOG(WARNING) << "Unable to signal the end of the experiment: pthread_cond_broadcast() failed.";
     pthread_mutex_unlock(&experiment->mutex_);
 
-    return NULL;
+    return false;
 }
 
 // ======================================================================
@@ -137,6 +116,8 @@ Experiment::Experiment() {
 
 Experiment::~Experiment() {
 
+    closeMetadataFiles();
+
     if (pthread_cond_destroy(&cond_) == -1)
         throw new MyException("Unable to pthread_cond_destroy().");
     if (pthread_mutex_destroy(&mutex_) == -1)
@@ -149,6 +130,7 @@ void Experiment::initialize() {
 
     name_ = "myExperiment";
     description_ = "";
+    displayStatistics_ = "";
     subExperimentIds_.clear();
     workingDirectory_ = "";
     folder_ = "";
@@ -158,9 +140,11 @@ void Experiment::initialize() {
     start_ = "";
     end_ = "";
     format_ = ELAPSED;
+    taskId_ = -1;
     running_ = false;
     abort_ = false;
     pause_ = false;
+    prematureAbortion_ = true;
     frameSuffix_ = "";
     frameWriter_ = new Dc1394FrameWriter();
 }
@@ -200,11 +184,39 @@ void Experiment::setup() throw(MyException*, boost::filesystem::filesystem_error
             throw new MyException(msg);
         }
     }
+
+    // list of the frames saved and the trigger schedule they come from
+    closeMetadataFiles();
+    CameraManager* cmanager = CameraManager::getInstance();
+    const bool triggerMode = (cmanager->getCameraMode() == CameraManager::SOFTWARE_TRIGGERS);
+    for (unsigned int i = 0; i < subExperimentFolders_.size(); i++) {
+        std::ofstream* file = new std::ofstream((subExperimentFolders_.at(i) + "/" + FRAME_METADATA_FILENAME).c_str(), std::ios::out | std::ios::trunc);
+        if (!file->is_open())
+            LOG(WARNING) << "Unable to create frame metadata file in " << subExperimentFolders_.at(i);
+        else if (triggerMode) {
+            TriggerSchedule schedule = cmanager->getTriggerManager()->getSchedule(i);
+            *file << "# Software triggers: period " << schedule.periodInUs_ << " us, phase " << schedule.phaseInUs_ << " us" << std::endl;
+        } else
+            *file << "# Free run" << std::endl;
+        *file << "# filename\ttime_us\tperiod_us\tphase_us\tdriver_timestamp_us\ttime_error_ns (-1 = time of dequeuing)\ttrigger_id (-1 = unknown)" << std::endl;
+        metadataFiles_.push_back(file);
+    }
     pthread_mutex_unlock(&mutex_);
 }
 
 // ----------------------------------------------------------------------
 
+void Experiment::closeMetadataFiles() {
+
+    for (unsigned int i = 0; i < metadataFiles_.size(); i++) {
+        metadataFiles_.at(i)->close();
+        delete metadataFiles_.at(i);
+    }
+    metadataFiles_.clear();
+}
+
+// ----------------------------------------------------------------------
+
 void Experiment::start() throw(MyException*) {
 
     if (running_)
@@ -213,9 +225,26 @@ void Experiment::start() throw(MyException*) {
     pthread_mutex_lock(&mutex_);
     abort_ = false;
     pause_ = false;
+    prematureAbortion_ = true;
+
+    // experiment time
+    SharedClock* clock = ExperimentTime::getInstance()->getClock();
+    clock->initialize();
+    CameraManager::getInstance()->grabReferenceTimer_ = clock;
+    clock->start();
+
+    // takes care of writing frames to files
+    frameWriter_->start();
 
-    if (pthread_create(&thread_, 0, Experiment::processThread, this))
-        throw new MyException("Unable to start experiment thread: pthread_create() failed.");
+    // start saving the frames if required
+    CameraManager::getInstance()->setSaveFrame(saveFirstFrames_);
+
+    try {
+        taskId_ = Scheduler::getInstance()->addTask(Scheduler::NON_RT_LANE, &Experiment::update, this, EXPERIMENT_UPDATE_INTERVAL);
+    } catch (MyException* e) {
+        pthread_mutex_unlock(&mutex_);
+        throw e;
+    }
 
     running_ = true;
     pthread_mutex_unlock(&mutex_);
@@ -240,6 +269,17 @@ std::string Experiment::saveDescription() {
             ssDescription << "Start time: " << start_ << std::endl;
             ssDescription << "End time: " << end_ << std::endl;
             ssDescription << std::endl;
+            CameraManager* cmanager = CameraManager::getInstance();
+            if (cmanager->getCameraMode() == CameraManager::SOFTWARE_TRIGGERS) {
+                ssDescription << "Trigger timing:" << std::endl;
+                ssDescription << cmanager->getTriggerManager()->getTimingReport();
+                ssDescription << cmanager->getTriggerGatingReport() << std::endl;
+            }
+            ssDescription << cmanager->getCycleTimerReport() << std::endl;
+            if (!displayStatistics_.empty()) {
+                ssDescription << "Display statistics:" << std::endl;
+                ssDescription << displayStatistics_ << std::endl;
+            }
             ssDescription << "Notes:" << std::endl;
             ssDescription << description_ << std::endl;
             ssDescription << std::endl;
@@ -261,14 +301,27 @@ std::string Experiment::saveDescription() {
 
 /**
  * Save a dc1394 frame to an image file in the correct sub-experiment folder.
- * This implementation only supports dc1394 MONO8 frames.
+ * This implementation only supports dc1394 8-bit frames (MONO8 and RAW8,
+ * the latter being saved as the raw Bayer pattern).
  */
 void Experiment::saveFrame(dc1394video_frame_t* frame, unsigned int cameraIndex, unsigned int tInUs) {
 
+    saveFrame(frame, cameraIndex, tInUs, frameSuffix_);
+}
+
+// ----------------------------------------------------------------------
+
+void Experiment::saveFrame(dc1394video_frame_t* frame, unsigned int cameraIndex, unsigned int tInUs, const std::string& suffix) {
+
     // XXX hack to avoid that frames are saved before the experiment timer is running
     if (tInUs == 0)
         return;
 
+    if (frame->color_coding != DC1394_COLOR_CODING_MONO8 && frame->color_coding != DC1394_COLOR_CODING_RAW8) {
+        LOG_FIRST_N(WARNING, 1) << "Unable to save frame: Only MONO8 and RAW8 frames can be saved (color coding " << frame->color_coding << ").";
+        return;
+    }
+
     unsigned int hour, min, sec, msec, us;
     char timestamp[20];
 
@@ -279,16 +332,39 @@ void Experiment::saveFrame(dc1394video_frame_t* frame, unsigned int cameraIndex,
     unsigned int format = -1;
 
     if (outputFormat_ == Dc1394FrameWriter::IMAGE_PGM) {
-        filename = subExperimentFolders_.at(cameraIndex) + "/" + subExperimentIds_.at(cameraIndex) + "_" + timestamp + frameSuffix_ + IMAGE_PGM_EXTENSION;
+        filename = subExperimentFolders_.at(cameraIndex) + "/" + subExperimentIds_.at(cameraIndex) + "_" + timestamp + suffix + IMAGE_PGM_EXTENSION;
         format = Dc1394FrameWriter::IMAGE_PGM;
     } else if (outputFormat_ == Dc1394FrameWriter::IMAGE_TIFF) {
-        filename = subExperimentFolders_.at(cameraIndex) + "/" + subExperimentIds_.at(cameraIndex) + "_" + timestamp + frameSuffix_ + IMAGE_TIFF_EXTENSION;
+        filename = subExperimentFolders_.at(cameraIndex) + "/" + subExperimentIds_.at(cameraIndex) + "_" + timestamp + suffix + IMAGE_TIFF_EXTENSION;
         format = Dc1394FrameWriter::IMAGE_TIFF;
     } else
         LOG(WARNING) << "Unable to save frame: Unknowm image format.";
 
     // add the current frame to the list of frames still left to be saved
     frameWriter_->push(frame, filename, format);
+
+    // records the schedule the frame comes from
+    pthread_mutex_lock(&mutex_);
+    if (cameraIndex < metadataFiles_.size() && metadataFiles_.at(cameraIndex)->is_open()) {
+        long period = 0, phase = 0;
+        CameraManager* cmanager = CameraManager::getInstance();
+        if (cmanager->getCameraMode() == CameraManager::SOFTWARE_TRIGGERS) {
+            TriggerSchedule schedule = cmanager->getTriggerManager()->getSchedule(cameraIndex);
+            period = schedule.periodInUs_;
+            phase = schedule.phaseInUs_;
+        }
+        const FrameMetadata metadata = cmanager->getFrameMetadata(cameraIndex, frame);
+        *metadataFiles_.at(cameraIndex) << filename.substr(filename.rfind('/') + 1) << "\t" << tInUs << "\t" << period << "\t" << phase << "\t" << frame->timestamp << "\t" << metadata.captureErrorInNs_ << "\t" << metadata.triggerId_ << "\n";
+    }
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
+void Experiment::prepareBurst(unsigned int numFrames) {
+
+    if (frameWriter_ != NULL)
+        frameWriter_->reserve(numFrames);
 }
 
 // ----------------------------------------------------------------------
@@ -300,10 +376,17 @@ void Experiment::stop() throw(MyException*) {
 
     if (pause_)
         pause(false);
-    pause_ = false;
+
+    // wait until the experiment is finished
+    pthread_mutex_lock(&mutex_);
     abort_ = true;
-    pthread_join(thread_, NULL);
-    running_ = false;
+    while (running_) {
+        if (pthread_cond_wait(&cond_, &mutex_)) {
+            pthread_mutex_unlock(&mutex_);
+            throw new MyException("Unable to stop experiment: pthread_cond_wait() failed.");
+        }
+    }
+    pthread_mutex_unlock(&mutex_);
 }
 
 // ----------------------------------------------------------------------
@@ -318,10 +401,11 @@ void Experiment::pause(bool pause) throw(MyException*) {
 
     pthread_mutex_lock(&mutex_);
     pause_ = pause;
-    if (!pause) {
-        if (pthread_cond_signal(&cond_))
-            throw new MyException("Unable to resume experiment thread: pthread_cond_signal() failed.");
-    }
+    // the pause offset is kept by the clock, shared with the playlist
+    SharedClock* clock = ExperimentTime::getInstance()->getClock();
+    clock->pause(pause);
+    if (!pause)
+        LOG(INFO) << "Resuming experiment after a break of " << clock->getPauseOffsetInNs()/1000000000. << " seconds.";
     pthread_mutex_unlock(&mutex_);
 }
 
@@ -337,6 +421,9 @@ std::string Experiment::getName() { return name_; }
 void Experiment::setDescription(std::string description) { description_ = description; }
 std::string Experiment::getDescription() { return description_; }
 
+void Experiment::setDisplayStatistics(std::string statistics) { displayStatistics_ = statistics; }
+std::string Experiment::getDisplayStatistics() { return displayStatistics_; }
+
 void Experiment::setDurationMode(durationMode mode) { durationMode_ = mode; }
 Experiment::durationMode Experiment::getDurationMode() { return durationMode_; }
 
@@ -34,6 +34,7 @@
 #include "dc1394framewriter.h"
 #include <vector>
 #include <sstream>
+#include <fstream>
 #include <cstring>
 #include <QObject>
 #include <boost/filesystem.hpp>
@@ -42,6 +43,14 @@
 namespace squid {
 
 #define REPORT_FILENAME "squid_report.txt"
+/** Name of the file listing the frames saved in each sub-experiment folder with their trigger schedule. */
+#define FRAME_METADATA_FILENAME "squid_frames.txt"
+/** Name of the binary log of the accesses to the port (time_ns on the same clock as time_us of the frames). */
+#define PORT_EVENT_LOG_FILENAME "squid_port_events.bin"
+/** Name of the text version of the port event log written at the end of the experiment. */
+#define PORT_EVENT_CSV_FILENAME "squid_port_events.txt"
+/** Interval in us between two refreshments of the experiment time. */
+#define EXPERIMENT_UPDATE_INTERVAL 10000
 
 /**
  * \brief Takes care of supervising the experiment including exporting frames to files.
@@ -70,12 +79,12 @@ public:
 
 private:
 
-    /** Mutex for the thread. */
+    /** Mutex protecting the state of the experiment. */
     pthread_mutex_t mutex_;
-    /** Condition variable to pause the thread. */
+    /** Signaled when the experiment is finished. */
     pthread_cond_t cond_;
-    /** Id returned by pthread_create(). */
-    pthread_t thread_;
+    /** Id of the update task registered on the non-RT lane of the scheduler. */
+    int taskId_;
 
     /** Is true if the experiment is running. */
     bool running_;
@@ -83,11 +92,15 @@ private:
     bool abort_;
     /** Sets to true to pause the experiment. */
     bool pause_;
+    /** Is true if the experiment is aborted before the end of its duration. */
+    bool prematureAbortion_;
 
     /** Name of the experiment */
     std::string name_;
     /** Notes taken during the experiment */
     std::string description_;
+    /** Statistics of the displays (frame counters and latencies) */
+    std::string displayStatistics_;
     /** Sub-experiments ids */
     std::vector<std::string> subExperimentIds_;
     /** Working directory */
@@ -96,6 +109,8 @@ private:
     std::string folder_;
     /** Absolute path towards each sub-experiment folders */
     std::vector<std::string> subExperimentFolders_;
+    /** Frame metadata file of each sub-experiment */
+    std::vector<std::ofstream*> metadataFiles_;
     /** Output format */
     unsigned int outputFormat_;
     /** Experiment duration mode (MANUAL or SPECIFIED)  */
@@ -144,6 +159,11 @@ public:
     /** Get experiment description */
     std::string getDescription();
 
+    /** Set statistics of the displays written to the report */
+    void setDisplayStatistics(std::string statistics);
+    /** Get statistics of the displays */
+    std::string getDisplayStatistics();
+
     /** Set duration mode */
     void setDurationMode(durationMode mode);
     /** Get duration mode */
@@ -195,10 +215,14 @@ public slots:
 
     /** Save received frame as image */
     void saveFrame(dc1394video_frame_t* frame, unsigned int cameraIndex, unsigned int us);
+    /** Save received frame as image with the given filename suffix rather than the current one */
+    void saveFrame(dc1394video_frame_t* frame, unsigned int cameraIndex, unsigned int us, const std::string& suffix);
     /** Save current experiment description to file */
     std::string saveDescription();
     /** Set string suffix for image filenames */
     void setFrameSuffix(std::string suffix);
+    /** Pre-allocates the frame writer for a burst of numFrames frames (all cameras). */
+    void prepareBurst(unsigned int numFrames);
 
 signals:
 
@@ -216,11 +240,13 @@ signals:
 
 private:
 
-    /**
-     * This is the static class function that serves as a C style function pointer
-     * for the pthread_create call.
-     */
-    static void* processThread(void* obj);
+    /** Function run periodically on the non-RT lane of the scheduler to refresh the experiment time (it shares mutex_ with saveFrame()). */
+    static bool update(void* obj);
+    /** Function run once on the non-RT lane of the scheduler to finish the experiment. */
+    static bool finish(void* obj);
+
+    /** Closes the frame metadata files of the sub-experiments. */
+    void closeMetadataFiles();
 
 };
 
@@ -38,7 +38,7 @@ static ExperimentTime* instance_ = NULL;
 
 ExperimentTime::ExperimentTime() {
 
-    time_ = new HighResolutionTime();
+    clock_ = new SharedClock();
 }
 
 // ======================================================================
@@ -56,12 +56,10 @@ ExperimentTime* ExperimentTime::getInstance() {
 
 void ExperimentTime::initialize() {
 
-    if (time_ != NULL)
-        time_->initialize();
+    clock_->initialize();
 }
 
 // ======================================================================
 // GETTERS AND SETTERS
 
-void ExperimentTime::setTimeReference(HighResolutionTime* time) { time_ = time; }
-HighResolutionTime* ExperimentTime::getTimeReference() { return time_; }
+SharedClock* ExperimentTime::getClock() { return clock_; }
@@ -28,7 +28,7 @@
 #ifndef EXPERIMENTTIME_H
 #define EXPERIMENTTIME_H
 
-#include "highresolutiontime.h"
+#include "sharedclock.h"
 #include <cstring>
 #include <vector>
 
@@ -38,15 +38,18 @@ namespace squid {
 /**
  * \brief Represents the unique instance of time for experiment.
  *
- * @version January 28, 2012
+ * The experiment clock is read without lock by the capture, the experiment,
+ * the playlist and the interface. Pausing the experiment pauses the clock.
+ *
+ * @version March 15, 2012
  * @author Thomas Schaffter (thomas.schaff...@gmail.com)
  */
 class ExperimentTime {
 
 private:
 
-    /** Time reference. */
-    HighResolutionTime* time_;
+    /** Experiment clock. */
+    SharedClock* clock_;
 
 public:
 
@@ -56,10 +59,8 @@ public:
     /** Initialization. */
     void initialize();
 
-    /** Sets the time reference. */
-    void setTimeReference(HighResolutionTime* time);
-    /** Returns the experiment time. */
-    HighResolutionTime* getTimeReference();
+    /** Returns the experiment clock. */
+    SharedClock* getClock();
 
 private:
 
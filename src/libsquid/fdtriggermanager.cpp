@@ -28,12 +28,18 @@
 #include "fdtriggermanager.h"
 #include "fdtimer.h"
 #include "rt.h"
+#include "sharedclock.h"
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <time.h>
+#include <algorithm>
+#include <sstream>
 #include <sys/time.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <sys/resource.h>
 #include <glog/logging.h>
 
@@ -49,34 +55,177 @@ void* FdTriggerManager::processThread(void* obj) {
     LOG(INFO) << "Promoting trigger manager to RT priority.";
     promoteRT();
 
+    // the first trigger of each channel is sent one period (plus phase) after the start
+    const unsigned int numChannels = std::max(tmanager->numChannels_, 1u);
+    uint64_t deadlines[TRIGGER_MAX_CHANNELS];
+    tmanager->resetDeadlines(deadlines, numChannels, SharedClock::getMonotonicTimeInNs());
+    uint64_t deadline = *std::min_element(deadlines, deadlines + numChannels);
+
+    // the cycle of the sequence starts now until it is synchronized
+    TriggerSequence& sequence = tmanager->sequence_;
+    const bool useSequence = !sequence.isEmpty();
+    uint64_t sequenceOrigin = SharedClock::getMonotonicTimeInNs();
+    unsigned int sequenceIndex = 0;
+    uint64_t lastScheduled = 0;
+    if (useSequence)
+        deadline = sequenceOrigin + sequence.getTimeInNs(0);
+
+    // the lock callback of the next trigger is pending until it has been executed
+    bool lockPending = true;
+    uint64_t wakeup = tmanager->getWakeupTime(deadline, lockPending);
+
+    // one-shot timer re-armed on the absolute deadline of every trigger
     FdTimer timer;
-    timer.initialize(0, tmanager->getIntervalInUs() * 1000);
-    timer.start();  // generates the timeouts
+    timer.setAbsolute(true);
+    timer.setInterval(0, 0);
+    timer.setValue(wakeup / 1000000000, wakeup % 1000000000);
+    timer.start();
     int fd = timer.getTimer();
 
-    int triggerId = 0;
+    // a burst or a resynchronization request wakes up the thread before the next deadline
+    struct pollfd fds[2];
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = tmanager->requestFd_;
+    fds[1].events = POLLIN;
+    uint64_t burstDeadline = 0;
+    uint64_t burstPeriodInNs = 0;
+
+    unsigned int triggerId = 0;
+    uint64_t lastWakeup = 0;
     while (!tmanager->isAbort()) {
-        pthread_mutex_lock(&tmanager->mutex_);
+        // no lock is taken while running, the mutex is only used to pause
         if (!tmanager->pause_) {
-            pthread_mutex_unlock(&tmanager->mutex_);
-
+            if (poll(fds, 2, -1) < 0)
+                continue; // interrupted, the timer is still armed
             uint64_t numTimeout;
-            read(fd, &numTimeout, sizeof(numTimeout));
-//            if (numTimeout > 1)
-//                LOG(WARNING) << "Trigger manager timer missed " << (numTimeout - 1) << " events.";
+            if (fds[0].revents & POLLIN)
+                read(fd, &numTimeout, sizeof(numTimeout));
+
+            const uint64_t now = SharedClock::getMonotonicTimeInNs();
+            if (fds[1].revents & POLLIN) {
+                uint64_t numRequests;
+                read(tmanager->requestFd_, &numRequests, sizeof(numRequests));
+                // a new burst replaces the burst in progress
+                const unsigned int numFrames = __sync_lock_test_and_set(&tmanager->burstRequestFrames_, 0);
+                if (numFrames > 0) {
+                    burstPeriodInNs = std::max((long)tmanager->burstRequestIntervalInUs_, 1L) * 1000;
+                    burstDeadline = now;
+                    tmanager->burstSize_ = numFrames;
+                    tmanager->burstIndex_ = 0;
+                    tmanager->numBursts_++;
+                }
+                // the triggers already sent are not sent again
+                const uint64_t origin = __sync_lock_test_and_set(&tmanager->syncRequestInNs_, 0);
+                if (origin > 0 && useSequence) {
+                    sequenceOrigin = origin;
+                    tmanager->seekSequence(sequenceOrigin, sequenceIndex, lastScheduled);
+                    tmanager->numSyncs_++;
+                }
+            }
+
+            // the lead time before the next trigger is reached
+            if (lockPending && now >= tmanager->getWakeupTime(deadline, lockPending))
+                lockPending = !tmanager->lock(triggerId, deadline);
+
+            // collects the channels whose deadline is reached
+            uint64_t scheduled = ~(uint64_t)0;
+            unsigned int mask = 0;
+            uint64_t lateness = 0;
+            bool allChannels = false;
+            if (tmanager->isBursting()) {
+                // the burst overrides the schedule of the channels
+                if (burstDeadline <= now) {
+                    scheduled = tmanager->catchUp(burstDeadline, burstPeriodInNs, now, lateness);
+                    tmanager->burstIndex_++;
+                    allChannels = true;
+                }
+            } else if (useSequence) {
+                if (sequenceOrigin + sequence.getTimeInNs(sequenceIndex) <= now) {
+                    scheduled = tmanager->catchUpSequence(sequenceOrigin, sequenceIndex, now, lateness);
+                    allChannels = true;
+                }
+            } else {
+                for (unsigned int c = 0; c < numChannels; c++) {
+                    if (deadlines[c] > now)
+                        continue;
+                    uint64_t s = tmanager->catchUp(deadlines[c], tmanager->getChannelPeriodInNs(c), now, lateness);
+                    tmanager->channelScheduledInNs_[c] = s;
+                    tmanager->channelTriggerIds_[c]++;
+                    scheduled = std::min(scheduled, s);
+                    mask |= 1 << c;
+                }
+            }
+            // bursts and sequences trigger all the channels
+            if (allChannels) {
+                for (unsigned int c = 0; c < numChannels; c++) {
+                    tmanager->channelScheduledInNs_[c] = scheduled;
+                    tmanager->channelTriggerIds_[c]++;
+                    mask |= 1 << c;
+                }
+            }
+            // a trigger already due at the previous wakeup is sent back to back by the same overrun
+            if (lateness > 0 && scheduled >= lastWakeup) {
+                __sync_lock_test_and_set(&tmanager->overrunLatenessInNs_, lateness);
+                __sync_fetch_and_add(&tmanager->numOverruns_, 1);
+            }
+            lastWakeup = now;
 
             // call the trigger function
-            pthread_mutex_lock(&tmanager->mutex_);
-            tmanager->trigger(triggerId++);
+            if (mask != 0) {
+                // a trigger which came earlier than expected (e.g. burst) is still locked before being sent
+                if (lockPending)
+                    tmanager->lock(triggerId, scheduled);
+                // without schedules, every trigger is sent to all the cameras
+                tmanager->triggerMask_ = (tmanager->numChannels_ == 0) ? ~0u : mask;
+                tmanager->trigger(triggerId++, scheduled, now);
+                lastScheduled = scheduled;
+                lockPending = true;
+            }
+
+            // the schedule restarts at the end of the burst (the sequence keeps its phase)
+            if (mask != 0 && tmanager->burstSize_ > 0 && !tmanager->isBursting()) {
+                tmanager->resetDeadlines(deadlines, numChannels, SharedClock::getMonotonicTimeInNs());
+                if (useSequence)
+                    tmanager->seekSequence(sequenceOrigin, sequenceIndex, SharedClock::getMonotonicTimeInNs());
+                tmanager->burstSize_ = 0;
+                tmanager->burstIndex_ = 0;
+            }
         }
 
         // pause the trigger manager ?
-        while (tmanager->pause_) {
-            if (pthread_cond_wait(&tmanager->cond_, &tmanager->mutex_)) // wait for resume signal
-                throw new MyException("Unable to suspend trigger manager: pthread_cond_wait() failed.");
-            LOG(INFO) << "Resuming trigger manager.";
+        bool paused = false;
+        const uint64_t pauseStart = SharedClock::getMonotonicTimeInNs();
+        if (tmanager->pause_) {
+            pthread_mutex_lock(&tmanager->mutex_);
+            while (tmanager->pause_) {
+                if (pthread_cond_wait(&tmanager->cond_, &tmanager->mutex_)) // wait for resume signal
+                    throw new MyException("Unable to suspend trigger manager: pthread_cond_wait() failed.");
+                LOG(INFO) << "Resuming trigger manager.";
+                paused = true;
+            }
+            pthread_mutex_unlock(&tmanager->mutex_);
         }
-        pthread_mutex_unlock(&tmanager->mutex_);
+
+        // the time spent in pause is not an overrun
+        if (paused) {
+            tmanager->resetDeadlines(deadlines, numChannels, SharedClock::getMonotonicTimeInNs());
+            burstDeadline = SharedClock::getMonotonicTimeInNs();
+            tmanager->lastSentInNs_ = 0;
+            // the sequence is delayed by the pause, like the playlist
+            sequenceOrigin += burstDeadline - pauseStart;
+            lastScheduled += burstDeadline - pauseStart;
+        }
+
+        if (tmanager->isBursting())
+            deadline = burstDeadline;
+        else if (useSequence)
+            deadline = sequenceOrigin + sequence.getTimeInNs(sequenceIndex);
+        else
+            deadline = *std::min_element(deadlines, deadlines + numChannels);
+        wakeup = tmanager->getWakeupTime(deadline, lockPending);
+        timer.setValue(wakeup / 1000000000, wakeup % 1000000000);
+        timer.update();
     }
 
     // abortion
@@ -84,6 +233,8 @@ void* FdTriggerManager::processThread(void* obj) {
 
     timer.stop();
 
+    LOG(INFO) << "Trigger manager sent " << triggerId << " triggers (" << tmanager->numOverruns_ << " overrun(s), " << tmanager->numMissedTriggers_ << " missed trigger(s), " << tmanager->numBursts_ << " burst(s)).";
+
     pthread_mutex_lock(&tmanager->mutex_);
     tmanager->running_ = false;
     pthread_mutex_unlock(&tmanager->mutex_);
@@ -93,13 +244,217 @@ void* FdTriggerManager::processThread(void* obj) {
 
 // ----------------------------------------------------------------------
 
-void FdTriggerManager::trigger(const unsigned int triggerId) {
+uint64_t FdTriggerManager::catchUp(uint64_t& deadline, const uint64_t periodInNs, const uint64_t now, uint64_t& latenessInNs) {
+
+    uint64_t scheduled = deadline;
+    uint64_t numMissed = (now > deadline) ? (now - deadline) / periodInNs : 0;
+
+    if (numMissed == 0) {
+        deadline += periodInNs;
+        return scheduled;
+    }
+
+    latenessInNs = std::max(latenessInNs, now - deadline);
+
+    switch (catchUpPolicy_) {
+    case BURST:
+        // the next deadlines are already passed and are sent back to back
+        if (numMissed > TRIGGER_MAX_BURST) {
+            scheduled = deadline + (numMissed - TRIGGER_MAX_BURST) * periodInNs;
+            numMissedTriggers_ += numMissed - TRIGGER_MAX_BURST;
+        }
+        deadline = scheduled + periodInNs;
+        break;
+    case SHIFT:
+        numMissedTriggers_ += numMissed;
+        deadline = now + periodInNs;
+        break;
+    case SKIP:
+    default:
+        scheduled = deadline + numMissed * periodInNs;
+        numMissedTriggers_ += numMissed;
+        deadline = scheduled + periodInNs;
+        break;
+    }
+    return scheduled;
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t FdTriggerManager::getWakeupTime(const uint64_t deadline, const bool lockPending) {
+
+    const uint64_t leadInNs = (uint64_t)lockLeadInUs_ * 1000;
+    if (!lockPending || lockCallback_ == NULL || leadInNs == 0)
+        return deadline;
+
+    // a lead time longer than the interval is executed right after the previous trigger
+    return (deadline > leadInNs) ? deadline - leadInNs : 1;
+}
+
+// ----------------------------------------------------------------------
+
+bool FdTriggerManager::lock(const unsigned int triggerId, const uint64_t triggerInNs) {
+
+    const TriggerLockCallback callback = lockCallback_;
+    if (callback == NULL)
+        return false;
+
+    __sync_synchronize(); // the data is published before the callback
+    callback(lockCallbackData_, triggerId, triggerInNs, (uint64_t)lockLeadInUs_ * 1000);
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::resetDeadlines(uint64_t* deadlines, const unsigned int numChannels, const uint64_t now) {
+
+    for (unsigned int c = 0; c < numChannels; c++) {
+        const uint64_t phase = (numChannels_ > 0) ? schedules_[c].phaseInUs_ * 1000 : 0;
+        deadlines[c] = now + getChannelPeriodInNs(c) + phase;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t FdTriggerManager::getChannelPeriodInNs(const unsigned int channel) {
+
+    long periodInUs = intervalInUs_;
+    if (numChannels_ > 0 && schedules_[channel].periodInUs_ > 0)
+        periodInUs = schedules_[channel].periodInUs_;
+
+    return std::max(periodInUs, 1L) * 1000;
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::seekSequence(uint64_t& origin, unsigned int& index, const uint64_t afterInNs) {
+
+    // moves to the cycle containing afterInNs
+    const uint64_t cycle = sequence_.getCycleInNs();
+    if (afterInNs >= origin) {
+        origin += (afterInNs - origin) / cycle * cycle;
+        index = sequence_.getNextIndex(afterInNs - origin);
+    } else
+        index = 0;
+
+    if (index >= sequence_.getNumTriggers()) {
+        origin += cycle;
+        index = 0;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t FdTriggerManager::catchUpSequence(uint64_t& origin, unsigned int& index, const uint64_t now, uint64_t& latenessInNs) {
+
+    const unsigned int numTriggers = sequence_.getNumTriggers();
+    const uint64_t cycle = sequence_.getCycleInNs();
+    uint64_t scheduled = origin + sequence_.getTimeInNs(index);
+    if (++index == numTriggers) {
+        index = 0;
+        origin += cycle;
+    }
+
+    // is the next trigger already passed ?
+    uint64_t next = origin + sequence_.getTimeInNs(index);
+    if (next > now)
+        return scheduled;
+
+    latenessInNs = std::max(latenessInNs, now - scheduled);
+
+    switch (catchUpPolicy_) {
+    case BURST:
+        // the next triggers are already passed and are sent back to back
+        break;
+    case SHIFT:
+        // the rest of the sequence is delayed
+        origin += now - scheduled;
+        break;
+    case SKIP:
+    default:
+        while (next <= now) {
+            scheduled = next;
+            numMissedTriggers_++;
+            if (++index == numTriggers) {
+                index = 0;
+                origin += cycle;
+            }
+            next = origin + sequence_.getTimeInNs(index);
+        }
+        break;
+    }
+    return scheduled;
+}
+
+// ----------------------------------------------------------------------
+
+void* FdTriggerManager::dispatchThread(void* obj) {
+
+    FdTriggerManager* tmanager = reinterpret_cast<FdTriggerManager*>(obj);
+
+    TriggerEvent event;
+    uint64_t numEvents;
+    unsigned long numOverrunsLogged = 0;
+    while (tmanager->dispatching_ || !tmanager->events_.isEmpty()) {
+        // blocks until the RT thread has pushed events (or stop() wakes it up)
+        if (tmanager->events_.isEmpty())
+            read(tmanager->eventFd_, &numEvents, sizeof(numEvents));
+        while (tmanager->events_.pop(event)) {
+            emit tmanager->triggered(event.triggerId_);
+            if (event.burstSize_ > 0 && event.burstIndex_ == event.burstSize_)
+                emit tmanager->burstFinished(event.burstSize_);
+        }
+
+        // the overruns are logged here rather than from the RT thread
+        const unsigned long numOverruns = tmanager->numOverruns_;
+        if (numOverruns != numOverrunsLogged) {
+            const uint64_t lateness = __sync_fetch_and_add(&tmanager->overrunLatenessInNs_, 0);
+            LOG_FIRST_N(WARNING, 10) << "Trigger manager woke up " << lateness / 1000 << " us late (" << numOverruns - numOverrunsLogged << " overrun(s)).";
+            numOverrunsLogged = numOverruns;
+        }
+    }
+    return NULL;
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::trigger(const unsigned int triggerId, const uint64_t scheduledInNs, const uint64_t wakeupInNs) {
+
+    TriggerEvent event;
+    event.triggerId_ = triggerId;
+    event.mask_ = triggerMask_;
+    event.scheduledInNs_ = scheduledInNs;
+    event.sentInNs_ = 0;
+    event.burstIndex_ = (burstSize_ > 0) ? burstIndex_ : 0;
+    event.burstSize_ = burstSize_;
 
     (this->*preTriggerAction_)(triggerId);
-    // there is no warranty that the slot(s) responding to this signal
-    // will be executed before the post trigger method.
-    emit triggered(triggerId);
+    for (unsigned int i = 0; i < numCallbacks_; i++)
+        callbacks_[i](callbackData_[i], event);
     (this->*postTriggerAction_)(triggerId);
+
+    const uint64_t sent = SharedClock::getMonotonicTimeInNs();
+    latencyHistogram_.record(sent - wakeupInNs, triggerId);
+    if (lastSentInNs_ > 0)
+        intervalHistogram_.record(sent - lastSentInNs_, triggerId);
+    lastSentInNs_ = sent;
+
+    // the entry is invalidated while it is written
+    TriggerTime& entry = history_[triggerId % TRIGGER_HISTORY_SIZE];
+    entry.triggerId_ = -1;
+    __sync_synchronize();
+    entry.scheduledInNs_ = scheduledInNs;
+    entry.sentInNs_ = sent;
+    __sync_synchronize();
+    entry.triggerId_ = triggerId;
+
+    // the non-RT listeners are notified by the dispatch thread
+    event.sentInNs_ = sent;
+    if (events_.push(event)) {
+        uint64_t one = 1;
+        write(eventFd_, &one, sizeof(one));
+    } else
+        numDroppedEvents_++;
 }
 
 // ======================================================================
@@ -130,6 +485,37 @@ FdTriggerManager::~FdTriggerManager() {
 void FdTriggerManager::initialize() {
 
     intervalInUs_ = 50000;
+    catchUpPolicy_ = SKIP;
+    numOverruns_ = 0;
+    overrunLatenessInNs_ = 0;
+    numMissedTriggers_ = 0;
+    for (unsigned int i = 0; i < TRIGGER_HISTORY_SIZE; i++)
+        history_[i].triggerId_ = -1;
+    lastSentInNs_ = 0;
+    numCallbacks_ = 0;
+    lockCallback_ = NULL;
+    lockCallbackData_ = NULL;
+    lockLeadInUs_ = 0;
+    eventFd_ = -1;
+    dispatching_ = false;
+    numDroppedEvents_ = 0;
+    numChannels_ = 0;
+    triggerMask_ = ~0u;
+    requestFd_ = -1;
+    burstRequestFrames_ = 0;
+    burstRequestIntervalInUs_ = 0;
+    burstIndex_ = 0;
+    burstSize_ = 0;
+    numBursts_ = 0;
+    sequence_.clear();
+    syncRequestInNs_ = 0;
+    numSyncs_ = 0;
+    for (unsigned int c = 0; c < TRIGGER_MAX_CHANNELS; c++) {
+        schedules_[c].periodInUs_ = 0;
+        schedules_[c].phaseInUs_ = 0;
+        channelTriggerIds_[c] = 0;
+        channelScheduledInNs_[c] = 0;
+    }
     running_ = false;
     pause_ = false;
     abort_ = false;
@@ -148,6 +534,36 @@ void FdTriggerManager::start() throw(MyException*) {
     pthread_mutex_lock(&mutex_);
     abort_ = false;
     pause_ = false;
+    numOverruns_ = 0;
+    overrunLatenessInNs_ = 0;
+    numMissedTriggers_ = 0;
+    for (unsigned int i = 0; i < TRIGGER_HISTORY_SIZE; i++)
+        history_[i].triggerId_ = -1;
+    lastSentInNs_ = 0;
+    for (unsigned int c = 0; c < TRIGGER_MAX_CHANNELS; c++) {
+        channelTriggerIds_[c] = 0;
+        channelScheduledInNs_[c] = 0;
+    }
+    resetTimingStatistics();
+
+    // the dispatch thread keeps the default (normal) priority
+    numDroppedEvents_ = 0;
+    events_.clear();
+    if ((eventFd_ = eventfd(0, 0)) < 0)
+        throw new MyException("Unable to start trigger manager: eventfd() failed.");
+    dispatching_ = true;
+    if (pthread_create(&dispatchThread_, 0, FdTriggerManager::dispatchThread, this))
+        throw new MyException("Unable to start trigger dispatch thread: pthread_create() failed.");
+
+    // bursts and resynchronizations are requested through an eventfd so that the RT thread wakes up immediately
+    burstRequestFrames_ = 0;
+    burstIndex_ = 0;
+    burstSize_ = 0;
+    numBursts_ = 0;
+    syncRequestInNs_ = 0;
+    numSyncs_ = 0;
+    if ((requestFd_ = eventfd(0, 0)) < 0)
+        throw new MyException("Unable to start trigger manager: eventfd() failed.");
 
     if (pthread_create(&thread_, 0, FdTriggerManager::processThread, this))
         throw new MyException("Unable to start trigger manager thread: pthread_create() failed.");
@@ -168,6 +584,19 @@ void FdTriggerManager::stop() throw(MyException*) {
     pause_ = false;
     abort_ = true;
     pthread_join(thread_, NULL);
+
+    // the remaining events are dispatched before the thread exits
+    dispatching_ = false;
+    uint64_t one = 1;
+    write(eventFd_, &one, sizeof(one));
+    pthread_join(dispatchThread_, NULL);
+    close(eventFd_);
+    eventFd_ = -1;
+    close(requestFd_);
+    requestFd_ = -1;
+    burstIndex_ = 0;
+    burstSize_ = 0;
+
     running_ = false;
 }
 
@@ -192,6 +621,184 @@ void FdTriggerManager::pause(bool pause) throw(MyException*) {
 
 // ----------------------------------------------------------------------
 
+bool FdTriggerManager::triggerBurst(unsigned int numFrames, long intervalInUs) throw(MyException*) {
+
+    if (numFrames > TRIGGER_MAX_BURST_FRAMES)
+        throw new MyException("Unable to trigger burst: Too many frames.");
+    if (intervalInUs <= 0)
+        throw new MyException("Unable to trigger burst: The interval must be positive.");
+    if (!running_ || numFrames == 0)
+        return false;
+
+    // the interval is visible before the request is taken by the RT thread
+    burstRequestIntervalInUs_ = intervalInUs;
+    __sync_synchronize();
+    __sync_lock_test_and_set(&burstRequestFrames_, numFrames);
+    uint64_t one = 1;
+    write(requestFd_, &one, sizeof(one));
+
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::syncSequence(uint64_t cycleStartInNs) {
+
+    if (!running_ || sequence_.isEmpty() || cycleStartInNs == 0)
+        return;
+
+    __sync_lock_test_and_set(&syncRequestInNs_, cycleStartInNs);
+    uint64_t one = 1;
+    write(requestFd_, &one, sizeof(one));
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::syncSequenceCallback(void* obj, uint64_t cycleStartInNs) {
+
+    reinterpret_cast<FdTriggerManager*>(obj)->syncSequence(cycleStartInNs);
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::setSequence(const TriggerSequence& sequence) throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Unable to set trigger sequence: Trigger manager is running.");
+
+    // the RT thread relies on a compiled sequence with a cycle
+    TriggerSequence s = sequence;
+    if (!s.isEmpty())
+        s.validate(0);
+    sequence_ = s;
+}
+
+// ----------------------------------------------------------------------
+
+bool FdTriggerManager::getTriggerTime(unsigned int triggerId, uint64_t& scheduledInNs, uint64_t& sentInNs) {
+
+    const TriggerTime& entry = history_[triggerId % TRIGGER_HISTORY_SIZE];
+    if (entry.triggerId_ != (int)triggerId)
+        return false;
+    __sync_synchronize();
+    scheduledInNs = entry.scheduledInNs_;
+    sentInNs = entry.sentInNs_;
+    __sync_synchronize();
+
+    // the entry may have been overwritten in the meantime
+    return entry.triggerId_ == (int)triggerId;
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::addTriggerCallback(TriggerCallback callback, void* data) throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Unable to add trigger callback: Trigger manager is running.");
+    if (numCallbacks_ >= TRIGGER_MAX_CALLBACKS)
+        throw new MyException("Unable to add trigger callback: Too many callbacks.");
+
+    callbacks_[numCallbacks_] = callback;
+    callbackData_[numCallbacks_] = data;
+    numCallbacks_++;
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::setLockCallback(TriggerLockCallback callback, void* data, long leadInUs) throw(MyException*) {
+
+    if (leadInUs < 0)
+        throw new MyException("Unable to set lock callback: Lead time must be positive.");
+
+    // the RT thread may be running: the callback is published last
+    lockCallback_ = NULL;
+    __sync_synchronize();
+    lockCallbackData_ = data;
+    lockLeadInUs_ = leadInUs;
+    __sync_synchronize();
+    lockCallback_ = callback;
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::clearTriggerCallbacks() throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Unable to remove trigger callbacks: Trigger manager is running.");
+
+    numCallbacks_ = 0;
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::setNumChannels(unsigned int numChannels) throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Unable to set the number of trigger channels: Trigger manager is running.");
+    if (numChannels > TRIGGER_MAX_CHANNELS)
+        throw new MyException("Unable to set the number of trigger channels: Too many channels.");
+
+    numChannels_ = numChannels;
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::setSchedule(unsigned int channel, long periodInUs, long phaseInUs) throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Unable to set trigger schedule: Trigger manager is running.");
+    if (channel >= TRIGGER_MAX_CHANNELS)
+        throw new MyException("Unable to set trigger schedule: Invalid channel.");
+    if (periodInUs < 0 || phaseInUs < 0)
+        throw new MyException("Unable to set trigger schedule: Period and phase must be positive.");
+
+    schedules_[channel].periodInUs_ = periodInUs;
+    schedules_[channel].phaseInUs_ = phaseInUs;
+}
+
+// ----------------------------------------------------------------------
+
+TriggerSchedule FdTriggerManager::getSchedule(unsigned int channel) {
+
+    TriggerSchedule schedule;
+    schedule.periodInUs_ = intervalInUs_;
+    schedule.phaseInUs_ = 0;
+    if (numChannels_ > 0 && channel < numChannels_) {
+        schedule.periodInUs_ = getChannelPeriodInNs(channel) / 1000;
+        schedule.phaseInUs_ = schedules_[channel].phaseInUs_;
+    }
+    return schedule;
+}
+
+// ----------------------------------------------------------------------
+
+void FdTriggerManager::resetTimingStatistics() {
+
+    latencyHistogram_.reset();
+    intervalHistogram_.reset();
+}
+
+// ----------------------------------------------------------------------
+
+std::string FdTriggerManager::getTimingReport() {
+
+    std::stringstream ss;
+    ss << "Trigger period: " << intervalInUs_ << " us" << std::endl;
+    for (unsigned int c = 0; c < numChannels_; c++)
+        ss << "Channel " << c << " schedule: period " << getSchedule(c).periodInUs_ << " us, phase " << getSchedule(c).phaseInUs_ << " us, " << channelTriggerIds_[c] << " triggers" << std::endl;
+    ss << "Overruns: " << numOverruns_ << ", missed triggers: " << numMissedTriggers_ << std::endl;
+    if (!sequence_.isEmpty())
+        ss << "Trigger sequence: " << sequence_.getSummary() << ", " << numSyncs_ << " resynchronization(s)" << std::endl;
+    if (numBursts_ > 0)
+        ss << "Bursts: " << numBursts_ << std::endl;
+    ss << "Wakeup to register write latency: " << latencyHistogram_.getSummary() << std::endl;
+    ss << "Interval between triggers: " << intervalHistogram_.getSummary() << std::endl;
+
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------
+
 void FdTriggerManager::defaultPreTriggerAction(int /*triggerId*/) {}
 
 // ----------------------------------------------------------------------
@@ -207,6 +814,29 @@ bool FdTriggerManager::isRunning() { return running_; }
 void FdTriggerManager::setIntervalInUs(long intervalInUs) { intervalInUs_ = intervalInUs; }
 long FdTriggerManager::getIntervalInUs() { return intervalInUs_; }
 
+void FdTriggerManager::setCatchUpPolicy(catchUpPolicy policy) { catchUpPolicy_ = policy; }
+FdTriggerManager::catchUpPolicy FdTriggerManager::getCatchUpPolicy() { return catchUpPolicy_; }
+
+unsigned long FdTriggerManager::getNumOverruns() { return numOverruns_; }
+unsigned long FdTriggerManager::getNumMissedTriggers() { return numMissedTriggers_; }
+
+unsigned long FdTriggerManager::getNumDroppedEvents() { return numDroppedEvents_; }
+long FdTriggerManager::getLockLeadInUs() { return lockLeadInUs_; }
+
+bool FdTriggerManager::isBursting() { return burstIndex_ < burstSize_; }
+unsigned long FdTriggerManager::getNumBursts() { return numBursts_; }
+
+TriggerSequence* FdTriggerManager::getSequence() { return &sequence_; }
+unsigned long FdTriggerManager::getNumSyncs() { return numSyncs_; }
+
+unsigned int FdTriggerManager::getNumChannels() { return numChannels_; }
+unsigned int FdTriggerManager::getTriggerMask() { return triggerMask_; }
+unsigned int FdTriggerManager::getChannelTriggerId(unsigned int channel) { return channelTriggerIds_[channel % TRIGGER_MAX_CHANNELS]; }
+uint64_t FdTriggerManager::getChannelScheduledTimeInNs(unsigned int channel) { return channelScheduledInNs_[channel % TRIGGER_MAX_CHANNELS]; }
+
+TimingHistogram* FdTriggerManager::getLatencyHistogram() { return &latencyHistogram_; }
+TimingHistogram* FdTriggerManager::getIntervalHistogram() { return &intervalHistogram_; }
+
 void FdTriggerManager::setPreTriggerAction(pfv functionPtr) { preTriggerAction_ = functionPtr; }
 pfv FdTriggerManager::getPreTriggerAction() { return preTriggerAction_; }
 
@@ -29,9 +29,26 @@
 #define FDTRIGGERMANAGER_H
 
 #include "myexception.h"
+#include "timinghistogram.h"
+#include "triggersequence.h"
+#include "lockfreequeue.h"
 #include <pthread.h>
+#include <stdint.h>
 #include <QObject>
 
+/** Number of triggers whose scheduled and send times are kept. */
+#define TRIGGER_HISTORY_SIZE 1024
+/** Maximum number of late triggers sent back to back with the BURST policy. */
+#define TRIGGER_MAX_BURST 16
+/** Maximum number of trigger channels (one per camera). */
+#define TRIGGER_MAX_CHANNELS 16
+/** Maximum number of callbacks executed by the RT thread at every trigger. */
+#define TRIGGER_MAX_CALLBACKS 8
+/** Capacity of the queue of trigger events passed to the non-RT listeners (power of two). */
+#define TRIGGER_EVENT_QUEUE_SIZE 256
+/** Maximum number of triggers of a burst. */
+#define TRIGGER_MAX_BURST_FRAMES 100000
+
 //! Library to control multiple cameras and manage the experiments.
 namespace squid {
 
@@ -40,19 +57,111 @@ class FdTriggerManager;
 /** Declares a typedef for pointer to a function returning void and taking an int argument (frame index). */
 typedef void (FdTriggerManager::*pfv)(int);
 
+/**
+ * \brief Scheduled and actual send times of a trigger.
+ *
+ * Times are in ns on CLOCK_MONOTONIC.
+ *
+ * @version March 8, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct TriggerTime {
+    /** Trigger id (-1 if the entry is being written). */
+    volatile int triggerId_;
+    /** Deadline at which the trigger was scheduled. */
+    uint64_t scheduledInNs_;
+    /** Time at which the trigger has actually been sent (post-trigger action done). */
+    uint64_t sentInNs_;
+};
+
+/**
+ * \brief Describes a trigger sent.
+ *
+ * @version March 10, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct TriggerEvent {
+    /** Trigger id. */
+    unsigned int triggerId_;
+    /** Channels triggered (bit i = channel i, all bits set without channels). */
+    unsigned int mask_;
+    /** Deadline at which the trigger was scheduled in ns (CLOCK_MONOTONIC). */
+    uint64_t scheduledInNs_;
+    /** Time at which the trigger has been sent in ns (0 while the callbacks are executed). */
+    uint64_t sentInNs_;
+    /** Index of the trigger in its burst starting from 1 (0 outside bursts). */
+    unsigned int burstIndex_;
+    /** Number of triggers of the burst (0 outside bursts). */
+    unsigned int burstSize_;
+};
+
+/** Callback executed by the RT thread at every trigger (must not block nor allocate). */
+typedef void (*TriggerCallback)(void* data, const TriggerEvent& event);
+/** Callback executed by the RT thread the lead time before the trigger scheduled at triggerInNs (must not block nor allocate). */
+typedef void (*TriggerLockCallback)(void* data, unsigned int triggerId, uint64_t triggerInNs, uint64_t leadInNs);
+
+/**
+ * \brief Trigger period and phase offset of a channel.
+ *
+ * @version March 9, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+struct TriggerSchedule {
+    /** Period in us (0 = interval of the trigger manager). */
+    long periodInUs_;
+    /** Offset in us of the first trigger relative to the other channels. */
+    long phaseInUs_;
+};
+
 /**
  * \brief Implements a software trigger manager for dc1394 cameras.
  *
  * The implementation uses a dedicated pthread using rtkit to promote the thread
- * to realtime (RT) priority.
+ * to realtime (RT) priority. Triggers are scheduled on absolute deadlines
+ * (CLOCK_MONOTONIC) so that the period doesn't drift. When the thread wakes up
+ * more than one period late, the overrun is counted and the missed triggers
+ * are handled according to the catch-up policy.
+ *
+ * Each channel (one per active camera) can have its own period and phase
+ * offset. All the channels are scheduled from the same thread and the
+ * channels whose deadline is reached are available through getTriggerMask()
+ * while the trigger actions are executed. Without channels, all the cameras
+ * are triggered every interval.
+ *
+ * A burst of triggers can be requested at any time with triggerBurst(): the
+ * RT thread wakes up immediately, sends the requested number of triggers to
+ * all the cameras at the burst interval, then returns to the schedule of
+ * the channels (typically a low preview rate).
+ *
+ * Instead of the periodic schedule, a precompiled sequence of trigger times
+ * can be played in loop on absolute deadlines. syncSequence() aligns the
+ * start of its cycle on an external event, e.g. the playlist restarting.
  *
- * @version January 27, 2012
+ * The RT thread doesn't take any lock while sending a trigger: it executes
+ * the callbacks registered before start() then pushes the trigger event to a
+ * lock-free queue. A normal-priority thread drains the queue and emits
+ * triggered() for the non-RT listeners.
+ *
+ * A lock callback can be executed by the RT thread a lead time before each
+ * trigger, e.g. to switch the LEDs and valves of a frame-locked playlist at
+ * an exact trigger id while compensating their rise time.
+ *
+ * @version March 18, 2012
  * @author Thomas Schaffter (thomas.schaff...@gmail.com)
  */
 class FdTriggerManager : public QObject {
 
     Q_OBJECT
 
+public:
+
+    /** Policy applied when one or more trigger deadlines have been missed. */
+    enum catchUpPolicy {
+        SKIP = 0,   // drops the missed triggers and keeps the phase
+        BURST = 1,  // sends the missed triggers as soon as possible
+        SHIFT = 2   // drops the missed triggers and restarts the schedule from now
+    };
+
 private:
 
     /** Mutex for the thread. */
@@ -72,6 +181,81 @@ private:
     /** Interval in us between two triggers. */
     long intervalInUs_;
 
+    /** Callbacks executed by the RT thread at every trigger. */
+    TriggerCallback callbacks_[TRIGGER_MAX_CALLBACKS];
+    /** Data passed to each callback. */
+    void* callbackData_[TRIGGER_MAX_CALLBACKS];
+    /** Number of callbacks registered. */
+    unsigned int numCallbacks_;
+
+    /** Callback executed the lead time before each trigger (NULL = none). */
+    volatile TriggerLockCallback lockCallback_;
+    /** Data passed to the lock callback. */
+    void* volatile lockCallbackData_;
+    /** Time in us between the lock callback and the trigger. */
+    volatile long lockLeadInUs_;
+
+    /** Trigger events passed from the RT thread to the dispatch thread. */
+    LockFreeQueue<TriggerEvent, TRIGGER_EVENT_QUEUE_SIZE> events_;
+    /** eventfd used to wake up the dispatch thread. */
+    int eventFd_;
+    /** Id of the thread emitting triggered() (normal priority). */
+    pthread_t dispatchThread_;
+    /** Is true while the dispatch thread must run. */
+    volatile bool dispatching_;
+    /** Number of events lost because the queue was full. */
+    unsigned long numDroppedEvents_;
+
+    /** Policy applied when trigger deadlines have been missed. */
+    catchUpPolicy catchUpPolicy_;
+
+    /** Number of wakeups more than one period late (the triggers sent back to back to catch up are not counted again). */
+    volatile unsigned long numOverruns_;
+    /** Lateness in ns of the last overrun, logged by the dispatch thread. */
+    volatile uint64_t overrunLatenessInNs_;
+    /** Number of scheduled triggers which have not been sent. */
+    unsigned long numMissedTriggers_;
+    /** Number of channels with their own schedule (0 = single schedule for all cameras). */
+    unsigned int numChannels_;
+    /** Schedule of each channel. */
+    TriggerSchedule schedules_[TRIGGER_MAX_CHANNELS];
+    /** Channels triggered by the current trigger (bit i = channel i). */
+    volatile unsigned int triggerMask_;
+    /** Number of triggers sent on each channel. */
+    volatile unsigned int channelTriggerIds_[TRIGGER_MAX_CHANNELS];
+    /** Deadline of the last trigger sent on each channel. */
+    volatile uint64_t channelScheduledInNs_[TRIGGER_MAX_CHANNELS];
+
+    /** eventfd used to wake up the RT thread when a burst or a resynchronization is requested. */
+    int requestFd_;
+    /** Number of triggers of the burst requested (0 = no pending request). */
+    volatile unsigned int burstRequestFrames_;
+    /** Interval in us between two triggers of the burst requested. */
+    volatile long burstRequestIntervalInUs_;
+    /** Index of the last trigger sent in the current burst (burstSize_ when idle). */
+    volatile unsigned int burstIndex_;
+    /** Number of triggers of the current burst. */
+    volatile unsigned int burstSize_;
+    /** Number of bursts started. */
+    unsigned long numBursts_;
+
+    /** Trigger times played in loop instead of the schedule of the channels (empty = periodic schedule). */
+    TriggerSequence sequence_;
+    /** Start of the cycle of the sequence in ns requested by syncSequence() (0 = no pending request). */
+    volatile uint64_t syncRequestInNs_;
+    /** Number of resynchronizations of the sequence. */
+    unsigned long numSyncs_;
+
+    /** Scheduled and send times of the last triggers (ring buffer). */
+    TriggerTime history_[TRIGGER_HISTORY_SIZE];
+
+    /** Latencies from the wakeup of the thread to the end of the trigger (register write). */
+    TimingHistogram latencyHistogram_;
+    /** Intervals between two consecutive triggers. */
+    TimingHistogram intervalHistogram_;
+    /** Time at which the last trigger has been sent (0 after a pause). */
+    uint64_t lastSentInNs_;
+
     /** Function pointer to call just before sending a trigger. */
     pfv preTriggerAction_;
     /** Function pointer to call just after sending a trigger. */
@@ -89,6 +273,67 @@ public:
     /** Returns the interval in um between two refreshments of the interface. */
     long getIntervalInUs();
 
+    /** Sets the policy applied when trigger deadlines have been missed. */
+    void setCatchUpPolicy(catchUpPolicy policy);
+    /** Returns the policy applied when trigger deadlines have been missed. */
+    catchUpPolicy getCatchUpPolicy();
+
+    /** Sets the number of channels with their own schedule (0 = single schedule for all cameras). */
+    void setNumChannels(unsigned int numChannels) throw(MyException*);
+    /** Returns the number of channels with their own schedule. */
+    unsigned int getNumChannels();
+    /** Sets the period and phase offset of a channel in us (period 0 = interval of the trigger manager). */
+    void setSchedule(unsigned int channel, long periodInUs, long phaseInUs) throw(MyException*);
+    /** Returns the effective schedule of a channel. */
+    TriggerSchedule getSchedule(unsigned int channel);
+    /** Returns the channels triggered by the current trigger (valid in the trigger actions). */
+    unsigned int getTriggerMask();
+    /** Returns the number of triggers sent on a channel. */
+    unsigned int getChannelTriggerId(unsigned int channel);
+    /** Returns the deadline of the last trigger sent on a channel in ns. */
+    uint64_t getChannelScheduledTimeInNs(unsigned int channel);
+
+    /** Returns the number of wakeups more than one period late. */
+    unsigned long getNumOverruns();
+    /** Returns the number of scheduled triggers which have not been sent. */
+    unsigned long getNumMissedTriggers();
+    /** Gets the scheduled and send times of a recent trigger (returns false if no longer available). */
+    bool getTriggerTime(unsigned int triggerId, uint64_t& scheduledInNs, uint64_t& sentInNs);
+
+    /** Returns the histogram of the latencies from wakeup to register write. */
+    TimingHistogram* getLatencyHistogram();
+    /** Returns the histogram of the intervals between two consecutive triggers. */
+    TimingHistogram* getIntervalHistogram();
+    /** Resets the timing histograms. */
+    void resetTimingStatistics();
+    /** Returns a report of the trigger timing (overruns, latencies and intervals). */
+    std::string getTimingReport();
+
+    /** Registers a callback executed by the RT thread at every trigger (before start()). */
+    void addTriggerCallback(TriggerCallback callback, void* data) throw(MyException*);
+    /** Removes all the callbacks (before start()). */
+    void clearTriggerCallbacks() throw(MyException*);
+    /** Returns the number of trigger events lost because the non-RT listeners were too slow. */
+    unsigned long getNumDroppedEvents();
+    /** Sets the callback executed leadInUs before each trigger (NULL = none, can be set while running). */
+    void setLockCallback(TriggerLockCallback callback, void* data, long leadInUs) throw(MyException*);
+    /** Returns the time in us between the lock callback and the trigger. */
+    long getLockLeadInUs();
+
+    /** Plays the sequence in loop instead of the schedule of the channels (empty sequence = periodic schedule). */
+    void setSequence(const TriggerSequence& sequence) throw(MyException*);
+    /** Returns the sequence played in loop. */
+    TriggerSequence* getSequence();
+    /** Returns the number of resynchronizations of the sequence. */
+    unsigned long getNumSyncs();
+    /** Calls syncSequence() on the trigger manager given as data (e.g. callback of the playlist). */
+    static void syncSequenceCallback(void* obj, uint64_t cycleStartInNs);
+
+    /** Returns true while a burst of triggers is being sent. */
+    bool isBursting();
+    /** Returns the number of bursts started. */
+    unsigned long getNumBursts();
+
     /** Sets pre-trigger function. */
     void setPreTriggerAction(pfv functionPtr);
     /** Returns pre-trigger function. */
@@ -114,6 +359,11 @@ public slots:
     /** Pauses or resumes the trigger manager. */
     void pause(bool pause) throw(MyException*);
 
+    /** Sends numFrames triggers every intervalInUs from now, then resumes the schedule (doesn't block, returns false if not running). */
+    bool triggerBurst(unsigned int numFrames, long intervalInUs) throw(MyException*);
+    /** Aligns the start of the cycle of the sequence on the given time in ns on CLOCK_MONOTONIC (doesn't block). */
+    void syncSequence(uint64_t cycleStartInNs);
+
     /** Returns true if the trigger manager is running. */
     bool isRunning();
     /** Returns true if the trigger manager has been aborted. */
@@ -121,8 +371,10 @@ public slots:
 
 signals:
 
-    /** Sent when a trigger is generated. */
+    /** Sent by the dispatch thread (normal priority) after a trigger has been sent. */
     void triggered(unsigned int triggerId);
+    /** Sent by the dispatch thread after the last trigger of a burst has been sent. */
+    void burstFinished(unsigned int numFrames);
     /** Emits a signal when the trigger manager is aborted. */
     void done();
 
@@ -136,9 +388,26 @@ private:
      * for the pthread_create call.
      */
     static void* processThread(void* obj);
+    /** Thread draining the trigger events and emitting triggered(). */
+    static void* dispatchThread(void* obj);
+
+    /** Applies the catch-up policy to the deadline of a channel and returns the time scheduled for the trigger. */
+    uint64_t catchUp(uint64_t& deadline, const uint64_t periodInNs, const uint64_t now, uint64_t& latenessInNs);
+    /** Schedules the next trigger of each channel from now. */
+    void resetDeadlines(uint64_t* deadlines, const unsigned int numChannels, const uint64_t now);
+    /** Returns the period of a channel in ns. */
+    uint64_t getChannelPeriodInNs(const unsigned int channel);
+    /** Moves the sequence to its first trigger strictly after the given time in ns. */
+    void seekSequence(uint64_t& origin, unsigned int& index, const uint64_t afterInNs);
+    /** Applies the catch-up policy to the sequence, moves to the next trigger and returns the time scheduled for the trigger. */
+    uint64_t catchUpSequence(uint64_t& origin, unsigned int& index, const uint64_t now, uint64_t& latenessInNs);
 
+    /** Returns the time at which the thread must wake up for the trigger scheduled at deadline (lead time of the lock callback). */
+    uint64_t getWakeupTime(const uint64_t deadline, const bool lockPending);
+    /** Executes the lock callback for the next trigger, returns false if there is no callback. */
+    bool lock(const unsigned int triggerId, const uint64_t triggerInNs);
     /** Function executed at every trigger. */
-    void trigger(const unsigned int triggerId);
+    void trigger(const unsigned int triggerId, const uint64_t scheduledInNs, const uint64_t wakeupInNs);
 };
 
 } // end namespace squid
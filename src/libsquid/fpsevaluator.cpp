@@ -25,19 +25,38 @@
  * THE SOFTWARE.
  */
 
-#include "cameramanager.h"
 #include "fpsevaluator.h"
-#include "fdtimer.h"
+#include "scheduler.h"
 #include "myexception.h"
 #include <glog/logging.h>
 
 using namespace squid;
 
+// ======================================================================
+// PRIVATE METHODS
+
+bool FpsEvaluator::evaluate(void* obj) {
+
+    FpsEvaluator* fps = reinterpret_cast<FpsEvaluator*>(obj);
+
+    fps->mutex_.lock();
+    const unsigned int currentNumFrames = fps->currentNumFrames_;
+    const unsigned int prevNumFrames = fps->prevNumFrames_;
+    // save variable for next time
+    fps->prevNumFrames_ = currentNumFrames;
+    fps->mutex_.unlock();
+
+    emit fps->fpsUpdated((1000.*((float)currentNumFrames-(float)prevNumFrames))/(float)fps->intervalInMs_);
+
+    return true;
+}
+
 // ======================================================================
 // PUBLIC METHODS
 
 FpsEvaluator::FpsEvaluator() {
 
+    taskId_ = -1;
     initialize();
 }
 
@@ -45,55 +64,30 @@ FpsEvaluator::FpsEvaluator() {
 
 FpsEvaluator::~FpsEvaluator() {
 
-    mutex_.lock();
-    abort_ = true;
-    // to wake up the thread if it's sleeping
-    // (the thread is put to sleep when it has nothing to do)
-    condition_.wakeOne();
-    mutex_.unlock();
-    // to wait until run() has exited before the base class destructor is invoked
-    wait();
+    // to wait until evaluate() has returned before the base class destructor is invoked
+    stop();
 }
 
 // ----------------------------------------------------------------------
 
 void FpsEvaluator::initialize() {
 
+    mutex_.lock();
     prevNumFrames_ = 0;
     currentNumFrames_ = 0;
-    baseTimeInMilliseconds_ = 0;
+    mutex_.unlock();
     intervalInMs_ = 2000;
-    restart_ = false;
-    abort_ = false;
 }
 
 // ----------------------------------------------------------------------
 
-void FpsEvaluator::run() {
-
-    try {
-        FdTimer timer;
-        timer.initialize(0, intervalInMs_ * 1000000);
-        timer.start();
-        int fd = timer.getTimer();
-
-        while (!abort_) {
-            uint64_t numTimeout;
-            read(fd, &numTimeout, sizeof(numTimeout));
-            if (numTimeout > 1)
-                LOG(WARNING) << "Timer missed " << (numTimeout - 1) << " events.";
-
-            emit fpsUpdated((1000.*((float)currentNumFrames_-(float)prevNumFrames_))/(float)intervalInMs_);
-
-            mutex_.lock();
-                // save variable for next time
-                this->prevNumFrames_ = currentNumFrames_;
-            mutex_.unlock();
-        }
+void FpsEvaluator::start() {
 
-        timer.stop();
-        emit fpsUpdated(0);
+    if (taskId_ >= 0)
+        return;
 
+    try {
+        taskId_ = Scheduler::getInstance()->addTask(Scheduler::NON_RT_LANE, &FpsEvaluator::evaluate, this, intervalInMs_ * 1000);
     } catch (MyException* e) {
         LOG(WARNING) << "FpsEvaluator failed: " << e->getMessage();
     }
@@ -103,14 +97,16 @@ void FpsEvaluator::run() {
 
 void FpsEvaluator::stop() {
 
-        setAbort(true);
-}
+    if (taskId_ < 0)
+        return;
 
-// ----------------------------------------------------------------------
-
-void FpsEvaluator::wake() {
-
-    condition_.wakeOne();
+    try {
+        Scheduler::getInstance()->removeTask(taskId_);
+    } catch (MyException* e) {
+        LOG(WARNING) << "FpsEvaluator failed: " << e->getMessage();
+    }
+    taskId_ = -1;
+    emit fpsUpdated(0);
 }
 
 // ----------------------------------------------------------------------
@@ -126,5 +122,4 @@ void FpsEvaluator::incrementNumFrames() {
 // GETTERS AND SETTERS
 
 void FpsEvaluator::setIntervalInMs(unsigned int intervalInMs) { intervalInMs_ = intervalInMs; }
-void FpsEvaluator::setRestart(bool b) { restart_ = b; }
-void FpsEvaluator::setAbort(bool b) { abort_ = b; }
+bool FpsEvaluator::isRunning() { return taskId_ >= 0; }
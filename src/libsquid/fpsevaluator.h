@@ -28,23 +28,22 @@
 #ifndef FPSEVALUATOR_H
 #define FPSEVALUATOR_H
 
-#include <QThread>
+#include <QObject>
 #include <QMutex>
-#include <QWaitCondition>
-#include <QTime>
 
 //! Library to control multiple cameras and manage the experiments.
 namespace squid {
 
 /**
- * \brief Computes FPS (frames per second) or camera framerate in a dedicated thread.
+ * \brief Computes FPS (frames per second) or camera framerate.
  *
- * Here QThread doesn't need to be replaced by pthread.
+ * The evaluation is a periodic task of the non-RT lane of the Scheduler,
+ * so that the FPS evaluators of all the cameras share the same thread.
  *
- * @version January 13, 2012
+ * @version March 14, 2012
  * @author Thomas Schaffter (thomas.schaff...@gmail.com)
  */
-class FpsEvaluator : public QThread {
+class FpsEvaluator : public QObject {
 
     Q_OBJECT
 
@@ -54,22 +53,16 @@ private:
     unsigned int prevNumFrames_;
     /** Current number of frames. */
     unsigned int currentNumFrames_;
-    /** When the last FPS evaluation has been done. */
-    unsigned int baseTimeInMilliseconds_;
     /** Time interval in ms between two FPS evaluations. */
     unsigned int intervalInMs_;
-    /** Time support. */
-    QTime time_;
+    /** Id of the task registered on the scheduler, -1 if not running. */
+    int taskId_;
 
     /** Mutex. */
     QMutex mutex_;
-    /** Condition for waiting. */
-    QWaitCondition condition_;
 
-    /** If false, the thread is put to sleep. */
-    bool restart_;
-    /** If true, the thread is stopped. */
-    bool abort_;
+    /** Function run by the scheduler at each evaluation. */
+    static bool evaluate(void* obj);
 
 public:
 
@@ -84,18 +77,15 @@ public:
     /** Set the interval time between two refresh (use mutliples of 1s). */
     void setIntervalInMs(unsigned int interval);
 
+    /** Returns true if the evaluator is running. */
+    bool isRunning();
+
 public slots:
 
-    /** Start thread. */
-    void run();
-    /** Stop thread. */
+    /** Starts evaluating the FPS. */
+    void start();
+    /** Stops evaluating the FPS. */
     void stop();
-    /** Call setRestart(false) to put the thread to sleep. */
-    void setRestart(bool b);
-    /** Call setAbort(true) to stop the thread. */
-    void setAbort(bool b);
-    /** If the thread has been put to sleep with setRestart(false), call this method to wake it. */
-    void wake();
 
     /** Do currentNumFrames_++. */
     void incrementNumFrames();
@@ -0,0 +1,247 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "frameprefetcher.h"
+#include <glog/logging.h>
+
+using namespace squid;
+
+// ======================================================================
+// PRIVATE METHODS
+
+void* FramePrefetcher::processThread(void* obj) {
+
+    FramePrefetcher* prefetcher = reinterpret_cast<FramePrefetcher*>(obj);
+    std::string filename;
+
+    pthread_mutex_lock(&prefetcher->mutex_);
+    while (!prefetcher->abort_) {
+        // wait for requests
+        if (prefetcher->requests_.empty()) {
+            pthread_cond_wait(&prefetcher->cond_, &prefetcher->mutex_);
+            continue;
+        }
+        filename = prefetcher->requests_.front();
+        prefetcher->requests_.pop_front();
+        if (prefetcher->cache_.find(filename) != prefetcher->cache_.end())
+            continue;
+        pthread_mutex_unlock(&prefetcher->mutex_);
+
+        // decoding is done without holding the lock
+        QImage image(QString::fromStdString(filename));
+        if (image.isNull())
+            LOG(WARNING) << "Unable to load frame " << filename;
+
+        pthread_mutex_lock(&prefetcher->mutex_);
+        if (!image.isNull())
+            prefetcher->insert(filename, image);
+    }
+    prefetcher->running_ = false;
+    pthread_mutex_unlock(&prefetcher->mutex_);
+
+    return NULL;
+}
+
+// ----------------------------------------------------------------------
+
+void FramePrefetcher::insert(const std::string filename, const QImage& image) {
+
+    if (cache_.find(filename) != cache_.end())
+        return;
+
+    lru_.push_front(filename);
+    cache_[filename] = std::make_pair(image, lru_.begin());
+    cacheSizeInBytes_ += image.numBytes();
+
+    // releases the least recently used frames (but never the one just inserted)
+    while (cacheSizeInBytes_ > maxCacheSizeInBytes_ && lru_.size() > 1) {
+        std::map<std::string, std::pair<QImage, std::list<std::string>::iterator> >::iterator it = cache_.find(lru_.back());
+        cacheSizeInBytes_ -= it->second.first.numBytes();
+        cache_.erase(it);
+        lru_.pop_back();
+    }
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+FramePrefetcher::FramePrefetcher() {
+
+    if (pthread_mutex_init(&mutex_, NULL) == -1)
+        throw new MyException("Unable to pthread_mutex_init().");
+    if (pthread_cond_init(&cond_, NULL) == -1)
+        throw new MyException("Unable to pthread_cond_init().");
+
+    running_ = false;
+    abort_ = false;
+    cacheSizeInBytes_ = 0;
+    maxCacheSizeInBytes_ = 512ULL * 1024 * 1024;
+    hits_ = 0;
+    misses_ = 0;
+}
+
+// ----------------------------------------------------------------------
+
+FramePrefetcher::~FramePrefetcher() {
+
+    stop();
+
+    if (pthread_cond_destroy(&cond_) == -1)
+        throw new MyException("Unable to pthread_cond_destroy().");
+    if (pthread_mutex_destroy(&mutex_) == -1)
+        throw new MyException("Unable to pthread_mutex_destroy().");
+}
+
+// ----------------------------------------------------------------------
+
+void FramePrefetcher::start() throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Frame prefetcher is already running.");
+
+    pthread_mutex_lock(&mutex_);
+    abort_ = false;
+
+    if (pthread_create(&thread_, 0, FramePrefetcher::processThread, this)) {
+        pthread_mutex_unlock(&mutex_);
+        throw new MyException("Unable to start frame prefetcher thread: pthread_create() failed.");
+    }
+
+    running_ = true;
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
+void FramePrefetcher::stop() {
+
+    if (!running_)
+        return;
+
+    pthread_mutex_lock(&mutex_);
+    abort_ = true;
+    requests_.clear();
+    pthread_cond_signal(&cond_);
+    pthread_mutex_unlock(&mutex_);
+
+    pthread_join(thread_, NULL);
+    running_ = false;
+}
+
+// ----------------------------------------------------------------------
+
+bool FramePrefetcher::get(const std::string filename, QImage& image) {
+
+    pthread_mutex_lock(&mutex_);
+    std::map<std::string, std::pair<QImage, std::list<std::string>::iterator> >::iterator it = cache_.find(filename);
+    if (it == cache_.end()) {
+        misses_++;
+        pthread_mutex_unlock(&mutex_);
+        return false;
+    }
+    // moves the frame to the front of the LRU list
+    lru_.splice(lru_.begin(), lru_, it->second.second);
+    image = it->second.first;
+    hits_++;
+    pthread_mutex_unlock(&mutex_);
+
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+QImage FramePrefetcher::load(const std::string filename) {
+
+    QImage image;
+    if (get(filename, image))
+        return image;
+
+    image.load(QString::fromStdString(filename));
+    if (image.isNull()) {
+        LOG(WARNING) << "Unable to load frame " << filename;
+        return image;
+    }
+
+    pthread_mutex_lock(&mutex_);
+    insert(filename, image);
+    pthread_mutex_unlock(&mutex_);
+
+    return image;
+}
+
+// ----------------------------------------------------------------------
+
+void FramePrefetcher::prefetch(const std::vector<std::string>& filenames) {
+
+    pthread_mutex_lock(&mutex_);
+    requests_.clear();
+    for (unsigned int i = 0; i < filenames.size(); i++) {
+        std::map<std::string, std::pair<QImage, std::list<std::string>::iterator> >::iterator it = cache_.find(filenames[i]);
+        if (it == cache_.end())
+            requests_.push_back(filenames[i]);
+        else // keeps the frames that will be needed soon away from the LRU end
+            lru_.splice(lru_.begin(), lru_, it->second.second);
+    }
+    if (!requests_.empty())
+        pthread_cond_signal(&cond_);
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
+void FramePrefetcher::clear() {
+
+    pthread_mutex_lock(&mutex_);
+    requests_.clear();
+    cache_.clear();
+    lru_.clear();
+    cacheSizeInBytes_ = 0;
+    hits_ = 0;
+    misses_ = 0;
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
+double FramePrefetcher::getHitRatio() {
+
+    pthread_mutex_lock(&mutex_);
+    const unsigned long total = hits_ + misses_;
+    const double ratio = (total == 0) ? 0. : (double)hits_ / total;
+    pthread_mutex_unlock(&mutex_);
+
+    return ratio;
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+bool FramePrefetcher::isAbort() { return abort_; }
+bool FramePrefetcher::isRunning() { return running_; }
+
+void FramePrefetcher::setMaxCacheSizeInBytes(unsigned long long size) { maxCacheSizeInBytes_ = size; }
+unsigned long long FramePrefetcher::getMaxCacheSizeInBytes() { return maxCacheSizeInBytes_; }
+unsigned long long FramePrefetcher::getCacheSizeInBytes() { return cacheSizeInBytes_; }
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef FRAMEPREFETCHER_H
+#define FRAMEPREFETCHER_H
+
+#include "myexception.h"
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <QImage>
+
+//! Library to control multiple cameras and manage the experiments.
+namespace squid {
+
+/**
+ * \brief Loads frames from disk in background into a bounded LRU cache.
+ *
+ * The viewer calls prefetch() with the list of the frames it will need
+ * next (most urgent first), which replaces the previous requests. A
+ * dedicated pthread decodes them into the cache. When the size of the cache
+ * exceeds the limit, the least recently used frames are released.
+ *
+ * @version March 7, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class FramePrefetcher {
+
+private:
+
+    /** Mutex protecting the cache and the requests. */
+    pthread_mutex_t mutex_;
+    /** Condition variable signaled when new requests are available. */
+    pthread_cond_t cond_;
+    /** Id returned by pthread_create(). */
+    pthread_t thread_;
+
+    /** Is true if the prefetcher is running. */
+    bool running_;
+    /** Sets to true to abort. */
+    bool abort_;
+
+    /** Filenames from the most to the least recently used. */
+    std::list<std::string> lru_;
+    /** Cached frames with their position in lru_. */
+    std::map<std::string, std::pair<QImage, std::list<std::string>::iterator> > cache_;
+    /** Frames to load (most urgent first). */
+    std::list<std::string> requests_;
+
+    /** Size of the cached frames in bytes. */
+    unsigned long long cacheSizeInBytes_;
+    /** Max size of the cache in bytes. */
+    unsigned long long maxCacheSizeInBytes_;
+
+    /** Number of frames found in the cache. */
+    unsigned long hits_;
+    /** Number of frames not found in the cache. */
+    unsigned long misses_;
+
+public:
+
+    /** Constructor. */
+    FramePrefetcher();
+    /** Destructor. */
+    ~FramePrefetcher();
+
+    /** Starts the prefetch thread. */
+    void start() throw(MyException*);
+    /** Stops the prefetch thread. */
+    void stop();
+
+    /** Gets a frame from the cache. Returns false if the frame is not cached. */
+    bool get(const std::string filename, QImage& image);
+    /** Loads a frame immediately (in the calling thread) and caches it. */
+    QImage load(const std::string filename);
+    /** Replaces the pending requests with the given frames (most urgent first). */
+    void prefetch(const std::vector<std::string>& filenames);
+    /** Releases all the cached frames. */
+    void clear();
+
+    /** Sets the max size of the cache in bytes. */
+    void setMaxCacheSizeInBytes(unsigned long long size);
+    /** Returns the max size of the cache in bytes. */
+    unsigned long long getMaxCacheSizeInBytes();
+    /** Returns the size of the cached frames in bytes. */
+    unsigned long long getCacheSizeInBytes();
+    /** Returns the ratio of frames found in the cache. */
+    double getHitRatio();
+
+    /** Returns true if the prefetcher is running. */
+    bool isRunning();
+    /** Returns true if the prefetcher has been aborted. */
+    bool isAbort();
+
+private:
+
+    /**
+     * This is the static class function that serves as a C style function pointer
+     * for the pthread_create call.
+     */
+    static void* processThread(void* obj);
+
+    /** Inserts a frame in the cache and releases the LRU frames if required (mutex_ must be locked). */
+    void insert(const std::string filename, const QImage& image);
+};
+
+} // end namespace squid
+
+#endif // FRAMEPREFETCHER_H
@@ -8,7 +8,13 @@ SOURCES += cameramanager.cpp \
     experimenttime.cpp \
     dc1394frame.cpp \
     dc1394framewriter.cpp \
-    fdtriggermanager.cpp
+    fdtriggermanager.cpp \
+    previewserver.cpp \
+    recording.cpp \
+    frameprefetcher.cpp \
+    timinghistogram.cpp \
+    cycletimecorrelator.cpp \
+    triggersequence.cpp
 HEADERS += cameramanager.h \
     dc1394camera.h \
     dc1394utility.h \
@@ -19,7 +25,13 @@ HEADERS += cameramanager.h \
     experimenttime.h \
     dc1394frame.h \
     dc1394framewriter.h \
-    fdtriggermanager.h
+    fdtriggermanager.h \
+    previewserver.h \
+    recording.h \
+    frameprefetcher.h \
+    timinghistogram.h \
+    cycletimecorrelator.h \
+    triggersequence.h
 
 
 
@@ -0,0 +1,647 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "previewserver.h"
+#include "dc1394utility.h"
+#include "scheduler.h"
+#include "sharedclock.h"
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <sstream>
+#include <unistd.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <QBuffer>
+#include <QByteArray>
+#include <glog/logging.h>
+
+using namespace squid;
+
+/** Escapes a string to be written as a JSON string value. */
+static std::string jsonEscape(const std::string str) {
+
+    std::string output;
+    for (unsigned int i = 0; i < str.size(); i++) {
+        const char c = str[i];
+        if (c == '"' || c == '\\') {
+            output += '\\';
+            output += c;
+        } else if ((unsigned char)c < 0x20)
+            output += ' ';
+        else
+            output += c;
+    }
+    return output;
+}
+
+// ----------------------------------------------------------------------
+
+PreviewSnapshot::PreviewSnapshot() {
+
+    front_ = 0;
+    encoding_ = -1;
+    imageBytes_ = 0;
+    width_ = 0;
+    height_ = 0;
+    coding_ = DC1394_COLOR_CODING_MONO8;
+    filter_ = DC1394_COLOR_FILTER_RGGB;
+    byteOrder_ = DC1394_BYTE_ORDER_UYVY;
+    littleEndian_ = false;
+    us_ = 0;
+    fresh_ = false;
+    lastCopyInUs_ = 0;
+    framesReceived_ = 0;
+    framesCopied_ = 0;
+    framesEncoded_ = 0;
+}
+
+// ----------------------------------------------------------------------
+
+PreviewClient::PreviewClient(int fd) {
+
+    fd_ = fd;
+    camera_ = -1;
+    closeWhenSent_ = false;
+}
+
+// ======================================================================
+// PRIVATE METHODS
+
+bool PreviewServer::update(void* obj) {
+
+    PreviewServer* server = reinterpret_cast<PreviewServer*>(obj);
+
+    server->acceptClients();
+    server->readRequests();
+    server->streamFrames();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+void PreviewServer::closeConnections() {
+
+    for (unsigned int i = 0; i < clients_.size(); i++) {
+        close(clients_.at(i)->fd_);
+        delete clients_.at(i);
+    }
+    clients_.clear();
+    close(listenFd_);
+    listenFd_ = -1;
+}
+
+// ----------------------------------------------------------------------
+
+void PreviewServer::acceptClients() {
+
+    int fd;
+    while ((fd = accept4(listenFd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        if (clients_.size() >= PREVIEW_MAX_CLIENTS) {
+            LOG(WARNING) << "Preview server: Too many clients, connection refused.";
+            close(fd);
+            continue;
+        }
+        clients_.push_back(new PreviewClient(fd));
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void PreviewServer::readRequests() {
+
+    std::vector<bool> toClose(clients_.size(), false);
+    PreviewClient* client = NULL;
+    char buffer[1024];
+    ssize_t n;
+
+    for (unsigned int i = 0; i < clients_.size(); i++) {
+        client = clients_.at(i);
+        // requests of streaming clients are ignored, we only detect disconnections
+        while ((n = recv(client->fd_, buffer, sizeof(buffer), 0)) > 0) {
+            if (client->camera_ < 0 && !client->closeWhenSent_)
+                client->request_.append(buffer, n);
+        }
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            toClose[i] = true;
+            continue;
+        }
+        if (client->camera_ >= 0 || client->closeWhenSent_)
+            continue;
+
+        if (client->request_.find("\r\n\r\n") != std::string::npos)
+            handleRequest(client);
+        else if (client->request_.size() > PREVIEW_MAX_REQUEST_SIZE) {
+            client->output_ = "HTTP/1.0 400 Bad Request\r\nConnection: close\r\n\r\n";
+            client->closeWhenSent_ = true;
+        }
+    }
+    closeClients(toClose);
+}
+
+// ----------------------------------------------------------------------
+
+void PreviewServer::handleRequest(PreviewClient* client) {
+
+    std::stringstream ss(client->request_.substr(0, client->request_.find("\r\n")));
+    std::string method, path;
+    ss >> method >> path;
+
+    std::string body;
+    std::string contentType;
+    std::stringstream header;
+    client->closeWhenSent_ = true;
+
+    if (method != "GET") {
+        client->output_ = "HTTP/1.0 405 Method Not Allowed\r\nConnection: close\r\n\r\n";
+        return;
+    }
+
+    if (path == "/" || path == "/index.html") {
+        body = getIndex();
+        contentType = "text/html";
+    } else if (path == "/status") {
+        body = getStatus();
+        contentType = "application/json";
+    } else if (path.find("/camera/") == 0) {
+        const int index = atoi(path.substr(8).c_str());
+        pthread_mutex_lock(&mutex_);
+        const int numCameras = cameraNames_.size();
+        pthread_mutex_unlock(&mutex_);
+        if (index >= 0 && index < numCameras && path.size() > 8) {
+            client->camera_ = index;
+            client->closeWhenSent_ = false;
+            client->output_ = "HTTP/1.0 200 OK\r\n"
+                    "Content-Type: multipart/x-mixed-replace; boundary=" PREVIEW_BOUNDARY "\r\n"
+                    "Cache-Control: no-cache\r\n"
+                    "Connection: close\r\n\r\n";
+            client->request_.clear();
+            return;
+        }
+    }
+
+    if (contentType.empty()) {
+        client->output_ = "HTTP/1.0 404 Not Found\r\nConnection: close\r\n\r\n";
+        return;
+    }
+
+    header << "HTTP/1.0 200 OK\r\n";
+    header << "Content-Type: " << contentType << "\r\n";
+    header << "Cache-Control: no-cache\r\n";
+    header << "Content-Length: " << body.size() << "\r\n";
+    header << "Connection: close\r\n\r\n";
+    client->output_ = header.str() + body;
+    client->request_.clear();
+}
+
+// ----------------------------------------------------------------------
+
+void PreviewServer::streamFrames() {
+
+    pthread_mutex_lock(&mutex_);
+    const unsigned int numCameras = cameraNames_.size();
+    pthread_mutex_unlock(&mutex_);
+
+    PreviewClient* client = NULL;
+    PreviewSnapshot* snapshot = NULL;
+
+    for (unsigned int i = 0; i < numCameras; i++) {
+        // encodes only if at least one client is ready to receive a new frame
+        bool ready = false;
+        for (unsigned int j = 0; j < clients_.size() && !ready; j++) {
+            client = clients_.at(j);
+            ready = (client->camera_ == (int)i && client->output_.empty());
+        }
+        if (!ready)
+            continue;
+
+        snapshot = snapshots_[i];
+        pthread_mutex_lock(&mutex_);
+        if (!snapshot->fresh_) {
+            pthread_mutex_unlock(&mutex_);
+            continue;
+        }
+        // the capture thread writes the other buffer meanwhile
+        snapshot->encoding_ = snapshot->front_;
+        const unsigned char* image = &snapshot->images_[snapshot->encoding_][0];
+        const unsigned int width = snapshot->width_;
+        const unsigned int height = snapshot->height_;
+        const dc1394color_coding_t coding = snapshot->coding_;
+        const dc1394color_filter_t filter = snapshot->filter_;
+        const dc1394byte_order_t order = snapshot->byteOrder_;
+        const bool littleEndian = snapshot->littleEndian_;
+        snapshot->fresh_ = false;
+        pthread_mutex_unlock(&mutex_);
+
+        QImage preview = snapshotToImage(image, width, height, coding, filter, order, littleEndian);
+        pthread_mutex_lock(&mutex_);
+        snapshot->encoding_ = -1;
+        pthread_mutex_unlock(&mutex_);
+        if (preview.isNull())
+            continue;
+
+        QByteArray jpeg;
+        QBuffer buffer(&jpeg);
+        buffer.open(QIODevice::WriteOnly);
+        if (!preview.save(&buffer, "JPEG", quality_)) {
+            LOG_FIRST_N(WARNING, 1) << "Preview server: Unable to encode JPEG image.";
+            continue;
+        }
+        snapshot->jpeg_.assign(jpeg.constData(), jpeg.size());
+        __sync_fetch_and_add(&snapshot->framesEncoded_, 1);
+
+        std::stringstream part;
+        part << "--" << PREVIEW_BOUNDARY << "\r\n";
+        part << "Content-Type: image/jpeg\r\n";
+        part << "Content-Length: " << snapshot->jpeg_.size() << "\r\n\r\n";
+        const std::string frame = part.str() + snapshot->jpeg_ + "\r\n";
+
+        // clients still sending the previous frame skip this one
+        for (unsigned int j = 0; j < clients_.size(); j++) {
+            client = clients_.at(j);
+            if (client->camera_ == (int)i && client->output_.empty())
+                client->output_ = frame;
+        }
+    }
+
+    std::vector<bool> toClose(clients_.size(), false);
+    for (unsigned int j = 0; j < clients_.size(); j++)
+        toClose[j] = !flush(clients_.at(j));
+    closeClients(toClose);
+}
+
+// ----------------------------------------------------------------------
+
+bool PreviewServer::flush(PreviewClient* client) {
+
+    ssize_t n;
+    while (!client->output_.empty()) {
+        n = send(client->fd_, client->output_.data(), client->output_.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0)
+            client->output_.erase(0, n);
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+        else
+            return false;
+    }
+    return !client->closeWhenSent_;
+}
+
+// ----------------------------------------------------------------------
+
+void PreviewServer::closeClients(std::vector<bool>& toClose) {
+
+    for (int i = toClose.size() - 1; i >= 0; i--) {
+        if (toClose[i]) {
+            close(clients_.at(i)->fd_);
+            delete clients_.at(i);
+            clients_.erase(clients_.begin() + i);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------
+
+QImage PreviewServer::snapshotToImage(const unsigned char* image, const unsigned int width, const unsigned int height, const dc1394color_coding_t coding, const dc1394color_filter_t filter, const dc1394byte_order_t order, const bool littleEndian) {
+
+    const unsigned int w = width / decimation_;
+    const unsigned int h = height / decimation_;
+    if (w == 0 || h == 0)
+        return QImage();
+
+    // grayscale frames are decimated while being copied
+    if (coding == DC1394_COLOR_CODING_MONO8 || coding == DC1394_COLOR_CODING_MONO16) {
+        QImage output(w, h, QImage::Format_Indexed8);
+        output.setNumColors(256);
+        for (unsigned int i = 0; i < 256; i++)
+            output.setColor(i, qRgb(i, i, i));
+
+        if (coding == DC1394_COLOR_CODING_MONO16) {
+            unsigned int min, max;
+            getMono16Range(image, width * height, littleEndian, 7, min, max);
+            computeWindowLevelLut(&lut_[0], min, max);
+        }
+        const unsigned int lsb = littleEndian ? 0 : 1;
+        for (unsigned int y = 0; y < h; y++) {
+            unsigned char* line = output.scanLine(y);
+            const unsigned int offset = y * decimation_ * width;
+            for (unsigned int x = 0; x < w; x++) {
+                const unsigned int k = offset + x * decimation_;
+                if (coding == DC1394_COLOR_CODING_MONO8)
+                    line[x] = image[k];
+                else
+                    line[x] = lut_[(image[2*k + 1 - lsb] << 8) | image[2*k + lsb]];
+            }
+        }
+        return output;
+    }
+
+    // color frames are converted at full resolution, then decimated
+    QImage output(width, height, QImage::Format_RGB32);
+    unsigned int* rgb = (unsigned int*)output.bits();
+    switch (coding) {
+    case DC1394_COLOR_CODING_RAW8:
+        raw8ToRgb32(image, rgb, width, height, filter);
+        break;
+    case DC1394_COLOR_CODING_YUV422:
+        yuv422ToRgb32(image, rgb, width * height, order);
+        break;
+    case DC1394_COLOR_CODING_RGB8:
+        rgb8ToRgb32(image, rgb, width * height);
+        break;
+    default:
+        LOG_FIRST_N(WARNING, 1) << "Preview server: Unsupported color coding " << coding << ".";
+        return QImage();
+    }
+    if (decimation_ > 1)
+        return output.scaled(w, h, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+    return output;
+}
+
+// ----------------------------------------------------------------------
+
+std::string PreviewServer::getStatus() {
+
+    std::stringstream json;
+    PreviewSnapshot* snapshot = NULL;
+    std::string coding;
+
+    pthread_mutex_lock(&mutex_);
+    json << "{\n";
+    json << "  \"address\": \"" << jsonEscape(address_) << "\",\n";
+    json << "  \"port\": " << port_ << ",\n";
+    json << "  \"maxFps\": " << maxFps_ << ",\n";
+    json << "  \"decimation\": " << decimation_ << ",\n";
+    json << "  \"quality\": " << quality_ << ",\n";
+    json << "  \"clients\": " << clients_.size() << ",\n";
+    json << "  \"cameras\": [";
+    for (unsigned int i = 0; i < cameraNames_.size(); i++) {
+        snapshot = snapshots_[i];
+        try {
+            coding = dc1394ToSringCoding(snapshot->coding_);
+        } catch (MyException* e) {
+            coding = "";
+        }
+        json << (i == 0 ? "\n" : ",\n");
+        json << "    {\"index\": " << i;
+        json << ", \"name\": \"" << jsonEscape(cameraNames_.at(i)) << "\"";
+        json << ", \"width\": " << snapshot->width_;
+        json << ", \"height\": " << snapshot->height_;
+        json << ", \"coding\": \"" << coding << "\"";
+        json << ", \"lastFrameUs\": " << snapshot->us_;
+        json << ", \"framesReceived\": " << snapshot->framesReceived_;
+        json << ", \"framesCopied\": " << snapshot->framesCopied_;
+        json << ", \"framesEncoded\": " << snapshot->framesEncoded_ << "}";
+    }
+    json << "\n  ]\n}\n";
+    pthread_mutex_unlock(&mutex_);
+
+    return json.str();
+}
+
+// ----------------------------------------------------------------------
+
+std::string PreviewServer::getIndex() {
+
+    std::stringstream html;
+
+    pthread_mutex_lock(&mutex_);
+    html << "<!DOCTYPE html>\n<html><head><title>sQuid preview</title></head><body>\n";
+    for (unsigned int i = 0; i < cameraNames_.size(); i++) {
+        html << "<h3>" << htmlEscape(cameraNames_.at(i)) << "</h3>\n";
+        html << "<img src=\"/camera/" << i << "\" alt=\"camera " << i << "\"/>\n";
+    }
+    html << "<p><a href=\"/status\">Status</a></p>\n</body></html>\n";
+    pthread_mutex_unlock(&mutex_);
+
+    return html.str();
+}
+
+// ----------------------------------------------------------------------
+
+std::string PreviewServer::htmlEscape(const std::string str) {
+
+    std::string output;
+    for (unsigned int i = 0; i < str.size(); i++) {
+        switch (str[i]) {
+        case '<': output += "&lt;"; break;
+        case '>': output += "&gt;"; break;
+        case '&': output += "&amp;"; break;
+        case '"': output += "&quot;"; break;
+        default: output += str[i];
+        }
+    }
+    return output;
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+PreviewServer::PreviewServer() {
+
+    if (pthread_mutex_init(&mutex_, NULL) == -1)
+        throw new MyException("Unable to pthread_mutex_init().");
+
+    for (unsigned int i = 0; i < PREVIEW_MAX_CAMERAS; i++)
+        snapshots_[i] = new PreviewSnapshot();
+
+    initialize();
+}
+
+// ----------------------------------------------------------------------
+
+PreviewServer::~PreviewServer() {
+
+    stop();
+
+    for (unsigned int i = 0; i < PREVIEW_MAX_CAMERAS; i++) {
+        delete snapshots_[i];
+        snapshots_[i] = NULL;
+    }
+
+    if (pthread_mutex_destroy(&mutex_) == -1)
+        throw new MyException("Unable to pthread_mutex_destroy().");
+}
+
+// ----------------------------------------------------------------------
+
+void PreviewServer::initialize() {
+
+    running_ = false;
+    abort_ = false;
+    address_ = "127.0.0.1";
+    port_ = 8080;
+    maxFps_ = 5;
+    quality_ = 75;
+    decimation_ = 2;
+    listenFd_ = -1;
+    taskId_ = -1;
+    lut_.resize(65536);
+}
+
+// ----------------------------------------------------------------------
+
+void PreviewServer::start() throw(MyException*) {
+
+    if (running_)
+        throw new MyException("Preview server is already running.");
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    if (inet_pton(AF_INET, address_.c_str(), &addr.sin_addr) != 1)
+        throw new MyException("Invalid preview server address " + address_ + ".");
+
+    if ((listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1)
+        throw new MyException("Unable to create preview server socket: " + std::string(strerror(errno)));
+
+    int reuse = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if (bind(listenFd_, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(listenFd_, PREVIEW_MAX_CLIENTS) == -1) {
+        std::string error = strerror(errno);
+        close(listenFd_);
+        listenFd_ = -1;
+        throw new MyException("Unable to bind preview server to " + address_ + ": " + error);
+    }
+
+    pthread_mutex_lock(&mutex_);
+    abort_ = false;
+
+    // the server runs at the preview rate on the non-RT lane
+    try {
+        taskId_ = Scheduler::getInstance()->addTask(Scheduler::NON_RT_LANE, &PreviewServer::update, this, 1000000L / getMaxFps());
+    } catch (MyException* e) {
+        pthread_mutex_unlock(&mutex_);
+        closeConnections();
+        throw e;
+    }
+
+    running_ = true;
+    pthread_mutex_unlock(&mutex_);
+
+    LOG(INFO) << "Preview server listening on http://" << address_ << ":" << port_ << "/";
+}
+
+// ----------------------------------------------------------------------
+
+void PreviewServer::stop() throw(MyException*) {
+
+    if (!running_)
+        return;
+
+    abort_ = true;
+    Scheduler::getInstance()->removeTask(taskId_);
+    taskId_ = -1;
+    closeConnections();
+    running_ = false;
+}
+
+// ----------------------------------------------------------------------
+
+void PreviewServer::pushFrame(dc1394video_frame_t* frame, unsigned int cameraIndex, unsigned int us, bool /*save*/) {
+
+    if (!running_ || cameraIndex >= PREVIEW_MAX_CAMERAS)
+        return;
+
+    PreviewSnapshot* snapshot = snapshots_[cameraIndex];
+    __sync_fetch_and_add(&snapshot->framesReceived_, 1);
+
+    // rate cap: the frame is dropped without taking the lock
+    const unsigned long long now = SharedClock::getMonotonicTimeInNs() / 1000;
+    if (now - snapshot->lastCopyInUs_ < 1000000ULL / maxFps_)
+        return;
+
+    // never wait for the server thread
+    if (pthread_mutex_trylock(&mutex_) != 0)
+        return;
+
+    // writes the buffer which is not being encoded
+    const int back = (snapshot->encoding_ >= 0) ? 1 - snapshot->encoding_ : snapshot->front_;
+    std::vector<unsigned char>& image = snapshot->images_[back];
+    if (image.size() < frame->image_bytes) {
+        LOG_FIRST_N(WARNING, 1) << "Preview server: Frames of " << frame->image_bytes << " bytes exceed the preallocated buffers.";
+        image.resize(frame->image_bytes);
+    }
+    memcpy(&image[0], frame->image, frame->image_bytes);
+    snapshot->front_ = back;
+    snapshot->imageBytes_ = frame->image_bytes;
+    snapshot->width_ = frame->size[0];
+    snapshot->height_ = frame->size[1];
+    snapshot->coding_ = frame->color_coding;
+    snapshot->filter_ = frame->color_filter;
+    snapshot->byteOrder_ = frame->yuv_byte_order;
+    snapshot->littleEndian_ = (frame->little_endian == DC1394_TRUE);
+    snapshot->us_ = us;
+    snapshot->fresh_ = true;
+    snapshot->lastCopyInUs_ = now;
+    __sync_fetch_and_add(&snapshot->framesCopied_, 1);
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
+void PreviewServer::setCameraNames(std::vector<std::string> names) {
+
+    pthread_mutex_lock(&mutex_);
+    cameraNames_ = names;
+    if (cameraNames_.size() > PREVIEW_MAX_CAMERAS)
+        cameraNames_.resize(PREVIEW_MAX_CAMERAS);
+    // the buffers are allocated here so that the capture thread never allocates
+    for (unsigned int i = 0; i < cameraNames_.size(); i++) {
+        for (unsigned int j = 0; j < 2; j++) {
+            if (snapshots_[i]->images_[j].size() < PREVIEW_IMAGE_BYTES)
+                snapshots_[i]->images_[j].resize(PREVIEW_IMAGE_BYTES);
+        }
+    }
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+bool PreviewServer::isAbort() { return abort_; }
+bool PreviewServer::isRunning() { return running_; }
+
+void PreviewServer::setAddress(std::string address) { address_ = address; }
+std::string PreviewServer::getAddress() { return address_; }
+
+void PreviewServer::setPort(unsigned int port) { port_ = port; }
+unsigned int PreviewServer::getPort() { return port_; }
+
+void PreviewServer::setMaxFps(unsigned int fps) { maxFps_ = (fps > 0) ? fps : 1; }
+unsigned int PreviewServer::getMaxFps() { return maxFps_; }
+
+void PreviewServer::setQuality(int quality) { quality_ = quality; }
+int PreviewServer::getQuality() { return quality_; }
+
+void PreviewServer::setDecimation(unsigned int decimation) { decimation_ = (decimation > 0) ? decimation : 1; }
+unsigned int PreviewServer::getDecimation() { return decimation_; }
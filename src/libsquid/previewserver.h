@@ -0,0 +1,271 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef PREVIEWSERVER_H
+#define PREVIEWSERVER_H
+
+#include "myexception.h"
+#include "dc1394/dc1394.h"
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <QObject>
+#include <QImage>
+
+/** Max number of cameras streamed. */
+#define PREVIEW_MAX_CAMERAS 16
+/** Max number of simultaneous HTTP clients. */
+#define PREVIEW_MAX_CLIENTS 16
+/** Max number of bytes of an HTTP request header. */
+#define PREVIEW_MAX_REQUEST_SIZE 4096
+/** Boundary string separating the JPEG images of a MJPEG stream. */
+#define PREVIEW_BOUNDARY "squidpreviewframe"
+/** Number of bytes preallocated per image buffer (1600x1200 RGB8). */
+#define PREVIEW_IMAGE_BYTES (1600 * 1200 * 3)
+
+//! Library to control multiple cameras and manage the experiments.
+namespace squid {
+
+/**
+ * \brief Latest frame copied from the capture thread for one camera.
+ *
+ * The frames are copied to two buffers allocated once: the capture thread
+ * always writes the buffer which is not being encoded.
+ */
+class PreviewSnapshot {
+
+public:
+
+    /** Raw copies of the dc1394 image (never swapped nor shrunk). */
+    std::vector<unsigned char> images_[2];
+    /** Index of the buffer holding the last frame copied. */
+    int front_;
+    /** Index of the buffer being encoded by the server task, -1 if none. */
+    int encoding_;
+    /** Number of bytes of the last frame copied. */
+    unsigned int imageBytes_;
+    /** Frame width in pixels. */
+    unsigned int width_;
+    /** Frame height in pixels. */
+    unsigned int height_;
+    /** Color coding of the frame. */
+    dc1394color_coding_t coding_;
+    /** Bayer pattern (RAW8 frames only). */
+    dc1394color_filter_t filter_;
+    /** Byte order (YUV422 frames only). */
+    dc1394byte_order_t byteOrder_;
+    /** True if 16-bit samples are little-endian. */
+    bool littleEndian_;
+    /** Capture time of the frame in us. */
+    unsigned int us_;
+    /** Is true if the snapshot has not been encoded yet. */
+    bool fresh_;
+    /** Time of the last copy in us (CLOCK_MONOTONIC). */
+    unsigned long long lastCopyInUs_;
+
+    /** Number of frames received from the capture thread. */
+    volatile unsigned long framesReceived_;
+    /** Number of frames copied (rate-capped). */
+    volatile unsigned long framesCopied_;
+    /** Number of frames encoded to JPEG. */
+    volatile unsigned long framesEncoded_;
+
+    /** Latest JPEG image. */
+    std::string jpeg_;
+
+    /** Constructor. */
+    PreviewSnapshot();
+    /** Destructor. */
+    ~PreviewSnapshot() {}
+};
+
+/**
+ * \brief State of one HTTP connection.
+ */
+class PreviewClient {
+
+public:
+
+    /** Socket. */
+    int fd_;
+    /** Bytes of the request received so far. */
+    std::string request_;
+    /** Bytes left to send. */
+    std::string output_;
+    /** Index of the camera streamed (-1 if the client is not streaming). */
+    int camera_;
+    /** If true, the connection is closed once the output is sent. */
+    bool closeWhenSent_;
+
+    /** Constructor. */
+    PreviewClient(int fd);
+    /** Destructor. */
+    ~PreviewClient() {}
+};
+
+/**
+ * \brief Embedded HTTP server serving a MJPEG preview of the cameras.
+ *
+ * Serves the following resources:
+ * - "/": HTML page showing the stream of all the cameras.
+ * - "/camera/<index>": MJPEG stream (multipart/x-mixed-replace) of one camera.
+ * - "/status": JSON status of the server and of the cameras.
+ *
+ * pushFrame() is called from the capture thread. It only copies the frame
+ * if the capped preview rate allows it and gives up if the server task
+ * holds the lock, so that the capture is never slowed down. The frame is
+ * copied to a preallocated buffer of the camera that the server task is not
+ * encoding, so that the capture thread never allocates. Decimation,
+ * JPEG encoding and the network I/O are done by a task of the non-RT lane
+ * of the Scheduler run at the preview rate. Slow clients skip frames instead of buffering.
+ *
+ * @version March 5, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class PreviewServer : public QObject {
+
+    Q_OBJECT
+
+private:
+
+    /** Mutex protecting the snapshots. */
+    pthread_mutex_t mutex_;
+    /** Id of the task registered on the non-RT lane of the scheduler. */
+    int taskId_;
+
+    /** Is true if the server is running. */
+    bool running_;
+    /** Sets to true to abort. */
+    bool abort_;
+
+    /** Address the server is bound to (default: 127.0.0.1). */
+    std::string address_;
+    /** TCP port. */
+    unsigned int port_;
+    /** Max number of frames per second encoded per camera. */
+    unsigned int maxFps_;
+    /** JPEG quality (0-100). */
+    int quality_;
+    /** Only one pixel out of decimation_ (in both directions) is streamed. */
+    unsigned int decimation_;
+
+    /** Listening socket. */
+    int listenFd_;
+    /** Connected clients. */
+    std::vector<PreviewClient*> clients_;
+    /** Latest frame of each camera (allocated once, never resized while running). */
+    PreviewSnapshot* snapshots_[PREVIEW_MAX_CAMERAS];
+    /** Name of each camera. */
+    std::vector<std::string> cameraNames_;
+    /** Window/level LUT used to preview MONO16 frames. */
+    std::vector<unsigned char> lut_;
+
+public:
+
+    /** Constructor. */
+    PreviewServer();
+    /** Destructor. */
+    ~PreviewServer();
+
+    /** Sets the address to bind to. */
+    void setAddress(std::string address);
+    /** Returns the address to bind to. */
+    std::string getAddress();
+
+    /** Sets the TCP port. */
+    void setPort(unsigned int port);
+    /** Returns the TCP port. */
+    unsigned int getPort();
+
+    /** Sets the max number of frames per second encoded per camera. */
+    void setMaxFps(unsigned int fps);
+    /** Returns the max number of frames per second encoded per camera. */
+    unsigned int getMaxFps();
+
+    /** Sets the JPEG quality (0-100). */
+    void setQuality(int quality);
+    /** Returns the JPEG quality. */
+    int getQuality();
+
+    /** Sets the decimation factor. */
+    void setDecimation(unsigned int decimation);
+    /** Returns the decimation factor. */
+    unsigned int getDecimation();
+
+    /** Sets the names of the cameras (one snapshot is allocated per camera). */
+    void setCameraNames(std::vector<std::string> names);
+
+public slots:
+
+    /** Opens the listening socket and starts the server task. */
+    void start() throw(MyException*);
+    /** Stops the server task and closes all connections. */
+    void stop() throw(MyException*);
+
+    /** Returns true if the server is running. */
+    bool isRunning();
+    /** Returns true if the server has been aborted. */
+    bool isAbort();
+
+    /** Copies the frame if required (must be connected with Qt::DirectConnection). */
+    void pushFrame(dc1394video_frame_t* frame, unsigned int cameraIndex, unsigned int us, bool save);
+
+private:
+
+    /** Initialization. */
+    void initialize();
+
+    /** Function run by the scheduler at the preview rate. */
+    static bool update(void* obj);
+    /** Closes all the connections. */
+    void closeConnections();
+
+    /** Accepts the pending connections. */
+    void acceptClients();
+    /** Reads the requests of the clients and answers them. */
+    void readRequests();
+    /** Answers a complete HTTP request. */
+    void handleRequest(PreviewClient* client);
+    /** Encodes the fresh snapshots and sends them to the streaming clients. */
+    void streamFrames();
+    /** Sends as many pending bytes as possible without blocking. Returns false if the client must be closed. */
+    bool flush(PreviewClient* client);
+    /** Closes the connections marked for closing. */
+    void closeClients(std::vector<bool>& toClose);
+
+    /** Converts a raw image to a decimated QImage. */
+    QImage snapshotToImage(const unsigned char* image, const unsigned int width, const unsigned int height, const dc1394color_coding_t coding, const dc1394color_filter_t filter, const dc1394byte_order_t order, const bool littleEndian);
+    /** Returns the JSON status. */
+    std::string getStatus();
+    /** Returns the HTML index page. */
+    std::string getIndex();
+    /** Escapes a string to be written in HTML. */
+    static std::string htmlEscape(const std::string str);
+};
+
+} // end namespace squid
+
+#endif // PREVIEWSERVER_H
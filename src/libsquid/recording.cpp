@@ -0,0 +1,334 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "recording.h"
+#include "dc1394framewriter.h"
+#include "experiment.h"
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <boost/filesystem.hpp>
+#include <glog/logging.h>
+
+using namespace squid;
+
+/** Sorts the frames by time, then by filename. */
+static bool compareFrames(const RecordingFrame& a, const RecordingFrame& b) {
+
+    if (a.timeInMs_ != b.timeInMs_)
+        return a.timeInMs_ < b.timeInMs_;
+    return a.filename_ < b.filename_;
+}
+
+// ----------------------------------------------------------------------
+
+/** Returns the last element of a path. */
+static std::string getLeaf(const std::string path) {
+
+    std::string::size_type pos = path.find_last_of('/');
+    return (pos == std::string::npos) ? path : path.substr(pos + 1);
+}
+
+// ----------------------------------------------------------------------
+
+RecordingFrame::RecordingFrame() {
+
+    filename_ = "";
+    timeInMs_ = 0;
+    state_ = "";
+    triggerId_ = -1;
+}
+
+// ======================================================================
+// PRIVATE METHODS
+
+bool Recording::parseFilename(const std::string name, RecordingFrame& frame) {
+
+    // extension
+    std::string::size_type dot = name.find_last_of('.');
+    if (dot == std::string::npos)
+        return false;
+    const std::string extension = name.substr(dot);
+    if (extension != IMAGE_PGM_EXTENSION && extension != IMAGE_TIFF_EXTENSION)
+        return false;
+    const std::string base = name.substr(0, dot);
+
+    // timestamp "_HH-MM-SS-mmm"
+    const char* pattern = "_dd-dd-dd-ddd";
+    const unsigned int n = 13;
+    for (std::string::size_type i = 0; i + n <= base.size(); i++) {
+        bool match = true;
+        for (unsigned int j = 0; j < n && match; j++) {
+            const char c = base[i + j];
+            match = (pattern[j] == 'd') ? (c >= '0' && c <= '9') : (c == pattern[j]);
+        }
+        // the timestamp is followed by the state suffix (if any)
+        if (match && (i + n == base.size() || base[i + n] == '_')) {
+            const unsigned int h = atoi(base.substr(i + 1, 2).c_str());
+            const unsigned int min = atoi(base.substr(i + 4, 2).c_str());
+            const unsigned int s = atoi(base.substr(i + 7, 2).c_str());
+            const unsigned int ms = atoi(base.substr(i + 10, 3).c_str());
+            frame.timeInMs_ = ((h * 60 + min) * 60 + s) * 1000 + ms;
+            frame.state_ = base.substr(i + n);
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------
+
+void Recording::readTriggerIds(const std::string folder, std::vector<RecordingFrame>& frames) {
+
+    std::ifstream file((folder + "/" + FRAME_METADATA_FILENAME).c_str());
+    if (!file.is_open())
+        return;
+
+    // the column of the trigger ids is found in the header
+    std::map<std::string, int> triggerIds;
+    int column = -1;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields;
+        std::string::size_type start = (line.size() > 0 && line[0] == '#') ? 1 : 0;
+        std::string::size_type tab;
+        while ((tab = line.find('\t', start)) != std::string::npos) {
+            fields.push_back(line.substr(start, tab - start));
+            start = tab + 1;
+        }
+        fields.push_back(line.substr(start));
+
+        if (line.size() > 0 && line[0] == '#') {
+            for (unsigned int i = 0; i < fields.size(); i++) {
+                if (fields.at(i).find("trigger_id") == 0)
+                    column = i;
+            }
+        } else if (column > 0 && (int)fields.size() > column)
+            triggerIds[fields.at(0)] = atoi(fields.at(column).c_str());
+    }
+
+    std::map<std::string, int>::iterator it;
+    for (unsigned int i = 0; i < frames.size(); i++) {
+        if ((it = triggerIds.find(getLeaf(frames.at(i).filename_))) != triggerIds.end())
+            frames.at(i).triggerId_ = it->second;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void Recording::indexTriggers(const std::vector<RecordingFrame>& frames, std::vector<unsigned int>& indexes) {
+
+    std::vector< std::pair<int, unsigned int> > triggers;
+    for (unsigned int i = 0; i < frames.size(); i++) {
+        if (frames.at(i).triggerId_ >= 0)
+            triggers.push_back(std::make_pair(frames.at(i).triggerId_, i));
+    }
+    std::sort(triggers.begin(), triggers.end());
+
+    indexes.clear();
+    for (unsigned int i = 0; i < triggers.size(); i++)
+        indexes.push_back(triggers.at(i).second);
+}
+
+// ----------------------------------------------------------------------
+
+bool Recording::indexFolder(const std::string folder, std::vector<RecordingFrame>& frames) {
+
+    boost::filesystem::directory_iterator end;
+    for (boost::filesystem::directory_iterator it(folder); it != end; ++it) {
+        if (boost::filesystem::is_directory(it->status()))
+            continue;
+        RecordingFrame frame;
+        frame.filename_ = it->path().string();
+        if (parseFilename(getLeaf(frame.filename_), frame))
+            frames.push_back(frame);
+    }
+    std::sort(frames.begin(), frames.end(), compareFrames);
+    readTriggerIds(folder, frames);
+
+    return !frames.empty();
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+Recording::Recording() {
+
+    folder_ = "";
+}
+
+// ----------------------------------------------------------------------
+
+void Recording::open(std::string folder) throw(MyException*) {
+
+    if (!boost::filesystem::exists(folder) || !boost::filesystem::is_directory(folder))
+        throw new MyException("Folder " + folder + " doesn't exist.");
+
+    folder_ = folder;
+    cameraNames_.clear();
+    frames_.clear();
+    triggerIndexes_.clear();
+
+    try {
+        // experiment folder: one sub-folder per camera
+        std::vector<std::string> subFolders;
+        boost::filesystem::directory_iterator end;
+        for (boost::filesystem::directory_iterator it(folder); it != end; ++it) {
+            if (boost::filesystem::is_directory(it->status()))
+                subFolders.push_back(it->path().string());
+        }
+        std::sort(subFolders.begin(), subFolders.end());
+
+        for (unsigned int i = 0; i < subFolders.size(); i++) {
+            std::vector<RecordingFrame> frames;
+            if (indexFolder(subFolders.at(i), frames)) {
+                cameraNames_.push_back(getLeaf(subFolders.at(i)));
+                frames_.push_back(frames);
+            }
+        }
+
+        // camera folder
+        if (frames_.empty()) {
+            std::vector<RecordingFrame> frames;
+            if (indexFolder(folder, frames)) {
+                cameraNames_.push_back(getLeaf(folder));
+                frames_.push_back(frames);
+            }
+        }
+    } catch (boost::filesystem::filesystem_error& e) {
+        throw new MyException(e.what());
+    }
+
+    if (frames_.empty())
+        throw new MyException("No frames found in " + folder + ".");
+
+    triggerIndexes_.resize(frames_.size());
+    for (unsigned int i = 0; i < frames_.size(); i++)
+        indexTriggers(frames_.at(i), triggerIndexes_.at(i));
+
+    for (unsigned int i = 0; i < frames_.size(); i++)
+        LOG(INFO) << "Recording " << cameraNames_.at(i) << ": " << frames_.at(i).size() << " frames.";
+}
+
+// ----------------------------------------------------------------------
+
+unsigned int Recording::getDurationInMs() {
+
+    unsigned int duration = 0;
+    for (unsigned int i = 0; i < frames_.size(); i++) {
+        if (!frames_.at(i).empty())
+            duration = std::max(duration, frames_.at(i).back().timeInMs_);
+    }
+    return duration;
+}
+
+// ----------------------------------------------------------------------
+
+int Recording::findFrame(const unsigned int camera, const unsigned int timeInMs) {
+
+    const std::vector<RecordingFrame>& frames = frames_.at(camera);
+
+    // binary search of the first frame grabbed after timeInMs
+    int low = 0;
+    int high = frames.size();
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        if (frames[mid].timeInMs_ <= timeInMs)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low - 1;
+}
+
+// ----------------------------------------------------------------------
+
+int Recording::findFrameByTrigger(const unsigned int camera, const int triggerId) {
+
+    const std::vector<RecordingFrame>& frames = frames_.at(camera);
+    const std::vector<unsigned int>& indexes = triggerIndexes_.at(camera);
+
+    // binary search of the first frame of a trigger after triggerId
+    int low = 0;
+    int high = indexes.size();
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        if (frames[indexes[mid]].triggerId_ <= triggerId)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return (low > 0) ? (int)indexes[low - 1] : -1;
+}
+
+// ----------------------------------------------------------------------
+
+bool Recording::getTriggerRange(int& first, int& last) {
+
+    bool found = false;
+    for (unsigned int i = 0; i < triggerIndexes_.size(); i++) {
+        const std::vector<unsigned int>& indexes = triggerIndexes_.at(i);
+        if (indexes.empty())
+            continue;
+        const int a = frames_.at(i).at(indexes.front()).triggerId_;
+        const int b = frames_.at(i).at(indexes.back()).triggerId_;
+        first = found ? std::min(first, a) : a;
+        last = found ? std::max(last, b) : b;
+        found = true;
+    }
+    return found;
+}
+
+// ----------------------------------------------------------------------
+
+void Recording::getStateChanges(std::vector<unsigned int>& times, std::vector<std::string>& states) {
+
+    times.clear();
+    states.clear();
+
+    // the states are read from the camera with the most frames
+    unsigned int camera = 0;
+    for (unsigned int i = 1; i < frames_.size(); i++) {
+        if (frames_.at(i).size() > frames_.at(camera).size())
+            camera = i;
+    }
+    const std::vector<RecordingFrame>& frames = frames_.at(camera);
+    for (unsigned int i = 0; i < frames.size(); i++) {
+        if (i == 0 || frames[i].state_ != frames[i-1].state_) {
+            times.push_back(frames[i].timeInMs_);
+            states.push_back(frames[i].state_);
+        }
+    }
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+unsigned int Recording::getNumCameras() { return frames_.size(); }
+std::string Recording::getCameraName(const unsigned int camera) { return cameraNames_.at(camera); }
+const std::vector<RecordingFrame>& Recording::getFrames(const unsigned int camera) { return frames_.at(camera); }
+std::string Recording::getFolder() { return folder_; }
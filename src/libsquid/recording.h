@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include "myexception.h"
+#include <string>
+#include <vector>
+
+//! Library to control multiple cameras and manage the experiments.
+namespace squid {
+
+/**
+ * \brief Frame saved to disk during an experiment.
+ */
+class RecordingFrame {
+
+public:
+
+    /** Absolute path to the image file. */
+    std::string filename_;
+    /** Experiment time at which the frame has been grabbed in ms. */
+    unsigned int timeInMs_;
+    /** Playlist state (suffix composed of the names of the active pins). */
+    std::string state_;
+    /** Id of the trigger which exposed the frame (-1 = unknown). */
+    int triggerId_;
+
+    /** Constructor. */
+    RecordingFrame();
+    /** Destructor. */
+    ~RecordingFrame() {}
+};
+
+/**
+ * \brief Index of the frames saved by an experiment.
+ *
+ * An experiment folder contains one sub-folder per camera. The frames are
+ * named <id>_<HH-MM-SS-mmm><state>.<ext> where the timestamp is the
+ * experiment time and the state the suffix of the playlist state (see
+ * Experiment::saveFrame()). The trigger ids are read from the frame metadata
+ * file of each sub-folder (column trigger_id, missing in older recordings)
+ * and indexed to move the playback to a given trigger. A sub-folder can also
+ * be opened on its own.
+ *
+ * @version March 7, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class Recording {
+
+private:
+
+    /** Absolute path to the folder opened. */
+    std::string folder_;
+    /** Names of the cameras (names of the sub-folders). */
+    std::vector<std::string> cameraNames_;
+    /** Frames of each camera sorted by time. */
+    std::vector< std::vector<RecordingFrame> > frames_;
+    /** Indexes of the frames of each camera with a trigger id, sorted by trigger id. */
+    std::vector< std::vector<unsigned int> > triggerIndexes_;
+
+public:
+
+    /** Constructor. */
+    Recording();
+    /** Destructor. */
+    ~Recording() {}
+
+    /** Indexes the frames of the given experiment (or camera) folder. */
+    void open(std::string folder) throw(MyException*);
+
+    /** Returns the number of cameras. */
+    unsigned int getNumCameras();
+    /** Returns the name of the given camera. */
+    std::string getCameraName(const unsigned int camera);
+    /** Returns the frames of the given camera. */
+    const std::vector<RecordingFrame>& getFrames(const unsigned int camera);
+    /** Returns the time of the last frame in ms. */
+    unsigned int getDurationInMs();
+
+    /** Returns the index of the last frame grabbed at or before the given time (-1 if none). */
+    int findFrame(const unsigned int camera, const unsigned int timeInMs);
+    /** Returns the index of the frame of the last trigger at or before the given one (-1 if none). */
+    int findFrameByTrigger(const unsigned int camera, const int triggerId);
+    /** Gets the first and last trigger ids of the recording. Returns false if the frames have no trigger id. */
+    bool getTriggerRange(int& first, int& last);
+
+    /** Returns the times at which the playlist state changes (and the new states). */
+    void getStateChanges(std::vector<unsigned int>& times, std::vector<std::string>& states);
+
+    /** Returns the folder opened. */
+    std::string getFolder();
+
+private:
+
+    /** Indexes the image files of one folder. Returns false if the folder contains no frames. */
+    bool indexFolder(const std::string folder, std::vector<RecordingFrame>& frames);
+    /** Parses the name of an image file. Returns false if it is not a frame. */
+    bool parseFilename(const std::string name, RecordingFrame& frame);
+    /** Reads the trigger ids of the frames from the metadata file of a folder (if any). */
+    void readTriggerIds(const std::string folder, std::vector<RecordingFrame>& frames);
+    /** Indexes the frames of one camera by trigger id. */
+    void indexTriggers(const std::vector<RecordingFrame>& frames, std::vector<unsigned int>& indexes);
+};
+
+} // end namespace squid
+
+#endif // RECORDING_H
@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "timinghistogram.h"
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace squid;
+
+// ======================================================================
+// PUBLIC METHODS
+
+TimingHistogram::TimingHistogram() {
+
+    reset();
+}
+
+// ----------------------------------------------------------------------
+
+TimingHistogram::~TimingHistogram() {}
+
+// ----------------------------------------------------------------------
+
+void TimingHistogram::reset() {
+
+    for (unsigned int i = 0; i < TIMING_HISTOGRAM_NUM_BUCKETS; i++)
+        counts_[i] = 0;
+    for (unsigned int i = 0; i < TIMING_HISTOGRAM_NUM_OUTLIERS; i++) {
+        outliers_[i] = 0;
+        outlierIds_[i] = 0;
+    }
+    min_ = TIMING_HISTOGRAM_MAX_VALUE;
+    max_ = 0;
+    sum_ = 0;
+    __sync_synchronize();
+    count_ = 0;
+}
+
+// ----------------------------------------------------------------------
+
+void TimingHistogram::record(uint64_t valueInNs, unsigned int id) {
+
+    if (valueInNs > TIMING_HISTOGRAM_MAX_VALUE)
+        valueInNs = TIMING_HISTOGRAM_MAX_VALUE;
+
+    __sync_fetch_and_add(&counts_[getBucketIndex(valueInNs)], 1);
+    __sync_fetch_and_add(&sum_, valueInNs);
+    if (valueInNs < min_)
+        min_ = valueInNs;
+    if (valueInNs > max_)
+        max_ = valueInNs;
+
+    // insertion in the sorted list of outliers
+    if (valueInNs > outliers_[TIMING_HISTOGRAM_NUM_OUTLIERS - 1]) {
+        unsigned int i = TIMING_HISTOGRAM_NUM_OUTLIERS - 1;
+        for (; i > 0 && valueInNs > outliers_[i - 1]; i--) {
+            outliers_[i] = outliers_[i - 1];
+            outlierIds_[i] = outlierIds_[i - 1];
+        }
+        outliers_[i] = valueInNs;
+        outlierIds_[i] = id;
+    }
+    __sync_fetch_and_add(&count_, 1);
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t TimingHistogram::getPercentile(double percentile) {
+
+    // copy first, the histogram may be modified in the meantime
+    uint32_t counts[TIMING_HISTOGRAM_NUM_BUCKETS];
+    uint64_t total = 0;
+    for (unsigned int i = 0; i < TIMING_HISTOGRAM_NUM_BUCKETS; i++) {
+        counts[i] = counts_[i];
+        total += counts[i];
+    }
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(percentile / 100. * total + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > total)
+        rank = total;
+
+    uint64_t n = 0;
+    for (unsigned int i = 0; i < TIMING_HISTOGRAM_NUM_BUCKETS; i++) {
+        n += counts[i];
+        if (n >= rank)
+            return std::max(std::min(getBucketValue(i), (uint64_t)max_), (uint64_t)min_);
+    }
+    return max_;
+}
+
+// ----------------------------------------------------------------------
+
+unsigned int TimingHistogram::getOutliers(uint64_t* values, unsigned int* ids) {
+
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < TIMING_HISTOGRAM_NUM_OUTLIERS; i++) {
+        if (outliers_[i] == 0)
+            break;
+        values[n] = outliers_[i];
+        ids[n] = outlierIds_[i];
+        n++;
+    }
+    return n;
+}
+
+// ----------------------------------------------------------------------
+
+std::string TimingHistogram::getSummary() {
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+
+    if (getCount() == 0) {
+        ss << "no value recorded";
+        return ss.str();
+    }
+
+    ss << "n = " << getCount();
+    ss << ", min = " << getMin() / 1000. << " us";
+    ss << ", mean = " << getMean() / 1000. << " us";
+    ss << ", p50 = " << getPercentile(50.) / 1000. << " us";
+    ss << ", p90 = " << getPercentile(90.) / 1000. << " us";
+    ss << ", p99 = " << getPercentile(99.) / 1000. << " us";
+    ss << ", p99.9 = " << getPercentile(99.9) / 1000. << " us";
+    ss << ", max = " << getMax() / 1000. << " us";
+
+    uint64_t values[TIMING_HISTOGRAM_NUM_OUTLIERS];
+    unsigned int ids[TIMING_HISTOGRAM_NUM_OUTLIERS];
+    unsigned int n = getOutliers(values, ids);
+    if (n > 0) {
+        ss << std::endl << "    worst:";
+        for (unsigned int i = 0; i < n; i++)
+            ss << " " << values[i] / 1000. << " us (#" << ids[i] << ")";
+    }
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------
+
+std::string TimingHistogram::getShortSummary() {
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << getPercentile(50.) / 1000. << "/" << getPercentile(99.) / 1000. << "/" << getMax() / 1000. << " us";
+
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------
+
+unsigned int TimingHistogram::getBucketIndex(uint64_t value) {
+
+    const unsigned int subCount = 1 << TIMING_HISTOGRAM_SUB_BITS;
+    if (value < subCount)
+        return value;
+
+    // position of the most significant bit
+    unsigned int msb = 63 - __builtin_clzll(value);
+    // value >> shift is in [subCount/2, subCount)
+    unsigned int shift = msb - (TIMING_HISTOGRAM_SUB_BITS - 1);
+    return subCount + (shift - 1) * (subCount / 2) + ((value >> shift) - subCount / 2);
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t TimingHistogram::getBucketValue(unsigned int index) {
+
+    const unsigned int subCount = 1 << TIMING_HISTOGRAM_SUB_BITS;
+    if (index < subCount)
+        return index;
+
+    // middle of [sub << shift, (sub + 1) << shift)
+    unsigned int shift = (index - subCount) / (subCount / 2) + 1;
+    uint64_t sub = (index - subCount) % (subCount / 2) + subCount / 2;
+    return (sub << shift) + ((1ULL << shift) - 1) / 2;
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+uint32_t TimingHistogram::getCount() { return count_; }
+uint64_t TimingHistogram::getMin() { return (count_ > 0) ? (uint64_t)min_ : 0; }
+uint64_t TimingHistogram::getMax() { return max_; }
+double TimingHistogram::getMean() { return (count_ > 0) ? (double)sum_ / count_ : 0.; }
@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef TIMINGHISTOGRAM_H
+#define TIMINGHISTOGRAM_H
+
+#include <stdint.h>
+#include <string>
+
+/** Number of bits of the sub-buckets (64 linear buckets per power of two, each at most 1/64 of its values wide). */
+#define TIMING_HISTOGRAM_SUB_BITS 7
+/** Largest value recorded in ns (larger values are clamped), about 18 minutes. */
+#define TIMING_HISTOGRAM_MAX_VALUE ((1ULL << 40) - 1)
+/** Number of buckets required to cover [0, TIMING_HISTOGRAM_MAX_VALUE]. */
+#define TIMING_HISTOGRAM_NUM_BUCKETS ((1 << TIMING_HISTOGRAM_SUB_BITS) + (40 - TIMING_HISTOGRAM_SUB_BITS) * (1 << (TIMING_HISTOGRAM_SUB_BITS - 1)))
+/** Number of worst outliers kept. */
+#define TIMING_HISTOGRAM_NUM_OUTLIERS 5
+
+//! Library to control multiple cameras and manage the experiments.
+namespace squid {
+
+/**
+ * \brief Histogram of durations with a constant relative precision (HDR-style).
+ *
+ * Values are recorded in ns. Values smaller than 2^TIMING_HISTOGRAM_SUB_BITS are
+ * counted exactly, larger values fall into logarithmic buckets which are each
+ * split into linear sub-buckets. Percentiles are given at the middle of their
+ * bucket, i.e. within 0.8% of the values counted in it. record() doesn't allocate nor lock and can be
+ * called from a realtime thread. The histogram is written by a single thread
+ * and can be read at any time from other threads.
+ *
+ * @version March 9, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class TimingHistogram {
+
+private:
+
+    /** Number of values recorded in each bucket. */
+    volatile uint32_t counts_[TIMING_HISTOGRAM_NUM_BUCKETS];
+    /** Total number of values recorded. */
+    volatile uint32_t count_;
+    /** Smallest value recorded in ns. */
+    volatile uint64_t min_;
+    /** Largest value recorded in ns. */
+    volatile uint64_t max_;
+    /** Sum of the values recorded in ns. */
+    volatile uint64_t sum_;
+
+    /** Largest values recorded in ns (sorted by decreasing value). */
+    volatile uint64_t outliers_[TIMING_HISTOGRAM_NUM_OUTLIERS];
+    /** Ids (e.g. trigger id) of the largest values recorded. */
+    volatile unsigned int outlierIds_[TIMING_HISTOGRAM_NUM_OUTLIERS];
+
+public:
+
+    /** Constructor. */
+    TimingHistogram();
+    /** Destructor. */
+    ~TimingHistogram();
+
+    /** Removes all the values recorded. */
+    void reset();
+    /** Records a value in ns, id identifies the value among the outliers. */
+    void record(uint64_t valueInNs, unsigned int id = 0);
+
+    /** Returns the value in ns below which the given percentage of the values fall. */
+    uint64_t getPercentile(double percentile);
+    /** Returns the largest values recorded in ns and their ids (returns the number of outliers). */
+    unsigned int getOutliers(uint64_t* values, unsigned int* ids);
+
+    /** Returns a summary (count, min, mean, percentiles, max and outliers) in us. */
+    std::string getSummary();
+    /** Returns a short summary (median, 99th percentile and max) in us. */
+    std::string getShortSummary();
+
+    /** Returns the number of values recorded. */
+    uint32_t getCount();
+    /** Returns the smallest value recorded in ns. */
+    uint64_t getMin();
+    /** Returns the largest value recorded in ns. */
+    uint64_t getMax();
+    /** Returns the mean of the values recorded in ns. */
+    double getMean();
+
+    /** Returns the index of the bucket of a value in ns. */
+    static unsigned int getBucketIndex(uint64_t value);
+    /** Returns the value in ns at the middle of a bucket. */
+    static uint64_t getBucketValue(unsigned int index);
+};
+
+} // end namespace squid
+
+#endif // TIMINGHISTOGRAM_H
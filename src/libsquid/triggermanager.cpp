@@ -29,6 +29,7 @@
 #include "cameramanager.h"
 
 #include <dc1394/vendor/avt.h>
+#include <sstream>
 #include <glog/logging.h>
 
 using namespace squid;
@@ -66,6 +67,7 @@ void TriggerManager::initialize() {
 
     timer_ = new HighResolutionTime();
     triggerId_ = 0;
+    lastSentInUs_ = -1.;
     preTriggerAction_ = (pfv) &TriggerManager::defaultPreTriggerAction;
     postTriggerAction_ = (pfv) &TriggerManager::defaultPostTriggerAction;
 //    restart_ = false;
@@ -77,6 +79,8 @@ void TriggerManager::initialize() {
 void TriggerManager::run() {
 
     triggerId_ = 0;
+    lastSentInUs_ = -1.;
+    resetTimingStatistics();
 
     double tInUs = 0;
     double tBaseInUs = 0;
@@ -94,7 +98,7 @@ void TriggerManager::run() {
         if (tInUs - tBaseInUs > periodInUs_) {
             tBaseInUs = tInUs;
             LOG(INFO) << tInUs/1000;
-            trigger(triggerId_++);
+            trigger(triggerId_++, tInUs + tOffsetUs);
         }
 
         mutex_.lock();
@@ -103,6 +107,7 @@ void TriggerManager::run() {
             double tBkpUs = timer_->getElapsedTimeInUs();
             condition_.wait(&mutex_);
             tOffsetUs += timer_->getElapsedTimeInUs() - tBkpUs;
+            lastSentInUs_ = -1.;
         }
         mutex_.unlock();
     }
@@ -110,29 +115,28 @@ void TriggerManager::run() {
 
 // ----------------------------------------------------------------------
 
-void TriggerManager::trigger(unsigned int triggerId) {
+void TriggerManager::trigger(unsigned int triggerId, double wakeupInUs) {
 
-//    ExperimentTime* time = ExperimentTime::getInstance();
-
-//    dc1394bool_t polarity;
-//    unsigned int mode;
-    dc1394bool_t pinstate;
-    
     try {
         // checks GPOut2 if the camera can now accept a trigger
         // WARNING: be sure to have configured GPOu2 to generate "WaitingForTrigger" signal
         // done in dc1394camera.cpp
-
-        // the nex line is only to get values polarity, mode and pinstate
-//         dc1394_avt_get_io(CameraManager::getInstance()->getCamera(0)->getCamera(), 0x324, &polarity, &mode, &pinstate);
+        CameraManager* cmanager = CameraManager::getInstance();
+        bool ready = !cmanager->getTriggerGating() || cmanager->getActiveCamera(0)->isWaitingForTrigger();
 
         // whether the camera can accept a trigger
-        if (true or pinstate) { // remove true to use the value of pinstate
+        if (ready) {
 
             (this->*preTriggerAction_)(triggerId);
             emit triggered(triggerId);
             (this->*postTriggerAction_)(triggerId);
 
+            double sentInUs = timer_->getElapsedTimeInUs();
+            latencyHistogram_.record((uint64_t)(1000. * (sentInUs - wakeupInUs)), triggerId);
+            if (lastSentInUs_ >= 0.)
+                intervalHistogram_.record((uint64_t)(1000. * (sentInUs - lastSentInUs_)), triggerId);
+            lastSentInUs_ = sentInUs;
+
         } else
             LOG(WARNING) << "===== CAMERA TRIGGER " << triggerId << " REFUSED =====";
 
@@ -143,6 +147,26 @@ void TriggerManager::trigger(unsigned int triggerId) {
 
 // ----------------------------------------------------------------------
 
+void TriggerManager::resetTimingStatistics() {
+
+    latencyHistogram_.reset();
+    intervalHistogram_.reset();
+}
+
+// ----------------------------------------------------------------------
+
+std::string TriggerManager::getTimingReport() {
+
+    std::stringstream ss;
+    ss << "Trigger period: " << periodInUs_ << " us" << std::endl;
+    ss << "Wakeup to register write latency: " << latencyHistogram_.getSummary() << std::endl;
+    ss << "Interval between triggers: " << intervalHistogram_.getSummary() << std::endl;
+
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------
+
 void TriggerManager::stop() {
 
         setAbort(true);
@@ -186,3 +210,6 @@ void TriggerManager::setAbort(bool b) { abort_ = b; }
 
 void TriggerManager::setTriggerId(unsigned int triggerId) { triggerId_ = triggerId; }
 unsigned int TriggerManager::getTriggerId() { return triggerId_; }
+
+TimingHistogram* TriggerManager::getLatencyHistogram() { return &latencyHistogram_; }
+TimingHistogram* TriggerManager::getIntervalHistogram() { return &intervalHistogram_; }
@@ -29,7 +29,9 @@
 
 #include "myexception.h"
 #include "highresolutiontime.h"
+#include "timinghistogram.h"
 #include <vector>
+#include <string>
 #include <QThread>
 #include <QMutex>
 #include <QWaitCondition>
@@ -87,6 +89,15 @@ public:
     /** Get trigger id. */
     unsigned int getTriggerId();
 
+    /** Get histogram of the latencies from wakeup to register write. */
+    TimingHistogram* getLatencyHistogram();
+    /** Get histogram of the intervals between two consecutive triggers. */
+    TimingHistogram* getIntervalHistogram();
+    /** Reset timing histograms. */
+    void resetTimingStatistics();
+    /** Get report of the trigger timing (latencies and intervals). */
+    std::string getTimingReport();
+
 public slots:
 
     /** Start to generate triggers */
@@ -109,8 +120,8 @@ signals:
 
 private:    
 
-    /** Called each time t - base > periodInUs_. */
-    void trigger(unsigned int triggerId);
+    /** Called each time t - base > periodInUs_ (wakeup time in us). */
+    void trigger(unsigned int triggerId, double wakeupInUs);
 
     /** High resolution timer. */
     HighResolutionTime* timer_;
@@ -120,6 +131,13 @@ private:
     /** Trigger id */
     unsigned int triggerId_;
 
+    /** Latencies from wakeup to the end of the trigger (register write) */
+    TimingHistogram latencyHistogram_;
+    /** Intervals between two consecutive triggers */
+    TimingHistogram intervalHistogram_;
+    /** Time in us at which the last trigger has been sent (negative after a pause) */
+    double lastSentInUs_;
+
     /** Function pointer to call just before sending a trigger */
     pfv preTriggerAction_;
     /** Function pointer to call just after sending a trigger */
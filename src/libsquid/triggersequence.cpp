@@ -0,0 +1,209 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "triggersequence.h"
+#include "myutility.h"
+#include <stdio.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+using namespace squid;
+
+// ======================================================================
+// PUBLIC METHODS
+
+TriggerSequence::TriggerSequence() {
+
+    clear();
+}
+
+// ----------------------------------------------------------------------
+
+void TriggerSequence::clear() {
+
+    timesInNs_.clear();
+    cycleInNs_ = 0;
+    compiled_ = true;
+}
+
+// ----------------------------------------------------------------------
+
+void TriggerSequence::addTrigger(uint64_t timeInUs) throw(MyException*) {
+
+    if (timesInNs_.size() >= TRIGGER_SEQUENCE_MAX_TRIGGERS)
+        throw new MyException("Unable to add trigger: Too many triggers in the sequence.");
+
+    timesInNs_.push_back(timeInUs * 1000);
+    compiled_ = false;
+}
+
+// ----------------------------------------------------------------------
+
+void TriggerSequence::addSegment(uint64_t startInUs, uint64_t endInUs, uint64_t periodInUs) throw(MyException*) {
+
+    if (periodInUs == 0)
+        throw new MyException("Unable to add trigger segment: The period must be positive.");
+    if (endInUs < startInUs)
+        throw new MyException("Unable to add trigger segment: The segment ends before it starts.");
+    // the segment has ceil((end - start) / period) triggers, the end being excluded
+    if (timesInNs_.size() + (endInUs - startInUs + periodInUs - 1) / periodInUs > TRIGGER_SEQUENCE_MAX_TRIGGERS)
+        throw new MyException("Unable to add trigger segment: Too many triggers in the sequence.");
+
+    for (uint64_t t = startInUs; t < endInUs; t += periodInUs)
+        timesInNs_.push_back(t * 1000);
+    compiled_ = false;
+}
+
+// ----------------------------------------------------------------------
+
+void TriggerSequence::parse(const std::string& text) throw(MyException*) {
+
+    clear();
+
+    std::stringstream lines(text);
+    std::string line;
+    unsigned int lineNumber = 0;
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        std::string::size_type comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::stringstream ss(line);
+        std::string token;
+        while (ss >> token) {
+            unsigned long long a, b, c;
+            char end;
+            if (token == "cycle") {
+                if (!(ss >> a))
+                    throw new MyException("Invalid trigger sequence at line " + intToIntString(lineNumber) + ": cycle expects a duration in us.");
+                setCycleInUs(a);
+            } else if (sscanf(token.c_str(), "%llu-%llu/%llu%c", &a, &b, &c, &end) == 3)
+                addSegment(a, b, c);
+            else if (sscanf(token.c_str(), "%llu%c", &a, &end) == 1)
+                addTrigger(a);
+            else
+                throw new MyException("Invalid trigger sequence at line " + intToIntString(lineNumber) + ": " + token + " (expected time or start-end/period in us).");
+        }
+    }
+    compile();
+}
+
+// ----------------------------------------------------------------------
+
+void TriggerSequence::load(const std::string& filename) throw(MyException*) {
+
+    std::ifstream file(filename.c_str());
+    if (!file.is_open())
+        throw new MyException("Unable to open trigger sequence file " + filename + ".");
+
+    std::stringstream text;
+    text << file.rdbuf();
+    parse(text.str());
+}
+
+// ----------------------------------------------------------------------
+
+void TriggerSequence::compile() {
+
+    if (compiled_)
+        return;
+
+    std::sort(timesInNs_.begin(), timesInNs_.end());
+    timesInNs_.erase(std::unique(timesInNs_.begin(), timesInNs_.end()), timesInNs_.end());
+    compiled_ = true;
+}
+
+// ----------------------------------------------------------------------
+
+void TriggerSequence::validate(long minIntervalInUs) throw(MyException*) {
+
+    compile();
+
+    if (timesInNs_.empty())
+        throw new MyException("Invalid trigger sequence: The sequence is empty.");
+    if (cycleInNs_ == 0)
+        throw new MyException("Invalid trigger sequence: The length of the cycle is not specified.");
+    if (timesInNs_.back() >= cycleInNs_) {
+        std::stringstream ss;
+        ss << "Invalid trigger sequence: The trigger at " << timesInNs_.back() / 1000 << " us is outside the cycle of " << cycleInNs_ / 1000 << " us.";
+        throw new MyException(ss.str());
+    }
+
+    const uint64_t minInterval = getMinIntervalInUs();
+    if (minIntervalInUs > 0 && minInterval < (uint64_t)minIntervalInUs) {
+        std::stringstream ss;
+        ss << "Invalid trigger sequence: Two triggers are only " << minInterval << " us apart but the cameras need at least " << minIntervalInUs << " us between two frames.";
+        throw new MyException(ss.str());
+    }
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t TriggerSequence::getMinIntervalInUs() {
+
+    compile();
+
+    if (timesInNs_.empty())
+        return 0;
+
+    // the first trigger of the next cycle follows the last one
+    uint64_t minInterval = (cycleInNs_ > timesInNs_.back()) ? cycleInNs_ - timesInNs_.back() + timesInNs_.front() : cycleInNs_;
+    for (unsigned int i = 1; i < timesInNs_.size(); i++)
+        minInterval = std::min(minInterval, timesInNs_[i] - timesInNs_[i-1]);
+
+    return minInterval / 1000;
+}
+
+// ----------------------------------------------------------------------
+
+std::string TriggerSequence::getSummary() {
+
+    std::stringstream ss;
+    ss << getNumTriggers() << " triggers every " << cycleInNs_ / 1000 << " us cycle, minimum interval " << getMinIntervalInUs() << " us";
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------
+
+unsigned int TriggerSequence::getNextIndex(uint64_t timeInNs) {
+
+    compile();
+    return std::upper_bound(timesInNs_.begin(), timesInNs_.end(), timeInNs) - timesInNs_.begin();
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+bool TriggerSequence::isEmpty() { return timesInNs_.empty(); }
+unsigned int TriggerSequence::getNumTriggers() { return timesInNs_.size(); }
+uint64_t TriggerSequence::getTimeInNs(unsigned int index) { return timesInNs_[index]; }
+
+void TriggerSequence::setCycleInUs(uint64_t cycleInUs) { cycleInNs_ = cycleInUs * 1000; }
+uint64_t TriggerSequence::getCycleInUs() { return cycleInNs_ / 1000; }
+uint64_t TriggerSequence::getCycleInNs() { return cycleInNs_; }
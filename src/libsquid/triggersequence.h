@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TRIGGERSEQUENCE_H
+#define TRIGGERSEQUENCE_H
+
+#include "myexception.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Maximum number of triggers of a sequence (guards against a typo in a segment). */
+#define TRIGGER_SEQUENCE_MAX_TRIGGERS 1000000
+
+//! Library to control multiple cameras and manage the experiments.
+namespace squid {
+
+/**
+ * \brief Precompiled list of trigger times played in loop by the trigger manager.
+ *
+ * The times are relative to the start of the cycle and are sorted once
+ * compiled, so that the trigger manager only has to walk the list. A
+ * sequence is described in a compact text file where each token is either
+ * a single time, a piecewise-periodic segment or the length of the cycle
+ * (all times in us, "#" starts a comment):
+ *
+ *     cycle 12000000              # the sequence loops every 12 s
+ *     0-2000000/100000            # every 100 ms from 0 s (included) to 2 s (excluded)
+ *     2000000-2500000/5000        # dense around the stimulus
+ *     3000000                     # a single trigger
+ *
+ * A cycle of 0 is replaced by the duration of the playlist when the
+ * sequence is played in sync with it.
+ *
+ * @version March 17, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class TriggerSequence {
+
+private:
+
+    /** Trigger times in ns relative to the start of the cycle. */
+    std::vector<uint64_t> timesInNs_;
+    /** Length of the cycle in ns (0 = not specified). */
+    uint64_t cycleInNs_;
+    /** Is true if timesInNs_ is sorted and without duplicates. */
+    bool compiled_;
+
+public:
+
+    /** Constructor. */
+    TriggerSequence();
+
+    /** Removes all the triggers. */
+    void clear();
+    /** Adds a trigger at the given time in us. */
+    void addTrigger(uint64_t timeInUs) throw(MyException*);
+    /** Adds triggers every periodInUs from startInUs (included) to endInUs (excluded). */
+    void addSegment(uint64_t startInUs, uint64_t endInUs, uint64_t periodInUs) throw(MyException*);
+
+    /** Parses a sequence from the content of a sequence file. */
+    void parse(const std::string& text) throw(MyException*);
+    /** Loads a sequence from file. */
+    void load(const std::string& filename) throw(MyException*);
+    /** Sorts the triggers and removes the duplicates. */
+    void compile();
+    /**
+     * Throws an exception if the sequence is empty, if a trigger is outside the
+     * cycle or if two consecutive triggers (also across the loop) are closer
+     * than minIntervalInUs.
+     */
+    void validate(long minIntervalInUs) throw(MyException*);
+
+    /** Returns the smallest interval in us between two consecutive triggers, across the loop. */
+    uint64_t getMinIntervalInUs();
+    /** Returns a short description of the sequence. */
+    std::string getSummary();
+
+    /** Returns true if the sequence has no trigger. */
+    bool isEmpty();
+    /** Returns the number of triggers in one cycle. */
+    unsigned int getNumTriggers();
+    /** Returns the time in ns of a trigger relative to the start of the cycle. */
+    uint64_t getTimeInNs(unsigned int index);
+    /** Returns the index of the first trigger strictly after the given time in the cycle (getNumTriggers() if none). */
+    unsigned int getNextIndex(uint64_t timeInNs);
+
+    /** Sets the length of the cycle in us (0 = not specified). */
+    void setCycleInUs(uint64_t cycleInUs);
+    /** Returns the length of the cycle in us. */
+    uint64_t getCycleInUs();
+    /** Returns the length of the cycle in ns. */
+    uint64_t getCycleInNs();
+};
+
+} // end namespace squid
+
+#endif // TRIGGERSEQUENCE_H
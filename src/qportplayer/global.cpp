@@ -53,6 +53,8 @@ void Global::initialize() {
     pins_ = "";
     states_ = "";
     durationUnit_ = 1;
+    pwmChannels_ = "";
+    pwmDuties_ = "";
     config_file_options_ = NULL;
 }
 
@@ -100,10 +102,12 @@ void Global::parseArguments(int argc, char* argv[]) throw(MyException*) {
             // ====================================================================================
             // COMMAND LINE OPTIONS
             ("settings-file,s", po::value<std::string>(&settingsFile_), "Specify a settings file")
-            ("portDevice", po::value<std::string>(&portDeviceAbsPath_), "Absolute path to the port device (e.g. \"/dev/parport0\").")
+            ("portDevice", po::value<std::string>(&portDeviceAbsPath_), "Absolute path to the port device (e.g. \"/dev/parport0\", \"/dev/gpiochip0\" or \"mock\").")
             ("pins,p", po::value<std::string>(&pins_), "List of pins formatted as \"pin1_name pin1_port pin1_index pin2_name ... pinN_index\"")
             ("states", po::value<std::string>(&states_), "Semicolon-separated list of states (playlist)")
-            ("durationUnit,u", po::value<int>(&durationUnit_), "Duration unit (0=min, 1=sec, 2=msec)")
+            ("durationUnit,u", po::value<int>(&durationUnit_), "Duration unit (0=min, 1=sec, 2=msec, 3=frames)")
+            ("pwmChannels", po::value<std::string>(&pwmChannels_), "Software PWM channels formatted as \"pin1_name period_us pin2_name ...\"")
+            ("pwmDuties", po::value<std::string>(&pwmDuties_), "Semicolon-separated list of the duty cycles (%) of the PWM channels for each state")
         ;
 
         // A group of options that containt options that we will not display in help
@@ -189,6 +193,8 @@ void Global::load(std::string filename) throw(MyException*) {
             stripLeadingAndEndingQuotes(portDeviceAbsPath_);
             stripLeadingAndEndingQuotes(pins_);
             stripLeadingAndEndingQuotes(states_);
+            stripLeadingAndEndingQuotes(pwmChannels_);
+            stripLeadingAndEndingQuotes(pwmDuties_);
 
             settingsFile_ = filename;
 
@@ -216,14 +222,19 @@ void Global::save(std::string filename) throw(MyException*) {
             myfile << "# Boolean values: 0 => false, 1 => true" << std::endl;
             myfile << std::endl;
             myfile << std::endl;
-            myfile << "# Absolute path to the port device (e.g. \"/dev/parport0\")." << std::endl;
+            myfile << "# Absolute path to the port device (e.g. \"/dev/parport0\", \"/dev/gpiochip0\" or \"mock\" to run without hardware)." << std::endl;
             myfile << "portDevice = \"" << this->portDeviceAbsPath_ << "\"" << std::endl;
             myfile << "# List of pins formatted as \"pin1_name pin1_port pin1_index pin2_name ... pinN_index\" (no whitespace in the elements)" << std::endl;
+            myfile << "# The port of a pin can be another parallel port device (e.g. \"/dev/parport1\") than portDevice." << std::endl;
             myfile << "pins = \"" << this->pins_ << "\"" << std::endl;
             myfile << "# Semicolon-separated list of states (playlist)" << std::endl;
             myfile << "states = \"" << states_ << "\"" << std::endl;
-            myfile << "# Duration unit (0=min, 1=sec, 2=msec)" << std::endl;
+            myfile << "# Duration unit (0=min, 1=sec, 2=msec, 3=frames)" << std::endl;
             myfile << "durationUnit = " << durationUnit_ << std::endl;
+            myfile << "# Software PWM channels formatted as \"pin1_name period_us pin2_name ... periodN_us\" (e.g. LED intensity)" << std::endl;
+            myfile << "pwmChannels = \"" << pwmChannels_ << "\"" << std::endl;
+            myfile << "# Semicolon-separated list of the duty cycles (%) of the PWM channels for each state (100 if not given)" << std::endl;
+            myfile << "pwmDuties = \"" << pwmDuties_ << "\"" << std::endl;
             myfile.close();
 
         } else
@@ -251,3 +262,9 @@ int Global::getDurationUnit() { return durationUnit_; }
 
 void Global::setStates(std::string states) { states_ = states; }
 std::string Global::getStates() { return states_; }
+
+void Global::setPwmChannels(std::string channels) { pwmChannels_ = channels; }
+std::string Global::getPwmChannels() { return pwmChannels_; }
+
+void Global::setPwmDuties(std::string duties) { pwmDuties_ = duties; }
+std::string Global::getPwmDuties() { return pwmDuties_; }
@@ -64,6 +64,10 @@ private:
     std::string states_;
     /** Duration unit (0=min, 1=sec, 2=msec). */
     int durationUnit_;
+    /** Software PWM channels ("pin1_name period_us ..."). */
+    std::string pwmChannels_;
+    /** Semicolon-separated list of the duty cycles in percent of the PWM channels for each state. */
+    std::string pwmDuties_;
 
 public:
 
@@ -102,6 +106,16 @@ public:
     /** Returns duration unit (0=min, 1=sec, 2=msec). */
     int getDurationUnit();
 
+    /** Sets the software PWM channels ("pin1_name period_us ..."). */
+    void setPwmChannels(std::string channels);
+    /** Returns the software PWM channels ("pin1_name period_us ..."). */
+    std::string getPwmChannels();
+
+    /** Sets the duty cycles of the PWM channels for each state ("d1 d2;d1 d2;..."). */
+    void setPwmDuties(std::string duties);
+    /** Returns the duty cycles of the PWM channels for each state ("d1 d2;d1 d2;..."). */
+    std::string getPwmDuties();
+
     /** Reads settings file. */
     void load(std::string filename) throw(MyException*);
     /** Writes settings file. */
@@ -64,14 +64,14 @@ int main(int argc, char* argv[]) {
         settings->configureLogging();
         settings->parseArguments(argc, argv);
 
-        portplayer::ParallelPortManager* ppManager = NULL;
+        portplayer::IOPinManager* ppManager = NULL;
 
         // create a default ppManager
         if (settings->getSettingsFile().empty() && argc == 1)
             ppManager =  portplayer::ParallelPortManager::generateParallelPortExample();
         // create a ppManager from settings
         else {
-            ppManager = new portplayer::ParallelPortManager();
+            ppManager = portplayer::IOPinManager::create(settings->getPortDeviceAbsPath());
             ppManager->load(settings->getPortDeviceAbsPath(), settings->getPins());
 
             std::string text = settings->getStates();
@@ -106,6 +106,8 @@ int main(int argc, char* argv[]) {
 
             ppManager->getPinPlaylist()->loadPlaylist(pinPlaylist);
             ppManager->getPinPlaylist()->loadStateDurations(stateDurations);
+            ppManager->loadPwm(settings->getPwmChannels(), settings->getPwmDuties());
+            ppManager->compileStates();
         }
 
         qportplayer::QPortPlayerDialog qppplayer;
@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "playlistdelegate.h"
+#include "playlistmodel.h"
+#include <QApplication>
+#include <QMouseEvent>
+#include <QKeyEvent>
+#include <QPainter>
+#include <QSpinBox>
+#include <QStyleOption>
+
+using namespace qportplayer;
+
+// ======================================================================
+// PRIVATE METHODS
+
+bool PlaylistDelegate::isBoolean(const QModelIndex& index) {
+
+    const PlaylistModel* model = qobject_cast<const PlaylistModel*>(index.model());
+    return model != NULL && model->getColumn(index.column()).type_ == PlaylistModel::BOOLEAN;
+}
+
+// ----------------------------------------------------------------------
+
+QRect PlaylistDelegate::getCheckRect(const QStyleOptionViewItem& option) {
+
+    QStyleOptionButton button;
+    QRect r = QApplication::style()->subElementRect(QStyle::SE_CheckBoxIndicator, &button);
+    r.moveCenter(option.rect.center());
+    return r;
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+PlaylistDelegate::PlaylistDelegate(QObject* parent) : QStyledItemDelegate(parent) {}
+
+// ----------------------------------------------------------------------
+
+void PlaylistDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const {
+
+    if (!isBoolean(index)) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    // background and selection
+    QStyleOptionViewItemV4 opt = option;
+    initStyleOption(&opt, index);
+    opt.features &= ~QStyleOptionViewItemV2::HasCheckIndicator;
+    QStyle* style = opt.widget ? opt.widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, opt.widget);
+
+    // check box, grayed when the cell can not be edited
+    QStyleOptionButton button;
+    button.rect = getCheckRect(option);
+    button.state = (index.data(Qt::CheckStateRole).toInt() == Qt::Checked) ? QStyle::State_On : QStyle::State_Off;
+    if (index.flags() & Qt::ItemIsUserCheckable)
+        button.state |= QStyle::State_Enabled;
+    style->drawPrimitive(QStyle::PE_IndicatorCheckBox, &button, painter, opt.widget);
+}
+
+// ----------------------------------------------------------------------
+
+QWidget* PlaylistDelegate::createEditor(QWidget* parent, const QStyleOptionViewItem& option, const QModelIndex& index) const {
+
+    const PlaylistModel* model = qobject_cast<const PlaylistModel*>(index.model());
+    if (model == NULL || isBoolean(index))
+        return QStyledItemDelegate::createEditor(parent, option, index);
+
+    const PlaylistModel::Column& c = model->getColumn(index.column());
+    QSpinBox* sb = new QSpinBox(parent);
+    sb->setRange(c.min_, c.max_);
+    sb->setSuffix(c.suffix_.c_str());
+    sb->setSpecialValueText(c.specialValueText_.c_str());
+    sb->setAlignment(Qt::AlignRight);
+    sb->setFrame(false);
+
+    return sb;
+}
+
+// ----------------------------------------------------------------------
+
+void PlaylistDelegate::setEditorData(QWidget* editor, const QModelIndex& index) const {
+
+    QSpinBox* sb = qobject_cast<QSpinBox*>(editor);
+    if (sb == NULL) {
+        QStyledItemDelegate::setEditorData(editor, index);
+        return;
+    }
+    sb->setValue(index.data(Qt::EditRole).toInt());
+}
+
+// ----------------------------------------------------------------------
+
+void PlaylistDelegate::setModelData(QWidget* editor, QAbstractItemModel* model, const QModelIndex& index) const {
+
+    QSpinBox* sb = qobject_cast<QSpinBox*>(editor);
+    if (sb == NULL) {
+        QStyledItemDelegate::setModelData(editor, model, index);
+        return;
+    }
+    sb->interpretText();
+    model->setData(index, sb->value(), Qt::EditRole);
+}
+
+// ----------------------------------------------------------------------
+
+void PlaylistDelegate::updateEditorGeometry(QWidget* editor, const QStyleOptionViewItem& option, const QModelIndex& /*index*/) const {
+
+    editor->setGeometry(option.rect);
+}
+
+// ----------------------------------------------------------------------
+
+bool PlaylistDelegate::editorEvent(QEvent* event, QAbstractItemModel* model, const QStyleOptionViewItem& option, const QModelIndex& index) {
+
+    if (!isBoolean(index))
+        return QStyledItemDelegate::editorEvent(event, model, option, index);
+
+    if (!(index.flags() & Qt::ItemIsUserCheckable))
+        return false;
+
+    if (event->type() == QEvent::MouseButtonRelease) {
+        QMouseEvent* e = static_cast<QMouseEvent*>(event);
+        if (e->button() != Qt::LeftButton || !getCheckRect(option).contains(e->pos()))
+            return false;
+    } else if (event->type() == QEvent::MouseButtonDblClick) {
+        return getCheckRect(option).contains(static_cast<QMouseEvent*>(event)->pos()); // eats the second click
+    } else if (event->type() == QEvent::KeyPress) {
+        const int key = static_cast<QKeyEvent*>(event)->key();
+        if (key != Qt::Key_Space && key != Qt::Key_Select)
+            return false;
+    } else
+        return false;
+
+    const bool checked = (index.data(Qt::CheckStateRole).toInt() == Qt::Checked);
+    return model->setData(index, checked ? Qt::Unchecked : Qt::Checked, Qt::CheckStateRole);
+}
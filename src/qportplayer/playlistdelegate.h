@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PLAYLISTDELEGATE_H
+#define PLAYLISTDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+//! Graphical interface to control the environment (valves, LEDs, robots, etc.).
+namespace qportplayer {
+
+/**
+ * \brief Paints and edits the cells of a PlaylistModel.
+ *
+ * The boolean cells are painted as centered check boxes toggled in place,
+ * the integer cells are edited with a spin box created only while the cell
+ * is being edited.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class PlaylistDelegate : public QStyledItemDelegate {
+
+    Q_OBJECT
+
+private:
+
+    /** Returns true if the cell is a check box. */
+    static bool isBoolean(const QModelIndex& index);
+    /** Returns the rectangle of the check box centered in the cell. */
+    static QRect getCheckRect(const QStyleOptionViewItem& option);
+
+public:
+
+    /** Constructor. */
+    PlaylistDelegate(QObject* parent = 0);
+
+    /** Paints the boolean cells as centered check boxes. */
+    void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const;
+    /** Creates a spin box for the integer cells. */
+    QWidget* createEditor(QWidget* parent, const QStyleOptionViewItem& option, const QModelIndex& index) const;
+    /** Sets the value of the spin box. */
+    void setEditorData(QWidget* editor, const QModelIndex& index) const;
+    /** Sets the value of the cell from the spin box. */
+    void setModelData(QWidget* editor, QAbstractItemModel* model, const QModelIndex& index) const;
+    /** Places the spin box over the cell. */
+    void updateEditorGeometry(QWidget* editor, const QStyleOptionViewItem& option, const QModelIndex& index) const;
+
+protected:
+
+    /** Toggles the boolean cells on click or space. */
+    bool editorEvent(QEvent* event, QAbstractItemModel* model, const QStyleOptionViewItem& option, const QModelIndex& index);
+};
+
+}
+
+#endif // PLAYLISTDELEGATE_H
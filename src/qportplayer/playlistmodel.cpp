@@ -0,0 +1,283 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "playlistmodel.h"
+#include <algorithm>
+
+using namespace qportplayer;
+
+// ======================================================================
+// PRIVATE METHODS
+
+unsigned int PlaylistModel::addColumn(const Column& column) {
+
+    const unsigned int n = columns_.size();
+    beginInsertColumns(QModelIndex(), n, n);
+    columns_.push_back(column);
+    values_.push_back(std::vector<int>(numRows_, column.default_));
+    endInsertColumns();
+
+    return n;
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+PlaylistModel::PlaylistModel(QObject* parent) :
+    QAbstractTableModel(parent),
+    numRows_(0),
+    editable_(true)
+{}
+
+// ----------------------------------------------------------------------
+
+PlaylistModel::~PlaylistModel() {}
+
+// ----------------------------------------------------------------------
+
+void PlaylistModel::clear(const unsigned int numRows) {
+
+    beginResetModel();
+    columns_.clear();
+    values_.clear();
+    numRows_ = numRows;
+    endResetModel();
+}
+
+// ----------------------------------------------------------------------
+
+unsigned int PlaylistModel::addBooleanColumn(const std::string name, const bool defaultValue) {
+
+    Column c;
+    c.name_ = name;
+    c.type_ = BOOLEAN;
+    c.min_ = 0;
+    c.max_ = 1;
+    c.default_ = defaultValue ? 1 : 0;
+    c.enabled_ = true;
+
+    return addColumn(c);
+}
+
+// ----------------------------------------------------------------------
+
+unsigned int PlaylistModel::addIntegerColumn(const std::string name, const int min, const int max, const int defaultValue, const std::string suffix, const std::string specialValueText) {
+
+    Column c;
+    c.name_ = name;
+    c.type_ = INTEGER;
+    c.min_ = min;
+    c.max_ = max;
+    c.default_ = defaultValue;
+    c.suffix_ = suffix;
+    c.specialValueText_ = specialValueText;
+    c.enabled_ = true;
+
+    return addColumn(c);
+}
+
+// ----------------------------------------------------------------------
+
+int PlaylistModel::getValue(const unsigned int row, const unsigned int column) const {
+
+    return values_.at(column).at(row);
+}
+
+// ----------------------------------------------------------------------
+
+void PlaylistModel::setValue(const unsigned int row, const unsigned int column, const int value) {
+
+    const Column& c = columns_.at(column);
+    values_.at(column).at(row) = std::max(c.min_, std::min(c.max_, value));
+    const QModelIndex i = index(row, column);
+    emit dataChanged(i, i);
+}
+
+// ----------------------------------------------------------------------
+
+void PlaylistModel::setColumnValues(const unsigned int column, const std::vector<int>& values) {
+
+    const Column& c = columns_.at(column);
+    std::vector<int>& v = values_.at(column);
+    const unsigned int n = std::min(v.size(), values.size());
+    for (unsigned int i = 0; i < n; i++)
+        v[i] = std::max(c.min_, std::min(c.max_, values[i]));
+
+    if (n > 0)
+        emit dataChanged(index(0, column), index(n - 1, column));
+}
+
+// ----------------------------------------------------------------------
+
+void PlaylistModel::setColumnEnabled(const unsigned int column, const bool enabled) {
+
+    columns_.at(column).enabled_ = enabled;
+    if (numRows_ > 0)
+        emit dataChanged(index(0, column), index(numRows_ - 1, column));
+}
+
+// ----------------------------------------------------------------------
+
+void PlaylistModel::setEditable(const bool editable) {
+
+    if (editable_ == editable)
+        return;
+
+    editable_ = editable;
+    if (numRows_ > 0 && !columns_.empty())
+        emit dataChanged(index(0, 0), index(numRows_ - 1, columns_.size() - 1));
+}
+
+// ----------------------------------------------------------------------
+
+int PlaylistModel::rowCount(const QModelIndex& parent) const {
+
+    return parent.isValid() ? 0 : numRows_;
+}
+
+// ----------------------------------------------------------------------
+
+int PlaylistModel::columnCount(const QModelIndex& parent) const {
+
+    return parent.isValid() ? 0 : columns_.size();
+}
+
+// ----------------------------------------------------------------------
+
+QVariant PlaylistModel::data(const QModelIndex& index, int role) const {
+
+    if (!index.isValid())
+        return QVariant();
+
+    const Column& c = columns_.at(index.column());
+    const int value = values_.at(index.column()).at(index.row());
+
+    if (c.type_ == BOOLEAN) {
+        if (role == Qt::CheckStateRole)
+            return value ? Qt::Checked : Qt::Unchecked;
+        if (role == Qt::EditRole)
+            return value != 0;
+        return QVariant();
+    }
+
+    if (role == Qt::DisplayRole) {
+        if (value == c.min_ && !c.specialValueText_.empty())
+            return QString(c.specialValueText_.c_str());
+        return QString::number(value) + QString(c.suffix_.c_str());
+    }
+    if (role == Qt::EditRole)
+        return value;
+    if (role == Qt::TextAlignmentRole)
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+
+    return QVariant();
+}
+
+// ----------------------------------------------------------------------
+
+bool PlaylistModel::setData(const QModelIndex& index, const QVariant& value, int role) {
+
+    if (!index.isValid())
+        return false;
+
+    const Column& c = columns_.at(index.column());
+    if (c.type_ == BOOLEAN && role == Qt::CheckStateRole)
+        setValue(index.row(), index.column(), value.toInt() == Qt::Checked ? 1 : 0);
+    else if (role == Qt::EditRole)
+        setValue(index.row(), index.column(), value.toInt());
+    else
+        return false;
+
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+QVariant PlaylistModel::headerData(int section, Qt::Orientation orientation, int role) const {
+
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    if (orientation == Qt::Horizontal)
+        return (section >= 0 && section < (int)columns_.size()) ? QVariant(QString(columns_.at(section).name_.c_str())) : QVariant();
+
+    return section + 1;
+}
+
+// ----------------------------------------------------------------------
+
+Qt::ItemFlags PlaylistModel::flags(const QModelIndex& index) const {
+
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+
+    Qt::ItemFlags f = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+    const Column& c = columns_.at(index.column());
+    if (editable_ && c.enabled_)
+        f |= (c.type_ == BOOLEAN) ? Qt::ItemIsUserCheckable : Qt::ItemIsEditable;
+
+    return f;
+}
+
+// ----------------------------------------------------------------------
+
+bool PlaylistModel::insertRows(int row, int count, const QModelIndex& parent) {
+
+    if (parent.isValid() || row < 0 || row > (int)numRows_ || count <= 0)
+        return false;
+
+    beginInsertRows(QModelIndex(), row, row + count - 1);
+    for (unsigned int c = 0; c < columns_.size(); c++)
+        values_[c].insert(values_[c].begin() + row, count, columns_[c].default_);
+    numRows_ += count;
+    endInsertRows();
+
+    return true;
+}
+
+// ----------------------------------------------------------------------
+
+bool PlaylistModel::removeRows(int row, int count, const QModelIndex& parent) {
+
+    if (parent.isValid() || row < 0 || count <= 0 || row + count > (int)numRows_)
+        return false;
+
+    beginRemoveRows(QModelIndex(), row, row + count - 1);
+    for (unsigned int c = 0; c < columns_.size(); c++)
+        values_[c].erase(values_[c].begin() + row, values_[c].begin() + row + count);
+    numRows_ -= count;
+    endRemoveRows();
+
+    return true;
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+const std::vector<int>& PlaylistModel::getColumnValues(const unsigned int column) const { return values_.at(column); }
+const PlaylistModel::Column& PlaylistModel::getColumn(const unsigned int column) const { return columns_.at(column); }
+bool PlaylistModel::isEditable() const { return editable_; }
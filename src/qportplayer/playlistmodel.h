@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PLAYLISTMODEL_H
+#define PLAYLISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <string>
+#include <vector>
+
+//! Graphical interface to control the environment (valves, LEDs, robots, etc.).
+namespace qportplayer {
+
+/**
+ * \brief Content of the playlist table (one row per state).
+ *
+ * The cells are plain integers stored column by column: the view only
+ * materializes the rows it displays and the editors are created by
+ * PlaylistDelegate for the cell being edited, so that long playlists load
+ * and display instantly. A column is either boolean (check box) or integer
+ * (spin box) and gives the default value of the new states.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class PlaylistModel : public QAbstractTableModel {
+
+    Q_OBJECT
+
+public:
+
+    /** Type of the cells of a column. */
+    enum ColumnType {
+        BOOLEAN = 0,    // check box
+        INTEGER         // spin box
+    };
+
+    /** Description of a column. */
+    struct Column {
+        /** Header of the column. */
+        std::string name_;
+        /** Type of the cells. */
+        ColumnType type_;
+        /** Minimum value. */
+        int min_;
+        /** Maximum value. */
+        int max_;
+        /** Value of the new states. */
+        int default_;
+        /** Suffix displayed after the value (e.g. " us"). */
+        std::string suffix_;
+        /** Text displayed instead of the minimum value (empty to display the value). */
+        std::string specialValueText_;
+        /** Is true if the cells can be edited (when the model is editable). */
+        bool enabled_;
+    };
+
+private:
+
+    /** Columns. */
+    std::vector<Column> columns_;
+    /** Values of the cells, column by column. */
+    std::vector< std::vector<int> > values_;
+    /** Number of rows. */
+    unsigned int numRows_;
+    /** Is true if the cells can be edited. */
+    bool editable_;
+
+    /** Adds a column and returns its index. */
+    unsigned int addColumn(const Column& column);
+
+public:
+
+    /** Constructor. */
+    PlaylistModel(QObject* parent = 0);
+    /** Destructor. */
+    ~PlaylistModel();
+
+    /** Removes all the columns and sets the number of rows. */
+    void clear(const unsigned int numRows);
+    /** Adds a column of check boxes and returns its index. */
+    unsigned int addBooleanColumn(const std::string name, const bool defaultValue);
+    /** Adds a column of spin boxes and returns its index. */
+    unsigned int addIntegerColumn(const std::string name, const int min, const int max, const int defaultValue, const std::string suffix = "", const std::string specialValueText = "");
+
+    /** Returns the value of a cell. */
+    int getValue(const unsigned int row, const unsigned int column) const;
+    /** Sets the value of a cell. */
+    void setValue(const unsigned int row, const unsigned int column, const int value);
+    /** Returns the values of a column. */
+    const std::vector<int>& getColumnValues(const unsigned int column) const;
+    /** Sets the values of a column (the missing rows keep their value). */
+    void setColumnValues(const unsigned int column, const std::vector<int>& values);
+
+    /** Returns the description of a column. */
+    const Column& getColumn(const unsigned int column) const;
+    /** Enables or disables the edition of a column. */
+    void setColumnEnabled(const unsigned int column, const bool enabled);
+    /** Enables or disables the edition of the cells. */
+    void setEditable(const bool editable);
+    /** Returns true if the cells can be edited. */
+    bool isEditable() const;
+
+    /** Returns the number of rows. */
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    /** Returns the number of columns. */
+    int columnCount(const QModelIndex& parent = QModelIndex()) const;
+    /** Returns the data of a cell for the given role. */
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+    /** Sets the data of a cell (check state of the boolean cells, value of the integer cells). */
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole);
+    /** Returns the names of the columns and the indexes of the states (starting at 1). */
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    /** Returns the flags of a cell. */
+    Qt::ItemFlags flags(const QModelIndex& index) const;
+    /** Inserts states set to the default values of the columns. */
+    bool insertRows(int row, int count, const QModelIndex& parent = QModelIndex());
+    /** Removes states. */
+    bool removeRows(int row, int count, const QModelIndex& parent = QModelIndex());
+};
+
+}
+
+#endif // PLAYLISTMODEL_H
@@ -1,10 +1,14 @@
 SOURCES += booleanledwidget.cpp \
     enhancedprogressbar.cpp \
     qportplayerdialog.cpp \
+    playlistmodel.cpp \
+    playlistdelegate.cpp \
     global.cpp
 HEADERS += booleanledwidget.h \
     enhancedprogressbar.h \
     qportplayerdialog.h \
+    playlistmodel.h \
+    playlistdelegate.h \
     global.h
 FORMS += booleanledwidget.ui \
     enhancedprogressbar.ui \
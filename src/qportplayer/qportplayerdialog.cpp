@@ -28,8 +28,10 @@
 #include "qportplayerdialog.h"
 #include "ui_qportplayerdialog.h"
 #include "booleanledwidget.h"
+#include "playlistdelegate.h"
 #include "global.h"
 #include <sstream>
+#include <algorithm>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <glog/logging.h>
@@ -43,16 +45,29 @@ QPortPlayerDialog::QPortPlayerDialog(QWidget* parent) : QDialog(parent), ui(new
 
     ui->setupUi(this);
     setWindowTitle("QPortPlayer");
+    // only the visible rows of the playlist are painted, editors are created on demand
+    playlistModel_ = new PlaylistModel(this);
+    ui->tableView->setModel(playlistModel_);
+    ui->tableView->setItemDelegate(new PlaylistDelegate(ui->tableView));
+    ui->tableView->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::SelectedClicked | QAbstractItemView::EditKeyPressed);
     pManager_ = NULL;
     sequenceProgressBar_ = NULL;
     stateProgressBar_ = NULL;
+    inputWatcher_ = NULL;
+    lastStatus_ = portplayer::PlayerStatus();
+    lastStatus_.stateIndex_ = PORT_EVENT_NO_STATE;
     makeConnections();
+
+    // the threads of the player never signal the interface, their status is polled
+    connect(&refreshTimer_, SIGNAL(timeout()), this, SLOT(refresh()));
+    refreshTimer_.start(QPORTPLAYER_REFRESH_INTERVAL);
 }
 
 // ----------------------------------------------------------------------
 
 QPortPlayerDialog::~QPortPlayerDialog() {
 
+    refreshTimer_.stop();
     delete ui;
 
     pManager_->setAllPinsLow();
@@ -93,7 +108,7 @@ void QPortPlayerDialog::makeConnections() {
     connect(ui->manualSelectionRadioButton, SIGNAL(clicked()), this, SLOT(changeMode()));
     connect(ui->sequenceRadioButton, SIGNAL(clicked()), this, SLOT(changeMode()));
     connect(ui->externalTriggerRadioButton, SIGNAL(clicked()), this, SLOT(changeMode()));
-    connect(ui->tableWidget, SIGNAL(itemSelectionChanged()), this, SLOT(tableSelectionChanged()));
+    connect(ui->tableView->selectionModel(), SIGNAL(selectionChanged(const QItemSelection&, const QItemSelection&)), this, SLOT(tableSelectionChanged()));
     connect(ui->closeButton, SIGNAL(clicked()), this, SLOT(saveEditionAndClose()));
     connect(ui->startSequenceButton, SIGNAL(clicked()), this, SLOT(startPlaylist()));
     connect(ui->stopSequenceButton, SIGNAL(clicked()), this, SLOT(stopPlaylist()));
@@ -121,7 +136,10 @@ void QPortPlayerDialog::changeEvent(QEvent* event) {
 void QPortPlayerDialog::initialize() {
 
     durationColumnEnabled_ = true;
-    ui->externalTriggerRadioButton->setVisible(false);
+    // REMOTE mode requires an external input
+    ui->externalTriggerRadioButton->setVisible(inputWatcher_ != NULL);
+    // frames require a trigger source (e.g. sQuid)
+    ui->framesRadioButton->setVisible(false);
     preNextStateAction_ = (pfv) &QPortPlayerDialog::defaultPreNextStateAction;
     postNextStateAction_ = (pfv) &QPortPlayerDialog::defaultPostNextStateAction;
 }
@@ -144,11 +162,13 @@ void QPortPlayerDialog::setup() {
         ui->secRadioButton->setChecked(true);
     else if (unit == 2)
         ui->msecRadioButton->setChecked(true);
+    else if (unit == 3 && !ui->framesRadioButton->isHidden())
+        ui->framesRadioButton->setChecked(true);
 
     pManager_->setAllPinsLow();
 
     // adpat dialog size to number of columns
-    const double customWidth = 90 * ui->tableWidget->columnCount();
+    const double customWidth = 90 * playlistModel_->columnCount();
     const QSize qs(customWidth, this->minimumHeight());
     this->resize(qs);
 
@@ -159,34 +179,23 @@ void QPortPlayerDialog::setup() {
 
 void QPortPlayerDialog::setPinCells() {
 
-    // create the rows
     const unsigned int numRows = pManager_->getPinPlaylist()->getNumStates();
-    ui->tableWidget->setRowCount(numRows);
-
-    // create the columns
-    const unsigned int numColumns = pManager_->getNumPins();
-    ui->tableWidget->setColumnCount(numColumns);
-    QHeaderView* header = ui->tableWidget->horizontalHeader();
-    header->setResizeMode(QHeaderView::Stretch);
-
-    // set table content
-    QCheckBox* cb = NULL;
-    for (unsigned int i = 0; i < numRows; i++) {
-        // get ith state from sequence
-        const std::vector<bool> state = pManager_->getPinPlaylist()->getPlaylist()->at(i);
-        for (unsigned int j = 0; j < numColumns; j++) {
-            cb = new QCheckBox();
-            cb->setChecked(state.at(j));
-            createCellWidget(i, j, cb);
-        }
+    const unsigned int numPins = pManager_->getNumPins();
+    const std::vector< std::vector<bool> >* playlist = pManager_->getPinPlaylist()->getPlaylist();
+    const std::vector<std::string> names = pManager_->getPinNames();
+
+    // one column of check boxes per pin
+    playlistModel_->clear(numRows);
+    std::vector<int> values(numRows, 0);
+    for (unsigned int j = 0; j < numPins; j++) {
+        playlistModel_->addBooleanColumn(names.at(j), false);
+        for (unsigned int i = 0; i < numRows; i++)
+            values[i] = playlist->at(i).at(j);
+        playlistModel_->setColumnValues(j, values);
     }
 
-    // set header
-    std::vector<std::string> list = pManager_->getPinNames();
-    QStringList qlist;
-    for (unsigned int i = 0; i < list.size(); i++)
-        qlist << QString(list.at(i).c_str());
-    ui->tableWidget->setHorizontalHeaderLabels(qlist);
+    QHeaderView* header = ui->tableView->horizontalHeader();
+    header->setResizeMode(QHeaderView::Stretch);
 }
 
 // ----------------------------------------------------------------------
@@ -200,18 +209,18 @@ void QPortPlayerDialog::updateGui() {
     ui->removeState->setEnabled(b);   
 
     b = (mode == portplayer::IOPinManager::PLAYLIST || mode == portplayer::IOPinManager::REMOTE);
-    ui->tableWidget->setEnabled(!b);
+    ui->tableView->setEnabled(!b);
 
     if (mode == portplayer::IOPinManager::EDITION) {
         // set default table style sheet
-        ui->tableWidget->setStyleSheet("");
+        ui->tableView->setStyleSheet("");
     } else if (mode == portplayer::IOPinManager::MANUAL) {
-        ui->tableWidget->clearSelection();
-        ui->tableWidget->setStyleSheet("selection-background-color: #A00000; selection-color: #FFFFFF");
+        ui->tableView->clearSelection();
+        ui->tableView->setStyleSheet("selection-background-color: #A00000; selection-color: #FFFFFF");
     } else if (mode == portplayer::IOPinManager::PLAYLIST) {
-        ui->tableWidget->setStyleSheet("selection-background-color: #00A000; selection-color: #FFFFFF");
+        ui->tableView->setStyleSheet("selection-background-color: #00A000; selection-color: #FFFFFF");
     } else if (mode == portplayer::IOPinManager::REMOTE) {
-        ui->tableWidget->setStyleSheet("selection-background-color: #A0A0A0; selection-color: #FFFFFF");
+        ui->tableView->setStyleSheet("selection-background-color: #A0A0A0; selection-color: #FFFFFF");
     } else
         LOG(WARNING) << "IOPinManagerDialog::updateGui(): Must never arrive .";
 
@@ -239,37 +248,12 @@ void QPortPlayerDialog::updateGui() {
 
 void QPortPlayerDialog::setDurationCells() {
 
-    QSpinBox* sb = NULL;
-    const unsigned int numStates = pManager_->getPinPlaylist()->getNumStates();
     const std::vector<unsigned int>* durations = pManager_->getPinPlaylist()->getStateDurations();
 
     // add one column to the table
-    ui->tableWidget->setColumnCount(ui->tableWidget->columnCount() + 1);
-
-    // set header
-    QTableWidgetItem* header = new QTableWidgetItem();
-    header->setText("Duration");
-    ui->tableWidget->setHorizontalHeaderItem(ui->tableWidget->columnCount() - 1, header);
-
-    // set content
-    const unsigned int n = ui->tableWidget->columnCount() - 1;
-    for (unsigned int i = 0; i < numStates; i++) {
-        sb = createDurationQSpinBox();
-        sb->setValue(durations->at(i));
-        createCellWidget(i, n, sb);
-    }
-}
-
-// ----------------------------------------------------------------------
-
-void QPortPlayerDialog::createCellWidget(const int row, const int column, QWidget* widget) {
-
-    QWidget* wdg = new QWidget();
-    QHBoxLayout* layout = new QHBoxLayout(wdg);
-    layout->addWidget(widget);
-    layout->setAlignment(Qt::AlignCenter);
-    wdg->setLayout(layout);
-    ui->tableWidget->setCellWidget(row, column, wdg);
+    const unsigned int n = playlistModel_->addIntegerColumn("Duration", 1, 9999999, 1000);
+    playlistModel_->setColumnValues(n, std::vector<int>(durations->begin(), durations->end()));
+    playlistModel_->setColumnEnabled(n, durationColumnEnabled_);
 }
 
 // ----------------------------------------------------------------------
@@ -277,46 +261,46 @@ void QPortPlayerDialog::createCellWidget(const int row, const int column, QWidge
 void QPortPlayerDialog::setDurationColumnEnabled(const bool state) {
 
     durationColumnEnabled_ = state;
-    const unsigned int j = ui->tableWidget->columnCount() - 1;
-    const unsigned int numStates = pManager_->getPinPlaylist()->getNumStates();
+    const unsigned int j = pManager_->getNumPins();
 
-    for (unsigned int i = 0; i < numStates; i++)
-        ui->tableWidget->cellWidget(i, j)->setEnabled(state);
+    if (j < (unsigned int)playlistModel_->columnCount())
+        playlistModel_->setColumnEnabled(j, state);
 }
 
 // ----------------------------------------------------------------------
 
 void QPortPlayerDialog::setWidgetsInTableEnabled(const bool state) {
 
-    const unsigned int numRows = ui->tableWidget->rowCount();
-    const unsigned int numColumns = ui->tableWidget->columnCount();
+    playlistModel_->setEditable(state);
+}
+
+// ----------------------------------------------------------------------
 
-    for (unsigned int i = 0; i < numRows; i++) {
-        for (unsigned int j = 0; j < numColumns; j++)
-            ui->tableWidget->cellWidget(i, j)->setEnabled(state);
+int QPortPlayerDialog::getFirstSelectedRow() {
+
+    const QModelIndexList rows = ui->tableView->selectionModel()->selectedRows();
+    int row = -1;
+    for (int i = 0; i < rows.count(); i++) {
+        if (row == -1 || rows.at(i).row() < row)
+            row = rows.at(i).row();
     }
+    return row;
 }
 
 // ----------------------------------------------------------------------
 
 void QPortPlayerDialog::addState() {
 
-    QModelIndexList indexes = ui->tableWidget->selectionModel()->selection().indexes();
+    const int selected = getFirstSelectedRow();
     int row = -1;
 
-    if (indexes.empty()) // no selection
-        row = ui->tableWidget->rowCount(); // add row to the bottom
+    if (selected == -1) // no selection
+        row = playlistModel_->rowCount(); // add row to the bottom
     else
-        row = indexes.at(0).row() + 1; // insert row after 1st row selected
+        row = selected + 1; // insert row after 1st row selected
 
-    ui->tableWidget->insertRow(row);
-    const unsigned int numPins = pManager_->getNumPins();
-
-    for (unsigned int i = 0; i < numPins; i++)
-        createCellWidget(row, i, new QCheckBox());
-
-    createCellWidget(row, ui->tableWidget->columnCount()-2, createDurationQSpinBox());
-    createCellWidget(row, ui->tableWidget->columnCount()-1, new QCheckBox());
+    // the new state takes the default values of the columns
+    playlistModel_->insertRows(row, 1);
 }
 
 // ----------------------------------------------------------------------
@@ -324,30 +308,21 @@ void QPortPlayerDialog::addState() {
 void QPortPlayerDialog::removeState() {
 
     // get all selections
-    QModelIndexList indexes = ui->tableWidget->selectionModel()->selection().indexes();
-    int numColumns = ui->tableWidget->columnCount();
-    int numDeletions = indexes.count() / numColumns;
-    int row = -1;
-
-    // removes rows from bottom to top
-    for (int i = 0; i < numDeletions; i++) {
-        row = indexes.at(numColumns * i).row();
-        ui->tableWidget->removeRow(row-i);
-        ui->tableWidget->selectRow(row);
-    }
-}
-
-// ----------------------------------------------------------------------
+    const QModelIndexList indexes = ui->tableView->selectionModel()->selectedRows();
+    std::vector<int> rows;
+    for (int i = 0; i < indexes.count(); i++)
+        rows.push_back(indexes.at(i).row());
 
-QSpinBox* QPortPlayerDialog::createDurationQSpinBox() {
+    if (rows.empty())
+        return;
 
-    QSpinBox* sb = new QSpinBox();
-    sb->setRange(1, 9999999);
-    sb->setValue(1000);
-    sb->setAlignment(Qt::AlignRight);
-    sb->setEnabled(durationColumnEnabled_);
+    // removes rows from bottom to top
+    std::sort(rows.begin(), rows.end());
+    for (int i = rows.size() - 1; i >= 0; i--)
+        playlistModel_->removeRows(rows.at(i), 1);
 
-    return sb;
+    if (playlistModel_->rowCount() > 0)
+        ui->tableView->selectRow(std::min(rows.front(), playlistModel_->rowCount() - 1));
 }
 
 // ----------------------------------------------------------------------
@@ -377,34 +352,36 @@ void QPortPlayerDialog::saveTableContent() {
     pinSequence->clear();
     pinSequenceDurations->clear();
 
-    const unsigned int numStates = ui->tableWidget->rowCount();
+    const unsigned int numStates = playlistModel_->rowCount();
     const unsigned int numPins = pManager_->getNumPins();
 
-    QWidget* w = NULL;
-    QCheckBox* c = NULL;
-    QSpinBox* s = NULL;
-
-    for (unsigned int i = 0; i < numStates; i++) {
-        std::vector<bool> state;
-        // save pin states
-        for (unsigned int j = 0; j < numPins; j++) {
-            w = ui->tableWidget->cellWidget(i, j);
-            c = (QCheckBox*)w->layout()->itemAt(0)->widget();
-            state.push_back(c->isChecked());
-        }
-        pinSequence->push_back(state);
-
-        // save state duration
-        w = ui->tableWidget->cellWidget(i, numPins);
-        s = (QSpinBox*)w->layout()->itemAt(0)->widget();
-
-        if (ui->minRadioButton->isChecked())
-            pinSequenceDurations->push_back(s->value() * 1000 * 60);
-        else if (ui->secRadioButton->isChecked())
-            pinSequenceDurations->push_back(s->value() * 1000);
-        else if (ui->msecRadioButton)
-            pinSequenceDurations->push_back(s->value());
+    unsigned int factor = 1; // msec or frames
+    if (ui->minRadioButton->isChecked())
+        factor = 1000 * 60;
+    else if (ui->secRadioButton->isChecked())
+        factor = 1000;
+
+    // save pin states
+    pinSequence->assign(numStates, std::vector<bool>(numPins, false));
+    for (unsigned int j = 0; j < numPins; j++) {
+        const std::vector<int>& values = playlistModel_->getColumnValues(j);
+        for (unsigned int i = 0; i < numStates; i++)
+            (*pinSequence)[i][j] = (values[i] != 0);
     }
+
+    // save state durations
+    const std::vector<int>& durations = playlistModel_->getColumnValues(numPins);
+    pinSequenceDurations->reserve(numStates);
+    for (unsigned int i = 0; i < numStates; i++)
+        pinSequenceDurations->push_back(durations[i] * factor);
+
+    // durations in frames are counted by the trigger thread
+    if (!pManager_->getPinPlaylist()->isRunning())
+        pManager_->getPinPlaylist()->setFrameLocked(ui->framesRadioButton->isChecked());
+
+    // the table can only be edited in EDITION mode, setMode() compiles the states of the other modes
+    if (pManager_->getMode() == portplayer::IOPinManager::EDITION)
+        pManager_->compileStates();
 }
 
 // ----------------------------------------------------------------------
@@ -418,13 +395,13 @@ void QPortPlayerDialog::changeMode() {
         saveTableContent();
         pManager_->setMode(portplayer::IOPinManager::MANUAL);
     } else if (ui->sequenceRadioButton->isChecked()) {
-        ui->tableWidget->clearSelection();
+        ui->tableView->clearSelection();
         saveTableContent();
         sequenceProgressBar_->setMaxDurationInMs(pManager_->getPinPlaylist()->getPlaylistTotalTime());
         stateProgressBar_->setMaxDurationInMs(pManager_->getPinPlaylist()->getStateDurations()->at(0));
         pManager_->setMode(portplayer::IOPinManager::PLAYLIST);
     } else if (ui->externalTriggerRadioButton->isChecked()) {
-        ui->tableWidget->clearSelection();
+        ui->tableView->clearSelection();
         saveTableContent();
         pManager_->setMode(portplayer::IOPinManager::REMOTE);
     } else
@@ -461,6 +438,25 @@ void QPortPlayerDialog::setOutputLeds() {
 
         gp->layout()->addWidget(led);
     }
+
+    lastStatus_.pins_ = pManager_->getSnapshot()->read().pins_;
+    setOutputLedStates(lastStatus_.pins_);
+}
+
+// ----------------------------------------------------------------------
+
+void QPortPlayerDialog::setOutputLedStates(const uint64_t states) {
+
+    QLayout* layout = ui->effectiveOutputGroupBox->layout();
+    if (layout == NULL)
+        return;
+
+    BooleanLedWidget* led = NULL;
+    for (int i = 0; i < layout->count(); i++) {
+        led = dynamic_cast<BooleanLedWidget*>(layout->itemAt(i)->widget());
+        if (led != NULL)
+            led->setState((states >> i) & 1);
+    }
 }
 
 // ----------------------------------------------------------------------
@@ -472,21 +468,14 @@ void QPortPlayerDialog::tableSelectionChanged() {
     if (mode == portplayer::IOPinManager::EDITION)
         return;
 
-    QModelIndexList indexes = ui->tableWidget->selectionModel()->selection().indexes();
+    const int numRowsSelected = ui->tableView->selectionModel()->selectedRows().count();
 
-    if (indexes.count() == 0) {
+    if (numRowsSelected == 0) {
         pManager_->setAllPinsLow();
         return;
     }
 
-    const unsigned int numRowsSelected = indexes.count() / ui->tableWidget->columnCount();
-
-    if (numRowsSelected < 1 && mode == portplayer::IOPinManager::MANUAL) {
-        pManager_->setAllPinsLow();
-        return;
-    }
-
-    const unsigned int rowIndex = indexes.at(0).row();
+    const unsigned int rowIndex = getFirstSelectedRow();
     LOG (INFO) << "Applying state " << rowIndex + 1 << ".";
 
     if (numRowsSelected > 1)
@@ -528,13 +517,11 @@ void QPortPlayerDialog::setPlaylistPlayer() {
 void QPortPlayerDialog::startPlaylist() {
 
     try {
-        // applies the content of the playlist to the port manager
+        // the states have been compiled when entering PLAYLIST mode
         saveTableContent();
 
         pManager_->getPinPlaylist()->disconnect();
 
-        connect(pManager_->getPinPlaylist(), SIGNAL(updatePlaylistTimeInMs(const unsigned int)), sequenceProgressBar_, SLOT(setTimeInMs(const unsigned int)));
-        connect(pManager_->getPinPlaylist(), SIGNAL(updateStateTimeInMs(const unsigned int)), stateProgressBar_, SLOT(setTimeInMs(const unsigned int)));
         connect(pManager_->getPinPlaylist(), SIGNAL(stateChanged(const unsigned int)), this, SLOT(stateChanged(const unsigned int)));
         connect(pManager_->getPinPlaylist(), SIGNAL(done()), this, SLOT(playlistDone()));
 
@@ -542,7 +529,9 @@ void QPortPlayerDialog::startPlaylist() {
         stateProgressBar_->setMaxDurationInMs(pManager_->getPinPlaylist()->getStateDurations()->at(0));
 
         pManager_->getPinPlaylist()->setCurrentState(0);
-        stateChanged(0);
+        // a frame-locked playlist applies and signals its first state at the first trigger
+        if (!pManager_->getPinPlaylist()->isFrameLocked())
+            stateChanged(0);
 
         pManager_->getPinPlaylist()->start();
 
@@ -586,7 +575,7 @@ void QPortPlayerDialog::playlistDone() {
 
     // clearSelection() also calls tableSelectionChanged(), which switch off
     // all the pins of the port if no row are selected
-    ui->tableWidget->clearSelection();
+    ui->tableView->clearSelection();
 
     updateGui();
 }
@@ -603,7 +592,7 @@ void QPortPlayerDialog::turnOff() {
     }
 
     if (mode == portplayer::IOPinManager::MANUAL || mode == portplayer::IOPinManager::REMOTE) {
-        ui->tableWidget->clearSelection();
+        ui->tableView->clearSelection();
         updateGui();
         return;
     }
@@ -616,13 +605,16 @@ void QPortPlayerDialog::stateChanged(const unsigned int currentState) {
     stateProgressBar_->setMaxDurationInMs(pManager_->getPinPlaylist()->getStateDurations()->at(currentState));
 
     // select the state in the table
-    ui->tableWidget->setEnabled(true);
-    ui->tableWidget->selectRow(currentState);
-    ui->tableWidget->setEnabled(false);
+    ui->tableView->setEnabled(true);
+    ui->tableView->selectRow(currentState);
+    ui->tableView->setEnabled(false);
 
     // XXX
     (this->*preNextStateAction_)(currentState);
-    pManager_->applyState(currentState);
+    // the running playlist has already applied the state from its RT lane
+    portplayer::BooleanPlaylist* playlist = pManager_->getPinPlaylist();
+    if (!playlist->isRunning() || !playlist->hasStateCallback())
+        pManager_->applyState(currentState);
     (this->*postNextStateAction_)(currentState);
 
     emit tableStateChanged(currentState);
@@ -691,7 +683,19 @@ void QPortPlayerDialog::importSettings() {
 
     Global* global = Global::getInstance();
 
-    pManager_->load(global->getPortDeviceAbsPath(), global->getPins());
+    const std::string portDevice = global->getPortDeviceAbsPath();
+    // the backend is recreated if the device switches between a parallel port and a GPIO chip
+    if (pManager_ == NULL || !pManager_->matchesDevice(portDevice)) {
+        portplayer::IOPinManager* manager = portplayer::IOPinManager::create(portDevice);
+        try {
+            manager->load(portDevice, global->getPins());
+        } catch (MyException* e) {
+            delete manager;
+            throw e;
+        }
+        setPortManager(manager);
+    } else
+        pManager_->load(portDevice, global->getPins());
     // because the sequence is recreated inside load(), we have to reconnect it.
     connect(ui->repeatSequenceCheckBox, SIGNAL(stateChanged(int)), pManager_->getPinPlaylist(), SLOT(repeatPlaylist(int)));
 
@@ -703,6 +707,14 @@ void QPortPlayerDialog::importSettings() {
     pManager_->getPinPlaylist()->loadPlaylist(sequence);
     pManager_->getPinPlaylist()->loadStateDurations(durations);
 
+    try {
+        pManager_->loadPwm(global->getPwmChannels(), global->getPwmDuties());
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to load the PWM channels: " << e->getMessage();
+        delete e;
+    }
+    pManager_->compileStates();
+
     const int unit = global->getDurationUnit();
     if (unit == 0)
         ui->minRadioButton->setChecked(true);
@@ -710,6 +722,8 @@ void QPortPlayerDialog::importSettings() {
         ui->secRadioButton->setChecked(true);
     else if (unit == 2)
         ui->msecRadioButton->setChecked(true);
+    else if (unit == 3 && !ui->framesRadioButton->isHidden())
+        ui->framesRadioButton->setChecked(true);
 
     setup();
 }
@@ -725,29 +739,31 @@ void QPortPlayerDialog::exportSettings() {
     global->setPins(pManager_->save());
 
     std::stringstream text;
-    const unsigned int numStates = ui->tableWidget->rowCount();
+    const unsigned int numStates = playlistModel_->rowCount();
     const unsigned int numPins = pManager_->getNumPins();
     for (unsigned int i = 0; i < numStates; i++) {
         for (unsigned int j = 0; j < numPins; j++) {
-            QCheckBox* box = qobject_cast<QCheckBox*>(ui->tableWidget->cellWidget(i, j)->layout()->itemAt(0)->widget());
-            text << box->isChecked();
+            text << playlistModel_->getValue(i, j);
             text << " ";
         }
 
-        QSpinBox* box = qobject_cast<QSpinBox*>(ui->tableWidget->cellWidget(i, numPins)->layout()->itemAt(0)->widget());
-        text << box->value();
+        text << playlistModel_->getValue(i, numPins);
 
         if (i < numStates - 1)
             text << ";";
     }
     global->setStates(text.str());
+    global->setPwmChannels(pManager_->savePwmChannels());
+    global->setPwmDuties(pManager_->savePwmDuties());
 
     if (ui->minRadioButton->isChecked())
         global->setDurationUnit(0);
     else if (ui->secRadioButton->isChecked())
         global->setDurationUnit(1);
-    else if (ui->msecRadioButton)
+    else if (ui->msecRadioButton->isChecked())
         global->setDurationUnit(2);
+    else if (ui->framesRadioButton->isChecked())
+        global->setDurationUnit(3);
 }
 
 // ----------------------------------------------------------------------
@@ -758,7 +774,55 @@ void QPortPlayerDialog::externalTriggerCatched(unsigned int index) {
         LOG (WARNING) << "\"" << windowTitle().toStdString() << "\" received an external trigger but is not configured to respond to it";
         return;
     }
-    pManager_->applyState(index % ui->tableWidget->rowCount());
+    pManager_->applyState(index % playlistModel_->rowCount());
+}
+
+// ----------------------------------------------------------------------
+
+void QPortPlayerDialog::remoteStateApplied(const unsigned int index) {
+
+    if (pManager_ == NULL || pManager_->getMode() != portplayer::IOPinManager::REMOTE || playlistModel_->rowCount() == 0)
+        return;
+
+    // the state has already been applied by the watcher thread
+    ui->tableView->setEnabled(true);
+    ui->tableView->selectRow(index % playlistModel_->rowCount());
+    ui->tableView->setEnabled(false);
+}
+
+// ----------------------------------------------------------------------
+
+void QPortPlayerDialog::refresh() {
+
+    if (pManager_ == NULL)
+        return;
+
+    const portplayer::PlayerStatus status = pManager_->getSnapshot()->read();
+
+    if (status.pins_ != lastStatus_.pins_)
+        setOutputLedStates(status.pins_);
+
+    // the times are only published while the playlist is played
+    if (sequenceProgressBar_ != NULL && status.playlistTimeInMs_ != lastStatus_.playlistTimeInMs_)
+        sequenceProgressBar_->setTimeInMs(status.playlistTimeInMs_);
+    if (stateProgressBar_ != NULL && status.stateTimeInMs_ != lastStatus_.stateTimeInMs_)
+        stateProgressBar_->setTimeInMs(status.stateTimeInMs_);
+
+    // several states applied between two polls are coalesced into the last one
+    if (status.numStates_ != lastStatus_.numStates_ && status.stateIndex_ != PORT_EVENT_NO_STATE)
+        remoteStateApplied(status.stateIndex_);
+
+    lastStatus_ = status;
+}
+
+// ----------------------------------------------------------------------
+
+void QPortPlayerDialog::setInputWatcher(portplayer::InputWatcher* watcher) {
+
+    // the states applied by the watcher are selected by refresh()
+    inputWatcher_ = watcher;
+    ui->externalTriggerRadioButton->setVisible(inputWatcher_ != NULL);
+    ui->externalTriggerRadioButton->setEnabled(inputWatcher_ != NULL);
 }
 
 // ----------------------------------------------------------------------
@@ -766,13 +830,11 @@ void QPortPlayerDialog::externalTriggerCatched(unsigned int index) {
 std::string QPortPlayerDialog::getStateKeys(const unsigned int index) {
 
     std::string output;
-    QCheckBox* box = NULL;
 
     const unsigned int n = pManager_->getNumPins();
     std::vector<std::string> list = pManager_->getPinNames();
     for (unsigned int i = 0; i < n; i++) {
-        box = qobject_cast<QCheckBox*>(ui->tableWidget->cellWidget(index, i)->layout()->itemAt(0)->widget());
-        if (box->isChecked())
+        if (playlistModel_->getValue(index, i))
             output += "_" + list[i];
     }
     return output;
@@ -29,14 +29,19 @@
 #define QPORTPLAYERDIALOG_H
 
 #include "parallelportmanager.h"
+#include "inputwatcher.h"
 #include "enhancedprogressbar.h"
+#include "playlistmodel.h"
 #include "myexception.h"
 #include <QDialog>
-#include <QSpinBox>
+#include <QTimer>
 
 #define QPORTPLAYER_VERSION "1.0.10 Beta"
 #define QPORTPLAYER_VERSION_DATE "February 2012"
 
+/** Interval in ms between two refreshments of the status of the player. */
+#define QPORTPLAYER_REFRESH_INTERVAL 40
+
 //! Elements of the graphical interface.
 namespace Ui {
     class QPortPlayerDialog;
@@ -65,12 +70,20 @@ protected:
     portplayer::IOPinManager* pManager_;
     /** Reference of the GUI. */
     Ui::QPortPlayerDialog* ui;
+    /** Content of the playlist table (pins, duration and the columns added by subclasses). */
+    PlaylistModel* playlistModel_;
     /** Is true if the duration column is enabled. */
     bool durationColumnEnabled_;
     /** Progress bar for the state of the playlist. */
     EnhancedProgressBar* sequenceProgressBar_;
     /** Progress bar for the current state. */
     EnhancedProgressBar* stateProgressBar_;
+    /** Watcher of the external input applying the states in REMOTE mode (NULL if none). */
+    portplayer::InputWatcher* inputWatcher_;
+    /** Timer polling the status of the player. */
+    QTimer refreshTimer_;
+    /** Status of the player displayed at the last refreshment. */
+    portplayer::PlayerStatus lastStatus_;
 
     /** Function pointer to call just before changing state. */
     pfv preNextStateAction_;
@@ -90,10 +103,13 @@ public:
     /** Returns the name of the boolean items checked for the given state. */
     std::string getStateKeys(const unsigned int index);
 
+    /** Sets the watcher of the external input which applies the states in REMOTE mode (NULL if none). */
+    void setInputWatcher(portplayer::InputWatcher* watcher);
+
 public slots:
 
     /** Adds a state/line to the playlist. */
-    void addState();
+    virtual void addState();
     /** Removes a state/line from the playlist. */
     void removeState();
     /** Applied the changes made to the playlist when closing EDITION mode (uses saveTableContent()). */
@@ -118,6 +134,10 @@ public slots:
 
     /** Called when the state selected changed. */
     void stateChanged(const unsigned int currentState);
+    /** Updates all the output LEDs at once (bit i is the state of the i-th pin). */
+    void setOutputLedStates(const uint64_t states);
+    /** Displays the status published by the player (LEDs, progress bars and state applied in REMOTE mode). */
+    void refresh();
 
     /** Loads the application settngs from file. */
     virtual void loadGlobal(std::string filename);
@@ -129,6 +149,8 @@ public slots:
     virtual void setPortManager(portplayer::IOPinManager* ppManager);
     /** Called when a trigger has been send from a remote part of the code to move to the next state of the playlist. */
     void externalTriggerCatched(unsigned int index);
+    /** Selects the state applied by the input watcher in REMOTE mode. */
+    void remoteStateApplied(const unsigned int index);
     /** Turns off the active elements of the application (e.g. the parallel port). */
     void turnOff();
     /** Applies the settings stored in Global. */
@@ -171,23 +193,21 @@ protected:
     /** Setup the GUI. */
     virtual void setup();
 
-    /** Initializes the cells content of the table (playlist). */
+    /** Initializes the pin columns of the table (playlist). */
     void setPinCells();
-    /** Initializes the duration cells. */
+    /** Initializes the duration column. */
     void setDurationCells();
 
-    /** Creates a spin box to be placed into duration cells. */
-    QSpinBox* createDurationQSpinBox();
     /** Initializes the output LEDs displayed in the GUI. */
     void setOutputLeds();
-    /** Creates checkbox widget to be placed into cells. */
-    void createCellWidget(const int row, const int column, QWidget* widget);
     /** Initializes playlist controls. */
     void setPlaylistPlayer();
     /** Enables or disables duration column. */
     void setDurationColumnEnabled(const bool state);
-    /** Enables or disables cells (does include duration cells). */
+    /** Enables or disables the edition of the cells (does include duration cells). */
     void setWidgetsInTableEnabled(const bool state);
+    /** Returns the index of the first state selected in the table (-1 if none). */
+    int getFirstSelectedRow();
     /** Makes connections. */
     void makeConnections();
 
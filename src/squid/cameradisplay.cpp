@@ -28,13 +28,26 @@
 #include "cameradisplay.h"
 #include "ui_cameradisplay.h"
 #include "squidsettings.h"
+#include "dc1394utility.h"
 #include <iostream>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <sys/time.h>
 #include <QVBoxLayout>
 #include <glog/logging.h>
 
 using namespace squid;
 using namespace qsquid;
 
+/** Returns the current unix time in us (same time base as dc1394 frame timestamps). */
+static uint64_t currentTimeInUs() {
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
 // ======================================================================
 // PUBLIC METHODS
 
@@ -56,9 +69,45 @@ CameraDisplay::CameraDisplay(QWidget* parent) : QDialog(parent), ui_(new Ui::Cam
     frameSize_ = NULL;
     chArr_ = NULL;
     wh_ = 0;
+    coding_ = DC1394_COLOR_CODING_MONO8;
+
+    lut_ = new unsigned char[65536];
+    autoWindowLevel_ = true;
+    windowLow_ = 0;
+    windowHigh_ = 0;
+    computeWindowLevelLut(lut_, 0, 65535);
+
+    autoWindowLevelAction_ = new QAction("Auto window/level", this);
+    autoWindowLevelAction_->setCheckable(true);
+    autoWindowLevelAction_->setChecked(autoWindowLevel_);
+    connect(autoWindowLevelAction_, SIGNAL(toggled(bool)), this, SLOT(setAutoWindowLevel(bool)));
+    addAction(autoWindowLevelAction_);
+
+    zoomLabel_ = new QLabel(this, Qt::Tool);
+    zoomImage_ = NULL;
+    zoomFactor_ = 0;
+    roiCenter_ = QPoint(-1, -1);
+    zoomActionGroup_ = new QActionGroup(this);
+    const char* zoomLabels[] = {"No zoom", "Zoom 1:1", "Zoom 2:1"};
+    QAction* separator = new QAction(this);
+    separator->setSeparator(true);
+    addAction(separator);
+    for (unsigned int i = 0; i < 3; i++) {
+        QAction* a = new QAction(zoomLabels[i], zoomActionGroup_);
+        a->setCheckable(true);
+        a->setChecked(i == zoomFactor_);
+        a->setData(i);
+        addAction(a);
+    }
+    connect(zoomActionGroup_, SIGNAL(triggered(QAction*)), this, SLOT(changeZoom(QAction*)));
+    setContextMenuPolicy(Qt::ActionsContextMenu);
+
+    resetStatistics();
+    lastTitleUpdateInUs_ = 0;
 
-    frameLabel_ = new QLabel();
+    frameLabel_ = new FrameLabel();
     frameLabel_->setBackgroundRole(QPalette::Base);
+    connect(frameLabel_, SIGNAL(painted()), this, SLOT(framePainted()));
     this->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     frameLabel_->setScaledContents(true);
 
@@ -77,6 +126,8 @@ CameraDisplay::~CameraDisplay() {
     delete framePixmap_;
     delete frameImage_;
     delete frameSize_;
+    delete zoomImage_;
+    delete[] lut_;
     // DO NOT DELETE chArr_
 
     ui_ = NULL;
@@ -84,28 +135,243 @@ CameraDisplay::~CameraDisplay() {
     framePixmap_ = NULL;
     frameImage_ = NULL;
     frameSize_ = NULL;
+    zoomImage_ = NULL;
+    lut_ = NULL;
     chArr_ = NULL;
 }
 
 // ----------------------------------------------------------------------
 
-void CameraDisplay::displayFrame(dc1394video_frame_t* frame) {
+void CameraDisplay::setupFrameImage(dc1394video_frame_t* frame) {
 
-    if (frameImage_ == NULL) {
-        frameSize_ = new QSize((int)frame->size[0], (int)frame->size[1]);
-        frameImage_ = new QImage(*frameSize_, QImage::Format_Indexed8);
+    delete frameImage_;
+    delete frameSize_;
 
-        // Setup grayscale image (MONO8)
-        // TODO: handle MONO16 and RGB images
+    coding_ = frame->color_coding;
+    frameSize_ = new QSize((int)frame->size[0], (int)frame->size[1]);
+    wh_ = frameSize_->width() * frameSize_->height();
+
+    if (coding_ == DC1394_COLOR_CODING_MONO8 || coding_ == DC1394_COLOR_CODING_MONO16) {
+        // grayscale image, MONO16 frames are mapped to 8 bits by window/level
+        frameImage_ = new QImage(*frameSize_, QImage::Format_Indexed8);
         frameImage_->setNumColors(256);
         for (unsigned int i = 0; i < 256; i++)
             frameImage_->setColor(i, qRgb(i, i, i)) ;
+    } else
+        frameImage_ = new QImage(*frameSize_, QImage::Format_RGB32);
+
+    if (framePixmap_ == NULL)
         framePixmap_ = new QPixmap();
-        chArr_ = frameImage_->bits();
-        wh_ = frameSize_->width() * frameSize_->height();
+    chArr_ = frameImage_->bits();
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::updateWindowLevel(dc1394video_frame_t* frame) {
+
+    const bool littleEndian = (frame->little_endian == DC1394_TRUE);
+    unsigned int low = windowLow_;
+    unsigned int high = windowHigh_;
+
+    if (autoWindowLevel_) {
+        // sampling one pixel out of 7 is enough to follow the dynamic of the scene
+        getMono16Range(frame->image, wh_, littleEndian, 7, low, high);
+    } else if (high == 0) {
+        // full range of the sensor
+        const unsigned int depth = (frame->data_depth > 0 && frame->data_depth <= 16) ? frame->data_depth : 16;
+        low = 0;
+        high = (1u << depth) - 1;
+    }
+
+    // the LUT is only recomputed when the window changes
+    if (low != windowLow_ || high != windowHigh_ || high == 0) {
+        windowLow_ = low;
+        windowHigh_ = high;
+        computeWindowLevelLut(lut_, windowLow_, windowHigh_);
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::updateZoom() {
+
+    const unsigned int width = frameSize_->width();
+    const unsigned int height = frameSize_->height();
+    const unsigned int roiWidth = std::min((unsigned int)ZOOM_ROI_SIZE, width);
+    const unsigned int roiHeight = std::min((unsigned int)ZOOM_ROI_SIZE, height);
+
+    // top-left corner of the ROI, kept inside the frame
+    int cx = (roiCenter_.x() < 0) ? width / 2 : roiCenter_.x();
+    int cy = (roiCenter_.y() < 0) ? height / 2 : roiCenter_.y();
+    const unsigned int x0 = std::max(0, std::min(cx - (int)roiWidth / 2, (int)(width - roiWidth)));
+    const unsigned int y0 = std::max(0, std::min(cy - (int)roiHeight / 2, (int)(height - roiHeight)));
+
+    const QImage::Format format = frameImage_->format();
+    const unsigned int bpp = (format == QImage::Format_Indexed8) ? 1 : 4;
+    const unsigned int zoomWidth = roiWidth * zoomFactor_;
+    const unsigned int zoomHeight = roiHeight * zoomFactor_;
+
+    if (zoomImage_ == NULL || zoomImage_->format() != format || (unsigned int)zoomImage_->width() != zoomWidth || (unsigned int)zoomImage_->height() != zoomHeight) {
+        delete zoomImage_;
+        zoomImage_ = new QImage(zoomWidth, zoomHeight, format);
+        if (format == QImage::Format_Indexed8)
+            zoomImage_->setColorTable(frameImage_->colorTable());
+        zoomLabel_->setFixedSize(zoomWidth, zoomHeight);
+    }
+
+    // only the ROI is copied from the frame converted for display, the
+    // dc1394 buffer may already be enqueued again
+    const unsigned char* src = NULL;
+    unsigned char* dst = NULL;
+    for (unsigned int y = 0; y < roiHeight; y++) {
+        src = frameImage_->scanLine(y0 + y) + x0 * bpp;
+        dst = zoomImage_->scanLine(y * zoomFactor_);
+
+        if (zoomFactor_ == 1)
+            memcpy(dst, src, roiWidth * bpp);
+        else if (bpp == 1) {
+            for (unsigned int x = 0; x < roiWidth; x++)
+                dst[2*x] = dst[2*x + 1] = src[x];
+        } else {
+            const unsigned int* src32 = (const unsigned int*)src;
+            unsigned int* dst32 = (unsigned int*)dst;
+            for (unsigned int x = 0; x < roiWidth; x++)
+                dst32[2*x] = dst32[2*x + 1] = src32[x];
+        }
+        // nearest-neighbor: the line is duplicated
+        for (unsigned int k = 1; k < zoomFactor_; k++)
+            memcpy(zoomImage_->scanLine(y * zoomFactor_ + k), dst, zoomWidth * bpp);
+    }
+    zoomLabel_->setPixmap(QPixmap::fromImage(*zoomImage_));
+    zoomLabel_->setWindowTitle(windowTitle() + QString(" - ROI (%1, %2)").arg(x0).arg(y0));
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::mousePressEvent(QMouseEvent* event) {
+
+    if (event->button() != Qt::LeftButton || zoomFactor_ == 0 || frameSize_ == NULL) {
+        QDialog::mousePressEvent(event);
+        return;
+    }
+    // the frame is scaled to the size of the label
+    const QPoint pos = frameLabel_->mapFrom(this, event->pos());
+    if (frameLabel_->width() > 0 && frameLabel_->height() > 0)
+        setRoiCenter(pos.x() * frameSize_->width() / frameLabel_->width(), pos.y() * frameSize_->height() / frameLabel_->height());
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::updateWindowTitle() {
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << " [displayed " << numFramesDisplayed_ << "/" << numFramesReceived_ << ", skipped " << numFramesSkipped_;
+    if (numLatencies_ > 0)
+        ss << ", latency " << latencySumInUs_ / numLatencies_ / 1000. << " ms (max " << maxLatencyInUs_ / 1000. << " ms)";
+    ss << "]";
+    setWindowTitle(displayName_ + QString::fromStdString(ss.str()));
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::skipFrame() {
+
+    numFramesReceived_++;
+    numFramesSkipped_++;
+}
+
+// ----------------------------------------------------------------------
+
+bool CameraDisplay::isDisplayOverdue() {
+
+    return currentTimeInUs() - lastDisplayInUs_ > DISPLAY_MAX_SKIP_INTERVAL;
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::resetStatistics() {
+
+    numFramesReceived_ = 0;
+    numFramesDisplayed_ = 0;
+    numFramesSkipped_ = 0;
+    pendingTimestamp_ = 0;
+    numLatencies_ = 0;
+    latencySumInUs_ = 0.;
+    maxLatencyInUs_ = 0.;
+    lastDisplayInUs_ = 0;
+}
+
+// ----------------------------------------------------------------------
+
+std::string CameraDisplay::getStatistics() {
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "received " << numFramesReceived_ << ", displayed " << numFramesDisplayed_ << ", skipped " << numFramesSkipped_;
+    if (numLatencies_ > 0)
+        ss << ", dequeue to paint latency " << latencySumInUs_ / numLatencies_ / 1000. << " ms (max " << maxLatencyInUs_ / 1000. << " ms)";
+
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::displayFrame(dc1394video_frame_t* frame) {
+
+    // read before the conversion, the buffer may be enqueued again in the meantime
+    const uint64_t timestamp = frame->timestamp;
+    numFramesReceived_++;
+
+    if (frameImage_ == NULL || frame->color_coding != coding_ ||
+            frameSize_->width() != (int)frame->size[0] || frameSize_->height() != (int)frame->size[1])
+        setupFrameImage(frame);
+
+    const unsigned int width = frameSize_->width();
+    const unsigned int height = frameSize_->height();
+    const unsigned int bytesPerLine = frameImage_->bytesPerLine();
+
+    switch (coding_) {
+    case DC1394_COLOR_CODING_MONO8:
+    case DC1394_COLOR_CODING_MONO16:
+        if (coding_ == DC1394_COLOR_CODING_MONO16)
+            updateWindowLevel(frame);
+        if (bytesPerLine == width) {
+            if (coding_ == DC1394_COLOR_CODING_MONO8)
+                memcpy(chArr_, frame->image, wh_);
+            else
+                mono16ToMono8(frame->image, chArr_, wh_, frame->little_endian == DC1394_TRUE, lut_);
+        } else {
+            // Indexed8 scan lines are 32-bit aligned
+            for (unsigned int y = 0; y < height; y++) {
+                if (coding_ == DC1394_COLOR_CODING_MONO8)
+                    memcpy(chArr_ + y * bytesPerLine, frame->image + y * width, width);
+                else
+                    mono16ToMono8(frame->image + 2 * y * width, chArr_ + y * bytesPerLine, width, frame->little_endian == DC1394_TRUE, lut_);
+            }
+        }
+        break;
+    case DC1394_COLOR_CODING_RAW8:
+        raw8ToRgb32(frame->image, (unsigned int*)chArr_, width, height, frame->color_filter);
+        break;
+    case DC1394_COLOR_CODING_YUV422:
+        yuv422ToRgb32(frame->image, (unsigned int*)chArr_, wh_, frame->yuv_byte_order);
+        break;
+    case DC1394_COLOR_CODING_RGB8:
+        rgb8ToRgb32(frame->image, (unsigned int*)chArr_, wh_);
+        break;
+    default:
+        LOG_FIRST_N(WARNING, 1) << "Unable to display frame: Unsupported color coding " << coding_ << ".";
+        numFramesSkipped_++;
+        return;
     }
-    memcpy(chArr_, frame->image, wh_);
     frameLabel_->setPixmap(QPixmap::fromImage(*frameImage_));
+    numFramesDisplayed_++;
+    lastDisplayInUs_ = currentTimeInUs();
+    pendingTimestamp_ = timestamp;
+
+    if (zoomFactor_ > 0)
+        updateZoom();
 
 
     // We suggest only using repaint() if you need an immediate repaint,
@@ -114,3 +380,88 @@ void CameraDisplay::displayFrame(dc1394video_frame_t* frame) {
     //this->repaint();
     update();
 }
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::setWindowLevel(unsigned int low, unsigned int high) {
+
+    autoWindowLevel_ = false;
+    autoWindowLevelAction_->setChecked(false);
+    windowLow_ = low;
+    windowHigh_ = high;
+    computeWindowLevelLut(lut_, windowLow_, windowHigh_);
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::setAutoWindowLevel(bool b) {
+
+    if (autoWindowLevel_ == b)
+        return;
+
+    autoWindowLevel_ = b;
+    // when disabled, falls back to the full range of the sensor
+    if (!autoWindowLevel_)
+        windowHigh_ = 0;
+    autoWindowLevelAction_->setChecked(b);
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::setZoomFactor(unsigned int factor) {
+
+    zoomFactor_ = std::min(factor, 2u);
+    zoomLabel_->setVisible(zoomFactor_ > 0);
+
+    QList<QAction*> actions = zoomActionGroup_->actions();
+    for (int i = 0; i < actions.size(); i++)
+        actions.at(i)->setChecked(actions.at(i)->data().toUInt() == zoomFactor_);
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::setRoiCenter(int x, int y) {
+
+    roiCenter_ = QPoint(x, y);
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::changeZoom(QAction* action) {
+
+    setZoomFactor(action->data().toUInt());
+}
+
+// ----------------------------------------------------------------------
+
+void CameraDisplay::framePainted() {
+
+    if (pendingTimestamp_ == 0)
+        return;
+
+    const uint64_t now = currentTimeInUs();
+    // frames displayed after a reset may have been dequeued before it
+    if (now >= pendingTimestamp_) {
+        double latency = (double)(now - pendingTimestamp_);
+        latencySumInUs_ += latency;
+        maxLatencyInUs_ = std::max(maxLatencyInUs_, latency);
+        numLatencies_++;
+    }
+    pendingTimestamp_ = 0;
+
+    if (now - lastTitleUpdateInUs_ > DISPLAY_STATISTICS_INTERVAL) {
+        updateWindowTitle();
+        lastTitleUpdateInUs_ = now;
+    }
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+void CameraDisplay::setDisplayName(QString name) {
+
+    displayName_ = name;
+    setWindowTitle(displayName_);
+}
+
+QString CameraDisplay::getDisplayName() { return displayName_; }
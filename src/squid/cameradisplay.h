@@ -31,6 +31,19 @@
 #include "dc1394/dc1394.h"
 #include <QDialog>
 #include <QLabel>
+#include <QAction>
+#include <QActionGroup>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <stdint.h>
+#include <string>
+
+/** Size in pixels of the region of interest zoomed (native resolution). */
+#define ZOOM_ROI_SIZE 160
+/** A frame is never skipped if no frame has been displayed for this duration (in us). */
+#define DISPLAY_MAX_SKIP_INTERVAL 100000
+/** Interval at which the statistics are refreshed in the window title (in us). */
+#define DISPLAY_STATISTICS_INTERVAL 500000
 
 //! Elements of the graphical interface.
 namespace Ui {
@@ -39,6 +52,32 @@ namespace Ui {
 //! Graphical interface of sQuid.
 namespace qsquid {
 
+/**
+ * \brief QLabel which notifies when it has been painted.
+ *
+ * @version March 8, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class FrameLabel : public QLabel {
+
+    Q_OBJECT
+
+public:
+
+    /** Constructor. */
+    FrameLabel(QWidget* parent = 0) : QLabel(parent) {}
+
+signals:
+
+    /** Sent once the label has been painted. */
+    void painted();
+
+private:
+
+    /** Paints the label and emits painted(). */
+    void paintEvent(QPaintEvent* event) { QLabel::paintEvent(event); emit painted(); }
+};
+
 /**
  * \brief Implements a dialog to display the frames grabbed by a camera.
  *
@@ -55,7 +94,7 @@ private:
     Ui::CameraDisplay* ui_;
 
     /** QLabel on which image are printed. */
-    QLabel* frameLabel_;
+    FrameLabel* frameLabel_;
     /** Required to print images on QLabel. */
     QPixmap* framePixmap_;
     /** QImage representing dc1394 frames. */
@@ -67,6 +106,51 @@ private:
     unsigned char* chArr_;
     /** frameWidth * frameHeight */
     unsigned int wh_;
+    /** Color coding of the frames currently displayed. */
+    dc1394color_coding_t coding_;
+
+    /** Window/level LUT used to display MONO16 frames (65536 entries). */
+    unsigned char* lut_;
+    /** If true, the window is set to the range of values of each frame. */
+    bool autoWindowLevel_;
+    /** Lowest 16-bit value of the window (displayed black). */
+    unsigned int windowLow_;
+    /** Highest 16-bit value of the window (displayed white). */
+    unsigned int windowHigh_;
+    /** Context menu action to enable the automatic window/level. */
+    QAction* autoWindowLevelAction_;
+
+    /** Tool window showing the zoomed region of interest. */
+    QLabel* zoomLabel_;
+    /** QImage of the zoomed region of interest. */
+    QImage* zoomImage_;
+    /** Zoom factor (0 = no zoom, 1 = 1:1, 2 = 2:1). */
+    unsigned int zoomFactor_;
+    /** Center of the region of interest in frame coordinates (-1 = center of the frame). */
+    QPoint roiCenter_;
+    /** Context menu actions to select the zoom factor. */
+    QActionGroup* zoomActionGroup_;
+
+    /** Name of the display (window title without statistics). */
+    QString displayName_;
+    /** Number of frames received from the camera manager. */
+    unsigned long numFramesReceived_;
+    /** Number of frames converted and displayed. */
+    unsigned long numFramesDisplayed_;
+    /** Number of frames skipped because a newer frame was pending. */
+    unsigned long numFramesSkipped_;
+    /** Dequeue timestamp of the last frame displayed but not yet painted (0 = none). */
+    uint64_t pendingTimestamp_;
+    /** Number of latencies measured. */
+    unsigned long numLatencies_;
+    /** Sum of the dequeue to paint latencies (in us). */
+    double latencySumInUs_;
+    /** Maximum dequeue to paint latency (in us). */
+    double maxLatencyInUs_;
+    /** Time at which the last frame has been displayed (in us). */
+    uint64_t lastDisplayInUs_;
+    /** Time at which the window title has been refreshed (in us). */
+    uint64_t lastTitleUpdateInUs_;
 
 public:
 
@@ -75,10 +159,36 @@ public:
     /** Destructor. */
     ~CameraDisplay();
 
+    /** Counts a frame received but not displayed. */
+    void skipFrame();
+    /** Returns true if no frame has been displayed for DISPLAY_MAX_SKIP_INTERVAL. */
+    bool isDisplayOverdue();
+    /** Resets the frame counters and latencies. */
+    void resetStatistics();
+    /** Returns the frame counters and latencies as a string. */
+    std::string getStatistics();
+
+    /** Sets the name of the display (shown in the window title). */
+    void setDisplayName(QString name);
+    /** Returns the name of the display. */
+    QString getDisplayName();
+
 public slots:
 
-    /** Displays the dc1394 frame received. */
+    /** Displays the dc1394 frame received (MONO8, MONO16, RAW8, YUV422 or RGB8). */
     void displayFrame(dc1394video_frame_t* frame);
+    /** Sets the window used to display MONO16 frames and disables the automatic window/level. */
+    void setWindowLevel(unsigned int low, unsigned int high);
+    /** Enables/disables the automatic window/level of MONO16 frames. */
+    void setAutoWindowLevel(bool b);
+    /** Sets the zoom factor of the region of interest (0 = no zoom, 1 = 1:1, 2 = 2:1). */
+    void setZoomFactor(unsigned int factor);
+    /** Sets the center of the region of interest in frame coordinates. */
+    void setRoiCenter(int x, int y);
+    /** Called when a zoom action is selected in the context menu. */
+    void changeZoom(QAction* action);
+    /** Measures the dequeue to paint latency of the last frame displayed. */
+    void framePainted();
 
 signals:
 
@@ -89,6 +199,16 @@ private:
 
     /** Called when the viewer is closed (emits displayClosed(false)). */
     void closeEvent(QCloseEvent*);
+    /** (Re)allocates the QImage for the size and coding of the given frame. */
+    void setupFrameImage(dc1394video_frame_t* frame);
+    /** Updates the window/level LUT from the given MONO16 frame. */
+    void updateWindowLevel(dc1394video_frame_t* frame);
+    /** Crops the region of interest of the frame displayed and shows it in the zoom window. */
+    void updateZoom();
+    /** Clicking on the frame moves the region of interest. */
+    void mousePressEvent(QMouseEvent* event);
+    /** Refreshes the statistics shown in the window title. */
+    void updateWindowTitle();
 };
 
 }
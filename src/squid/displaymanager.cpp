@@ -42,6 +42,7 @@ using namespace qsquid;
 DisplayManager::DisplayManager(std::vector<std::string> displayNames) {
 
     numDisplays_ = displayNames.size();
+    numPendingFrames_ = new int[numDisplays_];
     std::string title;
     CameraDisplay* display = NULL;
     const unsigned int selectedCamera = squid::CameraManager::getInstance()->getCameraIndex();
@@ -50,9 +51,10 @@ DisplayManager::DisplayManager(std::vector<std::string> displayNames) {
         title = displayNames.at(numDisplays_ - i - 1).c_str();
         if ( (numDisplays_ - i - 1) == selectedCamera)
             title += " (selected)";
-        display->setWindowTitle(title.c_str());
+        display->setDisplayName(title.c_str());
         display->show();
         displays_.push_back(display);
+        numPendingFrames_[numDisplays_ - i - 1] = 0;
 
         // at that time displays are empty shell (no images printed yet)
         display->move(0, 0);
@@ -64,17 +66,53 @@ DisplayManager::DisplayManager(std::vector<std::string> displayNames) {
 DisplayManager::~DisplayManager() {
 
     closeAll();
+    delete[] numPendingFrames_;
+    numPendingFrames_ = NULL;
+}
+
+// ----------------------------------------------------------------------
+
+void DisplayManager::resetStatistics() {
+
+    for (unsigned int i = 0; i < displays_.size(); i++)
+        displays_.at(i)->resetStatistics();
+}
+
+// ----------------------------------------------------------------------
+
+std::string DisplayManager::getStatistics() {
+
+    std::stringstream ss;
+    for (unsigned int i = 0; i < displays_.size(); i++)
+        ss << "Display " << i << ": " << displays_.at(i)->getStatistics() << std::endl;
+
+    return ss.str();
+}
+
+// ----------------------------------------------------------------------
+
+void DisplayManager::countFrame(dc1394video_frame_t* /*frame*/, unsigned int cameraIndex, unsigned int /*us*/, bool /*saveFrame*/) {
+
+    // called from the thread of the camera manager
+    if (cameraIndex < numDisplays_)
+        __sync_fetch_and_add(&numPendingFrames_[cameraIndex], 1);
 }
 
 // ----------------------------------------------------------------------
 
 void DisplayManager::displayFrame(dc1394video_frame_t* frame, unsigned int cameraIndex, unsigned int /*us*/, bool /*saveFrame*/) {
 
-    if (displays_.empty())
+    if (displays_.empty() || cameraIndex >= displays_.size())
         return;
 
-    // for now only print on the first display
     CameraDisplay* display = dynamic_cast<CameraDisplay*>(displays_.at(cameraIndex));
+
+    // if the GUI is late, skip the frame when a newer one is already queued
+    int numPending = __sync_sub_and_fetch(&numPendingFrames_[cameraIndex], 1);
+    if (numPending > 0 && !display->isDisplayOverdue()) {
+        display->skipFrame();
+        return;
+    }
     display->displayFrame(frame);
 }
 
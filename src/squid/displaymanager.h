@@ -30,6 +30,7 @@
 
 #include "cameradisplay.h"
 #include <vector>
+#include <string>
 #include <QObject>
 
 //! Graphical interface of sQuid.
@@ -51,6 +52,8 @@ private:
     std::vector<CameraDisplay*> displays_;
     /** Number of displays is the number of sub-experiments. */
     unsigned int numDisplays_;
+    /** Number of frames captured but not yet received by each display (updated atomically). */
+    int* numPendingFrames_;
 
 public:
 
@@ -59,9 +62,16 @@ public:
     /** Destructor. */
     ~DisplayManager();
 
+    /** Resets the frame counters and latencies of all displays. */
+    void resetStatistics();
+    /** Returns the frame counters and latencies of all displays (one line per display). */
+    std::string getStatistics();
+
 public slots:
 
-    /** Displays the frame on a display. */
+    /** Counts the frames captured (must be connected with Qt::DirectConnection). */
+    void countFrame(dc1394video_frame_t* frame, unsigned int cameraIndex = 0, unsigned int us = 0, bool saveFrame = false);
+    /** Displays the frame on a display, unless a newer frame is already pending. */
     void displayFrame(dc1394video_frame_t* frame, unsigned int cameraIndex = 0, unsigned int us = 0, bool saveFrame = false);
 
     /** Shows all displays. */
@@ -0,0 +1,438 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "playbackdialog.h"
+#include "squidsettings.h"
+#include "myutility.h"
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QPixmap>
+#include <glog/logging.h>
+
+using namespace squid;
+using namespace qsquid;
+
+/** Playback speeds proposed. */
+static const double speeds[] = {0.1, 0.25, 0.5, 1., 2., 4., 8., 16.};
+/** Number of playback speeds. */
+static const unsigned int numSpeeds = sizeof(speeds) / sizeof(speeds[0]);
+/** Index of the real time speed. */
+static const unsigned int realTimeSpeedIndex = 3;
+
+// ======================================================================
+// PRIVATE METHODS
+
+void PlaybackDialog::initialize() {
+
+    setWindowTitle("sQuid Playback");
+    setWindowIcon(SquidSettings::getInstance()->getApplicationWindowIcon());
+
+    openButton_ = new QPushButton("Open...");
+    playButton_ = new QPushButton("Play");
+    playButton_->setCheckable(true);
+    previousButton_ = new QPushButton("<");
+    previousButton_->setToolTip("Previous frame");
+    nextButton_ = new QPushButton(">");
+    nextButton_->setToolTip("Next frame");
+
+    speedCombo_ = new QComboBox();
+    for (unsigned int i = 0; i < numSpeeds; i++)
+        speedCombo_->addItem(QString::number(speeds[i]) + "x");
+    speedCombo_->setCurrentIndex(realTimeSpeedIndex);
+
+    stateCombo_ = new QComboBox();
+    stateCombo_->setToolTip("Go to playlist state");
+    stateCombo_->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+
+    triggerSpinBox_ = new QSpinBox();
+    triggerSpinBox_->setToolTip("Go to trigger id");
+    triggerSpinBox_->setRange(0, 0);
+    triggerSpinBox_->setEnabled(false);
+
+    timeSlider_ = new QSlider(Qt::Horizontal);
+    timeSlider_->setRange(0, 0);
+    timeLabel_ = new QLabel("00:00:00.000");
+    cacheLabel_ = new QLabel("");
+
+    QHBoxLayout* topLayout = new QHBoxLayout();
+    topLayout->addWidget(openButton_);
+    topLayout->addWidget(new QLabel("State:"));
+    topLayout->addWidget(stateCombo_);
+    topLayout->addWidget(new QLabel("Trigger:"));
+    topLayout->addWidget(triggerSpinBox_);
+    topLayout->addStretch();
+    topLayout->addWidget(cacheLabel_);
+
+    framesLayout_ = new QGridLayout();
+
+    QHBoxLayout* bottomLayout = new QHBoxLayout();
+    bottomLayout->addWidget(previousButton_);
+    bottomLayout->addWidget(playButton_);
+    bottomLayout->addWidget(nextButton_);
+    bottomLayout->addWidget(speedCombo_);
+    bottomLayout->addWidget(timeSlider_, 1);
+    bottomLayout->addWidget(timeLabel_);
+
+    QVBoxLayout* layout = new QVBoxLayout();
+    layout->addLayout(topLayout);
+    layout->addLayout(framesLayout_, 1);
+    layout->addLayout(bottomLayout);
+    setLayout(layout);
+
+    timeInMs_ = 0.;
+    speed_ = 1.;
+    prefetchDepth_ = 50;
+
+    connect(openButton_, SIGNAL(clicked()), this, SLOT(openRecording()));
+    connect(playButton_, SIGNAL(toggled(bool)), this, SLOT(play(bool)));
+    connect(previousButton_, SIGNAL(clicked()), this, SLOT(previousFrame()));
+    connect(nextButton_, SIGNAL(clicked()), this, SLOT(nextFrame()));
+    connect(speedCombo_, SIGNAL(currentIndexChanged(int)), this, SLOT(changeSpeed(int)));
+    connect(stateCombo_, SIGNAL(activated(int)), this, SLOT(jumpToState(int)));
+    connect(triggerSpinBox_, SIGNAL(valueChanged(int)), this, SLOT(jumpToTrigger(int)));
+    connect(timeSlider_, SIGNAL(sliderMoved(int)), this, SLOT(setTimeInMs(int)));
+    connect(&timer_, SIGNAL(timeout()), this, SLOT(refresh()));
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::setupFrameLabels() {
+
+    for (unsigned int i = 0; i < frameLabels_.size(); i++)
+        delete frameLabels_.at(i);
+    frameLabels_.clear();
+    currentFrames_.clear();
+
+    const unsigned int numCameras = recording_.getNumCameras();
+    const unsigned int numColumns = (unsigned int)ceil(sqrt((double)numCameras));
+    for (unsigned int i = 0; i < numCameras; i++) {
+        QLabel* label = new QLabel();
+        label->setMinimumSize(320, 240);
+        label->setAlignment(Qt::AlignCenter);
+        label->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+        label->setToolTip(QString::fromStdString(recording_.getCameraName(i)));
+        framesLayout_->addWidget(label, i / numColumns, i % numColumns);
+        frameLabels_.push_back(label);
+        currentFrames_.push_back(-1);
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::updateFrames() {
+
+    const bool playing = timer_.isActive();
+    QImage image;
+
+    for (unsigned int i = 0; i < frameLabels_.size(); i++) {
+        const int index = recording_.findFrame(i, (unsigned int)timeInMs_);
+        if (index == currentFrames_.at(i))
+            continue;
+        if (index < 0) {
+            frameLabels_.at(i)->clear();
+            currentFrames_.at(i) = index;
+            continue;
+        }
+        const std::string filename = recording_.getFrames(i).at(index).filename_;
+        // while playing, a frame not yet prefetched is skipped rather than
+        // blocking the playback, when scrubbing it is loaded immediately
+        if (!prefetcher_.get(filename, image)) {
+            if (playing)
+                continue;
+            image = prefetcher_.load(filename);
+            if (image.isNull())
+                continue;
+        }
+        QLabel* label = frameLabels_.at(i);
+        label->setPixmap(QPixmap::fromImage(image).scaled(label->size(), Qt::KeepAspectRatio, Qt::FastTransformation));
+        currentFrames_.at(i) = index;
+
+        // keeps the prefetched frames within the cache
+        if (image.numBytes() > 0) {
+            const unsigned long long depth = prefetcher_.getMaxCacheSizeInBytes() / (2ULL * image.numBytes() * frameLabels_.size());
+            prefetchDepth_ = (unsigned int)std::min((unsigned long long)PLAYBACK_MAX_PREFETCH, std::max(1ULL, depth));
+        }
+    }
+    prefetch();
+    updateTime();
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::prefetch() {
+
+    // the window starts at the frame to display now rather than at the last
+    // frame displayed, which stops advancing while frames are skipped
+    std::vector<unsigned int> targets;
+    for (unsigned int i = 0; i < frameLabels_.size(); i++)
+        targets.push_back((unsigned int)std::max(0, recording_.findFrame(i, (unsigned int)timeInMs_)));
+
+    // the next frames of all the cameras, interleaved from the most urgent
+    std::vector<std::string> filenames;
+    for (unsigned int k = 0; k < prefetchDepth_; k++) {
+        for (unsigned int i = 0; i < frameLabels_.size(); i++) {
+            const std::vector<RecordingFrame>& frames = recording_.getFrames(i);
+            const unsigned int index = targets.at(i) + k;
+            if (index < frames.size())
+                filenames.push_back(frames.at(index).filename_);
+        }
+    }
+    prefetcher_.prefetch(filenames);
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::updateTime() {
+
+    unsigned int h, min, s, ms;
+    char buffer[20];
+    formatTimeInMs((unsigned int)timeInMs_, h, min, s, ms);
+    sprintf(buffer, "%02d:%02d:%02d.%03d", h, min, s, ms);
+    timeLabel_->setText(buffer);
+
+    if (!timeSlider_->isSliderDown())
+        timeSlider_->setValue((int)timeInMs_);
+
+    std::stringstream cache;
+    cache << "Cache: " << prefetcher_.getCacheSizeInBytes() / (1024 * 1024) << " MB, hits: " << (int)(100 * prefetcher_.getHitRatio()) << "%";
+    cacheLabel_->setText(cache.str().c_str());
+
+    // selects the current playlist state
+    int state = -1;
+    for (unsigned int i = 0; i < stateTimes_.size() && stateTimes_.at(i) <= timeInMs_; i++)
+        state = i;
+    if (state >= 0 && stateCombo_->currentIndex() != state)
+        stateCombo_->setCurrentIndex(state);
+
+    // shows the last trigger of the frames displayed without moving the playback
+    int trigger = -1;
+    for (unsigned int i = 0; i < currentFrames_.size(); i++) {
+        if (currentFrames_.at(i) >= 0)
+            trigger = std::max(trigger, recording_.getFrames(i).at(currentFrames_.at(i)).triggerId_);
+    }
+    if (trigger >= 0 && triggerSpinBox_->value() != trigger) {
+        triggerSpinBox_->blockSignals(true);
+        triggerSpinBox_->setValue(trigger);
+        triggerSpinBox_->blockSignals(false);
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::closeEvent(QCloseEvent*) {
+
+    play(false);
+    prefetcher_.clear();
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+PlaybackDialog::PlaybackDialog(QWidget* parent) : QDialog(parent) {
+
+    initialize();
+    prefetcher_.start();
+}
+
+// ----------------------------------------------------------------------
+
+PlaybackDialog::~PlaybackDialog() {
+
+    timer_.stop();
+    prefetcher_.stop();
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::openRecording(std::string folder) throw(MyException*) {
+
+    play(false);
+    prefetcher_.clear();
+    recording_.open(folder);
+
+    setWindowTitle(QString::fromStdString("sQuid Playback - " + folder));
+    setupFrameLabels();
+
+    std::vector<std::string> states;
+    recording_.getStateChanges(stateTimes_, states);
+    stateCombo_->clear();
+    for (unsigned int i = 0; i < states.size(); i++) {
+        std::stringstream item;
+        item << (i + 1) << ": " << (states.at(i).empty() ? "(no pin)" : states.at(i).substr(1));
+        stateCombo_->addItem(item.str().c_str());
+    }
+
+    int firstTrigger = 0, lastTrigger = 0;
+    const bool triggers = recording_.getTriggerRange(firstTrigger, lastTrigger);
+    triggerSpinBox_->blockSignals(true);
+    triggerSpinBox_->setRange(firstTrigger, lastTrigger);
+    triggerSpinBox_->blockSignals(false);
+    triggerSpinBox_->setEnabled(triggers);
+
+    timeSlider_->setRange(0, recording_.getDurationInMs());
+    timeInMs_ = 0.;
+    updateFrames();
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::openRecording() {
+
+    QString folder = QFileDialog::getExistingDirectory(this, tr("Open Experiment Folder"), SquidSettings::getInstance()->getWorkingDirectory().c_str());
+
+    if (folder.isEmpty())
+        return;
+
+    try {
+        openRecording(folder.toStdString());
+
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to open recording: " << e->getMessage();
+        QMessageBox msgBox;
+        msgBox.setWindowTitle("sQuid message");
+        msgBox.setText("Unable to open recording.");
+        msgBox.setInformativeText((char*) e->what());
+        msgBox.setIcon(QMessageBox::Warning);
+        msgBox.exec();
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::play(bool play) {
+
+    if (play && recording_.getNumCameras() > 0) {
+        if (timeInMs_ >= recording_.getDurationInMs())
+            timeInMs_ = 0.;
+        clock_.start();
+        timer_.start(PLAYBACK_REFRESH_INTERVAL);
+    } else
+        timer_.stop();
+
+    playButton_->setChecked(timer_.isActive());
+    playButton_->setText(timer_.isActive() ? "Pause" : "Play");
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::refresh() {
+
+    // advances by the time really elapsed so that the speed doesn't depend on the refresh rate
+    timeInMs_ += clock_.restart() * speed_;
+
+    const double duration = recording_.getDurationInMs();
+    if (timeInMs_ >= duration) {
+        timeInMs_ = duration;
+        play(false);
+    }
+    updateFrames();
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::setTimeInMs(int timeInMs) {
+
+    timeInMs_ = timeInMs;
+    updateFrames();
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::changeSpeed(int index) {
+
+    if (index >= 0 && index < (int)numSpeeds)
+        speed_ = speeds[index];
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::jumpToState(int index) {
+
+    if (index >= 0 && index < (int)stateTimes_.size())
+        setTimeInMs(stateTimes_.at(index));
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::jumpToTrigger(int triggerId) {
+
+    play(false);
+
+    // latest frame of all the cameras exposed by the trigger
+    int time = -1;
+    for (unsigned int i = 0; i < frameLabels_.size(); i++) {
+        const int index = recording_.findFrameByTrigger(i, triggerId);
+        if (index >= 0)
+            time = std::max(time, (int)recording_.getFrames(i).at(index).timeInMs_);
+    }
+    if (time >= 0)
+        setTimeInMs(time);
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::previousFrame() {
+
+    play(false);
+
+    // latest frame of all the cameras grabbed before the current time
+    int time = -1;
+    for (unsigned int i = 0; i < frameLabels_.size(); i++) {
+        const int index = recording_.findFrame(i, (unsigned int)timeInMs_);
+        const std::vector<RecordingFrame>& frames = recording_.getFrames(i);
+        int j = index;
+        while (j >= 0 && frames.at(j).timeInMs_ >= (unsigned int)timeInMs_)
+            j--;
+        if (j >= 0)
+            time = std::max(time, (int)frames.at(j).timeInMs_);
+    }
+    if (time >= 0)
+        setTimeInMs(time);
+}
+
+// ----------------------------------------------------------------------
+
+void PlaybackDialog::nextFrame() {
+
+    play(false);
+
+    // earliest frame of all the cameras grabbed after the current time
+    int time = -1;
+    for (unsigned int i = 0; i < frameLabels_.size(); i++) {
+        const unsigned int index = recording_.findFrame(i, (unsigned int)timeInMs_) + 1;
+        const std::vector<RecordingFrame>& frames = recording_.getFrames(i);
+        if (index < frames.size() && (time < 0 || (int)frames.at(index).timeInMs_ < time))
+            time = frames.at(index).timeInMs_;
+    }
+    if (time >= 0)
+        setTimeInMs(time);
+}
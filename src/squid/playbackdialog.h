@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef PLAYBACKDIALOG_H
+#define PLAYBACKDIALOG_H
+
+#include "recording.h"
+#include "frameprefetcher.h"
+#include <vector>
+#include <QtGui/QDialog>
+#include <QLabel>
+#include <QPushButton>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QSlider>
+#include <QGridLayout>
+#include <QTimer>
+#include <QTime>
+
+/** Interval in ms between two refreshments of the playback. */
+#define PLAYBACK_REFRESH_INTERVAL 40
+/** Max number of frames prefetched per camera. */
+#define PLAYBACK_MAX_PREFETCH 200
+
+//! Graphical interface of sQuid.
+namespace qsquid {
+
+/**
+ * \brief Implements a dialog to play back the frames saved by an experiment.
+ *
+ * The frames of all the cameras are displayed in sync with a single playback
+ * clock, each camera showing its last frame grabbed at or before the current
+ * time. The playback can be scrubbed by time, stepped frame by frame or moved
+ * to the beginning of a playlist state or to the frames of a trigger id. The frames needed next are loaded in
+ * background by a FramePrefetcher.
+ *
+ * @version March 7, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class PlaybackDialog : public QDialog {
+
+    Q_OBJECT
+
+private:
+
+    /** Index of the frames of the recording. */
+    squid::Recording recording_;
+    /** Background loader and cache of the frames. */
+    squid::FramePrefetcher prefetcher_;
+
+    /** Button to open a recording. */
+    QPushButton* openButton_;
+    /** Button to play/pause the playback. */
+    QPushButton* playButton_;
+    /** Button to go to the previous frame. */
+    QPushButton* previousButton_;
+    /** Button to go to the next frame. */
+    QPushButton* nextButton_;
+    /** Playback speed. */
+    QComboBox* speedCombo_;
+    /** Playlist states of the recording. */
+    QComboBox* stateCombo_;
+    /** Trigger id of the frames displayed (disabled if the recording has no trigger ids). */
+    QSpinBox* triggerSpinBox_;
+    /** Slider to scrub by time. */
+    QSlider* timeSlider_;
+    /** Current time. */
+    QLabel* timeLabel_;
+    /** Cache information. */
+    QLabel* cacheLabel_;
+    /** Layout of the frame labels. */
+    QGridLayout* framesLayout_;
+    /** One label per camera. */
+    std::vector<QLabel*> frameLabels_;
+    /** Index of the frame displayed for each camera (-1 if none). */
+    std::vector<int> currentFrames_;
+
+    /** Timer refreshing the playback. */
+    QTimer timer_;
+    /** Measures the time elapsed between two refreshments. */
+    QTime clock_;
+    /** Current playback time in ms. */
+    double timeInMs_;
+    /** Playback speed (1 = real time). */
+    double speed_;
+    /** Number of frames prefetched per camera. */
+    unsigned int prefetchDepth_;
+
+    /** Times at which the playlist state changes. */
+    std::vector<unsigned int> stateTimes_;
+
+public:
+
+    /** Constructor. */
+    PlaybackDialog(QWidget* parent = 0);
+    /** Destructor. */
+    ~PlaybackDialog();
+
+    /** Opens the given experiment (or camera) folder. */
+    void openRecording(std::string folder) throw(MyException*);
+
+public slots:
+
+    /** Opens a dialog to select the folder to play back. */
+    void openRecording();
+    /** Starts or pauses the playback. */
+    void play(bool play);
+    /** Advances the playback (called by the timer). */
+    void refresh();
+    /** Moves the playback to the given time. */
+    void setTimeInMs(int timeInMs);
+    /** Changes the playback speed. */
+    void changeSpeed(int index);
+    /** Moves the playback to the beginning of the given playlist state. */
+    void jumpToState(int index);
+    /** Moves the playback to the frames exposed by the given trigger (or the last trigger before). */
+    void jumpToTrigger(int triggerId);
+    /** Moves the playback to the previous frame. */
+    void previousFrame();
+    /** Moves the playback to the next frame. */
+    void nextFrame();
+
+private:
+
+    /** Builds the widgets of the dialog. */
+    void initialize();
+    /** Creates one label per camera of the recording. */
+    void setupFrameLabels();
+    /** Displays the frames at the current time and prefetches the next ones. */
+    void updateFrames();
+    /** Requests the frames following the current ones. */
+    void prefetch();
+    /** Updates the time label and slider. */
+    void updateTime();
+    /** Called when the dialog is closed. */
+    void closeEvent(QCloseEvent*);
+};
+
+}
+
+#endif // PLAYBACKDIALOG_H
@@ -30,6 +30,7 @@
 #include "about.h"
 #include "squidsettings.h"
 #include "aoidialog.h"
+#include "playbackdialog.h"
 #include "myutility.h"
 #include "dc1394utility.h"
 #include "global.h"
@@ -40,6 +41,8 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <cstdio>
+#include <algorithm>
 #include <QString>
 #include <QFileDialog>
 #include <QListWidgetItem>
@@ -72,6 +75,7 @@ void Squid::initialize() throw(MyException*) {
 
     aoiAction_ = NULL;
     dmanager_ = NULL;
+    previewServer_ = NULL;
     experiment_ = NULL;
 
     importSettings();
@@ -199,8 +203,9 @@ void Squid::buildCameraResolutionSubMenu() {
         a->setCheckable(true);
 
         // among all the resolutions supported by the camera, discards:
-        // TODO: YUV, MONO16 and RGB images not supported by sQuid (both display and saving images), idem for FORMAT7
-        if (str.find("YUV") != str.npos || str.find("MONO16") != str.npos || str.find("RGB") != str.npos || str.find("FORMAT7") != str.npos)
+        // YUV411, YUV444 and FORMAT7 modes (the display handles MONO8, MONO16, YUV422 and RGB8)
+        // only 8-bit frames can be saved, initializeExperiment() refuses the other modes
+        if (str.find("YUV411") != str.npos || str.find("YUV444") != str.npos || str.find("FORMAT7") != str.npos || str.find("EXIF") != str.npos)
             a->setEnabled(false);
         else
             resolutionActionGroup_->addAction(a);
@@ -312,6 +317,7 @@ void Squid::makeConnections() {
     connect(ui_->triggersRadioButton, SIGNAL(clicked()), this, SLOT(changeCameraMode()));
     connect(ui_->holdCameraButton, SIGNAL(clicked()), this, SLOT(holdCamera()));
     connect(ui_->resumeCameraButton, SIGNAL(clicked()), this, SLOT(resumeCamera()));
+    connect(ui_->burstButton, SIGNAL(clicked()), this, SLOT(triggerBurst()));
     // FPS
     connect(cmanager_->getCamera()->getFpsEvaluator(), SIGNAL(fpsUpdated(const float)), this, SLOT(updateFps(const float)));
     // camera parameters
@@ -344,6 +350,7 @@ void Squid::makeConnections() {
     // help menu
     connect(ui_->aboutAction, SIGNAL(triggered()), this, SLOT(displayAbout()));
     connect(ui_->emailAddressAction, SIGNAL(triggered()), this, SLOT(setEmailAddress()));
+    connect(ui_->playbackAction, SIGNAL(triggered()), this, SLOT(displayPlayback()));
 
     connect(ui_->runCameraButton, SIGNAL(toggled(bool)), this, SLOT(runCamera(bool)));
     connect(ui_->runExperimentButton, SIGNAL(clicked()), this, SLOT(runExperiment()));
@@ -400,6 +407,12 @@ void Squid::importSettings() throw(MyException*) {
     // set trigger
     ui_->triggerPeriodSpinBox->setValue(settings->getTriggerPeriod());
     cmanager_->getTriggerManager()->setIntervalInUs(1000 * settings->getTriggerPeriod()); // in us
+    if (settings->getTriggerCatchUpPolicy() > squid::FdTriggerManager::SHIFT)
+        LOG(WARNING) << "Unknown trigger catch-up policy " << settings->getTriggerCatchUpPolicy() << ", using skip.";
+    else
+        cmanager_->getTriggerManager()->setCatchUpPolicy((squid::FdTriggerManager::catchUpPolicy)settings->getTriggerCatchUpPolicy());
+    cmanager_->setTriggerGating(settings->getTriggerGating() != 0);
+    cmanager_->setCycleTimerCorrelation(settings->getCycleTimerCorrelation() != 0);
 
     // WARNING: don't forget to call Dc1394Camera::setupCamera() after having modifying camera settings
     // (included in Squid::changeCamera())
@@ -422,6 +435,7 @@ void Squid::importSettings() throw(MyException*) {
     } else {
         player->loadGlobal(portPlayerFilename);
     }
+    startInputWatcher();
 
     // at this point, experiment instance is NULL
     // -> directly initialize the GUI components controlling experiments
@@ -530,10 +544,18 @@ Squid::Squid(int argc, char* argv[], QWidget* parent) : QMainWindow(parent), ui_
 
 Squid::~Squid() {
 
+    // the callbacks of the watcher use the player and the cameras
+    try {
+        inputWatcher_.stop();
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to stop input watcher: " << e->getMessage();
+        delete e;
+    }
     delete ui_;
     delete cmanager_;
     delete SquidPlayer::getInstance();
     delete experiment_;
+    delete previewServer_;
     delete resolutionActionGroup_;
     delete fpsActionGroup_;
     delete SquidSettings::getInstance();
@@ -541,6 +563,7 @@ Squid::~Squid() {
     ui_ = NULL;
     cmanager_ = NULL;
     experiment_ = NULL;
+    previewServer_ = NULL;
     resolutionActionGroup_ = NULL;
     fpsActionGroup_ = NULL;
 
@@ -585,6 +608,7 @@ void Squid::updateGui() {
     ui_->camerasCombobox->setCurrentIndex(cmanager_->getCameraIndex());
 
     ui_->cameraModeGroupbox->setEnabled(!cmanager_->isRunning());
+    ui_->burstButton->setEnabled(!b && cmanager_->isRunning());
 
     if (!cmanager_->isRunning()) {
         ui_->resumeCameraButton->setEnabled(false);
@@ -745,9 +769,11 @@ void Squid::runCamera(bool run) {
 
         LOG (INFO) << "Starting display manager for " << cmanager_->getNumActiveCameras() << " camera(s).";
         dmanager_ = new DisplayManager(list);
+        connect(cmanager_, SIGNAL(frameCaptured(dc1394video_frame_t*, unsigned int, unsigned int, bool)), dmanager_, SLOT(countFrame(dc1394video_frame_t*, unsigned int, unsigned int, bool)), Qt::DirectConnection);
         connect(cmanager_, SIGNAL(frameCaptured(dc1394video_frame_t*, unsigned int, unsigned int, bool)), dmanager_, SLOT(displayFrame(dc1394video_frame_t*, unsigned int, unsigned int, bool)));
         connect(ui_->displayAllButton, SIGNAL(clicked()), dmanager_, SLOT(displayAll()));
         connect(ui_->hideAllButton, SIGNAL(clicked()), dmanager_, SLOT(hideAll()));
+        startPreviewServer(list);
 
         // initialization
         cmanager_->setRestart(true);
@@ -756,6 +782,14 @@ void Squid::runCamera(bool run) {
 
         // useful only in trigger mode
         cmanager_->getTriggerManager()->setIntervalInUs(1000 * ui_->triggerPeriodSpinBox->value());
+        setupTriggerSchedules();
+        setupTriggerSequence();
+
+        // pre-arms the DMA buffers so that the frames of a burst wait to be dequeued instead of being dropped
+        unsigned int burstFrames = 0;
+        if (cmanager_->getCameraMode() == CameraManager::SOFTWARE_TRIGGERS)
+            burstFrames = std::max(SquidSettings::getInstance()->getTriggerBurstFrames(), SquidPlayer::getInstance()->getMaxBurstFrames());
+        cmanager_->setNumDmaBuffers(burstFrames);
 
         // start camera
         cmanager_->start(QThread::HighPriority);
@@ -792,11 +826,137 @@ void Squid::stopCameras() {
         delete dmanager_;
         dmanager_ = NULL;
     }
+    // the server keeps running so that the clients stay connected
+    if (previewServer_ != NULL)
+        disconnect(cmanager_, SIGNAL(frameCaptured(dc1394video_frame_t*, unsigned int, unsigned int, bool)), previewServer_, SLOT(pushFrame(dc1394video_frame_t*, unsigned int, unsigned int, bool)));
     cmanager_->setAllCamerasPassive();
 }
 
 // ----------------------------------------------------------------------
 
+void Squid::startPreviewServer(std::vector<std::string> cameraNames) {
+
+    SquidSettings* settings = SquidSettings::getInstance();
+
+    if (!settings->getPreviewServer())
+        return;
+
+    try {
+        if (previewServer_ == NULL) {
+            previewServer_ = new PreviewServer();
+            previewServer_->setAddress(settings->getPreviewServerAddress());
+            previewServer_->setPort(settings->getPreviewServerPort());
+            previewServer_->setMaxFps(settings->getPreviewServerMaxFps());
+            previewServer_->setQuality(settings->getPreviewServerQuality());
+            previewServer_->setDecimation(settings->getPreviewServerDecimation());
+            previewServer_->start();
+        }
+        previewServer_->setCameraNames(cameraNames);
+        // pushFrame() must be executed by the capture thread, before the frame is enqueued
+        connect(cmanager_, SIGNAL(frameCaptured(dc1394video_frame_t*, unsigned int, unsigned int, bool)), previewServer_, SLOT(pushFrame(dc1394video_frame_t*, unsigned int, unsigned int, bool)), Qt::DirectConnection);
+
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to start preview server: " << e->getMessage();
+        delete previewServer_;
+        previewServer_ = NULL;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void Squid::setupTriggerSchedules() {
+
+    squid::FdTriggerManager* tmanager = cmanager_->getTriggerManager();
+    std::string schedules = SquidSettings::getInstance()->getTriggerSchedules();
+
+    try {
+        tmanager->setNumChannels(0);
+        if (schedules.empty())
+            return;
+
+        // one "period:phase" token per active camera, in us
+        std::stringstream ss(schedules);
+        std::string token;
+        unsigned int channel = 0;
+        long period, phase;
+        while (ss >> token && channel < cmanager_->getNumActiveCameras()) {
+            if (sscanf(token.c_str(), "%ld:%ld", &period, &phase) != 2)
+                throw new MyException("Invalid trigger schedule " + token + " (expected period:phase in us).");
+            tmanager->setSchedule(channel++, period, phase);
+        }
+        // the remaining cameras use the trigger period
+        for (; channel < cmanager_->getNumActiveCameras(); channel++)
+            tmanager->setSchedule(channel, 0, 0);
+        tmanager->setNumChannels(channel);
+
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to set trigger schedules: " << e->getMessage();
+        tmanager->setNumChannels(0);
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void Squid::setupTriggerSequence() {
+
+    squid::FdTriggerManager* tmanager = cmanager_->getTriggerManager();
+    std::string filename = SquidSettings::getInstance()->getTriggerSequenceFile();
+
+    try {
+        squid::TriggerSequence sequence;
+        if (!filename.empty()) {
+            sequence.load(filename);
+            // by default the sequence loops with the playlist
+            if (sequence.getCycleInUs() == 0)
+                sequence.setCycleInUs(1000 * (uint64_t)SquidPlayer::getInstance()->getPortManager()->getPinPlaylist()->getPlaylistTotalTime());
+
+            // the cameras can't take frames faster than their framerate
+            long minPeriodInUs = 0;
+            for (unsigned int i = 0; i < cmanager_->getNumActiveCameras(); i++) {
+                minPeriodInUs = std::max(minPeriodInUs, (long)dc1394FpsToPeriodInUs(cmanager_->getActiveCamera(i)->getFps()));
+                minPeriodInUs = std::max(minPeriodInUs, (long)cmanager_->getMinSafeTriggerPeriodInUs(i));
+            }
+            sequence.validate(minPeriodInUs);
+            LOG(INFO) << "Trigger sequence " << filename << ": " << sequence.getSummary() << ".";
+        }
+        tmanager->setSequence(sequence);
+
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to use trigger sequence " << filename << ", using the trigger period: " << e->getMessage();
+        tmanager->setSequence(squid::TriggerSequence());
+    }
+    connectTriggerSequence();
+}
+
+// ----------------------------------------------------------------------
+
+void Squid::connectTriggerSequence() {
+
+    squid::FdTriggerManager* tmanager = cmanager_->getTriggerManager();
+    portplayer::BooleanPlaylist* playlist = SquidPlayer::getInstance()->getPortManager()->getPinPlaylist();
+    if (playlist->isRunning())
+        return;
+
+    if (tmanager->getSequence()->isEmpty())
+        playlist->setCycleCallback(NULL, NULL);
+    else
+        playlist->setCycleCallback(&squid::FdTriggerManager::syncSequenceCallback, tmanager);
+
+    // the states of a playlist in frames are paced by the trigger thread
+    try {
+        if (playlist->isFrameLocked()) {
+            if (cmanager_->getCameraMode() != CameraManager::SOFTWARE_TRIGGERS)
+                LOG(WARNING) << "The playlist is in frames but the cameras are not software triggered: the playlist will not move.";
+            tmanager->setLockCallback(&portplayer::BooleanPlaylist::lockToTrigger, playlist, SquidSettings::getInstance()->getFrameLockLeadTime());
+        } else
+            tmanager->setLockCallback(NULL, NULL, 0);
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to lock the playlist to the triggers: " << e->getMessage();
+    }
+}
+
+// ----------------------------------------------------------------------
+
 void Squid::updateFps(const float fps) {
 
     std::ostringstream buffer;
@@ -804,6 +964,29 @@ void Squid::updateFps(const float fps) {
     buffer << "FPS: ";
     buffer << std::setprecision(2) << fps;
     ui_->fpsLabel->setText(buffer.str().c_str());
+
+    // live trigger timing (median/99th percentile/max)
+    squid::FdTriggerManager* tmanager = cmanager_->getTriggerManager();
+    if (cmanager_->getCameraMode() == squid::CameraManager::SOFTWARE_TRIGGERS && tmanager->isRunning()) {
+        std::stringstream ss;
+        ss << "Trigger latency: " << tmanager->getLatencyHistogram()->getShortSummary();
+        ss << "  Interval: " << tmanager->getIntervalHistogram()->getShortSummary();
+        ss << "  Overruns: " << tmanager->getNumOverruns();
+        if (tmanager->getNumBursts() > 0)
+            ss << "  Bursts: " << tmanager->getNumBursts();
+        if (cmanager_->getTriggerGating()) {
+            unsigned long refused = 0;
+            unsigned int safePeriod = 0;
+            for (unsigned int i = 0; i < cmanager_->getNumActiveCameras(); i++) {
+                refused += cmanager_->getNumRefusedTriggers(i);
+                safePeriod = std::max(safePeriod, cmanager_->getMinSafeTriggerPeriodInUs(i));
+            }
+            ss << "  Refused: " << refused;
+            if (safePeriod > 0)
+                ss << "  Min. safe period: " << safePeriod / 1000. << " ms";
+        }
+        ui_->statusBar->showMessage(ss.str().c_str());
+    }
 }
 
 // ----------------------------------------------------------------------
@@ -816,8 +999,103 @@ void Squid::playerStateChanged(const unsigned int currentState) {
     Experiment* experiment = SquidSettings::getInstance()->getSquid()->getExperiment();
     if (experiment != NULL)
         experiment->setFrameSuffix(player->getStateKeys(currentState));
-    // specify if the frames must be saved since now on
+    // specify if the frames must be saved since now on (frame-locked playlists are
+    // saved according to the trigger of each frame, see saveFrame())
     CameraManager::getInstance()->setSaveFrame(player->getSave(currentState));
+    // capture the burst of the state (if any)
+    const unsigned int burstFrames = player->getBurstFrames(currentState);
+    if (burstFrames > 0)
+        SquidSettings::getInstance()->getSquid()->triggerBurst(burstFrames, player->getBurstIntervalInUs(currentState));
+}
+
+// ----------------------------------------------------------------------
+
+void Squid::triggerBurst() {
+
+    triggerBurst(SquidSettings::getInstance()->getTriggerBurstFrames(), 0);
+}
+
+// ----------------------------------------------------------------------
+
+bool Squid::triggerBurst(unsigned int numFrames, long intervalInUs) {
+
+    squid::FdTriggerManager* tmanager = cmanager_->getTriggerManager();
+    if (cmanager_->getCameraMode() != CameraManager::SOFTWARE_TRIGGERS || !tmanager->isRunning()) {
+        LOG(WARNING) << "Unable to trigger burst: Software triggers are not running.";
+        return false;
+    }
+    if (intervalInUs <= 0)
+        intervalInUs = SquidSettings::getInstance()->getTriggerBurstInterval();
+
+    // the frame writer takes the frames of the burst without reallocating its stack
+    if (experiment_ != NULL && experiment_->isRunning())
+        experiment_->prepareBurst(numFrames * cmanager_->getNumActiveCameras());
+
+    try {
+        LOG(INFO) << "Triggering burst of " << numFrames << " frames every " << intervalInUs << " us.";
+        return tmanager->triggerBurst(numFrames, intervalInUs);
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to trigger burst: " << e->getMessage();
+        return false;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void Squid::startInputWatcher() {
+
+    SquidSettings* settings = SquidSettings::getInstance();
+    const std::string device = settings->getExternalInputDevice();
+    if (device.empty())
+        return;
+
+    try {
+        inputWatcher_.stop();
+        inputWatcher_.clearCallbacks();
+        // the edges are timestamped on the same clock as the frames
+        inputWatcher_.setClock(ExperimentTime::getInstance()->getClock());
+        inputWatcher_.addCallback(&Squid::externalInputCallback, this);
+        inputWatcher_.start(device, settings->getExternalInputLine());
+        SquidPlayer::getInstance()->setInputWatcher(&inputWatcher_);
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to watch external input: " << e->getMessage();
+        delete e;
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void Squid::externalInputCallback(void* obj, const portplayer::InputEvent& event) {
+
+    Squid* squid = reinterpret_cast<Squid*>(obj);
+
+    switch (SquidSettings::getInstance()->getExternalInputAction()) {
+    case 0: {
+        // only applied if the player is in REMOTE mode
+        portplayer::IOPinManager* manager = SquidPlayer::getInstance()->getPortManager();
+        if (manager != NULL)
+            portplayer::IOPinManager::remoteStateCallback(manager, event);
+        break;
+    }
+    case 1: {
+        // the request is handled by the RT thread of the trigger manager
+        squid::FdTriggerManager* tmanager = squid->cmanager_->getTriggerManager();
+        try {
+            tmanager->triggerBurst(SquidSettings::getInstance()->getTriggerBurstFrames(), SquidSettings::getInstance()->getTriggerBurstInterval());
+        } catch (MyException* e) {
+            LOG(WARNING) << "Unable to trigger burst on external input: " << e->getMessage();
+            delete e;
+        }
+        break;
+    }
+    case 2:
+        // the flag is set without lock, the watcher thread never waits for the capture thread
+        if (ExperimentTime::getInstance()->getClock()->isRunning() && !squid->cmanager_->getSaveFrame())
+            squid->cmanager_->setSaveFrame(true);
+        break;
+    default:
+        break;
+    }
 }
 
 // ----------------------------------------------------------------------
@@ -827,6 +1105,13 @@ void Squid::initializeExperiment() {
     if (experiment_ != NULL && experiment_->isRunning())
         throw new MyException("The experiment " + experiment_->getName() + " is still running. First stop this experiment before starting a new one.");
 
+    // the frame writer only saves 8-bit frames (MONO8 and RAW8)
+    for (unsigned int i = 0; i < (unsigned int)cmanager_->getNumCameras(); i++) {
+        Dc1394Camera* camera = cmanager_->getCamera(i);
+        if (!camera->canSaveFrames())
+            throw new MyException("The frames of camera " + camera->getCameraNameAndGuid() + " can not be saved in video mode " + dc1394ToSringResolution(camera->getResolution()) + ". Select a MONO8 resolution before running an experiment.");
+    }
+
     experiment_ = new Experiment();
     experiment_->setName(ui_->experimentNameEdit->text().toStdString());
 
@@ -841,6 +1126,15 @@ void Squid::initializeExperiment() {
     // set the experiment duration mode, either MANUAL (user must click on the Stop button to stop experiment)
     // or SPECIFIED (the experiment stops when the specified time is elapsed)
     SquidPlayer* player = SquidPlayer::getInstance();
+
+    // saveFrame() reads these copies rather than the table of the player for each frame
+    const unsigned int numStates = player->getPortManager()->getPinPlaylist()->getNumStates();
+    stateSaves_.assign(numStates, false);
+    stateKeys_.assign(numStates, "");
+    for (unsigned int i = 0; i < numStates; i++) {
+        stateSaves_[i] = player->getSave(i);
+        stateKeys_[i] = player->getStateKeys(i);
+    }
     experimentProgressBar_.setTimeInMs(0);
     if (ui_->manualDurationRadioButton->isChecked()) {
         experiment_->setDurationMode(Experiment::MANUAL);
@@ -900,10 +1194,33 @@ void Squid::runExperiment() {
         ui_->stopExperimentButton->setEnabled(true);
 
         initializeExperiment();
+        if (dmanager_ != NULL)
+            dmanager_->resetStatistics();
+        cmanager_->getTriggerManager()->resetTimingStatistics();
+        experiment_->start();
+        // the frame writer takes the bursts triggered by the external input without reallocating its stack
+        if (inputWatcher_.isRunning() && SquidSettings::getInstance()->getExternalInputAction() == 1)
+            experiment_->prepareBurst(SquidSettings::getInstance()->getTriggerBurstFrames() * cmanager_->getNumActiveCameras());
+        // log the accesses to the port on the experiment clock (time_us of the frames)
+        if (SquidSettings::getInstance()->getPortEventLog()) {
+            try {
+                portEventLog_.open(experiment_->getFolder() + "/" + PORT_EVENT_LOG_FILENAME, ExperimentTime::getInstance()->getClock());
+                SquidPlayer::getInstance()->getPortManager()->setEventLog(&portEventLog_);
+                inputWatcher_.setEventLog(&portEventLog_);
+            } catch (MyException* e) {
+                LOG(WARNING) << "Unable to log the accesses to the port: " << e->getMessage();
+                delete e;
+            }
+        }
         // start the player if 1) player is selected in the app and 2) playlist is selected in the player
-        if (ui_->sequenceDoneRadioButton->isChecked() && SquidPlayer::getInstance()->getPortManager()->getMode() == portplayer::IOPinManager::PLAYLIST)
+        // the player then reads the experiment clock so that both share the same time and pauses
+        if (ui_->sequenceDoneRadioButton->isChecked() && SquidPlayer::getInstance()->getPortManager()->getMode() == portplayer::IOPinManager::PLAYLIST) {
+            portplayer::BooleanPlaylist* playlist = SquidPlayer::getInstance()->getPortManager()->getPinPlaylist();
+            if (!playlist->isRunning())
+                playlist->setClock(ExperimentTime::getInstance()->getClock());
+            connectTriggerSequence();
             SquidPlayer::getInstance()->startPlaylist();
-        experiment_->start();
+        }
 
     } catch (boost::filesystem::filesystem_error& e) {
         LOG(INFO) << "Unable to run experiment: " << e.what();
@@ -959,12 +1276,31 @@ void Squid::stopExperiment() {
         LOG(INFO) << "Turning off player.";
         SquidPlayer::getInstance()->turnOff();
         SquidPlayer::getInstance()->setPostNextStateAction((qportplayer::pfv) &qportplayer::QPortPlayerDialog::defaultPostNextStateAction);
+        if (!SquidPlayer::getInstance()->getPortManager()->getPinPlaylist()->isRunning())
+            SquidPlayer::getInstance()->getPortManager()->getPinPlaylist()->setClock(NULL);
+
+        // close and convert the log of the accesses to the port
+        if (portEventLog_.isOpen()) {
+            try {
+                SquidPlayer::getInstance()->getPortManager()->setEventLog(NULL);
+                inputWatcher_.setEventLog(NULL);
+                portEventLog_.close();
+                LOG(INFO) << "Port event log: " << portEventLog_.getNumEvents() << " events written to " << experiment_->getFolder() << "/" << PORT_EVENT_LOG_FILENAME;
+                portplayer::PortEventLog::convertToCsv(experiment_->getFolder() + "/" + PORT_EVENT_LOG_FILENAME, experiment_->getFolder() + "/" + PORT_EVENT_CSV_FILENAME);
+            } catch (MyException* e) {
+                LOG(WARNING) << "Unable to save port event log: " << e->getMessage();
+                errors += "Unable to save port event log\n";
+                delete e;
+            }
+        }
 
         // write report to file
         std::string reportContent = "";
         try {
             LOG(INFO) << "Writing report to " << experiment_->getFolder() << "/" << REPORT_FILENAME;
             experiment_->setDescription(ui_->experimentDescriptionEdit->toPlainText().toStdString());
+            if (dmanager_ != NULL)
+                experiment_->setDisplayStatistics(dmanager_->getStatistics());
             reportContent = experiment_->saveDescription();
         } catch (std::exception* e) {
             LOG(WARNING) << "Unable to save experiment report: " << e->what();
@@ -1042,7 +1378,21 @@ void Squid::stopExperiment() {
 
 void Squid::saveFrame(dc1394video_frame_t* frame, unsigned int cameraIndex, unsigned int us, bool saveFrame) {
 
-    if (experiment_ != NULL && saveFrame)
+    if (experiment_ == NULL)
+        return;
+
+    // the frame of a frame-locked playlist is saved according to the state at its trigger:
+    // the flag switched by playerStateChanged() is late by the frames already in the pipeline
+    portplayer::BooleanPlaylist* playlist = SquidPlayer::getInstance()->getPortManager()->getPinPlaylist();
+    const int triggerId = cmanager_->getFrameMetadata(cameraIndex, frame).triggerId_;
+    unsigned int state;
+    if (playlist->isFrameLocked() && triggerId >= 0 && playlist->getStateAtFrame(triggerId, state) && state < stateSaves_.size()) {
+        if (stateSaves_[state])
+            experiment_->saveFrame(frame, cameraIndex, us, stateKeys_[state]);
+        return;
+    }
+
+    if (saveFrame)
         experiment_->saveFrame(frame, cameraIndex, us);
 }
 
@@ -1229,6 +1579,24 @@ void Squid::displayAbout() {
 
 // ----------------------------------------------------------------------
 
+void Squid::displayPlayback() {
+
+    PlaybackDialog* playback = new PlaybackDialog(this);
+    playback->setAttribute(Qt::WA_DeleteOnClose);
+    playback->show();
+
+    // opens the last experiment (if any)
+    if (experiment_ != NULL && !experiment_->isRunning() && !experiment_->getFolder().empty()) {
+        try {
+            playback->openRecording(experiment_->getFolder());
+        } catch (MyException* e) {
+            LOG(INFO) << "Unable to open the last experiment: " << e->getMessage();
+        }
+    }
+}
+
+// ----------------------------------------------------------------------
+
 void Squid::setEmailAddress() {
 
     SquidSettings* settings = SquidSettings::getInstance();
@@ -34,7 +34,11 @@
 #include "enhancedprogressbar.h"
 #include "squidplayer.h"
 #include "fdtriggermanager.h"
+#include "previewserver.h"
+#include "porteventlog.h"
+#include "inputwatcher.h"
 #include <cstring>
+#include <vector>
 #include <QtGui/QMainWindow>
 #include <QListWidget>
 #include <QActionGroup>
@@ -72,11 +76,21 @@ private:
     squid::Experiment* experiment_;
     /** Display manager. */
     DisplayManager* dmanager_;
+    /** HTTP preview server (NULL if disabled). */
+    squid::PreviewServer* previewServer_;
+    /** Log of the accesses to the port of the player during the experiment. */
+    portplayer::PortEventLog portEventLog_;
+    /** Watcher of the external input (edges on the ACK pin of a parallel port or on a GPIO line). */
+    portplayer::InputWatcher inputWatcher_;
+    /** Save flag of each state of the playlist, copied at the start of the experiment. */
+    std::vector<bool> stateSaves_;
+    /** Frame suffix of each state of the playlist, copied at the start of the experiment. */
+    std::vector<std::string> stateKeys_;
 
     /** Enhanced progress bar attached to the experiment progress. */
     qportplayer::EnhancedProgressBar experimentProgressBar_;
 
-    /** Contains the camera resolution supported by sQuid (mainly MONO8 modes). */
+    /** Contains the camera resolution supported by sQuid (MONO8, MONO16, YUV422 and RGB8 modes). */
     QActionGroup* resolutionActionGroup_;
     /** Contains the camera FPS supported by sQuid. */
     QActionGroup* fpsActionGroup_;
@@ -125,6 +139,10 @@ public slots:
     void resumeCamera();
     /** Updates selected camera FPS. */
     void updateFps(const float fps);
+    /** Triggers a burst of frames with the parameters of the settings. */
+    void triggerBurst();
+    /** Triggers a burst of numFrames frames every intervalInUs (0 = interval of the settings). */
+    bool triggerBurst(unsigned int numFrames, long intervalInUs);
 
     /** Initializes experiment. */
     void initializeExperiment();
@@ -153,6 +171,8 @@ public slots:
     void setEmailAddress();
     /** Displays a dialog to set an area of interest. */
     void displayAoiDialog();
+    /** Displays a dialog to play back the frames of an experiment. */
+    void displayPlayback();
 
     /** Opens settings file. */
     void openSettings();
@@ -189,6 +209,19 @@ private:
     /** Connects SIGNALS/SLOTS. */
     void makeConnections() ;
 
+    /** Starts the preview server (if enabled) and connects it to the camera manager. */
+    void startPreviewServer(std::vector<std::string> cameraNames);
+    /** Sets the trigger period and phase of each active camera from the settings. */
+    void setupTriggerSchedules();
+    /** Loads and validates the sequence of trigger times of the settings (if any). */
+    void setupTriggerSequence();
+    /** Makes the sequence of trigger times loop in sync with the playlist and locks a playlist in frames to the triggers. */
+    void connectTriggerSequence();
+    /** Starts watching the external input of the settings (if any). */
+    void startInputWatcher();
+    /** Executes the action of the settings for an external input edge (watcher thread). */
+    static void externalInputCallback(void* obj, const portplayer::InputEvent& event);
+
     /** Updates the settings of the cameras. */
     void updateCameraControllers() throw(MyException*);
 
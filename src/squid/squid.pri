@@ -4,14 +4,16 @@ SOURCES += squid.cpp \
     about.cpp \
     displaymanager.cpp \
     aoidialog.cpp \
-    squidplayer.cpp
+    squidplayer.cpp \
+    playbackdialog.cpp
 HEADERS += squid.h \
     cameradisplay.h \
     squidsettings.h \
     about.h \
     displaymanager.h \
     aoidialog.h \
-    squidplayer.h
+    squidplayer.h \
+    playbackdialog.h
 FORMS += squid.ui \
     cameradisplay.ui \
     about.ui \
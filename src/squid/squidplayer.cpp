@@ -31,8 +31,7 @@
 #include "squidsettings.h"
 #include <QFileDialog>
 #include <QMessageBox>
-#include <QtGui/QComboBox>
-#include <QtGui/QCheckBox>
+#include <algorithm>
 #include <glog/logging.h>
 
 using namespace squid;
@@ -79,12 +78,10 @@ void SquidPlayer::setup() {
     setPinCells();
     setDurationCells();
     setSaveCells();
-//    setCameraCells();
+    setBurstCells();
     setOutputLeds();
     setPlaylistPlayer();
 
-    // get all the camera to fill the comboboxes
-//    setCameras(Settings::getInstance()->getSquid()->getCameraManager());
     loadSaveAndCameraConfiguration(qportplayer::Global::getInstance()->getStates());
 
     ui->editionRadioButton->setChecked(true);
@@ -96,15 +93,17 @@ void SquidPlayer::setup() {
         ui->secRadioButton->setChecked(true);
     else if (unit == 2)
         ui->msecRadioButton->setChecked(true);
+    else if (unit == 3)
+        ui->framesRadioButton->setChecked(true);
 
     // safety
     pManager_->setAllPinsLow();
 
     // adpat dialog size to number of columns
-    const double customWidth = 1 * ui->tableWidget->columnCount();
+    const double customWidth = 1 * playlistModel_->columnCount();
     const QSize qs(customWidth, this->minimumHeight());
     this->resize(qs);
-    ui->tableWidget->horizontalHeader()->setResizeMode(QHeaderView::ResizeToContents);
+    ui->tableView->horizontalHeader()->setResizeMode(QHeaderView::ResizeToContents);
 
     updateGui();
 }
@@ -118,6 +117,8 @@ void SquidPlayer::setPortManager(portplayer::IOPinManager* pManager) {
 
     if (pManager_ != NULL) {
         initialize();
+        // the playlist can be locked to the software triggers of the cameras
+        ui->framesRadioButton->setVisible(true);
         setup();
         connect(ui->repeatSequenceCheckBox, SIGNAL(stateChanged(int)), pManager_->getPinPlaylist(), SLOT(repeatPlaylist(int)));
     }
@@ -129,65 +130,21 @@ void SquidPlayer::setPortManager(portplayer::IOPinManager* pManager) {
 
 void SquidPlayer::setSaveCells() {
 
-    // add one column to the table
-    ui->tableWidget->setColumnCount(ui->tableWidget->columnCount() + 1);
-
-    // set header
-    QTableWidgetItem* header = new QTableWidgetItem();
-    header->setText("Save");
-    const unsigned int n = ui->tableWidget->columnCount() - 1;
-    const unsigned int m = ui->tableWidget->rowCount();
-    ui->tableWidget->setHorizontalHeaderItem(n, header);
-
-    // set content
-    QCheckBox* cb = NULL;
-    for (unsigned int i = 0; i < m; i++) {
-        cb = new QCheckBox();
-        cb->setChecked(true);
-        createCellWidget(i, n, cb);
-    }
+    // add one column to the table (frames saved by default)
+    playlistModel_->addBooleanColumn("Save", true);
 }
 
 // ----------------------------------------------------------------------
 
-void SquidPlayer::setCameraCells() {
-
-    // add one column to the table
-    ui->tableWidget->setColumnCount(ui->tableWidget->columnCount() + 1);
+void SquidPlayer::setBurstCells() {
 
-    // set header
-    QTableWidgetItem* header = new QTableWidgetItem();
-    header->setText("Camera");
-    const unsigned int n = ui->tableWidget->columnCount() - 1;
-    ui->tableWidget->setHorizontalHeaderItem(n, header);
+    const char* headers[2] = {"Burst", "Burst interval"};
+    const int max[2] = {TRIGGER_MAX_BURST_FRAMES, 9999999};
+    const char* suffix[2] = {"", " us"};
 
-    QComboBox* cb = NULL;
-    for (unsigned int i = 0; i < n; i++) {
-        cb = new QComboBox();
-        cb->setSizeAdjustPolicy(QComboBox::AdjustToContents);
-        createCellWidget(i, n, cb);
-    }
-}
-
-// ----------------------------------------------------------------------
-
-void SquidPlayer::setCameras(CameraManager* cameras) {
-
-    QComboBox* combo = NULL;
-    const unsigned int column = ui->tableWidget->columnCount() - 1;
-    const unsigned int numRows = ui->tableWidget->rowCount();
-    const unsigned int numCameras = cameras->getNumCameras();
-    std::string cameraId;
-    QIcon cameraIcon(":/camera");
-
-    for (unsigned int i = 0; i < numRows; i++) {
-        combo = qobject_cast<QComboBox*>(ui->tableWidget->cellWidget(i, column)->layout()->itemAt(0)->widget());
-        for (unsigned int j = 0; j < numCameras; j++) {
-            cameraId = cameras->getCamera(j)->getCameraName() + " (" + cameras->getCamera(j)->getCameraGuid() + ")";
-            combo->addItem(cameraIcon, QString(cameraId.c_str()));
-        }
-        combo->setCurrentIndex(0);
-    }
+    // no burst by default
+    for (unsigned int k = 0; k < 2; k++)
+        playlistModel_->addIntegerColumn(headers[k], 0, max[k], 0, suffix[k], "-");
 }
 
 // ----------------------------------------------------------------------
@@ -254,10 +211,19 @@ void SquidPlayer::importSettings() {
 
     qportplayer::Global* global = qportplayer::Global::getInstance();
 
-    if (pManager_ == NULL)
-        pManager_ = new portplayer::ParallelPortManager();
-
-    pManager_->load(global->getPortDeviceAbsPath(), global->getPins());
+    const std::string portDevice = global->getPortDeviceAbsPath();
+    // the backend is recreated if the device switches between a parallel port and a GPIO chip
+    if (pManager_ == NULL || !pManager_->matchesDevice(portDevice)) {
+        portplayer::IOPinManager* manager = portplayer::IOPinManager::create(portDevice);
+        try {
+            manager->load(portDevice, global->getPins());
+        } catch (MyException* e) {
+            delete manager;
+            throw e;
+        }
+        setPortManager(manager);
+    } else
+        pManager_->load(portDevice, global->getPins());
     // because the sequence is recreated inside load(), we have to reconnect it.
     connect(ui->repeatSequenceCheckBox, SIGNAL(stateChanged(int)), pManager_->getPinPlaylist(), SLOT(repeatPlaylist(int)));
 
@@ -268,6 +234,14 @@ void SquidPlayer::importSettings() {
     pManager_->getPinPlaylist()->loadPlaylist(playlist);
     pManager_->getPinPlaylist()->loadStateDurations(durations);
 
+    try {
+        pManager_->loadPwm(global->getPwmChannels(), global->getPwmDuties());
+    } catch (MyException* e) {
+        LOG(WARNING) << "Unable to load the PWM channels: " << e->getMessage();
+        delete e;
+    }
+    pManager_->compileStates();
+
     setup();
 }
 
@@ -282,40 +256,40 @@ void SquidPlayer::exportSettings() {
     global->setPins(pManager_->save());
 
     std::stringstream text;
-    const unsigned int numStates = ui->tableWidget->rowCount();
+    const unsigned int numStates = playlistModel_->rowCount();
     const unsigned int numPins = pManager_->getNumPins();
     for (unsigned int i = 0; i < numStates; i++) {
         for (unsigned int j = 0; j < numPins; j++) {
-            QCheckBox* box = qobject_cast<QCheckBox*>(ui->tableWidget->cellWidget(i, j)->layout()->itemAt(0)->widget());
-            text << box->isChecked();
+            text << playlistModel_->getValue(i, j);
             text << " ";
         }
 
         // duration
-        QSpinBox* box = qobject_cast<QSpinBox*>(ui->tableWidget->cellWidget(i, numPins)->layout()->itemAt(0)->widget());
-        text << box->value();
+        text << playlistModel_->getValue(i, numPins);
         text << " ";
 
         // save
-        QCheckBox* box2 = qobject_cast<QCheckBox*>(ui->tableWidget->cellWidget(i, numPins + 1)->layout()->itemAt(0)->widget());
-        text << box2->isChecked();
+        text << getSave(i);
         text << " ";
 
-//        // camera
-//        QComboBox* combo = qobject_cast<QComboBox*>(ui->tableWidget->cellWidget(i, numPins + 2)->layout()->itemAt(0)->widget());
-//        text << cmanager->getCamera(combo->currentIndex())->getCameraGuid();
+        // burst
+        text << getBurstFrames(i) << " " << getBurstIntervalInUs(i) << " ";
 
         if (i < numStates - 1)
             text << ";";
     }
     global->setStates(text.str());
+    global->setPwmChannels(pManager_->savePwmChannels());
+    global->setPwmDuties(pManager_->savePwmDuties());
 
     if (ui->minRadioButton->isChecked())
         global->setDurationUnit(0);
     else if (ui->secRadioButton->isChecked())
         global->setDurationUnit(1);
-    else if (ui->msecRadioButton)
+    else if (ui->msecRadioButton->isChecked())
         global->setDurationUnit(2);
+    else if (ui->framesRadioButton->isChecked())
+        global->setDurationUnit(3);
 }
 
 // ----------------------------------------------------------------------
@@ -325,15 +299,17 @@ void SquidPlayer::loadSaveAndCameraConfiguration(const std::string config) {
     if (config.length() == 0)
         return;
 
-    //CameraManager* cmanager = Settings::getInstance()->getSquid()->getCameraManager();
     const unsigned int numPins = pManager_->getNumPins();
-
-    unsigned int value = 0;
-    unsigned int row = 0;
+    const unsigned int numStates = playlistModel_->rowCount();
+    std::vector<int> save(numStates, 1);
+    std::vector<int> frames(numStates, 0);
+    std::vector<int> intervals(numStates, 0);
+
+    // the columns are filled at once rather than cell by cell
+    std::stringstream states(config);
+    std::string substring = "";
     std::string buffer = "";
-    std::string::size_type prev_pos = 0, pos = 0;
-    while((pos = config.find(';', pos)) != std::string::npos) {
-        std::string substring(config.substr(prev_pos, pos-prev_pos));
+    for (unsigned int row = 0; row < numStates && std::getline(states, substring, ';'); row++) {
         std::stringstream ss(substring);
         for (unsigned int i = 0; i < numPins; i++)
             ss >> buffer;
@@ -341,42 +317,46 @@ void SquidPlayer::loadSaveAndCameraConfiguration(const std::string config) {
         ss >> buffer;
 
         // save checkbox
-        QCheckBox* box = qobject_cast<QCheckBox*>(ui->tableWidget->cellWidget(row, numPins + 1)->layout()->itemAt(0)->widget());
-        ss >> value;
-        box->setChecked(value);
+        ss >> save[row];
 
-//        // camera
-//        QComboBox* combo = qobject_cast<QComboBox*>(ui->tableWidget->cellWidget(row, numPins + 2)->layout()->itemAt(0)->widget());
-//        ss >> buffer;
-//        combo->setCurrentIndex(cmanager->getCameraIndex(buffer));
-
-        prev_pos = ++pos;
-        row++;
+        // burst
+        loadBurstConfiguration(ss, frames[row], intervals[row]);
     }
-    std::string substring(config.substr(prev_pos, pos-prev_pos)); // Last word
-    std::stringstream ss(substring);
-    for (unsigned int i = 0; i < numPins; i++)
-        ss >> buffer;
-    // duration
-    ss >> buffer;
-
-    // save checkbox
-    QCheckBox* box = qobject_cast<QCheckBox*>(ui->tableWidget->cellWidget(row, numPins + 1)->layout()->itemAt(0)->widget());
-    ss >> value;
-    box->setChecked(value);
-
-//    // camera
-//    QComboBox* combo = qobject_cast<QComboBox*>(ui->tableWidget->cellWidget(row, numPins + 2)->layout()->itemAt(0)->widget());
-//    ss >> buffer;
-//    combo->setCurrentIndex(cmanager->getCameraIndex(buffer));
+
+    playlistModel_->setColumnValues(numPins + 1, save);
+    playlistModel_->setColumnValues(numPins + 2, frames);
+    playlistModel_->setColumnValues(numPins + 3, intervals);
 }
 
-// ======================================================================
-// GETTERS AND SETTERS
+// ----------------------------------------------------------------------
+
+void SquidPlayer::loadBurstConfiguration(std::stringstream& ss, int& frames, int& intervalInUs) {
+
+    // settings written before the burst columns existed end after "save"
+    int value = 0;
+    if (!(ss >> value))
+        return;
+    frames = value;
+    if (!(ss >> value))
+        return;
+    intervalInUs = value;
+}
+
+// ----------------------------------------------------------------------
+
+unsigned int SquidPlayer::getMaxBurstFrames() {
 
-bool SquidPlayer::getSave(const unsigned int index) {
+    const std::vector<int>& frames = playlistModel_->getColumnValues(pManager_->getNumPins() + 2);
+    int max = 0;
+    for (unsigned int i = 0; i < frames.size(); i++)
+        max = std::max(max, frames[i]);
 
-    const unsigned int saveColumn = ui->tableWidget->columnCount() - 1;
-    QCheckBox* box = qobject_cast<QCheckBox*>(ui->tableWidget->cellWidget(index, saveColumn)->layout()->itemAt(0)->widget());
-    return box->isChecked();
+    return max;
 }
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+bool SquidPlayer::getSave(const unsigned int index) { return playlistModel_->getValue(index, pManager_->getNumPins() + 1) != 0; }
+unsigned int SquidPlayer::getBurstFrames(const unsigned int index) { return playlistModel_->getValue(index, pManager_->getNumPins() + 2); }
+long SquidPlayer::getBurstIntervalInUs(const unsigned int index) { return playlistModel_->getValue(index, pManager_->getNumPins() + 3); }
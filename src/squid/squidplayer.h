@@ -30,6 +30,7 @@
 
 #include "qportplayerdialog.h"
 #include "cameramanager.h"
+#include <sstream>
 
 //! Graphical interface of sQuid.
 namespace qsquid {
@@ -59,18 +60,18 @@ protected:
 
     /** Returns true if the checkbox "save" of the selected state (line of the playlist) is checked. */
     bool getSave(const unsigned int row);
+    /** Returns the number of frames of the burst triggered when entering the state (0 = no burst). */
+    unsigned int getBurstFrames(const unsigned int row);
+    /** Returns the interval in us between two triggers of the burst of the state (0 = default interval). */
+    long getBurstIntervalInUs(const unsigned int row);
+    /** Returns the largest burst of the playlist. */
+    unsigned int getMaxBurstFrames();
 
 public slots:
 
     /** Overrides qportplayer::QPortPlayerDialog::setPortManager() */
     virtual void setPortManager(portplayer::IOPinManager* ppManager);
 
-    /**
-     * Sets the "camera" comboboxes.
-     * @deprecated
-     */
-    void setCameras(squid::CameraManager* cameras);
-
     /** Overrides qportcontrol::QPortControlDialog::loadGlobal(std::string). */
     virtual void loadGlobal(std::string filename);
     /** Overrides qportcontrol::QPortControlDialog::loadGlobal(). */
@@ -91,16 +92,15 @@ private:
     /** Constructor. */
     SquidPlayer(QWidget* parent = 0);
 
-    /** Sets the "save" checkboxes of the playlist. */
+    /** Sets the "save" column of the playlist. */
     void setSaveCells();
-    /**
-     * Sets the "camera" comboboxes of the playlist.
-     * @deprecated
-     */
-    void setCameraCells();
+    /** Sets the "burst" columns of the playlist (number of frames and interval). */
+    void setBurstCells();
 
-    /** Sets the "save" and "camera" columns of the playlist. */
+    /** Sets the "save" and "burst" columns of the playlist. */
     void loadSaveAndCameraConfiguration(const std::string config);
+    /** Reads the "burst" values of a state (keeps the defaults if the configuration has no burst). */
+    void loadBurstConfiguration(std::stringstream& ss, int& frames, int& intervalInUs);
 };
 
 }
@@ -63,13 +63,31 @@ void SquidSettings::initialize() {
     cameraGuid_ = "";
     cameraConfigurations_ = "";
     triggerPeriod_ = 50;
+    triggerCatchUpPolicy_ = 0;
+    triggerSchedules_ = "";
+    triggerGating_ = 0;
+    cycleTimerCorrelation_ = 1;
+    triggerBurstFrames_ = 50;
+    triggerBurstInterval_ = 5000;
+    triggerSequenceFile_ = "";
+    frameLockLeadTime_ = 0;
     playerSettingsFilename_ = "";
+    portEventLog_ = 1;
+    externalInputDevice_ = "";
+    externalInputLine_ = 0;
+    externalInputAction_ = 0;
     experimentName_ = "MyExperiment";
     experimentDurationMode_ = 1;
     experimentDuration_ = 1;
     experimentEmail_ = 1;
     experimentEmailSubjectPrefix_ = "sQuid message";
     outputFormat_ = Dc1394FrameWriter::IMAGE_TIFF;
+    previewServer_ = 0;
+    previewServerAddress_ = "127.0.0.1";
+    previewServerPort_ = 8080;
+    previewServerMaxFps_ = 5;
+    previewServerQuality_ = 75;
+    previewServerDecimation_ = 2;
     stderrLogging_ = 1;
     stderrLoggingSeverity_ = 0;
     fileLogging_ = 0;
@@ -162,9 +180,21 @@ void SquidSettings::parseArguments(int argc, char* argv[]) throw(MyException*) {
             ("cameraGuid", po::value<std::string>(&cameraGuid_), "Guid of the camera to select (if detected)")
             ("cameraConfigurations", po::value<std::string>(&cameraConfigurations_), "Cameras configuration")
             ("triggerPeriod", po::value<unsigned int>(&triggerPeriod_), "Trigger period in milliseconds")
+            ("triggerCatchUpPolicy", po::value<unsigned int>(&triggerCatchUpPolicy_), "Policy applied when trigger deadlines are missed")
+            ("triggerSchedules", po::value<std::string>(&triggerSchedules_), "Trigger period and phase in us of each active camera")
+            ("triggerGating", po::value<int>(&triggerGating_), "Gate the triggers by the WaitingForTrigger signal of the cameras (1=on, 0=off)")
+            ("cycleTimerCorrelation", po::value<int>(&cycleTimerCorrelation_), "Stamp the frames with their capture time derived from the FireWire cycle timer (1=on, 0=off)")
+            ("triggerBurstFrames", po::value<unsigned int>(&triggerBurstFrames_), "Number of frames of the burst triggered from the interface")
+            ("triggerBurstInterval", po::value<unsigned int>(&triggerBurstInterval_), "Interval in us between two triggers of a burst")
+            ("triggerSequenceFile", po::value<std::string>(&triggerSequenceFile_), "File describing the sequence of trigger times played in loop with the playlist")
+            ("frameLockLeadTime", po::value<unsigned int>(&frameLockLeadTime_), "Time in us by which the states of a frame-locked playlist are applied before their trigger")
             // ====================================================================================
             // PARALLEL PORT CONTROLLER
             ("playerSettingsFilename", po::value<std::string>(&playerSettingsFilename_), "Absolute path to the player settings file")
+            ("portEventLog", po::value<int>(&portEventLog_), "Log the accesses to the port during the experiments (1=on, 0=off)")
+            ("externalInputDevice", po::value<std::string>(&externalInputDevice_), "Device watched for external input edges (empty = disabled)")
+            ("externalInputLine", po::value<unsigned int>(&externalInputLine_), "GPIO line watched for external input edges")
+            ("externalInputAction", po::value<int>(&externalInputAction_), "Action of an external input edge (0=next player state, 1=trigger burst, 2=start saving frames)")
             // ====================================================================================
             // EXPERIMENTS
             ("experimentName", po::value<std::string>(&experimentName_), "Experiment name")
@@ -174,6 +204,14 @@ void SquidSettings::parseArguments(int argc, char* argv[]) throw(MyException*) {
             ("experimentEmailSubjectPrefix", po::value<std::string>(&experimentEmailSubjectPrefix_), "Email subject prefix")
             ("outputFormat", po::value<unsigned int>(&outputFormat_), "Image output format (0=IMAGE_PGM, 1=IMAGE_TIFF)")
             // ====================================================================================
+            // PREVIEW SERVER
+            ("previewServer", po::value<int>(&previewServer_), "Enable HTTP preview server (1=on, 0=off)")
+            ("previewServerAddress", po::value<std::string>(&previewServerAddress_), "Address the preview server is bound to (default: 127.0.0.1)")
+            ("previewServerPort", po::value<unsigned int>(&previewServerPort_), "TCP port of the preview server")
+            ("previewServerMaxFps", po::value<unsigned int>(&previewServerMaxFps_), "Max number of frames per second streamed per camera")
+            ("previewServerQuality", po::value<int>(&previewServerQuality_), "JPEG quality of the preview (0-100)")
+            ("previewServerDecimation", po::value<unsigned int>(&previewServerDecimation_), "Only one pixel out of N is streamed in each direction")
+            // ====================================================================================
             // LOGGING
             ("stderrLogging", po::value<int>(&stderrLogging_), "Enable stderr logging (1=on, 0=off)")
             ("stderrLoggingSeverity", po::value<int>(&stderrLoggingSeverity_), "Stderr logging severity (see Google logging documentation)")
@@ -254,11 +292,15 @@ void SquidSettings::load(std::string filename) throw(MyException*) {
             stripLeadingAndEndingQuotes(dc1394_);
             stripLeadingAndEndingQuotes(cameraGuid_);
             stripLeadingAndEndingQuotes(cameraConfigurations_);
+            stripLeadingAndEndingQuotes(triggerSchedules_);
+            stripLeadingAndEndingQuotes(triggerSequenceFile_);
             stripLeadingAndEndingQuotes(playerSettingsFilename_);
+            stripLeadingAndEndingQuotes(externalInputDevice_);
             stripLeadingAndEndingQuotes(experimentName_);
             stripLeadingAndEndingQuotes(experimentEmailSubjectPrefix_);
             stripLeadingAndEndingQuotes(fileLoggingDirectory_);
             stripLeadingAndEndingQuotes(fileLoggingPrefix_);
+            stripLeadingAndEndingQuotes(previewServerAddress_);
 
             if (!boost::filesystem::exists(workingDirectory_) || !boost::filesystem::is_directory(workingDirectory_)) {
                 LOG(WARNING) << "Invalid working directory " << workingDirectory_;
@@ -322,6 +364,23 @@ void SquidSettings::save(std::string filename) throw(MyException*) {
             myfile << "cameraConfigurations = \"" << this->cameraConfigurations_ << "\"" << std::endl;
             myfile << "# Trigger period in milliseconds." << std::endl;
             myfile << "triggerPeriod = " << this->triggerPeriod_ << std::endl;
+            myfile << "# Policy applied when trigger deadlines are missed (0=skip, 1=burst, 2=shift, default: 0)." << std::endl;
+            myfile << "triggerCatchUpPolicy = " << this->triggerCatchUpPolicy_ << std::endl;
+            myfile << "# Trigger period and phase in us of each active camera (period 0 = trigger period)." << std::endl;
+            myfile << "# Example for two interleaved cameras at 30 fps: \"33333:0 33333:16667\"" << std::endl;
+            myfile << "triggerSchedules = \"" << this->triggerSchedules_ << "\"" << std::endl;
+            myfile << "# Only trigger a camera when it signals WaitingForTrigger on GPOut2 (1=on, 0=off, default: 0)." << std::endl;
+            myfile << "triggerGating = " << this->triggerGating_ << std::endl;
+            myfile << "# Stamp the frames with their capture time derived from the FireWire cycle timer (1=on, 0=off, default: 1)." << std::endl;
+            myfile << "cycleTimerCorrelation = " << this->cycleTimerCorrelation_ << std::endl;
+            myfile << "# Number of frames of the burst triggered from the interface (bursts of the playlist states are set in the player)." << std::endl;
+            myfile << "triggerBurstFrames = " << this->triggerBurstFrames_ << std::endl;
+            myfile << "# Interval in us between two triggers of a burst (default interval of the playlist states)." << std::endl;
+            myfile << "triggerBurstInterval = " << this->triggerBurstInterval_ << std::endl;
+            myfile << "# File describing the sequence of trigger times played in loop with the playlist instead of the trigger period (empty = periodic)." << std::endl;
+            myfile << "triggerSequenceFile = \"" << this->triggerSequenceFile_ << "\"" << std::endl;
+            myfile << "# Time in us by which the states of a playlist in frames are applied before their trigger (LED rise time, valve delay)." << std::endl;
+            myfile << "frameLockLeadTime = " << this->frameLockLeadTime_ << std::endl;
             myfile << std::endl;
             myfile << "# ====================================================================================" << std::endl;
             myfile << "# PORT PLAYER" << std::endl;
@@ -329,6 +388,15 @@ void SquidSettings::save(std::string filename) throw(MyException*) {
             myfile << "# Absolute path to the player settings file." << std::endl;
             myfile << "# Example: /home/tschaffter/squid/settings_player.txt" << std::endl;
             myfile << "playerSettingsFilename = \"" << this->playerSettingsFilename_ << "\"" << std::endl;
+            myfile << "# Log the accesses to the port to " << PORT_EVENT_LOG_FILENAME << " in the experiment folder (1=on, 0=off, default: 1)." << std::endl;
+            myfile << "portEventLog = " << this->portEventLog_ << std::endl;
+            myfile << "# Device watched for external input edges: interrupt of the ACK pin of a parallel port (e.g. \"/dev/parport0\")" << std::endl;
+            myfile << "# or rising edges of a GPIO line (e.g. \"/dev/gpiochip0\"). Empty = disabled." << std::endl;
+            myfile << "externalInputDevice = \"" << this->externalInputDevice_ << "\"" << std::endl;
+            myfile << "# GPIO line watched for external input edges (only for GPIO chips)." << std::endl;
+            myfile << "externalInputLine = " << this->externalInputLine_ << std::endl;
+            myfile << "# Action of an external input edge (0=next player state in remote mode, 1=trigger burst, 2=start saving frames)." << std::endl;
+            myfile << "externalInputAction = " << this->externalInputAction_ << std::endl;
             myfile << std::endl;
             myfile << "# ====================================================================================" << std::endl;
             myfile << "# EXPERIMENT" << std::endl;
@@ -348,6 +416,23 @@ void SquidSettings::save(std::string filename) throw(MyException*) {
             myfile << "outputFormat = " << this->outputFormat_ << std::endl;
             myfile << std::endl;
             myfile << "# ====================================================================================" << std::endl;
+            myfile << "# PREVIEW SERVER" << std::endl;
+            myfile << std::endl;
+            myfile << "# Enable the HTTP preview server (1=on, 0=off). Open http://address:port/ in a" << std::endl;
+            myfile << "# browser, the status of the cameras is available at http://address:port/status." << std::endl;
+            myfile << "previewServer = " << this->previewServer_ << std::endl;
+            myfile << "# Address the preview server is bound to (127.0.0.1 = localhost only)." << std::endl;
+            myfile << "previewServerAddress = \"" << this->previewServerAddress_ << "\"" << std::endl;
+            myfile << "# TCP port of the preview server." << std::endl;
+            myfile << "previewServerPort = " << this->previewServerPort_ << std::endl;
+            myfile << "# Max number of frames per second streamed per camera." << std::endl;
+            myfile << "previewServerMaxFps = " << this->previewServerMaxFps_ << std::endl;
+            myfile << "# JPEG quality of the preview (0-100)." << std::endl;
+            myfile << "previewServerQuality = " << this->previewServerQuality_ << std::endl;
+            myfile << "# Decimation of the preview (only one pixel out of N is streamed in each direction)." << std::endl;
+            myfile << "previewServerDecimation = " << this->previewServerDecimation_ << std::endl;
+            myfile << std::endl;
+            myfile << "# ====================================================================================" << std::endl;
             myfile << "# LOGGING" << std::endl;
             myfile << std::endl;
             myfile << "# Enable stderr logging (1=on, 0=off)." << std::endl;
@@ -440,11 +525,65 @@ unsigned int SquidSettings::getOutputFormat() { return outputFormat_; }
 void SquidSettings::setPlayerSettingsFilename(std::string filename) { playerSettingsFilename_ = filename; }
 std::string SquidSettings::getPlayerSettingsFilename() { return playerSettingsFilename_; }
 
+void SquidSettings::setPortEventLog(int enabled) { portEventLog_ = enabled; }
+int SquidSettings::getPortEventLog() { return portEventLog_; }
+
+void SquidSettings::setExternalInputDevice(std::string device) { externalInputDevice_ = device; }
+std::string SquidSettings::getExternalInputDevice() { return externalInputDevice_; }
+
+void SquidSettings::setExternalInputLine(unsigned int line) { externalInputLine_ = line; }
+unsigned int SquidSettings::getExternalInputLine() { return externalInputLine_; }
+
+void SquidSettings::setExternalInputAction(int action) { externalInputAction_ = action; }
+int SquidSettings::getExternalInputAction() { return externalInputAction_; }
+
 void SquidSettings::setTriggerPeriod(unsigned int period) { triggerPeriod_ = period; }
 unsigned int SquidSettings::getTriggerPeriod() { return triggerPeriod_; }
 
+void SquidSettings::setTriggerCatchUpPolicy(unsigned int policy) { triggerCatchUpPolicy_ = policy; }
+unsigned int SquidSettings::getTriggerCatchUpPolicy() { return triggerCatchUpPolicy_; }
+
+void SquidSettings::setTriggerSchedules(std::string schedules) { triggerSchedules_ = schedules; }
+std::string SquidSettings::getTriggerSchedules() { return triggerSchedules_; }
+
+void SquidSettings::setTriggerGating(int enabled) { triggerGating_ = enabled; }
+int SquidSettings::getTriggerGating() { return triggerGating_; }
+
+void SquidSettings::setCycleTimerCorrelation(int enabled) { cycleTimerCorrelation_ = enabled; }
+int SquidSettings::getCycleTimerCorrelation() { return cycleTimerCorrelation_; }
+
+void SquidSettings::setTriggerBurstFrames(unsigned int numFrames) { triggerBurstFrames_ = numFrames; }
+unsigned int SquidSettings::getTriggerBurstFrames() { return triggerBurstFrames_; }
+
+void SquidSettings::setTriggerBurstInterval(unsigned int interval) { triggerBurstInterval_ = interval; }
+unsigned int SquidSettings::getTriggerBurstInterval() { return triggerBurstInterval_; }
+
+void SquidSettings::setTriggerSequenceFile(std::string filename) { triggerSequenceFile_ = filename; }
+std::string SquidSettings::getTriggerSequenceFile() { return triggerSequenceFile_; }
+
+void SquidSettings::setFrameLockLeadTime(unsigned int leadTime) { frameLockLeadTime_ = leadTime; }
+unsigned int SquidSettings::getFrameLockLeadTime() { return frameLockLeadTime_; }
+
 void SquidSettings::setCameraConfigurations(std::string config) { cameraConfigurations_ = config; }
 std::string SquidSettings::getCameraConfigurations() { return cameraConfigurations_; }
 
 void SquidSettings::setDc1394(const std::string dc1394) { dc1394_ = dc1394; }
 std::string SquidSettings::getDc1394() const { return dc1394_; }
+
+void SquidSettings::setPreviewServer(int enabled) { previewServer_ = enabled; }
+int SquidSettings::getPreviewServer() { return previewServer_; }
+
+void SquidSettings::setPreviewServerAddress(std::string address) { previewServerAddress_ = address; }
+std::string SquidSettings::getPreviewServerAddress() { return previewServerAddress_; }
+
+void SquidSettings::setPreviewServerPort(unsigned int port) { previewServerPort_ = port; }
+unsigned int SquidSettings::getPreviewServerPort() { return previewServerPort_; }
+
+void SquidSettings::setPreviewServerMaxFps(unsigned int fps) { previewServerMaxFps_ = fps; }
+unsigned int SquidSettings::getPreviewServerMaxFps() { return previewServerMaxFps_; }
+
+void SquidSettings::setPreviewServerQuality(int quality) { previewServerQuality_ = quality; }
+int SquidSettings::getPreviewServerQuality() { return previewServerQuality_; }
+
+void SquidSettings::setPreviewServerDecimation(unsigned int decimation) { previewServerDecimation_ = decimation; }
+unsigned int SquidSettings::getPreviewServerDecimation() { return previewServerDecimation_; }
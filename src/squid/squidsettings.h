@@ -70,6 +70,22 @@ private:
     std::string cameraConfigurations_;
     /** Trigger period in ms. */
     unsigned int triggerPeriod_;
+    /** Policy applied when trigger deadlines are missed (0 = skip, 1 = burst, 2 = shift). */
+    unsigned int triggerCatchUpPolicy_;
+    /** Trigger period and phase in us of each active camera ("period:phase period:phase ..."). */
+    std::string triggerSchedules_;
+    /** Gates the triggers by the WaitingForTrigger signal of the cameras (1=on, 0=off). */
+    int triggerGating_;
+    /** Stamps the frames with their capture time derived from the FireWire cycle timer (1=on, 0=off). */
+    int cycleTimerCorrelation_;
+    /** Number of frames of the burst triggered from the interface. */
+    unsigned int triggerBurstFrames_;
+    /** Interval in us between two triggers of a burst. */
+    unsigned int triggerBurstInterval_;
+    /** File describing the sequence of trigger times played instead of the trigger period (empty = periodic). */
+    std::string triggerSequenceFile_;
+    /** Time in us by which the states of a frame-locked playlist are applied before their trigger. */
+    unsigned int frameLockLeadTime_;
 
     /** The name of the experiment. */
     std::string experimentName_;
@@ -86,6 +102,27 @@ private:
 
     /** Settings file of the player. */
     std::string playerSettingsFilename_;
+    /** Logs the accesses to the port of the player during the experiments (1=on, 0=off). */
+    int portEventLog_;
+    /** Device watched for external input edges (empty = disabled, parallel port ACK or GPIO chip). */
+    std::string externalInputDevice_;
+    /** GPIO line watched for external input edges. */
+    unsigned int externalInputLine_;
+    /** Action of an external input edge (0 = next player state, 1 = trigger burst, 2 = start saving frames). */
+    int externalInputAction_;
+
+    /** Enables the HTTP preview server. */
+    int previewServer_;
+    /** Address the preview server is bound to. */
+    std::string previewServerAddress_;
+    /** TCP port of the preview server. */
+    unsigned int previewServerPort_;
+    /** Max number of frames per second streamed per camera. */
+    unsigned int previewServerMaxFps_;
+    /** JPEG quality of the preview (0-100). */
+    int previewServerQuality_;
+    /** Decimation factor of the preview. */
+    unsigned int previewServerDecimation_;
 
     /** Enables stderr logging. */
     int stderrLogging_;
@@ -159,6 +196,45 @@ public:
     /** Returns the trigger period in milliseconds. */
     unsigned int getTriggerPeriod();
 
+    /** Sets the policy applied when trigger deadlines are missed (0 = skip, 1 = burst, 2 = shift). */
+    void setTriggerCatchUpPolicy(unsigned int policy);
+    /** Returns the policy applied when trigger deadlines are missed. */
+    unsigned int getTriggerCatchUpPolicy();
+
+    /** Sets the trigger period and phase in us of each active camera ("period:phase period:phase ..."). */
+    void setTriggerSchedules(std::string schedules);
+    /** Returns the trigger period and phase in us of each active camera. */
+    std::string getTriggerSchedules();
+
+    /** Enables the gating of the triggers by the readiness of the cameras (1=on, 0=off). */
+    void setTriggerGating(int enabled);
+    /** Returns 1 if the triggers are gated by the readiness of the cameras. */
+    int getTriggerGating();
+
+    /** Enables stamping the frames with their capture time derived from the cycle timer (1=on, 0=off). */
+    void setCycleTimerCorrelation(int enabled);
+    /** Returns 1 if the frames are stamped with their capture time derived from the cycle timer. */
+    int getCycleTimerCorrelation();
+
+    /** Sets the number of frames of the burst triggered from the interface. */
+    void setTriggerBurstFrames(unsigned int numFrames);
+    /** Returns the number of frames of the burst triggered from the interface. */
+    unsigned int getTriggerBurstFrames();
+    /** Sets the interval in us between two triggers of a burst. */
+    void setTriggerBurstInterval(unsigned int interval);
+    /** Returns the interval in us between two triggers of a burst. */
+    unsigned int getTriggerBurstInterval();
+
+    /** Sets the file describing the sequence of trigger times (empty = periodic). */
+    void setTriggerSequenceFile(std::string filename);
+    /** Returns the file describing the sequence of trigger times. */
+    std::string getTriggerSequenceFile();
+
+    /** Sets the time in us by which the states of a frame-locked playlist are applied before their trigger. */
+    void setFrameLockLeadTime(unsigned int leadTime);
+    /** Returns the time in us by which the states of a frame-locked playlist are applied before their trigger. */
+    unsigned int getFrameLockLeadTime();
+
     /**
      * EXPERIMENT
      */
@@ -200,6 +276,57 @@ public:
     /** Returns the absolute path to the player settings file. */
     std::string getPlayerSettingsFilename();
 
+    /** Enables the log of the accesses to the port during the experiments (1=on, 0=off). */
+    void setPortEventLog(int enabled);
+    /** Returns 1 if the accesses to the port are logged during the experiments. */
+    int getPortEventLog();
+
+    /** Sets the device watched for external input edges (empty = disabled). */
+    void setExternalInputDevice(std::string device);
+    /** Returns the device watched for external input edges. */
+    std::string getExternalInputDevice();
+    /** Sets the GPIO line watched for external input edges. */
+    void setExternalInputLine(unsigned int line);
+    /** Returns the GPIO line watched for external input edges. */
+    unsigned int getExternalInputLine();
+    /** Sets the action of an external input edge (0 = next player state, 1 = trigger burst, 2 = start saving frames). */
+    void setExternalInputAction(int action);
+    /** Returns the action of an external input edge. */
+    int getExternalInputAction();
+
+    /**
+     * PREVIEW SERVER
+     */
+    /** Enables (1) or disables (0) the HTTP preview server. */
+    void setPreviewServer(int enabled);
+    /** Returns 1 if the HTTP preview server is enabled. */
+    int getPreviewServer();
+
+    /** Sets the address the preview server is bound to. */
+    void setPreviewServerAddress(std::string address);
+    /** Returns the address the preview server is bound to. */
+    std::string getPreviewServerAddress();
+
+    /** Sets the TCP port of the preview server. */
+    void setPreviewServerPort(unsigned int port);
+    /** Returns the TCP port of the preview server. */
+    unsigned int getPreviewServerPort();
+
+    /** Sets the max number of frames per second streamed per camera. */
+    void setPreviewServerMaxFps(unsigned int fps);
+    /** Returns the max number of frames per second streamed per camera. */
+    unsigned int getPreviewServerMaxFps();
+
+    /** Sets the JPEG quality of the preview. */
+    void setPreviewServerQuality(int quality);
+    /** Returns the JPEG quality of the preview. */
+    int getPreviewServerQuality();
+
+    /** Sets the decimation factor of the preview. */
+    void setPreviewServerDecimation(unsigned int decimation);
+    /** Returns the decimation factor of the preview. */
+    unsigned int getPreviewServerDecimation();
+
     /**
      * LOGGING
      */
@@ -256,16 +383,6 @@ public:
     /** Returns the icon of the application window. */
     QIcon getApplicationWindowIcon();
 
-    /** Sets the absolute path to the player settings file. */
-    void setParallelPortLogFilename(std::string filename);
-    /** Returns the absolute path to the player settings file. */
-    std::string getParallelPortLogFilename();
-
-    /** Sets the stream to the player log file. */
-    void setParallelPortLog(std::ofstream* stream);
-    /** Returns the stream to the player log file. */
-    std::ofstream* getParallelPortLog();
-
     /** Sets DC1394 mode. */
     void setDc1394(const std::string dc1394);
     /** Returns DC1394 mode. */
@@ -36,6 +36,7 @@ FdTimer::FdTimer() {
 
     timer_ = 0;
     running_ = false;
+    absolute_ = false;
 }
 
 // ----------------------------------------------------------------------
@@ -54,7 +55,7 @@ void FdTimer::start() throw(MyException*) {
     if ((timer_ = timerfd_create(CLOCK_MONOTONIC, 0)) < 0)
         throw new MyException("Unable to start timer: timerfd_create() failed.");
 
-    if (timerfd_settime(timer_, 0, &timerSpec_, NULL) < 0)
+    if (timerfd_settime(timer_, absolute_ ? TFD_TIMER_ABSTIME : 0, &timerSpec_, NULL) < 0)
         throw new MyException("Unable to start timer: timerfd_settime() failed.");
 
     running_ = true;
@@ -62,6 +63,17 @@ void FdTimer::start() throw(MyException*) {
 
 // ----------------------------------------------------------------------
 
+void FdTimer::update() throw(MyException*) {
+
+    if (!running_)
+        throw new MyException("Unable to update timer: Timer is not running.");
+
+    if (timerfd_settime(timer_, absolute_ ? TFD_TIMER_ABSTIME : 0, &timerSpec_, NULL) < 0)
+        throw new MyException("Unable to update timer: timerfd_settime() failed.");
+}
+
+// ----------------------------------------------------------------------
+
 void FdTimer::stop() throw(MyException*) {
 
     if (!running_)
@@ -125,4 +137,7 @@ void FdTimer::setValue(time_t sec, long nsec) {
 
 bool FdTimer::isRunning() { return running_; }
 
+void FdTimer::setAbsolute(bool absolute) { absolute_ = absolute; }
+bool FdTimer::isAbsolute() { return absolute_; }
+
 int FdTimer::getTimer() { return timer_; }
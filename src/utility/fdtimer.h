@@ -49,6 +49,8 @@ private:
 
     /** Is true if the timer is running. */
     bool running_;
+    /** If true, the first expiration is an absolute time on CLOCK_MONOTONIC (TFD_TIMER_ABSTIME). */
+    bool absolute_;
 
 public:
 
@@ -61,6 +63,8 @@ public:
     void start() throw(MyException*);
     /** Stops the timer. */
     void stop() throw(MyException*);
+    /** Re-arms the running timer with the current interval and value. */
+    void update() throw(MyException*);
 
     /** Initializes the timer with sec and nsec. */
     void initialize(time_t sec, long nsec) throw(MyException*);
@@ -69,9 +73,13 @@ public:
     void setInterval(time_t sec, long nsec);
     /** Set the first experiation in sec and nsec. */
     void setValue(time_t sec, long nsec);
+    /** If true, the value set is an absolute time on CLOCK_MONOTONIC. */
+    void setAbsolute(bool absolute);
 
     /** Returns true if the timer is running. */
     bool isRunning();
+    /** Returns true if the value set is an absolute time. */
+    bool isAbsolute();
 
     /** Get the file descriptor returned by timerfd_create(). */
     int getTimer();
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef LOCKFREEQUEUE_H
+#define LOCKFREEQUEUE_H
+
+/**
+ * \brief Bounded single-producer single-consumer queue without lock.
+ *
+ * push() and pop() never block nor allocate, so that a realtime thread can
+ * pass data to a normal-priority thread. Only one thread may push and only
+ * one thread may pop. The capacity N must be a power of two; the queue holds
+ * at most N - 1 elements.
+ *
+ * @version March 10, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+template<typename T, unsigned int N>
+class LockFreeQueue {
+
+private:
+
+    /** Elements of the queue. */
+    T elements_[N];
+    /** Index of the next element to write (modified by the producer only). */
+    volatile unsigned int head_;
+    /** Index of the next element to read (modified by the consumer only). */
+    volatile unsigned int tail_;
+
+public:
+
+    /** Constructor. */
+    LockFreeQueue() : head_(0), tail_(0) {}
+
+    /** Pushes an element, returns false if the queue is full (producer only). */
+    bool push(const T& element) {
+
+        const unsigned int head = head_;
+        const unsigned int next = (head + 1) & (N - 1);
+        if (next == tail_)
+            return false;
+        elements_[head] = element;
+        __sync_synchronize(); // the element must be written before it is published
+        head_ = next;
+        return true;
+    }
+
+    /** Pops an element, returns false if the queue is empty (consumer only). */
+    bool pop(T& element) {
+
+        const unsigned int tail = tail_;
+        if (tail == head_)
+            return false;
+        __sync_synchronize(); // the element must be read after head_
+        element = elements_[tail];
+        __sync_synchronize(); // the element must be read before the slot is released
+        tail_ = (tail + 1) & (N - 1);
+        return true;
+    }
+
+    /** Returns true if the queue is empty. */
+    bool isEmpty() { return head_ == tail_; }
+
+    /** Removes all the elements (must not be called while pushing or popping). */
+    void clear() { head_ = 0; tail_ = 0; }
+};
+
+#endif // LOCKFREEQUEUE_H
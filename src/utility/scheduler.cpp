@@ -0,0 +1,428 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "scheduler.h"
+#include "rt.h"
+#include "sharedclock.h"
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <glog/logging.h>
+
+Scheduler* Scheduler::instance_ = NULL;
+
+// ======================================================================
+// PRIVATE METHODS
+
+Scheduler::Scheduler() {
+
+    nextTaskId_ = 0;
+
+    for (unsigned int l = 0; l < SCHEDULER_NUM_LANES; l++) {
+        Lane* lane = &lanes_[l];
+        lane->index_ = l;
+        lane->running_ = false;
+        lane->abort_ = false;
+        lane->numWakeups_ = 0;
+        lane->numMissedDeadlines_ = 0;
+        for (unsigned int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+            lane->tasks_[i].id_ = -1;
+            lane->tasks_[i].running_ = false;
+            lane->tasks_[i].wake_ = 0;
+        }
+        if ((lane->wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+            throw new MyException("Unable to create scheduler wake-up eventfd.");
+        if (pthread_mutex_init(&lane->mutex_, NULL) == -1)
+            throw new MyException("Unable to pthread_mutex_init().");
+        if (pthread_cond_init(&lane->cond_, NULL) == -1)
+            throw new MyException("Unable to pthread_cond_init().");
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void Scheduler::startLane(Lane* lane) throw(MyException*) {
+
+    lane->abort_ = false;
+
+    // the timer is disarmed until a deadline is set
+    lane->timer_.setAbsolute(true);
+    lane->timer_.setInterval(0, 0);
+    lane->timer_.setValue(0, 0);
+    lane->timer_.start();
+
+    if (pthread_create(&lane->thread_, 0, Scheduler::processLane, lane))
+        throw new MyException("Unable to start scheduler thread: pthread_create() failed.");
+
+    lane->running_ = true;
+}
+
+// ----------------------------------------------------------------------
+
+void Scheduler::armLane(Lane* lane) throw(MyException*) {
+
+    uint64_t deadline = 0;
+    for (unsigned int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+        const Task& task = lane->tasks_[i];
+        if (task.id_ >= 0 && (deadline == 0 || task.deadlineInNs_ < deadline))
+            deadline = task.deadlineInNs_;
+    }
+
+    // a value of 0 disarms the timer, a deadline already passed expires immediately
+    lane->timer_.setValue(deadline / 1000000000, deadline % 1000000000);
+    lane->timer_.update();
+}
+
+// ----------------------------------------------------------------------
+
+int Scheduler::registerTask(lane l, SchedulerCallback callback, void* data, uint64_t periodInNs, uint64_t deadlineInNs) throw(MyException*) {
+
+    if (l < 0 || l >= SCHEDULER_NUM_LANES)
+        throw new MyException("Unable to register task: invalid lane.");
+    if (callback == NULL)
+        throw new MyException("Unable to register task: callback is null.");
+
+    Lane* lane = &lanes_[l];
+    const int id = __sync_fetch_and_add(&nextTaskId_, 1);
+
+    pthread_mutex_lock(&lane->mutex_);
+    Task* task = NULL;
+    for (unsigned int i = 0; i < SCHEDULER_MAX_TASKS && task == NULL; i++) {
+        if (lane->tasks_[i].id_ < 0 && !lane->tasks_[i].running_)
+            task = &lane->tasks_[i];
+    }
+    if (task == NULL) {
+        pthread_mutex_unlock(&lane->mutex_);
+        throw new MyException("Unable to register task: too many tasks on the lane.");
+    }
+
+    task->callback_ = callback;
+    task->data_ = data;
+    task->periodInNs_ = periodInNs;
+    task->deadlineInNs_ = deadlineInNs;
+    task->wake_ = 0;
+    task->id_ = id;
+
+    try {
+        if (!lane->running_)
+            startLane(lane);
+        armLane(lane);
+    } catch (MyException* e) {
+        task->id_ = -1;
+        pthread_mutex_unlock(&lane->mutex_);
+        throw e;
+    }
+    pthread_mutex_unlock(&lane->mutex_);
+
+    return id;
+}
+
+// ----------------------------------------------------------------------
+
+void* Scheduler::processLane(void* obj) {
+
+    Lane* lane = reinterpret_cast<Lane*>(obj);
+
+    if (lane->index_ == RT_LANE) {
+        LOG(INFO) << "Promoting scheduler RT lane to RT priority.";
+        promoteRT();
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd = lane->timer_.getTimer();
+    fds[0].events = POLLIN;
+    fds[1].fd = lane->wakeFd_;
+    fds[1].events = POLLIN;
+
+    pthread_mutex_lock(&lane->mutex_);
+    while (!lane->abort_) {
+        pthread_mutex_unlock(&lane->mutex_);
+
+        // sleeps until the earliest deadline (forever if no task is registered)
+        // or until a task is woken up by wakeTask()
+        if (poll(fds, 2, -1) > 0) {
+            uint64_t count;
+            for (unsigned int f = 0; f < 2; f++) {
+                if (fds[f].revents & POLLIN)
+                    read(fds[f].fd, &count, sizeof(count));
+            }
+        }
+
+        pthread_mutex_lock(&lane->mutex_);
+        lane->numWakeups_++;
+
+        for (unsigned int i = 0; i < SCHEDULER_MAX_TASKS && !lane->abort_; i++) {
+            Task* task = &lane->tasks_[i];
+            if (task->id_ < 0)
+                continue;
+            const bool due = task->deadlineInNs_ <= SharedClock::getMonotonicTimeInNs();
+            const bool woken = __sync_lock_test_and_set(&task->wake_, 0) != 0;
+            if (!due && !woken)
+                continue;
+
+            // run the task without holding the lock
+            const int id = task->id_;
+            const uint64_t deadline = task->deadlineInNs_;
+            task->running_ = true;
+            pthread_mutex_unlock(&lane->mutex_);
+
+            bool keep = false;
+            try {
+                keep = task->callback_(task->data_);
+            } catch (MyException* e) {
+                LOG(WARNING) << "Scheduler task " << id << " failed: " << e->getMessage();
+            }
+
+            pthread_mutex_lock(&lane->mutex_);
+            task->running_ = false;
+            if (task->id_ == id) { // the task has not been removed meanwhile
+                // a one-shot task is kept only if it has moved its deadline (setTaskDeadline())
+                // or if it has been woken up before its deadline
+                if (!keep || (task->periodInNs_ == 0 && due && task->deadlineInNs_ == deadline))
+                    task->id_ = -1;
+                else if (task->periodInNs_ > 0 && due) {
+                    task->deadlineInNs_ += task->periodInNs_;
+                    const uint64_t now = SharedClock::getMonotonicTimeInNs();
+                    if (task->deadlineInNs_ <= now) {
+                        // skip the deadlines already missed
+                        const uint64_t numMissed = (now - task->deadlineInNs_) / task->periodInNs_ + 1;
+                        task->deadlineInNs_ += numMissed * task->periodInNs_;
+                        lane->numMissedDeadlines_ += numMissed;
+                    }
+                }
+            }
+            pthread_cond_broadcast(&lane->cond_);
+        }
+
+        if (!lane->abort_) {
+            try {
+                armLane(lane);
+            } catch (MyException* e) {
+                LOG(WARNING) << "Unable to arm scheduler lane " << lane->index_ << ": " << e->getMessage();
+            }
+        }
+    }
+
+    lane->running_ = false;
+    pthread_mutex_unlock(&lane->mutex_);
+
+    return NULL;
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+Scheduler* Scheduler::getInstance() {
+
+    if (instance_ == NULL)
+        instance_ = new Scheduler();
+
+    return instance_;
+}
+
+// ----------------------------------------------------------------------
+
+Scheduler::~Scheduler() {
+
+    stop();
+
+    for (unsigned int l = 0; l < SCHEDULER_NUM_LANES; l++) {
+        if (pthread_cond_destroy(&lanes_[l].cond_) == -1)
+            throw new MyException("Unable to pthread_cond_destroy().");
+        if (pthread_mutex_destroy(&lanes_[l].mutex_) == -1)
+            throw new MyException("Unable to pthread_mutex_destroy().");
+        close(lanes_[l].wakeFd_);
+    }
+}
+
+// ----------------------------------------------------------------------
+
+int Scheduler::addTask(lane l, SchedulerCallback callback, void* data, long periodInUs) throw(MyException*) {
+
+    if (periodInUs <= 0)
+        throw new MyException("Unable to register task: period must be positive.");
+
+    const uint64_t periodInNs = (uint64_t)periodInUs * 1000;
+    return registerTask(l, callback, data, periodInNs, SharedClock::getMonotonicTimeInNs() + periodInNs);
+}
+
+// ----------------------------------------------------------------------
+
+int Scheduler::addOneShotTask(lane l, SchedulerCallback callback, void* data, long delayInUs) throw(MyException*) {
+
+    if (delayInUs < 0)
+        throw new MyException("Unable to register task: delay must be positive.");
+
+    return registerTask(l, callback, data, 0, SharedClock::getMonotonicTimeInNs() + (uint64_t)delayInUs * 1000);
+}
+
+// ----------------------------------------------------------------------
+
+int Scheduler::addDeadlineTask(lane l, SchedulerCallback callback, void* data, uint64_t deadlineInNs) throw(MyException*) {
+
+    if (deadlineInNs == 0)
+        throw new MyException("Unable to register task: deadline must be positive.");
+
+    return registerTask(l, callback, data, 0, deadlineInNs);
+}
+
+// ----------------------------------------------------------------------
+
+void Scheduler::setTaskDeadline(int id, uint64_t deadlineInNs) throw(MyException*) {
+
+    if (id < 0)
+        return;
+    if (deadlineInNs == 0)
+        throw new MyException("Unable to set task deadline: deadline must be positive.");
+
+    for (unsigned int l = 0; l < SCHEDULER_NUM_LANES; l++) {
+        Lane* lane = &lanes_[l];
+        pthread_mutex_lock(&lane->mutex_);
+        for (unsigned int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+            Task* task = &lane->tasks_[i];
+            if (task->id_ != id)
+                continue;
+
+            task->deadlineInNs_ = deadlineInNs;
+            try {
+                // the lane rearms itself after running its tasks
+                if (!task->running_)
+                    armLane(lane);
+            } catch (MyException* e) {
+                pthread_mutex_unlock(&lane->mutex_);
+                throw e;
+            }
+            pthread_mutex_unlock(&lane->mutex_);
+            return;
+        }
+        pthread_mutex_unlock(&lane->mutex_);
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void Scheduler::wakeTask(int id) {
+
+    if (id < 0)
+        return;
+
+    for (unsigned int l = 0; l < SCHEDULER_NUM_LANES; l++) {
+        Lane* lane = &lanes_[l];
+        for (unsigned int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+            if (lane->tasks_[i].id_ != id)
+                continue;
+
+            __sync_lock_test_and_set(&lane->tasks_[i].wake_, 1);
+            const uint64_t one = 1;
+            write(lane->wakeFd_, &one, sizeof(one));
+            return;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------
+
+void Scheduler::removeTask(int id) throw(MyException*) {
+
+    if (id < 0)
+        return;
+
+    for (unsigned int l = 0; l < SCHEDULER_NUM_LANES; l++) {
+        Lane* lane = &lanes_[l];
+        pthread_mutex_lock(&lane->mutex_);
+        for (unsigned int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+            Task* task = &lane->tasks_[i];
+            if (task->id_ != id)
+                continue;
+
+            task->id_ = -1;
+            // a task removing itself (or a task of the same lane) can not be running
+            if (!lane->running_ || !pthread_equal(pthread_self(), lane->thread_)) {
+                while (task->running_) {
+                    if (pthread_cond_wait(&lane->cond_, &lane->mutex_))
+                        throw new MyException("Unable to remove task: pthread_cond_wait() failed.");
+                }
+            }
+            pthread_mutex_unlock(&lane->mutex_);
+            return;
+        }
+        pthread_mutex_unlock(&lane->mutex_);
+    }
+}
+
+// ----------------------------------------------------------------------
+
+bool Scheduler::isLaneThread(lane l) {
+
+    const Lane* lane = &lanes_[l];
+    return lane->running_ && pthread_equal(pthread_self(), lane->thread_);
+}
+
+// ----------------------------------------------------------------------
+
+void Scheduler::stop() throw(MyException*) {
+
+    for (unsigned int l = 0; l < SCHEDULER_NUM_LANES; l++) {
+        Lane* lane = &lanes_[l];
+        pthread_mutex_lock(&lane->mutex_);
+        if (!lane->running_) {
+            pthread_mutex_unlock(&lane->mutex_);
+            continue;
+        }
+        lane->abort_ = true;
+        // expire the timer immediately to wake up the thread
+        lane->timer_.setValue(0, 1);
+        lane->timer_.update();
+        pthread_mutex_unlock(&lane->mutex_);
+
+        pthread_join(lane->thread_, NULL);
+        lane->timer_.stop();
+
+        pthread_mutex_lock(&lane->mutex_);
+        for (unsigned int i = 0; i < SCHEDULER_MAX_TASKS; i++)
+            lane->tasks_[i].id_ = -1;
+        pthread_mutex_unlock(&lane->mutex_);
+    }
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+unsigned int Scheduler::getNumTasks(lane l) {
+
+    unsigned int numTasks = 0;
+    pthread_mutex_lock(&lanes_[l].mutex_);
+    for (unsigned int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+        if (lanes_[l].tasks_[i].id_ >= 0)
+            numTasks++;
+    }
+    pthread_mutex_unlock(&lanes_[l].mutex_);
+
+    return numTasks;
+}
+
+unsigned int Scheduler::getNumWakeups(lane l) { return lanes_[l].numWakeups_; }
+unsigned int Scheduler::getNumMissedDeadlines(lane l) { return lanes_[l].numMissedDeadlines_; }
@@ -0,0 +1,183 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "fdtimer.h"
+#include "myexception.h"
+#include <pthread.h>
+#include <stdint.h>
+
+/** Maximum number of tasks registered on one lane. */
+#define SCHEDULER_MAX_TASKS 64
+/** Number of lanes (RT and non-RT). */
+#define SCHEDULER_NUM_LANES 2
+
+/** Function run by the scheduler, returns false to unregister the task. */
+typedef bool (*SchedulerCallback)(void* data);
+
+/**
+ * \brief Runs periodic and one-shot tasks from a small number of shared threads.
+ *
+ * Instead of having each component owning a thread and a timerfd, tasks are
+ * registered on one of two lanes. The RT lane runs in a thread promoted to
+ * real-time priority and is reserved to short tasks which never wait for a
+ * non-RT thread (playlist, PWM). The non-RT lane runs everything else (frame
+ * writer, FPS evaluators, experiment time). Each lane owns a single timerfd armed on the absolute time of
+ * its earliest deadline, so that the lane only wakes up when a task is due and
+ * sleeps without timeout when no task is registered. Lanes are started the
+ * first time a task is registered on them.
+ *
+ * A task must not block: all tasks of a lane are run one after the other.
+ * A periodic task that falls behind skips the deadlines already missed.
+ * A deadline task is run at an absolute time and stays registered as long as
+ * it returns true after having moved its deadline with setTaskDeadline().
+ * A task can be run before its deadline with wakeTask(), which takes no lock
+ * and can therefore be called from a real-time callback.
+ *
+ * @version March 18, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class Scheduler {
+
+public:
+
+    /** Lanes. */
+    enum lane {
+        RT_LANE = 0,
+        NON_RT_LANE = 1
+    };
+
+private:
+
+    /** Task registered on a lane. */
+    struct Task {
+        /** Id returned by addTask(), -1 if the slot is free. */
+        int id_;
+        /** Function to run. */
+        SchedulerCallback callback_;
+        /** Data given to the callback. */
+        void* data_;
+        /** Period in ns, 0 for a one-shot task. */
+        uint64_t periodInNs_;
+        /** Next deadline in ns on CLOCK_MONOTONIC. */
+        uint64_t deadlineInNs_;
+        /** Is true while the callback is running. */
+        bool running_;
+        /** Sets to 1 by wakeTask() to run the task before its deadline. */
+        volatile int wake_;
+    };
+
+    /** Thread, timer and tasks of one lane. */
+    struct Lane {
+        /** Index of the lane. */
+        int index_;
+        /** Mutex protecting the tasks. */
+        pthread_mutex_t mutex_;
+        /** Signaled each time a task returns. */
+        pthread_cond_t cond_;
+        /** Id returned by pthread_create(). */
+        pthread_t thread_;
+        /** One-shot timer armed on the earliest deadline. */
+        FdTimer timer_;
+        /** Eventfd written by wakeTask() to wake up the thread of the lane. */
+        int wakeFd_;
+        /** Is true if the thread of the lane is running. */
+        bool running_;
+        /** Sets to true to stop the thread of the lane. */
+        bool abort_;
+        /** Registered tasks. */
+        Task tasks_[SCHEDULER_MAX_TASKS];
+        /** Number of times the lane woke up. */
+        unsigned int numWakeups_;
+        /** Number of deadlines skipped by periodic tasks. */
+        unsigned int numMissedDeadlines_;
+    };
+
+    /**
+     * Singleton instance. Declared as a class member so that libraries
+     * including utility share the instance of the application.
+     */
+    static Scheduler* instance_;
+
+    /** Lanes. */
+    Lane lanes_[SCHEDULER_NUM_LANES];
+    /** Id given to the next task registered. */
+    int nextTaskId_;
+
+    /** Constructor. */
+    Scheduler();
+
+    /** Starts the thread of the lane (lane mutex must be held). */
+    void startLane(Lane* lane) throw(MyException*);
+    /** Arms the timer of the lane on its earliest deadline (lane mutex must be held). */
+    static void armLane(Lane* lane) throw(MyException*);
+    /** Registers a task first run at deadlineInNs (CLOCK_MONOTONIC), then every periodInNs if not 0. */
+    int registerTask(lane l, SchedulerCallback callback, void* data, uint64_t periodInNs, uint64_t deadlineInNs) throw(MyException*);
+
+    /**
+     * This is the static class function that serves as a C style function pointer
+     * for the pthread_create call.
+     */
+    static void* processLane(void* obj);
+
+public:
+
+    /** Returns the singleton instance. */
+    static Scheduler* getInstance();
+    /** Destructor. */
+    ~Scheduler();
+
+    /** Registers a periodic task, returns its id. The first run occurs after one period. */
+    int addTask(lane l, SchedulerCallback callback, void* data, long periodInUs) throw(MyException*);
+    /** Registers a task run once after delayInUs (0 to run it as soon as possible), returns its id. */
+    int addOneShotTask(lane l, SchedulerCallback callback, void* data, long delayInUs) throw(MyException*);
+    /** Registers a task run at the absolute time deadlineInNs on CLOCK_MONOTONIC, returns its id. */
+    int addDeadlineTask(lane l, SchedulerCallback callback, void* data, uint64_t deadlineInNs) throw(MyException*);
+    /** Moves the next deadline of a task, e.g. from the task itself to run again at a given time. */
+    void setTaskDeadline(int id, uint64_t deadlineInNs) throw(MyException*);
+    /** Runs a task as soon as possible without moving its deadline. Doesn't block nor allocate. */
+    void wakeTask(int id);
+    /**
+     * Unregisters a task. If the task is running, waits until it returns
+     * (unless called from the task itself).
+     */
+    void removeTask(int id) throw(MyException*);
+    /** Returns true if called from the thread of the given lane. */
+    bool isLaneThread(lane l);
+    /** Stops the threads of all lanes. Tasks still registered are dropped. */
+    void stop() throw(MyException*);
+
+    /** Returns the number of tasks registered on a lane. */
+    unsigned int getNumTasks(lane l);
+    /** Returns the number of times a lane woke up. */
+    unsigned int getNumWakeups(lane l);
+    /** Returns the number of deadlines skipped by the periodic tasks of a lane. */
+    unsigned int getNumMissedDeadlines(lane l);
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,185 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "sharedclock.h"
+#include "myexception.h"
+#include <time.h>
+
+// ======================================================================
+// PRIVATE METHODS
+
+void SharedClock::beginWrite() {
+
+    sequence_++;
+    __sync_synchronize(); // the sequence must be odd before the clock is modified
+}
+
+// ----------------------------------------------------------------------
+
+void SharedClock::endWrite() {
+
+    __sync_synchronize(); // the clock must be modified before the sequence is even again
+    sequence_++;
+}
+
+// ======================================================================
+// PUBLIC METHODS
+
+SharedClock::SharedClock() {
+
+    if (pthread_mutex_init(&mutex_, NULL) == -1)
+        throw new MyException("Unable to pthread_mutex_init().");
+
+    sequence_ = 0;
+    initialize();
+}
+
+// ----------------------------------------------------------------------
+
+SharedClock::~SharedClock() {
+
+    if (pthread_mutex_destroy(&mutex_) == -1)
+        throw new MyException("Unable to pthread_mutex_destroy().");
+}
+
+// ----------------------------------------------------------------------
+
+void SharedClock::initialize() {
+
+    pthread_mutex_lock(&mutex_);
+    beginWrite();
+    baseInNs_ = 0;
+    pauseOffsetInNs_ = 0;
+    frozenInNs_ = 0;
+    endWrite();
+    running_ = false;
+    pauseDepth_ = 0;
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
+void SharedClock::start() {
+
+    pthread_mutex_lock(&mutex_);
+    beginWrite();
+    baseInNs_ = getMonotonicTimeInNs();
+    pauseOffsetInNs_ = 0;
+    frozenInNs_ = 0;
+    endWrite();
+    running_ = true;
+    pauseDepth_ = 0;
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
+void SharedClock::stop() {
+
+    pthread_mutex_lock(&mutex_);
+    if (running_) {
+        // if paused, the clock stays frozen at the beginning of the pause
+        if (frozenInNs_ == 0) {
+            beginWrite();
+            frozenInNs_ = getMonotonicTimeInNs();
+            endWrite();
+        }
+        running_ = false;
+    }
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
+void SharedClock::pause(bool pause) {
+
+    pthread_mutex_lock(&mutex_);
+    if (running_) {
+        if (pause && pauseDepth_++ == 0) {
+            beginWrite();
+            frozenInNs_ = getMonotonicTimeInNs();
+            endWrite();
+        }
+        else if (!pause && pauseDepth_ > 0 && --pauseDepth_ == 0) {
+            beginWrite();
+            pauseOffsetInNs_ += getMonotonicTimeInNs() - frozenInNs_;
+            frozenInNs_ = 0;
+            endWrite();
+        }
+    }
+    pthread_mutex_unlock(&mutex_);
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t SharedClock::getElapsedTimeInNs() {
+
+    return toElapsedTimeInNs(getMonotonicTimeInNs());
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t SharedClock::toElapsedTimeInNs(uint64_t monotonicTimeInNs) {
+
+    unsigned int sequence;
+    uint64_t base;
+    uint64_t offset;
+    uint64_t frozen;
+    do {
+        sequence = sequence_;
+        __sync_synchronize(); // the clock must be read after the sequence
+        base = baseInNs_;
+        offset = pauseOffsetInNs_;
+        frozen = frozenInNs_;
+        __sync_synchronize(); // the clock must be read before checking the sequence again
+    } while ((sequence & 1) || sequence != sequence_);
+
+    if (frozen != 0 && monotonicTimeInNs > frozen)
+        monotonicTimeInNs = frozen;
+    if (base == 0 || monotonicTimeInNs < base + offset)
+        return 0;
+
+    return monotonicTimeInNs - base - offset;
+}
+
+// ----------------------------------------------------------------------
+
+uint64_t SharedClock::getMonotonicTimeInNs() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// ======================================================================
+// GETTERS AND SETTERS
+
+uint64_t SharedClock::getElapsedTimeInUs() { return getElapsedTimeInNs() / 1000; }
+double SharedClock::getElapsedTimeInMs() { return getElapsedTimeInNs() / 1000000.; }
+uint64_t SharedClock::getPauseOffsetInNs() { return pauseOffsetInNs_; }
+
+bool SharedClock::isRunning() { return running_; }
+bool SharedClock::isPaused() { return pauseDepth_ > 0; }
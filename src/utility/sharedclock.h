@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2010-2012 Thomas Schaffter (thomas.schaff...@gmail.com)
+ *
+ * We release this software open source under a Creative Commons Attribution-
+ * NonCommercial 3.0 Unported License. Please cite the papers listed on
+ * http://tschaffter.ch/projects/squid/ when using sQuid in your publication.
+ *
+ * For commercial use, please contact Thomas Schaffter.
+ *
+ * A brief description of the license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/
+ *
+ * The full license is available at:
+ * http://creativecommons.org/licenses/by-nc/3.0/legalcode
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SHAREDCLOCK_H
+#define SHAREDCLOCK_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+/**
+ * \brief Pausable clock read concurrently by several threads without lock.
+ *
+ * The clock counts the nanoseconds elapsed on CLOCK_MONOTONIC since start(),
+ * minus the time spent in pause. Readers never block: the state of the clock
+ * is protected by a seqlock, i.e. a sequence number incremented before and
+ * after each update, and a reader retries if the sequence number was odd or
+ * has changed while reading. Writers (start, stop, pause) are serialized by a
+ * mutex.
+ *
+ * Pauses can be nested so that several components (e.g. the experiment and
+ * the playlist) sharing the same clock can pause it independently. The
+ * clock runs again when all of them have resumed it.
+ *
+ * @version March 15, 2012
+ * @author Thomas Schaffter (thomas.schaff...@gmail.com)
+ */
+class SharedClock {
+
+private:
+
+    /** Sequence number, odd while the clock is being updated. */
+    volatile unsigned int sequence_;
+    /** Monotonic time in ns when the clock started, 0 if never started. */
+    volatile uint64_t baseInNs_;
+    /** Total time in ns spent in pause. */
+    volatile uint64_t pauseOffsetInNs_;
+    /** Monotonic time in ns when the clock was paused or stopped, 0 if the clock is running. */
+    volatile uint64_t frozenInNs_;
+
+    /** Is true between start() and stop(). */
+    bool running_;
+    /** Number of pause(true) not yet resumed. */
+    unsigned int pauseDepth_;
+    /** Mutex serializing the writers. */
+    pthread_mutex_t mutex_;
+
+    /** Begins an update of the clock (mutex must be held). */
+    void beginWrite();
+    /** Ends an update of the clock (mutex must be held). */
+    void endWrite();
+
+public:
+
+    /** Constructor. */
+    SharedClock();
+    /** Destructor. */
+    ~SharedClock();
+
+    /** Resets the clock to zero (stopped). */
+    void initialize();
+    /** Starts the clock from zero. */
+    void start();
+    /** Stops the clock, the elapsed time is then frozen. */
+    void stop();
+    /** Pauses or resumes the clock. */
+    void pause(bool pause);
+
+    /** Returns the elapsed time in ns, excluding pauses. */
+    uint64_t getElapsedTimeInNs();
+    /** Returns the elapsed time in us, excluding pauses. */
+    uint64_t getElapsedTimeInUs();
+    /** Returns the elapsed time in ms, excluding pauses. */
+    double getElapsedTimeInMs();
+    /**
+     * Converts a time in ns on CLOCK_MONOTONIC to the elapsed time of the clock
+     * (0 if before the start, frozen during a pause or after stop).
+     */
+    uint64_t toElapsedTimeInNs(uint64_t monotonicTimeInNs);
+    /** Returns the total time in ns spent in pause. */
+    uint64_t getPauseOffsetInNs();
+
+    /** Returns true if the clock is started and not stopped. */
+    bool isRunning();
+    /** Returns true if the clock is paused. */
+    bool isPaused();
+
+    /** Returns the current time in ns on CLOCK_MONOTONIC. */
+    static uint64_t getMonotonicTimeInNs();
+};
+
+#endif // SHAREDCLOCK_H
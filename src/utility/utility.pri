@@ -2,11 +2,16 @@ SOURCES += myexception.cpp \
     myutility.cpp \
     fdtimer.cpp \
     highresolutiontime.cpp \
+    scheduler.cpp \
+    sharedclock.cpp \
     ../utility/rt.cpp
 HEADERS += myexception.h \
     myutility.h \
     fdtimer.h \
     highresolutiontime.h \
+    lockfreequeue.h \
+    scheduler.h \
+    sharedclock.h \
     ../utility/rt.h
 
 